@@ -0,0 +1,56 @@
+#include "AllocationCounter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+    // Constant initialised, so allocations made while other statics are constructed are counted safely
+    std::atomic<uint64_t> s_nAllocations{0};
+} // namespace
+
+namespace AllocationCounter
+{
+    void Count()
+    {
+        s_nAllocations.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    bool IsCounting()
+    {
+#ifdef ONFS_COUNT_ALLOCATIONS
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    uint64_t GetCount()
+    {
+        return s_nAllocations.load(std::memory_order_relaxed);
+    }
+} // namespace AllocationCounter
+
+#ifdef ONFS_COUNT_ALLOCATIONS
+// Replaces the global operator new so every allocation the program makes is counted, at the cost of a relaxed increment each
+void *operator new(size_t size)
+{
+    AllocationCounter::Count();
+    if (void *ptr = std::malloc(size ? size : 1))
+    {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+#endif
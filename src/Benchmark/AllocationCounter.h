@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstdint>
+
+// Counts heap allocations for the benchmarks, but only in the OpenNFSBenchmark build. That compiles AllocationCounter.cpp with
+// ONFS_COUNT_ALLOCATIONS, which replaces the global operator new with one that calls Count. OpenNFS keeps the standard allocator.
+namespace AllocationCounter
+{
+    void Count();
+    bool IsCounting();
+    uint64_t GetCount();
+} // namespace AllocationCounter
@@ -0,0 +1,241 @@
+#include "CullingBenchmark.h"
+
+#include <algorithm>
+#include <bitset>
+
+#include "AllocationCounter.h"
+
+constexpr uint32_t kCullingBenchmarkFrames = 2000;
+constexpr float kCameraHeight              = 1.5f; // Above the vroad, about where the car camera sits
+
+CullingBenchmark::CullingBenchmark(const std::shared_ptr<Track> &track) : m_track(track)
+{
+    m_camera = std::make_shared<FreeCamera>(nullptr, glm::vec3(0, 0, 0));
+}
+
+void CullingBenchmark::Run()
+{
+    typedef std::chrono::high_resolution_clock clock_;
+    if (m_track->virtualRoad.size() < 2)
+    {
+        LOG(WARNING) << "Culling benchmark needs a track with virtual road data";
+        return;
+    }
+    LOG(INFO) << "Culling benchmark: " << m_track->name << " (" << ToString(m_track->nfsVersion) << ", " << m_track->nBlocks << " trackblocks), " << kCullingBenchmarkFrames
+              << " frames";
+
+    std::chrono::duration<double, std::micro> copyTime(0), handleTime(0);
+    uint64_t nCopyAllocations = 0, nHandleAllocations = 0, nVisibleEntities = 0;
+    VisibleSet visibleSet;
+    for (uint32_t frameIdx = 0; frameIdx < kCullingBenchmarkFrames; ++frameIdx)
+    {
+        this->_PlaceCamera(frameIdx);
+
+        // As it was: a fresh set each frame, holding a copy of every visible entity
+        uint64_t nAllocations = AllocationCounter::GetCount();
+        auto start            = clock_::now();
+        {
+            VisibleSet frameSet;
+            Renderer::FrustumCull(m_track, m_camera, m_userParams, frameSet);
+            std::vector<std::shared_ptr<Entity>> entityCopies;
+            for (auto &entity : frameSet.entities)
+            {
+                entityCopies.emplace_back(std::make_shared<Entity>(*entity));
+            }
+        }
+        copyTime += clock_::now() - start;
+        nCopyAllocations += AllocationCounter::GetCount() - nAllocations;
+
+        nAllocations = AllocationCounter::GetCount();
+        start        = clock_::now();
+        Renderer::FrustumCull(m_track, m_camera, m_userParams, visibleSet);
+        handleTime += clock_::now() - start;
+        nHandleAllocations += AllocationCounter::GetCount() - nAllocations;
+        nVisibleEntities += visibleSet.entities.size();
+    }
+
+    LOG(INFO) << "Visible:      " << (double) nVisibleEntities / kCullingBenchmarkFrames << " entities/frame";
+    if (AllocationCounter::IsCounting())
+    {
+        LOG(INFO) << "Copies (old): " << copyTime.count() / kCullingBenchmarkFrames << "us/frame, " << (double) nCopyAllocations / kCullingBenchmarkFrames
+                  << " allocations/frame";
+        LOG(INFO) << "Borrowed:     " << handleTime.count() / kCullingBenchmarkFrames << "us/frame, " << (double) nHandleAllocations / kCullingBenchmarkFrames
+                  << " allocations/frame";
+    }
+    else
+    {
+        LOG(INFO) << "Copies (old): " << copyTime.count() / kCullingBenchmarkFrames << "us/frame";
+        LOG(INFO) << "Borrowed:     " << handleTime.count() / kCullingBenchmarkFrames << "us/frame";
+        LOG(INFO) << "Run the OpenNFSBenchmark build to count allocations per frame";
+    }
+
+    this->_MeasureFrustumTests();
+    this->_MeasureTreeQueries();
+    this->_MeasureOcclusion();
+}
+
+void CullingBenchmark::_MeasureFrustumTests()
+{
+    typedef std::chrono::high_resolution_clock clock_;
+    std::chrono::duration<double, std::micro> singleTime(0), batchTime(0);
+    uint64_t nBoxes = 0, nSingleVisible = 0, nBatchVisible = 0;
+    std::vector<uint32_t> trackBlockIDs, visibilityMask;
+    for (uint32_t frameIdx = 0; frameIdx < kCullingBenchmarkFrames; ++frameIdx)
+    {
+        this->_PlaceCamera(frameIdx);
+        m_camera->UpdateFrustum();
+        const Frustum &frustum = m_camera->viewFrustum;
+        trackBlockIDs          = m_track->trackBlocks[m_track->spatialIndex.GetNearestTrackblock(m_camera->position)].neighbourIds;
+
+        auto start = clock_::now();
+        for (auto &trackBlockID : trackBlockIDs)
+        {
+            for (auto *entities : {&m_track->trackBlocks[trackBlockID].track, &m_track->trackBlocks[trackBlockID].objects})
+            {
+                for (auto &entity : *entities)
+                {
+                    nSingleVisible += frustum.CheckIntersection(entity.GetAABB());
+                }
+            }
+        }
+        singleTime += clock_::now() - start;
+
+        start = clock_::now();
+        for (auto &trackBlockID : trackBlockIDs)
+        {
+            for (auto *bounds : {&m_track->trackBlocks[trackBlockID].trackBounds, &m_track->trackBlocks[trackBlockID].objectBounds})
+            {
+                frustum.CheckIntersections(*bounds, visibilityMask);
+                for (auto &maskWord : visibilityMask)
+                {
+                    nBatchVisible += std::bitset<32>(maskWord).count();
+                }
+                nBoxes += bounds->Size();
+            }
+        }
+        batchTime += clock_::now() - start;
+    }
+
+    LOG(INFO) << "Frustum tests over " << (double) nBoxes / kCullingBenchmarkFrames << " boxes/frame";
+    LOG(INFO) << "Per box:      " << singleTime.count() / kCullingBenchmarkFrames << "us/frame";
+    LOG(INFO) << "Batched:      " << batchTime.count() / kCullingBenchmarkFrames << "us/frame, " << kCullingBatchSize << " boxes at a time";
+    if (nSingleVisible != nBatchVisible)
+    {
+        LOG(WARNING) << "Batched test found " << nBatchVisible << " boxes visible, per box found " << nSingleVisible;
+    }
+}
+
+void CullingBenchmark::_MeasureTreeQueries()
+{
+    typedef std::chrono::high_resolution_clock clock_;
+    std::chrono::duration<double, std::micro> linearTime(0), treeTime(0);
+    uint64_t nLinearVisible = 0, nTreeVisible = 0;
+    std::vector<uint32_t> treeObjects;
+    for (uint32_t frameIdx = 0; frameIdx < kCullingBenchmarkFrames; ++frameIdx)
+    {
+        this->_PlaceCamera(frameIdx);
+        m_camera->UpdateFrustum();
+        const Frustum &frustum = m_camera->viewFrustum;
+
+        auto start = clock_::now();
+        for (auto &globalEntity : m_track->globalObjects)
+        {
+            nLinearVisible += frustum.CheckIntersection(globalEntity.GetAABB());
+        }
+        for (auto &trackLight : m_track->trackLights)
+        {
+            nLinearVisible += frustum.CheckIntersection(m_track->trackBlocks[trackLight.first].lights[trackLight.second].GetAABB());
+        }
+        linearTime += clock_::now() - start;
+
+        start = clock_::now();
+        treeObjects.clear();
+        m_track->globalObjectTree.QueryFrustum(frustum, treeObjects);
+        m_track->lightTree.QueryFrustum(frustum, treeObjects);
+        treeTime += clock_::now() - start;
+        nTreeVisible += treeObjects.size();
+    }
+
+    LOG(INFO) << "Whole track queries over " << m_track->globalObjects.size() << " global objects (tree height " << m_track->globalObjectTree.GetHeight() << ", cost "
+              << m_track->globalObjectTree.GetCost() << ") and " << m_track->trackLights.size() << " lights (tree height " << m_track->lightTree.GetHeight() << ", cost "
+              << m_track->lightTree.GetCost() << ")";
+    LOG(INFO) << "Per box:      " << linearTime.count() / kCullingBenchmarkFrames << "us/frame";
+    LOG(INFO) << "Trees:        " << treeTime.count() / kCullingBenchmarkFrames << "us/frame";
+    if (nLinearVisible != nTreeVisible)
+    {
+        LOG(WARNING) << "Trees found " << nTreeVisible << " boxes visible, per box found " << nLinearVisible;
+    }
+
+    // Both ways of putting a tree together, over everything culled a trackblock at a time, to see what rotations leave on the table
+    std::vector<AABB> bounds;
+    for (auto &trackBlock : m_track->trackBlocks)
+    {
+        for (auto *entities : {&trackBlock.track, &trackBlock.objects})
+        {
+            for (auto &entity : *entities)
+            {
+                bounds.emplace_back(entity.GetAABB());
+            }
+        }
+    }
+    AABBTree builtTree, insertedTree;
+    auto start = clock_::now();
+    builtTree.Build(bounds);
+    std::chrono::duration<double, std::milli> buildTime = clock_::now() - start;
+    start                                               = clock_::now();
+    for (uint32_t object = 0; object < bounds.size(); ++object)
+    {
+        insertedTree.Insert(object, bounds[object]);
+    }
+    std::chrono::duration<double, std::milli> insertTime = clock_::now() - start;
+    LOG(INFO) << "Trees of all " << bounds.size() << " trackblock boxes";
+    LOG(INFO) << "Built:        " << buildTime.count() << "ms, height " << builtTree.GetHeight() << ", cost " << builtTree.GetCost();
+    LOG(INFO) << "Inserted:     " << insertTime.count() << "ms, height " << insertedTree.GetHeight() << ", cost " << insertedTree.GetCost();
+}
+
+void CullingBenchmark::_MeasureOcclusion()
+{
+    typedef std::chrono::high_resolution_clock clock_;
+    OcclusionCuller serialCuller(1), parallelCuller(std::max(Config::get().occlusionThreads, 1u));
+    std::chrono::duration<double, std::micro> serialTime(0), parallelTime(0);
+    uint64_t nFrustumEntities = 0, nUnoccludedEntities = 0, nTriangles = 0, nMismatchedFrames = 0;
+    VisibleSet serialSet, parallelSet;
+    for (uint32_t frameIdx = 0; frameIdx < kCullingBenchmarkFrames; ++frameIdx)
+    {
+        this->_PlaceCamera(frameIdx);
+        Renderer::FrustumCull(m_track, m_camera, m_userParams, serialSet);
+        Renderer::FrustumCull(m_track, m_camera, m_userParams, parallelSet);
+        nFrustumEntities += serialSet.entities.size();
+
+        auto start = clock_::now();
+        Renderer::OcclusionCull(m_track, m_camera, serialCuller, serialSet);
+        serialTime += clock_::now() - start;
+
+        start = clock_::now();
+        Renderer::OcclusionCull(m_track, m_camera, parallelCuller, parallelSet);
+        parallelTime += clock_::now() - start;
+
+        nUnoccludedEntities += serialSet.entities.size();
+        nTriangles += serialCuller.GetNumTriangles();
+        nMismatchedFrames += serialSet.entities != parallelSet.entities;
+    }
+
+    LOG(INFO) << "Occlusion culling " << (double) nFrustumEntities / kCullingBenchmarkFrames << " entities/frame down to " << (double) nUnoccludedEntities / kCullingBenchmarkFrames
+              << ", drawing " << (double) nTriangles / kCullingBenchmarkFrames << " occluder triangles/frame";
+    LOG(INFO) << "1 thread:     " << serialTime.count() / kCullingBenchmarkFrames << "us/frame";
+    LOG(INFO) << parallelCuller.GetNumThreads() << " threads:    " << parallelTime.count() / kCullingBenchmarkFrames << "us/frame";
+    if (nMismatchedFrames)
+    {
+        LOG(WARNING) << parallelCuller.GetNumThreads() << " threads culled differently to 1 on " << nMismatchedFrames << " frames";
+    }
+}
+
+// Looking down the road from a little above it, a whole lap over the run
+void CullingBenchmark::_PlaceCamera(uint32_t frameIdx)
+{
+    auto nVroad              = (uint32_t) m_track->virtualRoad.size();
+    uint32_t vroadIdx        = (uint32_t) (((uint64_t) frameIdx * nVroad) / kCullingBenchmarkFrames) % nVroad;
+    const VirtualRoad &vroad = m_track->virtualRoad[vroadIdx];
+    m_camera->position       = vroad.position + vroad.normal * kCameraHeight;
+    m_camera->viewMatrix     = glm::lookAt(m_camera->position, m_camera->position + vroad.forward, vroad.normal);
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include "../Camera/FreeCamera.h"
+#include "../Renderer/Renderer.h"
+#include "../Scene/Track.h"
+
+// Flies a camera down the loaded track's vroad and times building each frame's visible set, as the renderer used to by copying
+// every visible entity, and as it does now into a reused set of borrowed entities. Counts the heap allocations each makes per frame,
+// in the OpenNFSBenchmark build.
+// Then times frustum testing the track and object AABBs of the local trackblocks one at a time against the batched test, and the
+// global objects and lights one at a time against querying the track's trees of them. Last, times occlusion culling what's left on
+// one thread and on as many as configured.
+class CullingBenchmark
+{
+public:
+    explicit CullingBenchmark(const std::shared_ptr<Track> &track);
+    void Run();
+
+private:
+    void _PlaceCamera(uint32_t frameIdx);
+    void _MeasureFrustumTests();
+    void _MeasureTreeQueries();
+    void _MeasureOcclusion();
+
+    std::shared_ptr<Track> m_track;
+    std::shared_ptr<FreeCamera> m_camera;
+    ParamData m_userParams;
+};
@@ -0,0 +1,185 @@
+#include "PhysicsBenchmark.h"
+
+#include <stdexcept>
+#include <string>
+
+constexpr uint32_t kWarmupTicks    = 60;
+constexpr uint32_t kBenchmarkTicks = 600;
+constexpr uint32_t kVroadSpacing   = 4;
+constexpr float kStepTime          = 1.f / 60.f;
+const std::vector<uint32_t> kRacerCounts           = {1, 8, 16, 32};
+const std::vector<uint32_t> kBroadphaseRacerCounts = {1, 10, 20, 40};
+const std::vector<BroadphaseType> kBroadphaseTypes = {DBVT_BROADPHASE, AXIS_SWEEP_BROADPHASE, TRACK_BROADPHASE};
+const std::vector<WheelRaycasterType> kWheelRaycasterTypes = {WORLD_RAYCASTER, TRACK_RAYCASTER};
+const std::vector<RangefinderType> kRangefinderTypes        = {WORLD_RANGEFINDER, VROAD_RANGEFINDER};
+
+constexpr double kMaxRaycasterMismatchRate = 0.001; // Share of wheel rays the track raycaster may read differently to the world one
+
+PhysicsBenchmark::PhysicsBenchmark(const std::shared_ptr<Track> &track, const std::shared_ptr<Car> &car) : m_track(track), m_car(car)
+{
+}
+
+void PhysicsBenchmark::Run()
+{
+    uint32_t maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<uint32_t> threadCounts;
+    for (uint32_t nThreads = 1; nThreads < maxThreads; nThreads *= 2)
+    {
+        threadCounts.push_back(nThreads);
+    }
+    threadCounts.push_back(maxThreads);
+
+    LOG(INFO) << "Physics benchmark: " << m_track->name << " (" << ToString(m_track->nfsVersion) << "), " << kBenchmarkTicks << " ticks per run";
+
+    for (auto nRacers : kRacerCounts)
+    {
+        double singleThreadedStepTime = 0.0;
+        for (auto nThreads : threadCounts)
+        {
+            // Nothing else is running, so the process wide scheduler can be resized for each run
+            PhysicsSettings settings;
+            settings.nThreads = PhysicsEngine::InitTaskScheduler(nThreads);
+            double stepTime   = this->_MeasureStepTime(settings, nRacers, kVroadSpacing);
+            if (nThreads == 1)
+            {
+                singleThreadedStepTime = stepTime;
+            }
+            LOG(INFO) << nRacers << " racers, " << nThreads << " threads: " << stepTime << "ms/tick (" << singleThreadedStepTime / stepTime << "x)";
+        }
+    }
+    PhysicsEngine::InitTaskScheduler(Config::get().physicsThreads);
+}
+
+// Compares Bullet's general purpose broadphases against the trackblock bucketed one, with the field spread over the whole track
+void PhysicsBenchmark::RunBroadphase()
+{
+    LOG(INFO) << "Broadphase benchmark: " << m_track->name << " (" << ToString(m_track->nfsVersion) << ", " << m_track->nBlocks << " trackblocks), " << kBenchmarkTicks
+              << " ticks per run";
+
+    for (auto nRacers : kBroadphaseRacerCounts)
+    {
+        double dbvtStepTime = 0.0;
+        for (auto broadphaseType : kBroadphaseTypes)
+        {
+            PhysicsSettings settings;
+            settings.broadphase = broadphaseType;
+            double stepTime     = this->_MeasureStepTime(settings, nRacers, std::max(1u, (uint32_t) m_track->virtualRoad.size() / nRacers));
+            if (broadphaseType == DBVT_BROADPHASE)
+            {
+                dbvtStepTime = stepTime;
+            }
+            LOG(INFO) << nRacers << " racers, " << ToString(broadphaseType) << ": " << stepTime << "ms/tick (" << dbvtStepTime / stepTime << "x)";
+        }
+    }
+}
+
+// Times the world rayTest wheel raycaster against the trackblock scoped one, then replays the same drive casting both to check they agree
+void PhysicsBenchmark::RunRaycaster()
+{
+    LOG(INFO) << "Wheel raycaster benchmark: " << m_track->name << " (" << ToString(m_track->nfsVersion) << "), " << kBenchmarkTicks << " ticks per run";
+
+    for (auto nRacers : kRacerCounts)
+    {
+        double worldStepTime = 0.0;
+        for (auto raycasterType : kWheelRaycasterTypes)
+        {
+            PhysicsSettings settings;
+            settings.wheelRaycaster = raycasterType;
+            double stepTime         = this->_MeasureStepTime(settings, nRacers, kVroadSpacing);
+            if (raycasterType == WORLD_RAYCASTER)
+            {
+                worldStepTime = stepTime;
+            }
+            LOG(INFO) << nRacers << " racers, " << ToString(raycasterType) << ": " << stepTime << "ms/tick (" << worldStepTime / stepTime << "x)";
+        }
+    }
+
+    PhysicsSettings settings;
+    settings.wheelRaycaster = VALIDATING_RAYCASTER;
+    VehicleRaycaster::ResetValidationStats();
+    this->_MeasureStepTime(settings, kRacerCounts.back(), kVroadSpacing);
+    RaycastValidationStats validationStats = VehicleRaycaster::GetValidationStats();
+    LOG(INFO) << "Validation: " << validationStats.nMismatches << " of " << validationStats.nRays << " wheel rays differed from the world raycaster";
+    // Thrown so the benchmark exits with a failure, a raycaster this far off isn't worth timing
+    if (validationStats.nMismatches > validationStats.nRays * kMaxRaycasterMismatchRate)
+    {
+        throw std::runtime_error("Track raycaster disagreed with the world raycaster on more than " + std::to_string(kMaxRaycasterMismatchRate * 100.0) + "% of wheel rays");
+    }
+}
+
+// Times the world rayTest rangefinders against the vroad wall ones, then replays the same drive casting both to see how far apart they read
+void PhysicsBenchmark::RunRangefinder()
+{
+    LOG(INFO) << "Rangefinder benchmark: " << m_track->name << " (" << ToString(m_track->nfsVersion) << "), " << kBenchmarkTicks << " ticks per run";
+
+    for (auto nRacers : kRacerCounts)
+    {
+        double worldStepTime = 0.0;
+        for (auto rangefinderType : kRangefinderTypes)
+        {
+            double stepTime = this->_MeasureStepTime(PhysicsSettings(), nRacers, kVroadSpacing, rangefinderType);
+            if (rangefinderType == WORLD_RANGEFINDER)
+            {
+                worldStepTime = stepTime;
+            }
+            LOG(INFO) << nRacers << " racers, " << ToString(rangefinderType) << ": " << stepTime << "ms/tick (" << worldStepTime / stepTime << "x)";
+        }
+    }
+
+    VroadRangefinder::ResetValidationStats();
+    this->_MeasureStepTime(PhysicsSettings(), kRacerCounts.back(), kVroadSpacing, VALIDATING_RANGEFINDER);
+    RangefinderValidationStats validationStats = VroadRangefinder::GetValidationStats();
+    LOG(INFO) << "Validation: " << validationStats.nHitMismatches << " of " << validationStats.nReadings
+              << " readings disagreed with the world rangefinders on whether anything was in range, the rest were off by " << validationStats.meanError << " on average ("
+              << validationStats.maxError << " at worst)";
+}
+
+double PhysicsBenchmark::_MeasureStepTime(const PhysicsSettings &settings, uint32_t nRacers, uint32_t vroadSpacing, RangefinderType rangefinderType)
+{
+    PhysicsEngine physicsEngine(settings);
+    physicsEngine.RegisterTrack(m_track);
+
+    // Line the racers up along the virtual road, alternating either side of the centre line
+    std::vector<std::shared_ptr<Car>> cars;
+    for (uint32_t racerIdx = 0; racerIdx < nRacers; ++racerIdx)
+    {
+        auto car = std::make_shared<Car>(m_car->assetData, m_car->tag, m_car->id);
+        car->SetRangefinders(rangefinderType, m_track);
+        physicsEngine.RegisterVehicle(car);
+
+        const VirtualRoad &vroad = m_track->virtualRoad[(racerIdx * vroadSpacing) % m_track->virtualRoad.size()];
+        glm::vec3 vroadPoint     = vroad.position + vroad.respawn;
+        glm::quat carOrientation = glm::conjugate(glm::toQuat(glm::lookAt(vroadPoint, vroadPoint - vroad.forward, vroad.normal)));
+        car->SetPosition(vroadPoint + (racerIdx % 2 ? 0.25f : -0.25f) * vroad.right, carOrientation);
+        cars.push_back(car);
+    }
+
+    std::vector<uint32_t> residentTrackblockIDs;
+    Utils::Timer stepTimer;
+    for (uint32_t tickIdx = 0; tickIdx < kWarmupTicks + kBenchmarkTicks; ++tickIdx)
+    {
+        if (tickIdx == kWarmupTicks)
+        {
+            stepTimer.reset();
+        }
+        // Keep every car on the throttle so the wheels and rangefinders do real work
+        for (auto &car : cars)
+        {
+            car->ApplyAccelerationForce(true, false);
+        }
+        // Racers report their resident trackblocks like they do in a race, so only nearby track collision stays in the world
+        residentTrackblockIDs.clear();
+        for (auto &car : cars)
+        {
+            residentTrackblockIDs.push_back(this->_GetNearestTrackblockID(car->GetPosition()));
+        }
+        physicsEngine.StepSimulation(kStepTime, residentTrackblockIDs);
+    }
+
+    return stepTimer.elapsed() / kBenchmarkTicks;
+}
+
+uint32_t PhysicsBenchmark::_GetNearestTrackblockID(const glm::vec3 &position) const
+{
+    return m_track->spatialIndex.GetNearestTrackblock(position);
+}
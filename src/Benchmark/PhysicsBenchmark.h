@@ -0,0 +1,27 @@
+#pragma once
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "../Physics/PhysicsEngine.h"
+#include "../Physics/VroadRangefinder.h"
+#include "../Scene/Track.h"
+
+// Measures how the physics step scales with Bullet worker threads, broadphase, wheel raycaster, rangefinders and the number of racers on the loaded track
+class PhysicsBenchmark
+{
+public:
+    PhysicsBenchmark(const std::shared_ptr<Track> &track, const std::shared_ptr<Car> &car);
+    void Run();
+    void RunBroadphase();
+    void RunRaycaster();
+    void RunRangefinder();
+
+private:
+    double _MeasureStepTime(const PhysicsSettings &settings, uint32_t nRacers, uint32_t vroadSpacing, RangefinderType rangefinderType = WORLD_RANGEFINDER);
+    uint32_t _GetNearestTrackblockID(const glm::vec3 &position) const;
+
+    std::shared_ptr<Track> m_track;
+    std::shared_ptr<Car> m_car;
+};
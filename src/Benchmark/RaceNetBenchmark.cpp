@@ -0,0 +1,177 @@
+#include "RaceNetBenchmark.h"
+
+#include "../Util/Utils.h"
+
+constexpr uint32_t kRaceNetBenchmarkTicks       = 600;
+constexpr uint32_t kRaceNetBenchmarkGenerations = 20; // Evolved long enough for the population's topologies to diverge
+
+void RaceNetBenchmark::Run()
+{
+    // Same shape as the networks TrainingGround evolves
+    pool pool(kNetworkInputs, 5, 4, false);
+    LOG(INFO) << "RaceNet benchmark: population of " << pool.speciating_parameters.population << ", " << kRaceNetBenchmarkTicks << " ticks per run";
+
+    for (uint32_t generationIdx = 0; generationIdx <= kRaceNetBenchmarkGenerations; ++generationIdx)
+    {
+        std::vector<RaceNet> raceNets;
+        for (auto &species : pool.species)
+        {
+            for (auto &genome : species.genomes)
+            {
+                raceNets.emplace_back();
+                raceNets.back().from_genome(genome);
+            }
+        }
+
+        if (generationIdx == kRaceNetBenchmarkGenerations)
+        {
+            this->_MeasurePopulation("Evolved (generation " + std::to_string(pool.generation()) + ")", raceNets);
+            // Every agent driving the same genome, as when racing one trained network
+            std::vector<RaceNet> clonedRaceNets(raceNets.size(), raceNets.front());
+            this->_MeasurePopulation("Single topology", clonedRaceNets);
+            break;
+        }
+
+        // Fitness doesn't matter here, only that the pool keeps mutating
+        for (auto &species : pool.species)
+        {
+            for (auto &genome : species.genomes)
+            {
+                genome.fitness = (unsigned int) Utils::RandomFloat(0.f, 1000.f);
+            }
+        }
+        pool.new_generation();
+    }
+
+    if (CompiledRaceNets::All().empty())
+    {
+        LOG(INFO) << "No compiled networks built in, copy trained .net files into resources/racenets and rebuild to measure them";
+    }
+    for (auto &compiledRaceNet : CompiledRaceNets::All())
+    {
+        this->_MeasureCompiledRaceNet(compiledRaceNet.first, compiledRaceNet.second);
+    }
+}
+
+void RaceNetBenchmark::_MeasurePopulation(const std::string &description, std::vector<RaceNet> &raceNets)
+{
+    typedef std::chrono::high_resolution_clock clock_;
+    size_t nNets = raceNets.size();
+
+    // Rangefinder distances and speed/10 all sit roughly between 0 and 5
+    std::vector<float> networkInputs(nNets * kNetworkInputs);
+    for (auto &networkInput : networkInputs)
+    {
+        networkInput = Utils::RandomFloat(0.f, 5.f);
+    }
+    std::vector<double> interpreterOutputs(nNets * kNetworkOutputs);
+    std::vector<float> compiledOutputs(nNets * kNetworkOutputs), batchOutputs(nNets * kNetworkOutputs);
+
+    std::vector<RaceNet *> raceNetPtrs;
+    for (auto &raceNet : raceNets)
+    {
+        raceNetPtrs.emplace_back(&raceNet);
+    }
+    RaceNetBatch raceNetBatch;
+    raceNetBatch.build(raceNetPtrs);
+
+    std::chrono::duration<double, std::micro> interpreterTime(0), compiledTime(0), batchTime(0);
+    for (uint32_t tickIdx = 0; tickIdx < kRaceNetBenchmarkTicks; ++tickIdx)
+    {
+        auto start = clock_::now();
+        for (size_t netIdx = 0; netIdx < nNets; ++netIdx)
+        {
+            // As the agents used to, a fresh input and output vector per evaluation
+            std::vector<double> inputs(networkInputs.begin() + netIdx * kNetworkInputs, networkInputs.begin() + (netIdx + 1) * kNetworkInputs);
+            std::vector<double> outputs(kNetworkOutputs, 0.0);
+            raceNets[netIdx].evaluate(inputs, outputs);
+            std::copy(outputs.begin(), outputs.end(), interpreterOutputs.begin() + netIdx * kNetworkOutputs);
+        }
+        interpreterTime += clock_::now() - start;
+
+        start = clock_::now();
+        for (size_t netIdx = 0; netIdx < nNets; ++netIdx)
+        {
+            raceNets[netIdx].evaluate(&networkInputs[netIdx * kNetworkInputs], kNetworkInputs, &compiledOutputs[netIdx * kNetworkOutputs], kNetworkOutputs);
+        }
+        compiledTime += clock_::now() - start;
+
+        start = clock_::now();
+        raceNetBatch.evaluate(networkInputs.data(), kNetworkInputs, batchOutputs.data(), kNetworkOutputs);
+        batchTime += clock_::now() - start;
+    }
+
+    double maxError = 0.0;
+    for (size_t outputIdx = 0; outputIdx < interpreterOutputs.size(); ++outputIdx)
+    {
+        maxError = std::max({maxError, std::abs(interpreterOutputs[outputIdx] - compiledOutputs[outputIdx]), std::abs(interpreterOutputs[outputIdx] - batchOutputs[outputIdx])});
+    }
+
+    LOG(INFO) << description << ", " << nNets << " networks:";
+    LOG(INFO) << "Interpreter: " << interpreterTime.count() / kRaceNetBenchmarkTicks << "us/tick";
+    LOG(INFO) << "Compiled:    " << compiledTime.count() / kRaceNetBenchmarkTicks << "us/tick (" << interpreterTime / compiledTime << "x)";
+    LOG(INFO) << "Batched:     " << batchTime.count() / kRaceNetBenchmarkTicks << "us/tick (" << interpreterTime / batchTime << "x), largest difference from interpreter "
+              << maxError;
+}
+
+void RaceNetBenchmark::_MeasureCompiledRaceNet(const std::string &name, const CompiledRaceNet &compiledRaceNet)
+{
+    typedef std::chrono::high_resolution_clock clock_;
+    std::string networkPath = COMPILED_NETWORK_PATH + name + ".net";
+    if (!boost::filesystem::exists(networkPath))
+    {
+        LOG(WARNING) << "Compiled network " << name << " has no " << networkPath << " to compare it against";
+        return;
+    }
+    RaceNet raceNet;
+    raceNet.import_fromfile(networkPath);
+    if (raceNet.fingerprint() != compiledRaceNet.fingerprint)
+    {
+        LOG(WARNING) << "Compiled network " << name << " is out of date with " << networkPath << ", rebuild to regenerate it";
+        return;
+    }
+
+    // One evaluation per agent of a full grid's worth of races
+    size_t nEvaluations = kRaceNetBenchmarkTicks * 100;
+    std::vector<float> networkInputs(nEvaluations * kNetworkInputs);
+    for (auto &networkInput : networkInputs)
+    {
+        networkInput = Utils::RandomFloat(0.f, 5.f);
+    }
+    std::vector<float> interpretedOutputs(nEvaluations * kNetworkOutputs), compiledOutputs(nEvaluations * kNetworkOutputs);
+
+    auto start = clock_::now();
+    std::vector<double> inputs(kNetworkInputs), outputs(kNetworkOutputs);
+    for (size_t evaluationIdx = 0; evaluationIdx < nEvaluations; ++evaluationIdx)
+    {
+        inputs.assign(networkInputs.begin() + evaluationIdx * kNetworkInputs, networkInputs.begin() + (evaluationIdx + 1) * kNetworkInputs);
+        raceNet.evaluate(inputs, outputs);
+    }
+    std::chrono::duration<double, std::nano> graphTime = clock_::now() - start;
+
+    start = clock_::now();
+    for (size_t evaluationIdx = 0; evaluationIdx < nEvaluations; ++evaluationIdx)
+    {
+        raceNet.evaluate(&networkInputs[evaluationIdx * kNetworkInputs], kNetworkInputs, &interpretedOutputs[evaluationIdx * kNetworkOutputs], kNetworkOutputs);
+    }
+    std::chrono::duration<double, std::nano> interpretedTime = clock_::now() - start;
+
+    start = clock_::now();
+    for (size_t evaluationIdx = 0; evaluationIdx < nEvaluations; ++evaluationIdx)
+    {
+        compiledRaceNet.evaluate(&networkInputs[evaluationIdx * kNetworkInputs], kNetworkInputs, &compiledOutputs[evaluationIdx * kNetworkOutputs], kNetworkOutputs);
+    }
+    std::chrono::duration<double, std::nano> compiledTime = clock_::now() - start;
+
+    size_t nMismatches = 0;
+    for (size_t outputIdx = 0; outputIdx < interpretedOutputs.size(); ++outputIdx)
+    {
+        nMismatches += interpretedOutputs[outputIdx] != compiledOutputs[outputIdx];
+    }
+
+    LOG(INFO) << "Compiled network " << name << ", " << nEvaluations << " evaluations:";
+    LOG(INFO) << "Interpreter: " << graphTime.count() / nEvaluations << "ns/evaluation";
+    LOG(INFO) << "Program:     " << interpretedTime.count() / nEvaluations << "ns/evaluation (" << graphTime / interpretedTime << "x)";
+    LOG(INFO) << "Generated:   " << compiledTime.count() / nEvaluations << "ns/evaluation (" << graphTime / compiledTime << "x), " << nMismatches
+              << " outputs differ from the program";
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <chrono>
+#include <vector>
+
+#include "../RaceNet/RaceNet.h"
+#include "../RaceNet/CompiledRaceNets.h"
+#include "../RaceNet/Agents/CarAgent.h"
+
+// Times a training population's worth of network evaluations through the graph interpreter, the compiled program one network at a
+// time, and the batched evaluator, both for a population sharing one topology and for an evolved population of mixed genomes. Then
+// times every network compiled into the binary against the interpreter running the .net file it was generated from.
+class RaceNetBenchmark
+{
+public:
+    void Run();
+
+private:
+    void _MeasurePopulation(const std::string &description, std::vector<RaceNet> &raceNets);
+    void _MeasureCompiledRaceNet(const std::string &name, const CompiledRaceNet &compiledRaceNet);
+};
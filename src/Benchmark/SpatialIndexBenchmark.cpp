@@ -0,0 +1,110 @@
+#include "SpatialIndexBenchmark.h"
+
+#include <cfloat>
+
+constexpr uint32_t kSpatialBenchmarkAgents = 200;
+constexpr uint32_t kSpatialBenchmarkTicks  = 2000;
+constexpr float kMinAgentSpeed             = 0.05f; // Vroad nodes per tick
+constexpr float kMaxAgentSpeed             = 0.5f;
+
+SpatialIndexBenchmark::SpatialIndexBenchmark(const std::shared_ptr<Track> &track) : m_track(track)
+{
+}
+
+void SpatialIndexBenchmark::Run()
+{
+    typedef std::chrono::high_resolution_clock clock_;
+    uint32_t nVroad = (uint32_t) m_track->virtualRoad.size();
+    if (nVroad < 2)
+    {
+        LOG(WARNING) << "Spatial index benchmark needs a track with virtual road data";
+        return;
+    }
+    LOG(INFO) << "Spatial index benchmark: " << m_track->name << " (" << ToString(m_track->nfsVersion) << ", " << m_track->nBlocks << " trackblocks, " << nVroad
+              << " vroad nodes), " << kSpatialBenchmarkAgents << " agents for " << kSpatialBenchmarkTicks << " ticks";
+
+    // Agents start spread around the track at varying speeds and offsets from the centre line, and drive along the vroad
+    std::vector<float> vroadPositions, speeds, offsets;
+    std::vector<TrackLocation> trackLocations(kSpatialBenchmarkAgents);
+    for (uint32_t agentIdx = 0; agentIdx < kSpatialBenchmarkAgents; ++agentIdx)
+    {
+        vroadPositions.push_back((float) (agentIdx * nVroad) / kSpatialBenchmarkAgents);
+        speeds.push_back(Utils::RandomFloat(kMinAgentSpeed, kMaxAgentSpeed));
+        offsets.push_back(Utils::RandomFloat(-1.f, 1.f));
+    }
+
+    std::chrono::duration<double, std::micro> scanTime(0), gridTime(0), trackedTime(0);
+    uint64_t nScanVroadMisses = 0, nTrackedVroadMisses = 0, nTrackedTrackblockMisses = 0;
+    for (uint32_t tickIdx = 0; tickIdx < kSpatialBenchmarkTicks; ++tickIdx)
+    {
+        for (uint32_t agentIdx = 0; agentIdx < kSpatialBenchmarkAgents; ++agentIdx)
+        {
+            vroadPositions[agentIdx] = std::fmod(vroadPositions[agentIdx] + speeds[agentIdx], (float) (nVroad - 1));
+            glm::vec3 position       = this->_GetAgentPosition(vroadPositions[agentIdx], offsets[agentIdx]);
+
+            auto start = clock_::now();
+            uint32_t scanTrackblockID;
+            uint32_t scanVroadID = this->_ScanNearestVroad(position, scanTrackblockID);
+            scanTime += clock_::now() - start;
+
+            start                     = clock_::now();
+            uint32_t exactTrackblockID = m_track->spatialIndex.GetNearestTrackblock(position);
+            uint32_t exactVroadID      = m_track->spatialIndex.GetNearestVroad(position);
+            gridTime += clock_::now() - start;
+
+            start = clock_::now();
+            m_track->spatialIndex.UpdateLocation(position, trackLocations[agentIdx]);
+            trackedTime += clock_::now() - start;
+
+            nScanVroadMisses += scanVroadID != exactVroadID;
+            nTrackedVroadMisses += trackLocations[agentIdx].vroadID != exactVroadID;
+            nTrackedTrackblockMisses += trackLocations[agentIdx].trackblockID != exactTrackblockID;
+        }
+    }
+
+    double nQueries = (double) kSpatialBenchmarkAgents * kSpatialBenchmarkTicks;
+    LOG(INFO) << "Scan (old):  " << scanTime.count() / kSpatialBenchmarkTicks << "us/tick, wrong vroad " << 100.0 * nScanVroadMisses / nQueries << "%";
+    LOG(INFO) << "Grid:        " << gridTime.count() / kSpatialBenchmarkTicks << "us/tick (exact)";
+    LOG(INFO) << "Tracked:     " << trackedTime.count() / kSpatialBenchmarkTicks << "us/tick, wrong vroad " << 100.0 * nTrackedVroadMisses / nQueries << "%, wrong trackblock "
+              << 100.0 * nTrackedTrackblockMisses / nQueries << "%";
+}
+
+glm::vec3 SpatialIndexBenchmark::_GetAgentPosition(float vroadPosition, float offset) const
+{
+    auto vroadIdx            = (uint32_t) vroadPosition;
+    float t                  = vroadPosition - vroadIdx;
+    const VirtualRoad &from  = m_track->virtualRoad[vroadIdx];
+    const VirtualRoad &to    = m_track->virtualRoad[vroadIdx + 1];
+    return glm::mix(from.position, to.position, t) + offset * glm::mix(from.right, to.right, t);
+}
+
+// What CarAgent did before the spatial index: scan every trackblock centre, then the vroad nodes of the closest block only
+uint32_t SpatialIndexBenchmark::_ScanNearestVroad(const glm::vec3 &position, uint32_t &nearestTrackblockID) const
+{
+    float lowestDistance = FLT_MAX;
+    nearestTrackblockID  = 0;
+    for (auto &trackblock : m_track->trackBlocks)
+    {
+        float distance = glm::distance(position, trackblock.position);
+        if (distance < lowestDistance)
+        {
+            nearestTrackblockID = trackblock.id;
+            lowestDistance      = distance;
+        }
+    }
+
+    uint32_t nearestVroadID = 0;
+    lowestDistance          = FLT_MAX;
+    uint32_t nodeNumber     = m_track->trackBlocks[nearestTrackblockID].virtualRoadStartIndex;
+    uint32_t nPositions     = m_track->trackBlocks[nearestTrackblockID].nVirtualRoadPositions;
+    for (uint32_t vroadIdx = nodeNumber; vroadIdx < nodeNumber + nPositions; ++vroadIdx)
+    {
+        float distance = glm::distance(position, m_track->virtualRoad[vroadIdx].position);
+        if (distance < lowestDistance)
+        {
+            nearestVroadID = vroadIdx;
+            lowestDistance = distance;
+        }
+    }
+    return nearestVroadID;
+}
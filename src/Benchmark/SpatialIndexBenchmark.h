@@ -0,0 +1,22 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include "../Scene/Track.h"
+
+// Times nearest trackblock/vroad lookups for a field of agents driving the loaded track: the old per-agent scans against the
+// spatial index's exact grid queries and its incremental tracking, and counts how often each disagrees with the exact answer
+class SpatialIndexBenchmark
+{
+public:
+    explicit SpatialIndexBenchmark(const std::shared_ptr<Track> &track);
+    void Run();
+
+private:
+    glm::vec3 _GetAgentPosition(float vroadPosition, float offset) const;
+    uint32_t _ScanNearestVroad(const glm::vec3 &position, uint32_t &nearestTrackblockID) const;
+
+    std::shared_ptr<Track> m_track;
+};
@@ -22,14 +22,43 @@ void Config::InitFromCommandLine(int argc, char **argv)
         desc.add_options()
           // Option name/short name, parameter to option, description
           ("help,h", "Print OpenNFS command-line parameters")("spark", bool_switch(&sparkMode), "Ignore Virual Road boundaries")(
-            "vulkan", bool_switch(&vulkanRender), "Use the Vulkan renderer instead of GL default")("headless", bool_switch(&headless), "Launch ONFS without a window")(
+            "vulkan", bool_switch(&vulkanRender), "Use the Vulkan renderer instead of GL default")("headless", bool_switch(&headless), "Launch ONFS without a window or GL context, loading simulation only assets (training and benchmarks)")(
             "train", bool_switch(&trainingMode), "Launch ONFS in AI training mode")("fullv", bool_switch(&useFullVroad), "Allow AI to drive whole track")(
             "nracers", value(&nRacers), "Number of AI Racers on track")("ngens", value(&nGenerations), "Number of generations to allow AI to develop for (training mode)")(
             "nticks", value(&nTicks), "Number of ticks to allow AI agents to simulate in, per generation (training mode)")("car,c", value(&car), "Name of desired car")(
             "carv,cv", value(&carTag), "NFS Version containing desired car (NFS_2, NFS_3, NFS_3_PS1, NFS_4, NFS_4_PS1, NFS_5")("track,t", value(&track), "Name of desired track")(
             "trackv,tv", value(&trackTag), "NFS Version containing desired track (NFS_2, NFS_3, NFS_3_PS1, NFS_4, NFS_4_PS1, NFS_5")(
             "resX,x", value<uint32_t>(&resX), "Horizontal screen resolution")("resY,y", value<uint32_t>(&resY), "Vertical screen resolution")
-            ("fixup-asset-paths", bool_switch(&renameAssets), "Rename all available NFS files and folders to lowercase so can be consistent for ONFS read");
+            ("occlusion-threads", value(&occlusionThreads), "Number of threads to rasterise occluders and test visible entities against them with, counting the render thread (0 turns occlusion culling off)")
+            ("fixup-asset-paths", bool_switch(&renameAssets), "Rename all available NFS files and folders to lowercase so can be consistent for ONFS read")
+            ("physics-threads", value(&physicsThreads), "Number of threads to step the Bullet world with (1 uses the single threaded world)")
+            ("physics-block-radius", value(&physicsBlockRadius), "Number of neighbouring trackblocks around each racer to keep track collision active for")
+            ("broadphase", value(&broadphase), "Bullet broadphase to use: dbvt, sap (32 bit axis sweep) or track (trackblock bucketed)")
+            ("wheel-raycaster", value(&wheelRaycaster), "Wheel suspension rays: track (nearby trackblock meshes), world (Bullet rayTest) or validate (both, reporting differences)")
+            ("training-rangefinder", value(&trainingRangefinder), "Rangefinders for training agents: world (Bullet rayTest), vroad (virtual road walls) or validate (both, reporting differences)")
+            ("racer-rangefinder", value(&racerRangefinder), "Rangefinders for AI racers: world, vroad or validate")
+            ("player-rangefinder", value(&playerRangefinder), "Rangefinders for the player's car: world, vroad or validate")
+            ("racer-lod-distance", value(&racerLodDistance), "Metres from both the player and the camera past which AI racers leave physics and follow the virtual road kinematically (0 disables)")
+            ("racer-lod-hysteresis", value(&racerLodHysteresis), "Extra metres past the racer LOD distance before an AI racer goes kinematic, so racers on the boundary don't flip every tick")
+            ("training-shards", value(&trainingShards), "Number of independent physics worlds to split the training population across, each stepped on its own thread")
+            ("evolution", value(&evolution), "How training evolves the NEAT pool: generational (race every species, then breed a generation) or steady-state (breed a replacement as soon as any agent finishes)")
+            ("training-render-rate", value(&trainingRenderRate), "Frames per second to show windowed training at, the simulation only stops to copy agent positions this often")
+            ("training-metrics", value(&trainingMetrics), "CSV file to append training evaluations/s and fitness over time to, to compare evolution modes")
+            ("training-seed", value(&trainingSeed), "Seed for the NEAT pool, the same seed and track reproduce a training run (0 picks one at random)")
+            ("checkpoint-keep-last", value(&checkpointKeepLast), "Number of most recent generation checkpoints to keep while training")
+            ("checkpoint-keep-every", value(&checkpointKeepEvery), "Also keep the checkpoint of every Nth generation (0 keeps only the most recent)")
+            ("checkpoint-raw", bool_switch(&checkpointRaw), "Write checkpoints with fixed width fields instead of packing them")
+            ("checkpoint-to-text", value(&checkpointToText), "Export the given binary pool checkpoint as a text pool file alongside it, then exit")
+            ("farm-listen", value(&farmListen), "Evaluate headless training species on farm workers that connect to this endpoint (unix:<path> or tcp:<host>:<port>)")
+            ("farm-workers", value(&farmWorkers), "Number of farm worker processes to start on this machine for headless training")
+            ("farm-worker", value(&farmWorker), "Run as a farm worker for the training coordinator at the given endpoint")
+            ("farm-timeout", value(&farmTimeout), "Milliseconds without a heartbeat before a farm worker is dropped and its species reassigned")
+            ("record", value(&recordPath), "Record the race to the given file: the assets, player inputs and periodic racer pose checksums needed to replay it exactly")
+            ("replay", value(&replayPath), "Replay a race recording as fast as possible, with --headless to skip rendering, reporting any divergence from it")
+            ("record-checksum-interval", value(&recordChecksumInterval), "Simulation ticks between racer pose checksums in race recordings (0 records none)")
+            ("bench", value(&benchmark), "Run the named benchmark against the selected car and track, then exit (physics, broadphase, raycaster, spatial, culling, racenet, rangefinder)");
+        executablePath = argv[0];
+        commandLineArgs.assign(argv + 1, argv + argc);
         store(parse_command_line(argc, argv, desc), storedConfig);
         notify(storedConfig);
 
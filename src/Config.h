@@ -27,7 +27,9 @@ const std::string CAR_PATH      = ASSET_PATH + "car/";
 const std::string TRACK_PATH    = ASSET_PATH + "tracks/";
 const std::string RESOURCE_PATH = "../resources/";
 
-const std::string BEST_NETWORK_PATH = ASSET_PATH + "bestRacer.net";
+const std::string BEST_NETWORK_PATH     = ASSET_PATH + "bestRacer.net";
+const std::string COMPILED_NETWORK_PATH = RESOURCE_PATH + "racenets/"; // Networks here are compiled into the binary at build time
+const std::string CHECKPOINT_PATH       = "./checkpoints/";             // NEAT pool checkpoints, one per generation
 
 const std::string NFS_2_TRACK_PATH = "/gamedata/tracks/pc/";
 const std::string NFS_2_CAR_PATH   = "/gamedata/carmodel/pc/";
@@ -60,11 +62,26 @@ const int LIGHTS_PER_NB_BLOCK         = 3; // Number of lights per neighbouring
 const int NEIGHBOUR_BLOCKS_FOR_LIGHTS = 1; // Number of neighbouring trackblocks to search for lights
 
 // ----- Defaults -----
-const std::string DEFAULT_CAR           = "corv";
-const std::string DEFAULT_TRACK         = "trk003";
-const std::string DEFAULT_CAR_NFS_VER   = ToString(NFS_3);
-const std::string DEFAULT_TRACK_NFS_VER = ToString(NFS_3);
-const int DEFAULT_NUM_RACERS            = 0;
+const std::string DEFAULT_CAR               = "corv";
+const std::string DEFAULT_TRACK             = "trk003";
+const std::string DEFAULT_CAR_NFS_VER       = ToString(NFS_3);
+const std::string DEFAULT_TRACK_NFS_VER     = ToString(NFS_3);
+const int DEFAULT_NUM_RACERS                = 0;
+const uint32_t DEFAULT_PHYSICS_THREADS      = 1;
+const uint32_t DEFAULT_PHYSICS_BLOCK_RADIUS = 2; // Neighbouring trackblocks around each racer whose collision is kept in the dynamics world
+const std::string DEFAULT_BROADPHASE        = "dbvt";
+const std::string DEFAULT_WHEEL_RAYCASTER   = "track";
+const std::string DEFAULT_RANGEFINDER       = "world"; // Networks are trained against what they sense, so changing this changes their inputs
+const float DEFAULT_RACER_LOD_DISTANCE      = 0.f;  // Metres from the player and camera past which AI racers go kinematic, 0 keeps them all on physics
+const float DEFAULT_RACER_LOD_HYSTERESIS    = 25.f; // Extra metres a racer has to be past the LOD distance before it goes kinematic
+const uint32_t DEFAULT_TRAINING_SHARDS      = 1;
+const std::string DEFAULT_EVOLUTION         = "generational";
+const uint32_t DEFAULT_TRAINING_RENDER_RATE = 30; // Hz, windowed training publishes agent positions for the visualisation no more often than this
+const uint32_t DEFAULT_CHECKPOINT_KEEP_LAST = 3;
+const uint32_t DEFAULT_CHECKPOINT_INTERVAL  = 10; // Every Nth generation is kept for good, on top of the most recent
+const uint32_t DEFAULT_FARM_TIMEOUT         = 10000; // Milliseconds a farm worker can go without heartbeating before its batch goes to another
+const uint32_t DEFAULT_CHECKSUM_INTERVAL    = 120;   // Simulation ticks between racer pose checksums in race recordings
+const uint32_t DEFAULT_OCCLUSION_THREADS    = 2;     // Counting the render thread
 
 /* --------------- ONFS Runtime parameters here -----------------*/
 class Config
@@ -82,24 +99,59 @@ public:
     {
         return storedConfig[key].as<_T>();
     };
+    // Headless runs load simulation only assets, geometry stays on the CPU for collision and nothing creates GL objects
+    bool UseGL() const
+    {
+        return !vulkanRender && !headless;
+    }
     // Better named parameters instead of using var_map with command-line arg name
     std::string car = DEFAULT_CAR, track = DEFAULT_TRACK;
     std::string carTag = DEFAULT_CAR_NFS_VER, trackTag = DEFAULT_TRACK_NFS_VER;
     uint16_t nRacers = DEFAULT_NUM_RACERS;
     /* -- Physics/AI Params -- */
-    bool useFullVroad = true;
-    bool sparkMode    = false;
+    bool useFullVroad               = true;
+    bool sparkMode                  = false;
+    uint32_t physicsThreads         = DEFAULT_PHYSICS_THREADS;
+    uint32_t physicsBlockRadius     = DEFAULT_PHYSICS_BLOCK_RADIUS;
+    std::string broadphase          = DEFAULT_BROADPHASE;
+    std::string wheelRaycaster      = DEFAULT_WHEEL_RAYCASTER;
+    std::string trainingRangefinder = DEFAULT_RANGEFINDER;
+    std::string racerRangefinder    = DEFAULT_RANGEFINDER;
+    std::string playerRangefinder   = DEFAULT_RANGEFINDER;
+    float racerLodDistance          = DEFAULT_RACER_LOD_DISTANCE;
+    float racerLodHysteresis        = DEFAULT_RACER_LOD_HYSTERESIS;
     /* -- Render Params -- */
     bool vulkanRender = false;
     bool headless     = false;
     float fov         = DEFAULT_FOV;
     uint32_t resX = DEFAULT_X_RESOLUTION, resY = DEFAULT_Y_RESOLUTION;
+    uint32_t occlusionThreads = DEFAULT_OCCLUSION_THREADS;
     /* -- Training Params -- */
     bool trainingMode     = false;
     uint16_t nGenerations = 0;
     uint32_t nTicks;
+    uint32_t trainingShards      = DEFAULT_TRAINING_SHARDS;
+    std::string evolution        = DEFAULT_EVOLUTION;
+    std::string trainingMetrics; // CSV to append throughput and fitness over time to, as well as logging them
+    uint32_t trainingRenderRate  = DEFAULT_TRAINING_RENDER_RATE;
+    uint32_t trainingSeed        = 0;
+    uint32_t checkpointKeepLast  = DEFAULT_CHECKPOINT_KEEP_LAST;
+    uint32_t checkpointKeepEvery = DEFAULT_CHECKPOINT_INTERVAL;
+    bool checkpointRaw           = false;
+    /* -- Training Farm Params -- */
+    std::string farmListen;   // Endpoint the coordinator takes workers on, unix:<path> or tcp:<host>:<port>
+    uint32_t farmWorkers = 0; // Workers to start on this machine, over a unix socket unless farmListen is given
+    std::string farmWorker;   // Run as a worker for the coordinator at this endpoint
+    uint32_t farmTimeout = DEFAULT_FARM_TIMEOUT;
+    std::string executablePath; // How we were started, so local farm workers can be started the same way
+    std::vector<std::string> commandLineArgs;
     /* -- Tool Params -- */
     bool renameAssets = false;
+    std::string benchmark;
+    std::string checkpointToText;
+    std::string recordPath; // Race recording to write, for replaying the same race later
+    std::string replayPath; // Race recording to replay, headless or rendered
+    uint32_t recordChecksumInterval = DEFAULT_CHECKSUM_INTERVAL;
 
 private:
     Config() = default;
@@ -120,15 +172,19 @@ struct ParamData
     bool physicsDebugView       = false;
     bool drawHermiteFrustum     = false;
     bool drawTrackAABB          = false;
+    bool drawVisibleAABB        = false;
     bool useClassicGraphics     = false;
     bool attachCamToHermite     = false;
     bool useNbData              = true;
     bool attachCamToCar         = true;
     bool frustumCull            = false;
+    bool occlusionCull          = true;
     bool drawVroad              = false;
     bool drawCAN                = false;
     bool drawRaycast            = false;
     bool simulateCars           = true;
+    uint32_t nFullRacers        = 0; // Racer LOD on the last simulation tick, for display only
+    uint32_t nKinematicRacers   = 0;
 };
 
 struct AssetData
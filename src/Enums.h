@@ -38,6 +38,10 @@ enum collisionTypes
 
 DEFINE_ENUM_WITH_STRING_CONVERSIONS(NFSVer, (UNKNOWN)(NFS_1)(NFS_2)(NFS_2_PS1)(NFS_2_SE)(NFS_3)(NFS_3_PS1)(NFS_4)(NFS_4_PS1)(MCO)(NFS_5));
 DEFINE_ENUM_WITH_STRING_CONVERSIONS(EntityType, (XOBJ)(OBJ_POLY)(LANE)(SOUND)(LIGHT)(ROAD)(GLOBAL)(CAR)(VROAD)(VROAD_CEIL))
+DEFINE_ENUM_WITH_STRING_CONVERSIONS(BroadphaseType, (DBVT_BROADPHASE)(AXIS_SWEEP_BROADPHASE)(TRACK_BROADPHASE))
+DEFINE_ENUM_WITH_STRING_CONVERSIONS(WheelRaycasterType, (WORLD_RAYCASTER)(TRACK_RAYCASTER)(VALIDATING_RAYCASTER))
+DEFINE_ENUM_WITH_STRING_CONVERSIONS(RangefinderType, (WORLD_RANGEFINDER)(VROAD_RANGEFINDER)(VALIDATING_RANGEFINDER))
+DEFINE_ENUM_WITH_STRING_CONVERSIONS(EvolutionType, (GENERATIONAL_EVOLUTION)(STEADY_STATE_EVOLUTION))
 
 // TODO: Use BOOST_PP to automate this
 inline NFSVer getEnum(const std::string& nfsVerString)
@@ -65,3 +69,41 @@ inline NFSVer getEnum(const std::string& nfsVerString)
     else
         return UNKNOWN;
 }
+
+inline BroadphaseType getBroadphaseType(const std::string& broadphaseString)
+{
+    if (broadphaseString == "sap")
+        return AXIS_SWEEP_BROADPHASE;
+    else if (broadphaseString == "track")
+        return TRACK_BROADPHASE;
+    else
+        return DBVT_BROADPHASE;
+}
+
+inline WheelRaycasterType getWheelRaycasterType(const std::string& raycasterString)
+{
+    if (raycasterString == "world")
+        return WORLD_RAYCASTER;
+    else if (raycasterString == "validate")
+        return VALIDATING_RAYCASTER;
+    else
+        return TRACK_RAYCASTER;
+}
+
+inline RangefinderType getRangefinderType(const std::string& rangefinderString)
+{
+    if (rangefinderString == "vroad")
+        return VROAD_RANGEFINDER;
+    else if (rangefinderString == "validate")
+        return VALIDATING_RANGEFINDER;
+    else
+        return WORLD_RANGEFINDER;
+}
+
+inline EvolutionType getEvolutionType(const std::string& evolutionString)
+{
+    if (evolutionString == "steady-state")
+        return STEADY_STATE_EVOLUTION;
+    else
+        return GENERATIONAL_EVOLUTION;
+}
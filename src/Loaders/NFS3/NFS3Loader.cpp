@@ -83,6 +83,7 @@ std::shared_ptr<Track> NFS3Loader::LoadTrack(const std::string &trackBasePath)
     track->trackBlocks     = _ParseTRKModels(frdFile, track);
     track->globalObjects   = _ParseCOLModels(colFile, track);
     track->virtualRoad     = _ParseVirtualRoad(colFile);
+    track->vroadSpeeds     = _ParseVroadSpeeds(speedFile, track->virtualRoad.size());
 
     LOG(INFO) << "Track loaded successfully";
 
@@ -399,6 +400,21 @@ std::vector<VirtualRoad> NFS3Loader::_ParseVirtualRoad(const ColFile &colFile)
     return virtualRoad;
 }
 
+// One byte per vroad node, taken as km/h. Files that don't have exactly one per node are stretched over the vroad.
+std::vector<float> NFS3Loader::_ParseVroadSpeeds(const SpeedsFile &speedFile, size_t nVroad)
+{
+    std::vector<float> vroadSpeeds;
+    if (speedFile.speeds.empty())
+    {
+        return vroadSpeeds;
+    }
+    for (size_t vroadIdx = 0; vroadIdx < nVroad; ++vroadIdx)
+    {
+        vroadSpeeds.push_back(speedFile.speeds[vroadIdx * speedFile.speeds.size() / nVroad] / 3.6f);
+    }
+    return vroadSpeeds;
+}
+
 std::vector<Entity> NFS3Loader::_ParseCOLModels(const ColFile &colFile, const std::shared_ptr<Track> &track)
 {
     LOG(INFO) << "Parsing COL file into ONFS GL structures";
@@ -33,5 +33,6 @@ private:
     static CarData _ParseFCEModels(const LibOpenNFS::NFS3::FceFile &fceFile);
     static std::vector<OpenNFS::TrackBlock> _ParseTRKModels(const LibOpenNFS::NFS3::FrdFile &frdFile, const std::shared_ptr<Track> &track);
     static std::vector<VirtualRoad> _ParseVirtualRoad(const LibOpenNFS::NFS3::ColFile &colFile);
+    static std::vector<float> _ParseVroadSpeeds(const LibOpenNFS::NFS3::SpeedsFile &speedFile, size_t nVroad);
     static std::vector<Entity> _ParseCOLModels(const LibOpenNFS::NFS3::ColFile &colFile, const std::shared_ptr<Track> &track);
 };
@@ -55,6 +55,9 @@ std::shared_ptr<Track> TrackLoader::LoadTrack(NFSVer trackVersion, const std::st
 
     loadedTrack->GenerateSpline();
     loadedTrack->GenerateAabbTree();
+    loadedTrack->GenerateSpatialIndex();
+    loadedTrack->GenerateCullingBounds();
+    loadedTrack->GenerateOccluders();
 
     return loadedTrack;
 }
\ No newline at end of file
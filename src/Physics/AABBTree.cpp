@@ -1,304 +1,581 @@
 #include "AABBTree.h"
 
+#include <algorithm>
 #include <cassert>
-#include <stack>
+#include <cfloat>
 
-AABBTree::AABBTree(unsigned initialSize) : _rootNodeIndex(AABB_NULL_NODE), _allocatedNodeCount(0), _nextFreeNodeIndex(0), _nodeCapacity(initialSize), _growthSize(initialSize)
+constexpr uint32_t kSAHBins        = 12;
+constexpr size_t kQueryStackSize   = 64;
+constexpr float kMinCentroidExtent = 1e-6f;
+
+namespace
 {
-    _nodes.resize(initialSize);
-    for (unsigned nodeIndex = 0; nodeIndex < initialSize; nodeIndex++)
+    float Area(const glm::vec3 &min, const glm::vec3 &max)
+    {
+        glm::vec3 size = max - min;
+        return 2.f * (size.x * size.y + size.x * size.z + size.y * size.z);
+    }
+
+    float Area(const AABBTreeNode &node)
     {
-        AABBNode& node     = _nodes[nodeIndex];
-        node.nextNodeIndex = nodeIndex + 1;
+        return Area(node.min, node.max);
     }
-    _nodes[initialSize - 1].nextNodeIndex = AABB_NULL_NODE;
+
+    float UnionArea(const AABBTreeNode &a, const AABBTreeNode &b)
+    {
+        return Area(glm::min(a.min, b.min), glm::max(a.max, b.max));
+    }
+} // namespace
+
+AABBTree::AABBTree(float margin) : m_margin(margin)
+{
 }
 
-AABBTree::~AABBTree()
+void AABBTree::Build(const std::vector<AABB> &bounds)
 {
+    this->Clear();
+    if (bounds.empty())
+    {
+        return;
+    }
+
+    // A binary tree over n leaves has n - 1 internal nodes
+    m_nodes.reserve(2 * bounds.size() - 1);
+    m_objectLeaves.assign(bounds.size(), kAABBTreeNullNode);
+    std::vector<uint32_t> leaves;
+    std::vector<glm::vec3> centroids;
+    for (uint32_t object = 0; object < bounds.size(); ++object)
+    {
+        uint32_t leafIdx       = this->_AllocateNode();
+        AABBTreeNode &leaf     = m_nodes[leafIdx];
+        leaf.min               = bounds[object].position + bounds[object].min - m_margin;
+        leaf.max               = bounds[object].position + bounds[object].max + m_margin;
+        leaf.object            = object;
+        leaf.height            = 0;
+        m_objectLeaves[object] = leafIdx;
+        leaves.emplace_back(leafIdx);
+        centroids.emplace_back((leaf.min + leaf.max) * 0.5f);
+    }
+    m_nObjects = bounds.size();
+
+    m_root                 = this->_BuildRange(leaves, 0, leaves.size(), centroids);
+    m_nodes[m_root].parent = kAABBTreeNullNode;
 }
 
-unsigned AABBTree::allocateNode()
+void AABBTree::Clear()
 {
-    // if we have no free tree nodes then grow the pool
-    if (_nextFreeNodeIndex == AABB_NULL_NODE)
+    m_nodes.clear();
+    m_objectLeaves.clear();
+    m_root     = kAABBTreeNullNode;
+    m_freeList = kAABBTreeNullNode;
+    m_nObjects = 0;
+}
+
+// Splits the leaves on the widest axis of their centroids, wherever binning them says gives the lowest surface area heuristic
+uint32_t AABBTree::_BuildRange(std::vector<uint32_t> &leaves, size_t begin, size_t end, const std::vector<glm::vec3> &centroids)
+{
+    if (end - begin == 1)
     {
-        assert(_allocatedNodeCount == _nodeCapacity);
+        return leaves[begin];
+    }
 
-        _nodeCapacity += _growthSize;
-        _nodes.resize(_nodeCapacity);
-        for (unsigned nodeIndex = _allocatedNodeCount; nodeIndex < _nodeCapacity; nodeIndex++)
+    glm::vec3 centroidMin = centroids[m_nodes[leaves[begin]].object], centroidMax = centroidMin;
+    for (size_t leafIdx = begin; leafIdx < end; ++leafIdx)
+    {
+        centroidMin = glm::min(centroidMin, centroids[m_nodes[leaves[leafIdx]].object]);
+        centroidMax = glm::max(centroidMax, centroids[m_nodes[leaves[leafIdx]].object]);
+    }
+    glm::vec3 centroidExtent = centroidMax - centroidMin;
+    int axis                 = centroidExtent.x > centroidExtent.y ? (centroidExtent.x > centroidExtent.z ? 0 : 2) : (centroidExtent.y > centroidExtent.z ? 1 : 2);
+
+    size_t mid = begin + (end - begin) / 2;
+    if (centroidExtent[axis] > kMinCentroidExtent)
+    {
+        auto getBin = [&](uint32_t leafIdx) {
+            float t = (centroids[m_nodes[leafIdx].object][axis] - centroidMin[axis]) / centroidExtent[axis];
+            return std::min((uint32_t) (t * kSAHBins), kSAHBins - 1);
+        };
+
+        uint32_t binCounts[kSAHBins] = {};
+        glm::vec3 binMin[kSAHBins], binMax[kSAHBins];
+        for (size_t leafIdx = begin; leafIdx < end; ++leafIdx)
         {
-            AABBNode& node     = _nodes[nodeIndex];
-            node.nextNodeIndex = nodeIndex + 1;
+            const AABBTreeNode &leaf = m_nodes[leaves[leafIdx]];
+            uint32_t bin             = getBin(leaves[leafIdx]);
+            binMin[bin]              = binCounts[bin] == 0 ? leaf.min : glm::min(binMin[bin], leaf.min);
+            binMax[bin]              = binCounts[bin] == 0 ? leaf.max : glm::max(binMax[bin], leaf.max);
+            ++binCounts[bin];
         }
-        _nodes[_nodeCapacity - 1].nextNodeIndex = AABB_NULL_NODE;
-        _nextFreeNodeIndex                      = _allocatedNodeCount;
-    }
 
-    unsigned nodeIndex            = _nextFreeNodeIndex;
-    AABBNode& allocatedNode       = _nodes[nodeIndex];
-    allocatedNode.parentNodeIndex = AABB_NULL_NODE;
-    allocatedNode.leftNodeIndex   = AABB_NULL_NODE;
-    allocatedNode.rightNodeIndex  = AABB_NULL_NODE;
-    _nextFreeNodeIndex            = allocatedNode.nextNodeIndex;
-    _allocatedNodeCount++;
+        // Sweep from the right to get the cost of everything after each split, then from the left to find the cheapest
+        float rightCosts[kSAHBins] = {};
+        glm::vec3 sweepMin, sweepMax;
+        uint32_t sweepCount = 0;
+        for (uint32_t bin = kSAHBins - 1; bin > 0; --bin)
+        {
+            if (binCounts[bin] > 0)
+            {
+                sweepMin = sweepCount == 0 ? binMin[bin] : glm::min(sweepMin, binMin[bin]);
+                sweepMax = sweepCount == 0 ? binMax[bin] : glm::max(sweepMax, binMax[bin]);
+                sweepCount += binCounts[bin];
+            }
+            rightCosts[bin - 1] = sweepCount == 0 ? 0.f : Area(sweepMin, sweepMax) * sweepCount;
+        }
+        float bestCost     = FLT_MAX;
+        uint32_t bestSplit = 0;
+        sweepCount         = 0;
+        for (uint32_t bin = 0; bin < kSAHBins - 1; ++bin)
+        {
+            if (binCounts[bin] > 0)
+            {
+                sweepMin = sweepCount == 0 ? binMin[bin] : glm::min(sweepMin, binMin[bin]);
+                sweepMax = sweepCount == 0 ? binMax[bin] : glm::max(sweepMax, binMax[bin]);
+                sweepCount += binCounts[bin];
+            }
+            float cost = (sweepCount == 0 ? 0.f : Area(sweepMin, sweepMax) * sweepCount) + rightCosts[bin];
+            if (sweepCount > 0 && sweepCount < end - begin && cost < bestCost)
+            {
+                bestCost  = cost;
+                bestSplit = bin;
+            }
+        }
+        if (bestCost < FLT_MAX)
+        {
+            auto split = std::partition(leaves.begin() + begin, leaves.begin() + end, [&](uint32_t leafIdx) { return getBin(leafIdx) <= bestSplit; });
+            mid        = split - leaves.begin();
+        }
+    }
 
-    return nodeIndex;
+    uint32_t leftIdx         = this->_BuildRange(leaves, begin, mid, centroids);
+    uint32_t rightIdx        = this->_BuildRange(leaves, mid, end, centroids);
+    uint32_t nodeIdx         = this->_AllocateNode();
+    AABBTreeNode &node       = m_nodes[nodeIdx];
+    node.left                = leftIdx;
+    node.right               = rightIdx;
+    node.min                 = glm::min(m_nodes[leftIdx].min, m_nodes[rightIdx].min);
+    node.max                 = glm::max(m_nodes[leftIdx].max, m_nodes[rightIdx].max);
+    node.height              = 1 + std::max(m_nodes[leftIdx].height, m_nodes[rightIdx].height);
+    m_nodes[leftIdx].parent  = nodeIdx;
+    m_nodes[rightIdx].parent = nodeIdx;
+    return nodeIdx;
 }
 
-void AABBTree::deallocateNode(unsigned nodeIndex)
+void AABBTree::Insert(uint32_t object, const AABB &aabb)
 {
-    AABBNode& deallocatedNode     = _nodes[nodeIndex];
-    deallocatedNode.nextNodeIndex = _nextFreeNodeIndex;
-    _nextFreeNodeIndex            = nodeIndex;
-    _allocatedNodeCount--;
+    if (object >= m_objectLeaves.size())
+    {
+        m_objectLeaves.resize(object + 1, kAABBTreeNullNode);
+    }
+    assert(m_objectLeaves[object] == kAABBTreeNullNode);
+
+    uint32_t leafIdx       = this->_AllocateNode();
+    AABBTreeNode &leaf     = m_nodes[leafIdx];
+    leaf.min               = aabb.position + aabb.min - m_margin;
+    leaf.max               = aabb.position + aabb.max + m_margin;
+    leaf.object            = object;
+    leaf.height            = 0;
+    m_objectLeaves[object] = leafIdx;
+    ++m_nObjects;
+
+    this->_InsertLeaf(leafIdx);
 }
 
-void AABBTree::insertObject(const std::shared_ptr<IAABB>& object)
+void AABBTree::Remove(uint32_t object)
 {
-    unsigned nodeIndex = allocateNode();
-    AABBNode& node     = _nodes[nodeIndex];
+    uint32_t leafIdx = m_objectLeaves[object];
+    assert(leafIdx != kAABBTreeNullNode);
+    this->_RemoveLeaf(leafIdx);
+    this->_FreeNode(leafIdx);
+    m_objectLeaves[object] = kAABBTreeNullNode;
+    --m_nObjects;
+}
 
-    node.aabb   = object->GetAABB();
-    node.object = object;
+bool AABBTree::Update(uint32_t object, const AABB &aabb)
+{
+    uint32_t leafIdx = m_objectLeaves[object];
+    glm::vec3 min    = aabb.position + aabb.min;
+    glm::vec3 max    = aabb.position + aabb.max;
+    // Without a margin the leaf is kept exact, so even shrinking means moving it
+    if (m_margin > 0.f && glm::all(glm::greaterThanEqual(min, m_nodes[leafIdx].min)) && glm::all(glm::lessThanEqual(max, m_nodes[leafIdx].max)))
+    {
+        return false;
+    }
 
-    insertLeaf(nodeIndex);
-    _objectNodeIndexMap[object] = nodeIndex;
+    this->_RemoveLeaf(leafIdx);
+    m_nodes[leafIdx].min = min - m_margin;
+    m_nodes[leafIdx].max = max + m_margin;
+    this->_InsertLeaf(leafIdx);
+    return true;
 }
 
-void AABBTree::removeObject(const std::shared_ptr<IAABB>& object)
+void AABBTree::SetBounds(uint32_t object, const AABB &aabb)
 {
-    unsigned nodeIndex = _objectNodeIndexMap[object];
-    removeLeaf(nodeIndex);
-    deallocateNode(nodeIndex);
-    _objectNodeIndexMap.erase(object);
+    AABBTreeNode &leaf = m_nodes[m_objectLeaves[object]];
+    leaf.min           = aabb.position + aabb.min - m_margin;
+    leaf.max           = aabb.position + aabb.max + m_margin;
 }
 
-void AABBTree::updateObject(const std::shared_ptr<IAABB>& object)
+void AABBTree::Refit()
 {
-    unsigned nodeIndex = _objectNodeIndexMap[object];
-    updateLeaf(nodeIndex, object->GetAABB());
+    if (m_root != kAABBTreeNullNode)
+    {
+        this->_RefitNode(m_root);
+    }
 }
 
-std::forward_list<std::shared_ptr<IAABB>> AABBTree::queryOverlaps(const Frustum& frustum) const
+void AABBTree::_RefitNode(uint32_t nodeIdx)
 {
-    std::forward_list<std::shared_ptr<IAABB>> overlaps;
-    std::stack<unsigned> stack;
+    AABBTreeNode &node = m_nodes[nodeIdx];
+    if (node.IsLeaf())
+    {
+        return;
+    }
+    this->_RefitNode(node.left);
+    this->_RefitNode(node.right);
+    node.min = glm::min(m_nodes[node.left].min, m_nodes[node.right].min);
+    node.max = glm::max(m_nodes[node.left].max, m_nodes[node.right].max);
+}
 
-    stack.push(_rootNodeIndex);
-    while (!stack.empty())
+uint32_t AABBTree::_AllocateNode()
+{
+    if (m_freeList == kAABBTreeNullNode)
     {
-        unsigned nodeIndex = stack.top();
-        stack.pop();
+        m_nodes.emplace_back();
+        return (uint32_t) m_nodes.size() - 1;
+    }
+    uint32_t nodeIdx = m_freeList;
+    m_freeList       = m_nodes[nodeIdx].parent;
+    m_nodes[nodeIdx] = AABBTreeNode();
+    return nodeIdx;
+}
 
-        if (nodeIndex == AABB_NULL_NODE)
-            continue;
+void AABBTree::_FreeNode(uint32_t nodeIdx)
+{
+    m_nodes[nodeIdx]        = AABBTreeNode();
+    m_nodes[nodeIdx].parent = m_freeList;
+    m_freeList              = nodeIdx;
+}
+
+void AABBTree::_InsertLeaf(uint32_t leafIdx)
+{
+    if (m_root == kAABBTreeNullNode)
+    {
+        m_root                  = leafIdx;
+        m_nodes[leafIdx].parent = kAABBTreeNullNode;
+        return;
+    }
 
-        const AABBNode& node = _nodes[nodeIndex];
-        if (frustum.CheckIntersection(node.aabb))
+    // Walk down to the cheapest sibling for the leaf, by how much surface area pairing it with each would add to the tree
+    uint32_t siblingIdx = m_root;
+    while (!m_nodes[siblingIdx].IsLeaf())
+    {
+        const AABBTreeNode &node = m_nodes[siblingIdx];
+        const AABBTreeNode &leaf = m_nodes[leafIdx];
+        float combinedArea       = UnionArea(node, leaf);
+        float pairCost           = 2.f * combinedArea;                      // Pairing with this node, under a new parent
+        float inheritedCost      = 2.f * (combinedArea - Area(node));       // Every ancestor of a deeper sibling grows too
+        auto descendCost         = [&](const AABBTreeNode &child) {
+            return child.IsLeaf() ? UnionArea(child, leaf) + inheritedCost : UnionArea(child, leaf) - Area(child) + inheritedCost;
+        };
+        float leftCost  = descendCost(m_nodes[node.left]);
+        float rightCost = descendCost(m_nodes[node.right]);
+        if (pairCost < leftCost && pairCost < rightCost)
         {
-            if (node.isLeaf())
-            {
-                overlaps.push_front(node.object);
-            }
-            else
-            {
-                stack.push(node.leftNodeIndex);
-                stack.push(node.rightNodeIndex);
-            }
+            break;
         }
+        siblingIdx = leftCost < rightCost ? node.left : node.right;
+    }
+
+    uint32_t oldParentIdx      = m_nodes[siblingIdx].parent;
+    uint32_t newParentIdx      = this->_AllocateNode();
+    AABBTreeNode &newParent    = m_nodes[newParentIdx];
+    newParent.parent           = oldParentIdx;
+    newParent.left             = siblingIdx;
+    newParent.right            = leafIdx;
+    newParent.min              = glm::min(m_nodes[siblingIdx].min, m_nodes[leafIdx].min);
+    newParent.max              = glm::max(m_nodes[siblingIdx].max, m_nodes[leafIdx].max);
+    newParent.height           = m_nodes[siblingIdx].height + 1;
+    m_nodes[siblingIdx].parent = newParentIdx;
+    m_nodes[leafIdx].parent    = newParentIdx;
+
+    if (oldParentIdx == kAABBTreeNullNode)
+    {
+        m_root = newParentIdx;
+    }
+    else if (m_nodes[oldParentIdx].left == siblingIdx)
+    {
+        m_nodes[oldParentIdx].left = newParentIdx;
+    }
+    else
+    {
+        m_nodes[oldParentIdx].right = newParentIdx;
     }
 
-    return overlaps;
+    this->_FixUpwards(oldParentIdx);
 }
 
-void AABBTree::insertLeaf(unsigned leafNodeIndex)
+void AABBTree::_RemoveLeaf(uint32_t leafIdx)
 {
-    // make sure we're inserting a new leaf
-    assert(_nodes[leafNodeIndex].parentNodeIndex == AABB_NULL_NODE);
-    assert(_nodes[leafNodeIndex].leftNodeIndex == AABB_NULL_NODE);
-    assert(_nodes[leafNodeIndex].rightNodeIndex == AABB_NULL_NODE);
-
-    // if the tree is empty then we make the root the leaf
-    if (_rootNodeIndex == AABB_NULL_NODE)
+    if (leafIdx == m_root)
     {
-        _rootNodeIndex = leafNodeIndex;
+        m_root = kAABBTreeNullNode;
         return;
     }
 
-    // search for the best place to put the new leaf in the tree
-    // we use surface area and depth as search heuristics
-    unsigned treeNodeIndex = _rootNodeIndex;
-    AABBNode& leafNode     = _nodes[leafNodeIndex];
-    while (!_nodes[treeNodeIndex].isLeaf())
+    // The leaf's sibling takes its parent's place
+    uint32_t parentIdx      = m_nodes[leafIdx].parent;
+    uint32_t grandParentIdx = m_nodes[parentIdx].parent;
+    uint32_t siblingIdx     = m_nodes[parentIdx].left == leafIdx ? m_nodes[parentIdx].right : m_nodes[parentIdx].left;
+    if (grandParentIdx == kAABBTreeNullNode)
     {
-        // because of the test in the while loop above we know we are never a leaf inside it
-        const AABBNode& treeNode  = _nodes[treeNodeIndex];
-        unsigned leftNodeIndex    = treeNode.leftNodeIndex;
-        unsigned rightNodeIndex   = treeNode.rightNodeIndex;
-        const AABBNode& leftNode  = _nodes[leftNodeIndex];
-        const AABBNode& rightNode = _nodes[rightNodeIndex];
-
-        AABB combinedAabb = treeNode.aabb.Merge(leafNode.aabb);
+        m_root = siblingIdx;
+    }
+    else if (m_nodes[grandParentIdx].left == parentIdx)
+    {
+        m_nodes[grandParentIdx].left = siblingIdx;
+    }
+    else
+    {
+        m_nodes[grandParentIdx].right = siblingIdx;
+    }
+    m_nodes[siblingIdx].parent = grandParentIdx;
+    m_nodes[leafIdx].parent    = kAABBTreeNullNode;
+    this->_FreeNode(parentIdx);
 
-        float newParentNodeCost   = 2.0f * combinedAabb.surfaceArea;
-        float minimumPushDownCost = 2.0f * (combinedAabb.surfaceArea - treeNode.aabb.surfaceArea);
+    this->_FixUpwards(grandParentIdx);
+}
 
-        // use the costs to figure out whether to create a new parent here or descend
-        float costLeft;
-        float costRight;
-        if (leftNode.isLeaf())
-        {
-            costLeft = leafNode.aabb.Merge(leftNode.aabb).surfaceArea + minimumPushDownCost;
-        }
-        else
-        {
-            AABB newLeftAabb = leafNode.aabb.Merge(leftNode.aabb);
-            costLeft         = (newLeftAabb.surfaceArea - leftNode.aabb.surfaceArea) + minimumPushDownCost;
-        }
-        if (rightNode.isLeaf())
-        {
-            costRight = leafNode.aabb.Merge(rightNode.aabb).surfaceArea + minimumPushDownCost;
-        }
-        else
-        {
-            AABB newRightAabb = leafNode.aabb.Merge(rightNode.aabb);
-            costRight         = (newRightAabb.surfaceArea - rightNode.aabb.surfaceArea) + minimumPushDownCost;
-        }
+// Refits bounds and heights from nodeIdx up to the root, rotating each node on the way
+void AABBTree::_FixUpwards(uint32_t nodeIdx)
+{
+    while (nodeIdx != kAABBTreeNullNode)
+    {
+        AABBTreeNode &node = m_nodes[nodeIdx];
+        node.min           = glm::min(m_nodes[node.left].min, m_nodes[node.right].min);
+        node.max           = glm::max(m_nodes[node.left].max, m_nodes[node.right].max);
+        node.height        = 1 + std::max(m_nodes[node.left].height, m_nodes[node.right].height);
+        this->_Rotate(nodeIdx);
+        nodeIdx = m_nodes[nodeIdx].parent;
+    }
+}
 
-        // if the cost of creating a new parent node here is less than descending in either direction then
-        // we know we need to create a new parent node, errrr, here and attach the leaf to that
-        if (newParentNodeCost < costLeft && newParentNodeCost < costRight)
-        {
-            break;
-        }
+// Swaps a child of the node with one of its grandchildren on the other side, if that shrinks the child left holding the other
+// grandchild. The node's own bounds don't change, as it still holds the same leaves.
+void AABBTree::_Rotate(uint32_t nodeIdx)
+{
+    AABBTreeNode &node = m_nodes[nodeIdx];
+    if (node.height < 2)
+    {
+        return;
+    }
 
-        // otherwise descend in the cheapest direction
-        if (costLeft < costRight)
+    // Best rotation found so far: childIdx moves down under otherChildIdx, in place of grandChildIdx which comes up
+    float bestSaving       = 0.f;
+    uint32_t childIdx      = kAABBTreeNullNode;
+    uint32_t otherChildIdx = kAABBTreeNullNode;
+    uint32_t grandChildIdx = kAABBTreeNullNode;
+    auto consider          = [&](uint32_t swapIdx, uint32_t underIdx) {
+        const AABBTreeNode &under = m_nodes[underIdx];
+        if (under.IsLeaf())
         {
-            treeNodeIndex = leftNodeIndex;
+            return;
         }
-        else
+        for (uint32_t upIdx : {under.left, under.right})
         {
-            treeNodeIndex = rightNodeIndex;
+            uint32_t keptIdx = upIdx == under.left ? under.right : under.left;
+            float saving     = Area(under) - UnionArea(m_nodes[swapIdx], m_nodes[keptIdx]);
+            if (saving > bestSaving)
+            {
+                bestSaving    = saving;
+                childIdx      = swapIdx;
+                otherChildIdx = underIdx;
+                grandChildIdx = upIdx;
+            }
         }
+    };
+    consider(node.left, node.right);
+    consider(node.right, node.left);
+    if (childIdx == kAABBTreeNullNode)
+    {
+        return;
     }
 
-    // the leafs sibling is going to be the node we found above and we are going to create a new
-    // parent node and attach the leaf and this item
-    unsigned leafSiblingIndex   = treeNodeIndex;
-    AABBNode& leafSibling       = _nodes[leafSiblingIndex];
-    unsigned oldParentIndex     = leafSibling.parentNodeIndex;
-    unsigned newParentIndex     = allocateNode();
-    AABBNode& newParent         = _nodes[newParentIndex];
-    newParent.parentNodeIndex   = oldParentIndex;
-    newParent.aabb              = leafNode.aabb.Merge(leafSibling.aabb); // the new parents aabb is the leaf aabb combined with it's siblings aabb
-    newParent.leftNodeIndex     = leafSiblingIndex;
-    newParent.rightNodeIndex    = leafNodeIndex;
-    leafNode.parentNodeIndex    = newParentIndex;
-    leafSibling.parentNodeIndex = newParentIndex;
-
-    if (oldParentIndex == AABB_NULL_NODE)
+    AABBTreeNode &other = m_nodes[otherChildIdx];
+    uint32_t keptIdx    = other.left == grandChildIdx ? other.right : other.left;
+    if (node.left == childIdx)
     {
-        // the old parent was the root and so this is now the root
-        _rootNodeIndex = newParentIndex;
+        node.left = grandChildIdx;
     }
     else
     {
-        // the old parent was not the root and so we need to patch the left or right index to
-        // point to the new node
-        AABBNode& oldParent = _nodes[oldParentIndex];
-        if (oldParent.leftNodeIndex == leafSiblingIndex)
-        {
-            oldParent.leftNodeIndex = newParentIndex;
-        }
-        else
-        {
-            oldParent.rightNodeIndex = newParentIndex;
-        }
+        node.right = grandChildIdx;
+    }
+    if (other.left == grandChildIdx)
+    {
+        other.left = childIdx;
     }
+    else
+    {
+        other.right = childIdx;
+    }
+    m_nodes[grandChildIdx].parent = nodeIdx;
+    m_nodes[childIdx].parent      = otherChildIdx;
 
-    // finally we need to walk back up the tree fixing heights and areas
-    treeNodeIndex = leafNode.parentNodeIndex;
-    fixUpwardsTree(treeNodeIndex);
+    other.min    = glm::min(m_nodes[childIdx].min, m_nodes[keptIdx].min);
+    other.max    = glm::max(m_nodes[childIdx].max, m_nodes[keptIdx].max);
+    other.height = 1 + std::max(m_nodes[childIdx].height, m_nodes[keptIdx].height);
+    node.height  = 1 + std::max(m_nodes[node.left].height, m_nodes[node.right].height);
 }
 
-void AABBTree::removeLeaf(unsigned leafNodeIndex)
+template <typename Overlaps>
+void AABBTree::_Query(const Overlaps &overlaps, std::vector<uint32_t> &objects) const
 {
-    // if the leaf is the root then we can just clear the root pointer and return
-    if (leafNodeIndex == _rootNodeIndex)
+    if (m_root == kAABBTreeNullNode)
     {
-        _rootNodeIndex = AABB_NULL_NODE;
         return;
     }
 
-    AABBNode& leafNode            = _nodes[leafNodeIndex];
-    unsigned parentNodeIndex      = leafNode.parentNodeIndex;
-    const AABBNode& parentNode    = _nodes[parentNodeIndex];
-    unsigned grandParentNodeIndex = parentNode.parentNodeIndex;
-    unsigned siblingNodeIndex     = parentNode.leftNodeIndex == leafNodeIndex ? parentNode.rightNodeIndex : parentNode.leftNodeIndex;
-    assert(siblingNodeIndex != AABB_NULL_NODE); // we must have a sibling
-    AABBNode& siblingNode = _nodes[siblingNodeIndex];
+    // Trees only outgrow the fixed stack if inserts have gone very badly
+    uint32_t stack[kQueryStackSize];
+    size_t nStack = 0;
+    std::vector<uint32_t> deepStack;
+    auto push = [&](uint32_t nodeIdx) {
+        if (nStack < kQueryStackSize)
+        {
+            stack[nStack++] = nodeIdx;
+        }
+        else
+        {
+            deepStack.emplace_back(nodeIdx);
+        }
+    };
 
-    if (grandParentNodeIndex != AABB_NULL_NODE)
+    push(m_root);
+    while (nStack > 0 || !deepStack.empty())
     {
-        // if we have a grand parent (i.e. the parent is not the root) then destroy the parent and connect the sibling to the grandparent in
-        // its place
-        AABBNode& grandParentNode = _nodes[grandParentNodeIndex];
-        if (grandParentNode.leftNodeIndex == parentNodeIndex)
+        uint32_t nodeIdx;
+        if (!deepStack.empty())
         {
-            grandParentNode.leftNodeIndex = siblingNodeIndex;
+            nodeIdx = deepStack.back();
+            deepStack.pop_back();
         }
         else
         {
-            grandParentNode.rightNodeIndex = siblingNodeIndex;
+            nodeIdx = stack[--nStack];
         }
-        siblingNode.parentNodeIndex = grandParentNodeIndex;
-        deallocateNode(parentNodeIndex);
 
-        fixUpwardsTree(grandParentNodeIndex);
-    }
-    else
-    {
-        // if we have no grandparent then the parent is the root and so our sibling becomes the root and has it's parent removed
-        _rootNodeIndex              = siblingNodeIndex;
-        siblingNode.parentNodeIndex = AABB_NULL_NODE;
-        deallocateNode(parentNodeIndex);
+        const AABBTreeNode &node = m_nodes[nodeIdx];
+        if (!overlaps(node.min, node.max))
+        {
+            continue;
+        }
+        if (node.IsLeaf())
+        {
+            objects.emplace_back(node.object);
+        }
+        else
+        {
+            push(node.left);
+            push(node.right);
+        }
     }
+}
 
-    leafNode.parentNodeIndex = AABB_NULL_NODE;
+void AABBTree::QueryFrustum(const Frustum &frustum, std::vector<uint32_t> &objects) const
+{
+    this->_Query([&](const glm::vec3 &min, const glm::vec3 &max) { return frustum.CheckIntersection(min, max); }, objects);
 }
 
-void AABBTree::updateLeaf(unsigned leafNodeIndex, const AABB& newAaab)
+void AABBTree::QuerySphere(const glm::vec3 &centre, float radius, std::vector<uint32_t> &objects) const
 {
-    AABBNode& node = _nodes[leafNodeIndex];
+    this->_Query(
+      [&](const glm::vec3 &min, const glm::vec3 &max) {
+          glm::vec3 offset = glm::clamp(centre, min, max) - centre;
+          return glm::dot(offset, offset) <= radius * radius;
+      },
+      objects);
+}
 
-    // if the node contains the new aabb then we just leave things
-    // TODO: when we add velocity this check should kick in as often an update will lie within the velocity fattened initial aabb
-    // to support this we might need to differentiate between velocity fattened aabb and actual aabb
-    if (node.aabb.Contains(newAaab))
-        return;
+void AABBTree::QueryRay(const glm::vec3 &origin, const glm::vec3 &direction, float maxDistance, std::vector<uint32_t> &objects) const
+{
+    this->_Query(
+      [&](const glm::vec3 &min, const glm::vec3 &max) {
+          // Slab test, distances along the ray in units of direction
+          float tMin = 0.f, tMax = maxDistance;
+          for (int axis = 0; axis < 3; ++axis)
+          {
+              if (direction[axis] == 0.f)
+              {
+                  if (origin[axis] < min[axis] || origin[axis] > max[axis])
+                  {
+                      return false;
+                  }
+                  continue;
+              }
+              float t1 = (min[axis] - origin[axis]) / direction[axis];
+              float t2 = (max[axis] - origin[axis]) / direction[axis];
+              tMin     = std::max(tMin, std::min(t1, t2));
+              tMax     = std::min(tMax, std::max(t1, t2));
+          }
+          return tMin <= tMax;
+      },
+      objects);
+}
 
-    removeLeaf(leafNodeIndex);
-    node.aabb = newAaab;
-    insertLeaf(leafNodeIndex);
+int32_t AABBTree::GetHeight() const
+{
+    return m_root == kAABBTreeNullNode ? 0 : m_nodes[m_root].height;
 }
 
-void AABBTree::fixUpwardsTree(unsigned treeNodeIndex)
+float AABBTree::GetCost() const
 {
-    while (treeNodeIndex != AABB_NULL_NODE)
+    if (m_root == kAABBTreeNullNode || m_nodes[m_root].IsLeaf())
     {
-        AABBNode& treeNode = _nodes[treeNodeIndex];
-
-        // every node should be a parent
-        assert(treeNode.leftNodeIndex != AABB_NULL_NODE && treeNode.rightNodeIndex != AABB_NULL_NODE);
+        return 0.f;
+    }
+    float internalArea = 0.f;
+    for (auto &node : m_nodes)
+    {
+        if (node.height > 0)
+        {
+            internalArea += Area(node);
+        }
+    }
+    return internalArea / Area(m_nodes[m_root]);
+}
 
-        // fix height and area
-        const AABBNode& leftNode  = _nodes[treeNode.leftNodeIndex];
-        const AABBNode& rightNode = _nodes[treeNode.rightNodeIndex];
-        treeNode.aabb             = leftNode.aabb.Merge(rightNode.aabb);
+bool AABBTree::Validate() const
+{
+    size_t nLeaves = 0;
+    for (uint32_t object = 0; object < m_objectLeaves.size(); ++object)
+    {
+        uint32_t leafIdx = m_objectLeaves[object];
+        if (leafIdx == kAABBTreeNullNode)
+        {
+            continue;
+        }
+        if (!m_nodes[leafIdx].IsLeaf() || m_nodes[leafIdx].object != object)
+        {
+            return false;
+        }
+        ++nLeaves;
+    }
+    return nLeaves == m_nObjects && (m_root == kAABBTreeNullNode ? m_nObjects == 0 : this->_ValidateNode(m_root, kAABBTreeNullNode));
+}
 
-        treeNodeIndex = treeNode.parentNodeIndex;
+bool AABBTree::_ValidateNode(uint32_t nodeIdx, uint32_t parentIdx) const
+{
+    const AABBTreeNode &node = m_nodes[nodeIdx];
+    if (node.parent != parentIdx)
+    {
+        return false;
+    }
+    if (node.IsLeaf())
+    {
+        return node.height == 0 && node.right == kAABBTreeNullNode && m_objectLeaves[node.object] == nodeIdx;
     }
+    const AABBTreeNode &left  = m_nodes[node.left];
+    const AABBTreeNode &right = m_nodes[node.right];
+    return node.height == 1 + std::max(left.height, right.height) && node.min == glm::min(left.min, right.min) && node.max == glm::max(left.max, right.max) &&
+           this->_ValidateNode(node.left, nodeIdx) && this->_ValidateNode(node.right, nodeIdx);
 }
@@ -1,61 +1,83 @@
 #pragma once
 
-#include <memory>
+#include <cstdint>
 #include <vector>
-#include <map>
-#include <forward_list>
+#include <glm/glm.hpp>
 
 #include "AABB.h"
 #include "Frustum.h"
-#include "IAABB.h"
 
-#define AABB_NULL_NODE 0xffffffff
+constexpr uint32_t kAABBTreeNullNode = UINT32_MAX;
 
-struct AABBNode
+struct AABBTreeNode
 {
-    AABB aabb;
-    std::shared_ptr<IAABB> object;
-    // tree links
-    unsigned parentNodeIndex;
-    unsigned leftNodeIndex;
-    unsigned rightNodeIndex;
-    // node linked list link
-    unsigned nextNodeIndex;
-
-    bool isLeaf() const
-    {
-        return leftNodeIndex == AABB_NULL_NODE;
-    }
+    glm::vec3 min, max; // World space, fattened by the tree's margin for leaves
+    uint32_t parent = kAABBTreeNullNode; // Next free node while unused
+    uint32_t left   = kAABBTreeNullNode;
+    uint32_t right  = kAABBTreeNullNode;
+    uint32_t object = kAABBTreeNullNode; // Leaves only
+    int32_t height  = -1;                // 0 for leaves, -1 while unused
 
-    AABBNode() : object(nullptr), parentNodeIndex(AABB_NULL_NODE), leftNodeIndex(AABB_NULL_NODE), rightNodeIndex(AABB_NULL_NODE), nextNodeIndex(AABB_NULL_NODE)
+    bool IsLeaf() const
     {
+        return left == kAABBTreeNullNode;
     }
 };
 
+// Dynamic bounding volume hierarchy over world space AABBs, one object per leaf. Objects are the caller's 32 bit handles, dense like
+// indices into its own arrays, as the tree keeps a leaf per handle to find them again. Nodes live in one flat array and queries write
+// into a buffer the caller keeps, so neither allocates once they've grown to fit.
+// Build lays out a whole set top down by binned SAH. Insert picks the cheapest sibling by surface area then rotates nodes on the way
+// back up to the root, keeping a tree built up one object at a time close to a built one.
 class AABBTree
 {
-private:
-    std::map<std::shared_ptr<IAABB>, unsigned> _objectNodeIndexMap;
-    std::vector<AABBNode> _nodes;
-    unsigned _rootNodeIndex;
-    unsigned _allocatedNodeCount;
-    unsigned _nextFreeNodeIndex;
-    unsigned _nodeCapacity;
-    unsigned _growthSize;
-
-    unsigned allocateNode();
-    void deallocateNode(unsigned nodeIndex);
-    void insertLeaf(unsigned leafNodeIndex);
-    void removeLeaf(unsigned leafNodeIndex);
-    void updateLeaf(unsigned leafNodeIndex, const AABB& newAaab);
-    void fixUpwardsTree(unsigned treeNodeIndex);
-
 public:
-    AABBTree(unsigned initialSize);
-    ~AABBTree();
+    explicit AABBTree(float margin = 0.f);
+    // Replaces everything in the tree with object i bounded by bounds[i]
+    void Build(const std::vector<AABB> &bounds);
+    void Clear();
+    void Insert(uint32_t object, const AABB &aabb);
+    void Remove(uint32_t object);
+    // Reinserts object only if it has left its leaf's fattened bounds, returning whether it did
+    bool Update(uint32_t object, const AABB &aabb);
+    // For many objects moving at once: set each one's bounds in place, then Refit the whole tree in one pass. Cheaper than Update for
+    // each, though the tree is never restructured so degrades as objects move away from where they were built.
+    void SetBounds(uint32_t object, const AABB &aabb);
+    void Refit();
+
+    // Objects whose bounds pass Frustum::CheckIntersection, are within radius of centre, or are hit by the ray before maxDistance. Each
+    // appends to objects, in no particular order.
+    void QueryFrustum(const Frustum &frustum, std::vector<uint32_t> &objects) const;
+    void QuerySphere(const glm::vec3 &centre, float radius, std::vector<uint32_t> &objects) const;
+    void QueryRay(const glm::vec3 &origin, const glm::vec3 &direction, float maxDistance, std::vector<uint32_t> &objects) const;
+
+    size_t Size() const
+    {
+        return m_nObjects;
+    }
+    int32_t GetHeight() const;
+    // Summed surface area of the internal nodes relative to the root's, lower is better
+    float GetCost() const;
+    // Checks every link, height and bound, for tests
+    bool Validate() const;
+
+private:
+    uint32_t _AllocateNode();
+    void _FreeNode(uint32_t nodeIdx);
+    uint32_t _BuildRange(std::vector<uint32_t> &leaves, size_t begin, size_t end, const std::vector<glm::vec3> &centroids);
+    void _InsertLeaf(uint32_t leafIdx);
+    void _RemoveLeaf(uint32_t leafIdx);
+    void _FixUpwards(uint32_t nodeIdx);
+    void _Rotate(uint32_t nodeIdx);
+    void _RefitNode(uint32_t nodeIdx);
+    bool _ValidateNode(uint32_t nodeIdx, uint32_t parentIdx) const;
+    template <typename Overlaps>
+    void _Query(const Overlaps &overlaps, std::vector<uint32_t> &objects) const;
 
-    void insertObject(const std::shared_ptr<IAABB>& object);
-    void removeObject(const std::shared_ptr<IAABB>& object);
-    void updateObject(const std::shared_ptr<IAABB>& object);
-    std::forward_list<std::shared_ptr<IAABB>> queryOverlaps(const Frustum& frustum) const;
+    std::vector<AABBTreeNode> m_nodes;
+    std::vector<uint32_t> m_objectLeaves; // Leaf of each object handle, kAABBTreeNullNode if it isn't in the tree
+    uint32_t m_root     = kAABBTreeNullNode;
+    uint32_t m_freeList = kAABBTreeNullNode;
+    size_t m_nObjects   = 0;
+    float m_margin;
 };
@@ -1,6 +1,7 @@
 #include "Car.h"
 
 #include "../Scene/Entity.h"
+#include "VroadRangefinder.h"
 
 // Forward casts should extend further than L/R
 constexpr float kCastDistances[kNumRangefinders] = {
@@ -19,7 +20,7 @@ Car::Car(const CarData &carData, NFSVer nfsVersion, const std::string &carID) :
     name = carData.carName.empty() ? id : carData.carName;
 
     // Load in vehicle texture data to OpenGL
-    if (!Config::get().vulkanRender)
+    if (Config::get().UseGL())
     {
         this->_LoadTextures();
     }
@@ -48,22 +49,48 @@ Car::~Car()
     }
     // And bullet collision shapes on heap
     m_collisionShapes.clear();
-    // And the loaded GL textures
-    if (renderInfo.isMultitexturedModel)
+    // And the loaded GL textures, simulation only cars never made any
+    if (Config::get().UseGL())
     {
-        // TODO: Store number of textures so can pass correct parameter here
-        glDeleteTextures(1, &renderInfo.textureArrayID);
+        if (renderInfo.isMultitexturedModel)
+        {
+            // TODO: Store number of textures so can pass correct parameter here
+            glDeleteTextures(1, &renderInfo.textureArrayID);
+        }
+        else
+        {
+            glDeleteTextures(1, &renderInfo.textureID);
+        }
     }
-    else
+}
+
+VehiclePose VehiclePose::Interpolate(const VehiclePose &from, const VehiclePose &to, float alpha)
+{
+    VehiclePose interpolatedPose;
+    interpolatedPose.chassisPosition    = glm::mix(from.chassisPosition, to.chassisPosition, alpha);
+    interpolatedPose.chassisOrientation = glm::slerp(from.chassisOrientation, to.chassisOrientation, alpha);
+    for (uint8_t wheelIdx = 0; wheelIdx < 4; ++wheelIdx)
     {
-        glDeleteTextures(1, &renderInfo.textureID);
+        interpolatedPose.wheelPositions[wheelIdx]    = glm::mix(from.wheelPositions[wheelIdx], to.wheelPositions[wheelIdx], alpha);
+        interpolatedPose.wheelOrientations[wheelIdx] = glm::slerp(from.wheelOrientations[wheelIdx], to.wheelOrientations[wheelIdx], alpha);
     }
+    return interpolatedPose;
+}
+
+VehicleTelemetry Car::GetTelemetry() const
+{
+    VehicleTelemetry telemetry;
+    telemetry.state           = vehicleState;
+    telemetry.properties      = vehicleProperties;
+    telemetry.rangefinderInfo = rangefinderInfo;
+    telemetry.speed           = m_vehicle->getCurrentSpeedKmHour();
+    return telemetry;
 }
 
 void Car::Update(btDynamicsWorld *dynamicsWorld)
 {
-    // Update car
-    this->_UpdateMeshesToMatchPhysics();
+    // Read back the chassis and wheel transforms
+    this->_UpdatePose();
     // Apply user input
     this->_ApplyInputs();
     // Update raycasts
@@ -143,8 +170,67 @@ void Car::SetPosition(glm::vec3 position, glm::quat orientation)
     btTransform positionTransform = Utils::MakeTransform(position, orientation);
     m_carChassis->setWorldTransform(positionTransform);
 
-    // Update mesh positions to match new chassis transform
-    this->_UpdateMeshesToMatchPhysics();
+    // Keep the pose in step with the new chassis transform, meshes follow when the renderer next places them
+    this->_UpdatePose();
+    if (m_vroadRangefinder != nullptr)
+    {
+        m_vroadRangefinder->ResetLocation();
+    }
+}
+
+void Car::SetLinearVelocity(const glm::vec3 &linearVelocity)
+{
+    m_carChassis->setLinearVelocity(Utils::glmToBullet(linearVelocity));
+    m_carChassis->setInterpolationLinearVelocity(Utils::glmToBullet(linearVelocity));
+}
+
+void Car::SetKinematicPose(const glm::vec3 &position, const glm::quat &orientation)
+{
+    // Parked bodies aren't synchronised with their motion state by Bullet, and the pose is read back from the motion state
+    btTransform positionTransform = Utils::MakeTransform(position, orientation);
+    m_carChassis->setWorldTransform(positionTransform);
+    m_vehicleMotionState->setWorldTransform(positionTransform);
+    this->_UpdatePose();
+}
+
+void Car::ResetState()
+{
+    m_carChassis->clearForces();
+    m_carChassis->setLinearVelocity(btVector3(0, 0, 0));
+    m_carChassis->setAngularVelocity(btVector3(0, 0, 0));
+    m_carChassis->setInterpolationLinearVelocity(btVector3(0, 0, 0));
+    m_carChassis->setInterpolationAngularVelocity(btVector3(0, 0, 0));
+    m_vehicle->resetSuspension();
+    for (int wheelIdx = 0; wheelIdx < m_vehicle->getNumWheels(); ++wheelIdx)
+    {
+        btWheelInfo &wheel            = m_vehicle->getWheelInfo(wheelIdx);
+        wheel.m_rotation              = 0.f;
+        wheel.m_deltaRotation         = 0.f;
+        wheel.m_engineForce           = 0.f;
+        wheel.m_brake                 = 0.f;
+        wheel.m_steering              = 0.f;
+        wheel.m_skidInfo              = 1.f;
+        wheel.m_wheelsSuspensionForce = 0.f;
+    }
+
+    vehicleState    = VehicleState{};
+    rangefinderInfo = RangefinderInfo{};
+}
+
+void Car::SetRangefinders(RangefinderType rangefinderType, const std::shared_ptr<Track> &track)
+{
+    m_rangefinderType = rangefinderType;
+    m_vroadRangefinder.reset();
+    if (m_rangefinderType != WORLD_RANGEFINDER)
+    {
+        ASSERT(track != nullptr, "Vroad rangefinders need a track to cast against");
+        m_vroadRangefinder = std::make_shared<VroadRangefinder>(track);
+    }
+}
+
+glm::vec3 Car::GetPosition() const
+{
+    return m_pose.chassisPosition + (carBodyModel.initialPosition * glm::inverse(m_pose.chassisOrientation));
 }
 
 float Car::GetCarBodyOrientation()
@@ -153,59 +239,58 @@ float Car::GetCarBodyOrientation()
     return glm::degrees(atan2(2 * orientation.y * orientation.w - 2 * orientation.x * orientation.z, 1 - 2 * orientation.y * orientation.y - 2 * orientation.z * orientation.z));
 }
 
-void Car::_UpdateMeshesToMatchPhysics()
+void Car::UpdateMeshes()
 {
-    btTransform trans;
-    m_vehicleMotionState->getWorldTransform(trans);
-    carBodyModel.position    = Utils::bulletToGlm(trans.getOrigin()) + (carBodyModel.initialPosition * glm::inverse(Utils::bulletToGlm(trans.getRotation())));
-    carBodyModel.orientation = Utils::bulletToGlm(trans.getRotation());
+    this->UpdateMeshes(m_pose);
+}
+
+void Car::UpdateMeshes(const VehiclePose &vehiclePose)
+{
+    glm::vec3 chassisPosition    = vehiclePose.chassisPosition;
+    glm::quat chassisOrientation = vehiclePose.chassisOrientation;
+
+    carBodyModel.position    = chassisPosition + (carBodyModel.initialPosition * glm::inverse(chassisOrientation));
+    carBodyModel.orientation = chassisOrientation;
     carBodyModel.update();
 
     // Might as well apply the body transform to the Miscellaneous models
     for (auto &miscModel : miscModels)
     {
-        miscModel.position    = Utils::bulletToGlm(trans.getOrigin()) + (miscModel.initialPosition * glm::inverse(Utils::bulletToGlm(trans.getRotation())));
-        miscModel.orientation = Utils::bulletToGlm(trans.getRotation());
+        miscModel.position    = chassisPosition + (miscModel.initialPosition * glm::inverse(chassisOrientation));
+        miscModel.orientation = chassisOrientation;
         miscModel.update();
     }
 
-    // Update headlight direction vectors to match car body
-    leftHeadlight.direction  = Utils::bulletToGlm(m_vehicle->getForwardVector());
-    rightHeadlight.direction = Utils::bulletToGlm(m_vehicle->getForwardVector());
-    leftHeadlight.position   = Utils::bulletToGlm(trans.getOrigin()) + (leftHeadlight.initialPosition * glm::inverse(Utils::bulletToGlm(trans.getRotation())));
-    rightHeadlight.position  = Utils::bulletToGlm(trans.getOrigin()) + (rightHeadlight.initialPosition * glm::inverse(Utils::bulletToGlm(trans.getRotation())));
+    // Update headlight direction vectors to match car body, the vehicle forward axis is Z
+    leftHeadlight.direction  = chassisOrientation * glm::vec3(0, 0, 1);
+    rightHeadlight.direction = chassisOrientation * glm::vec3(0, 0, 1);
+    leftHeadlight.position   = chassisPosition + (leftHeadlight.initialPosition * glm::inverse(chassisOrientation));
+    rightHeadlight.position  = chassisPosition + (rightHeadlight.initialPosition * glm::inverse(chassisOrientation));
 
     // Lets go update wheel geometry positions based on physics feedback
+    CarModel *wheelModels[4] = {&leftFrontWheelModel, &rightFrontWheelModel, &leftRearWheelModel, &rightRearWheelModel};
+    for (uint8_t wheelIdx = 0; wheelIdx < 4; ++wheelIdx)
+    {
+        wheelModels[wheelIdx]->position    = vehiclePose.wheelPositions[wheelIdx];
+        wheelModels[wheelIdx]->orientation = vehiclePose.wheelOrientations[wheelIdx];
+        wheelModels[wheelIdx]->update();
+    }
+}
+
+void Car::_UpdatePose()
+{
+    btTransform trans;
+    m_vehicleMotionState->getWorldTransform(trans);
+    m_pose.chassisPosition    = Utils::bulletToGlm(trans.getOrigin());
+    m_pose.chassisOrientation = Utils::bulletToGlm(trans.getRotation());
+
+    ASSERT(m_vehicle->getNumWheels() <= 4, "More than 4 wheels currently unsupported");
     for (int wheelIdx = 0; wheelIdx < m_vehicle->getNumWheels(); ++wheelIdx)
     {
         m_vehicle->updateWheelTransform(wheelIdx, true);
-        trans = m_vehicle->getWheelInfo(wheelIdx).m_worldTransform;
-        switch (wheelIdx)
-        {
-        case Wheels::FRONT_LEFT:
-            leftFrontWheelModel.position    = Utils::bulletToGlm(trans.getOrigin());
-            leftFrontWheelModel.orientation = Utils::bulletToGlm(trans.getRotation());
-            leftFrontWheelModel.update();
-            break;
-        case Wheels::FRONT_RIGHT:
-            rightFrontWheelModel.position    = Utils::bulletToGlm(trans.getOrigin());
-            rightFrontWheelModel.orientation = Utils::bulletToGlm(trans.getRotation());
-            rightFrontWheelModel.update();
-            break;
-        case Wheels::REAR_LEFT:
-            leftRearWheelModel.position    = Utils::bulletToGlm(trans.getOrigin());
-            leftRearWheelModel.orientation = Utils::bulletToGlm(trans.getRotation());
-            leftRearWheelModel.update();
-            break;
-        case Wheels::REAR_RIGHT:
-            rightRearWheelModel.position    = Utils::bulletToGlm(trans.getOrigin());
-            rightRearWheelModel.orientation = Utils::bulletToGlm(trans.getRotation());
-            rightRearWheelModel.update();
-            break;
-        default:
-            ASSERT(false, "More than 4 wheels currently unsupported");
-            break;
-        }
+        trans                              = m_vehicle->getWheelInfo(wheelIdx).m_worldTransform;
+        m_pose.wheelPositions[wheelIdx]    = Utils::bulletToGlm(trans.getOrigin());
+        m_pose.wheelOrientations[wheelIdx] = Utils::bulletToGlm(trans.getRotation());
     }
 }
 
@@ -340,6 +425,16 @@ void Car::_GenPhysicsModel()
     m_carChassis->setDamping(0.2f, 0.2f);
     m_carChassis->setLinearVelocity(btVector3(0, 0, 0));
     m_carChassis->setAngularVelocity(btVector3(0, 0, 0));
+
+    // Until the vehicle is first stepped, its pose is wherever the meshes were loaded
+    m_pose.chassisPosition    = carBodyModel.position;
+    m_pose.chassisOrientation = carBodyModel.orientation;
+    CarModel *wheelModels[4]  = {&leftFrontWheelModel, &rightFrontWheelModel, &leftRearWheelModel, &rightRearWheelModel};
+    for (uint8_t wheelIdx = 0; wheelIdx < 4; ++wheelIdx)
+    {
+        m_pose.wheelPositions[wheelIdx]    = wheelModels[wheelIdx]->position;
+        m_pose.wheelOrientations[wheelIdx] = wheelModels[wheelIdx]->orientation;
+    }
 }
 
 void Car::_GenRaycasts(btDynamicsWorld *dynamicsWorld)
@@ -349,37 +444,61 @@ void Car::_GenRaycasts(btDynamicsWorld *dynamicsWorld)
     glm::vec3 carBodyPosition = Utils::bulletToGlm(trans.getOrigin());
 
     // Get base vectors
-    glm::vec3 carUp      = carBodyModel.ModelMatrix * glm::vec4(0, 1, 0, 0);
+    glm::vec3 carUp      = m_pose.chassisOrientation * glm::vec3(0, 1, 0);
     glm::vec3 carForward = Utils::bulletToGlm(m_vehicle->getForwardVector());
 
-    btCollisionWorld::ClosestRayResultCallback *rayCallbacks[kNumRangefinders];
-    glm::vec3 castVectors[kNumRangefinders];
-
     for (uint8_t rangeIdx = 0; rangeIdx < kNumRangefinders; ++rangeIdx)
     {
         // Calculate base vector from -90 + (rangeIdx * kAngleBetweenRays) from car forward vector
-        castVectors[rangeIdx] = carForward * glm::normalize(glm::quat(glm::vec3(0, glm::radians(-90.f + (rangeIdx * kAngleBetweenRays)), 0)));
+        glm::vec3 castVector = carForward * glm::normalize(glm::quat(glm::vec3(0, glm::radians(-90.f + (rangeIdx * kAngleBetweenRays)), 0)));
         // Calculate where the ray will cast out to
-        rangefinderInfo.castPositions[rangeIdx] = carBodyPosition + (castVectors[rangeIdx] * kCastDistances[rangeIdx]);
-        rayCallbacks[rangeIdx] = new btCollisionWorld::ClosestRayResultCallback(Utils::glmToBullet(carBodyPosition), Utils::glmToBullet(rangefinderInfo.castPositions[rangeIdx]));
+        rangefinderInfo.castPositions[rangeIdx] = carBodyPosition + (castVector * kCastDistances[rangeIdx]);
+    }
+    rangefinderInfo.upCastPosition   = (carBodyPosition + (carUp * kCastDistance));
+    rangefinderInfo.downCastPosition = (carBodyPosition + (-carUp * kCastDistance));
+
+    switch (m_rangefinderType)
+    {
+    case VROAD_RANGEFINDER:
+        m_vroadRangefinder->Cast(carBodyPosition, rangefinderInfo);
+        break;
+    case VALIDATING_RANGEFINDER:
+        this->_CastRangefindersWorld(dynamicsWorld, carBodyPosition);
+        m_vroadRangefinder->Validate(carBodyPosition, rangefinderInfo);
+        break;
+    case WORLD_RANGEFINDER:
+    default:
+        this->_CastRangefindersWorld(dynamicsWorld, carBodyPosition);
+        break;
+    }
+    // Always against the world, whatever the rangefinders use. Training reads these for flips and for being inside the vroad
+    // ceiling, which only the world has.
+    this->_CastUpDownWorld(dynamicsWorld, carBodyPosition);
+}
+
+void Car::_CastRangefindersWorld(btDynamicsWorld *dynamicsWorld, const glm::vec3 &carBodyPosition)
+{
+    for (uint8_t rangeIdx = 0; rangeIdx < kNumRangefinders; ++rangeIdx)
+    {
+        btCollisionWorld::ClosestRayResultCallback rayCallback(Utils::glmToBullet(carBodyPosition), Utils::glmToBullet(rangefinderInfo.castPositions[rangeIdx]));
         // Don't Raycast against other opponents for now. Ghost through them. Only interested in VROAD edge.
-        rayCallbacks[rangeIdx]->m_collisionFilterMask = COL_TRACK;
+        rayCallback.m_collisionFilterMask = COL_TRACK;
         // Perform the raycast
-        dynamicsWorld->rayTest(Utils::glmToBullet(carBodyPosition), Utils::glmToBullet(rangefinderInfo.castPositions[rangeIdx]), *rayCallbacks[rangeIdx]);
+        dynamicsWorld->rayTest(Utils::glmToBullet(carBodyPosition), Utils::glmToBullet(rangefinderInfo.castPositions[rangeIdx]), rayCallback);
         // Check whether we hit anything
-        if (rayCallbacks[rangeIdx]->hasHit())
+        if (rayCallback.hasHit())
         {
-            rangefinderInfo.rangefinders[rangeIdx] = glm::distance(carBodyPosition, Utils::bulletToGlm(rayCallbacks[rangeIdx]->m_hitPointWorld));
+            rangefinderInfo.rangefinders[rangeIdx] = glm::distance(carBodyPosition, Utils::bulletToGlm(rayCallback.m_hitPointWorld));
         }
         else
         {
             rangefinderInfo.rangefinders[rangeIdx] = kFarDistance;
         }
-        delete rayCallbacks[rangeIdx];
     }
-    rangefinderInfo.upCastPosition   = (carBodyPosition + (carUp * kCastDistance));
-    rangefinderInfo.downCastPosition = (carBodyPosition + (-carUp * kCastDistance));
+}
 
+void Car::_CastUpDownWorld(btDynamicsWorld *dynamicsWorld, const glm::vec3 &carBodyPosition)
+{
     btCollisionWorld::ClosestRayResultCallback upRayCallback(Utils::glmToBullet(carBodyPosition), Utils::glmToBullet(rangefinderInfo.upCastPosition));
     btCollisionWorld::ClosestRayResultCallback downRayCallback(Utils::glmToBullet(carBodyPosition), Utils::glmToBullet(rangefinderInfo.downCastPosition));
     // Up raycast is used to check for flip over, and also whether inside VROAD
@@ -7,6 +7,7 @@
 #include <BulletDynamics/Vehicle/btRaycastVehicle.h>
 #include <BulletCollision/CollisionShapes/btBoxShape.h>
 #include <btBulletDynamicsCommon.h>
+#include <memory>
 
 #include "../RaceNet/RaceNet.h"
 #include "../Scene/Lights/Spotlight.h"
@@ -15,6 +16,9 @@
 #include "../Util/Utils.h"
 #include "../Enums.h"
 
+class Track;
+class VroadRangefinder;
+
 // Raycasting Data
 enum RayDirection : uint8_t
 {
@@ -89,6 +93,27 @@ struct RangefinderInfo
     float upDistance = 0.f, downDistance = 0.f;
 };
 
+// Chassis and wheel transforms captured from Bullet after a physics step. Meshes are placed from a pose rather than straight
+// from the motion state, so the renderer can place them from a snapshot while physics runs on another thread.
+struct VehiclePose
+{
+    glm::vec3 chassisPosition;
+    glm::quat chassisOrientation;
+    glm::vec3 wheelPositions[4];
+    glm::quat wheelOrientations[4];
+
+    static VehiclePose Interpolate(const VehiclePose &from, const VehiclePose &to, float alpha);
+};
+
+// What the debug views show of a vehicle besides its pose, copied out after a physics step alongside it
+struct VehicleTelemetry
+{
+    VehicleState state;
+    VehicleProperties properties;
+    RangefinderInfo rangefinderInfo;
+    float speed = 0.f; // km/h
+};
+
 struct RenderInfo
 {
     bool isMultitexturedModel = false;
@@ -103,7 +128,16 @@ public:
     Car(const CarData& carData, NFSVer nfsVersion, const std::string& carID, GLuint textureArrayID); // Multitextured car
     ~Car();
     void Update(btDynamicsWorld* dynamicsWorld);
+    void UpdateMeshes();
+    void UpdateMeshes(const VehiclePose& vehiclePose);
     void SetPosition(glm::vec3 position, glm::quat orientation);
+    void SetLinearVelocity(const glm::vec3& linearVelocity);
+    // Moves a parked car without touching its dynamics, for cars driven along the track outside of the physics world
+    void SetKinematicPose(const glm::vec3& position, const glm::quat& orientation);
+    void ResetState(); // Back to a standstill with no inputs, wheel spin or sensor readings, so a reused car starts like a new one
+    // World rangefinders ray test the Bullet world and need no track, the vroad ones cast against track's virtual road walls
+    void SetRangefinders(RangefinderType rangefinderType, const std::shared_ptr<Track>& track);
+    glm::vec3 GetPosition() const;
     void ApplyAccelerationForce(bool accelerate, bool reverse);
     void ApplyBrakingForce(bool apply);
     void ApplySteeringRight(bool apply);
@@ -111,14 +145,14 @@ public:
     void ApplyAbsoluteSteerAngle(float targetAngle);
     float GetCarBodyOrientation();
 
-    // Physics Engine registration
+    // Physics Engine registration, the car takes ownership and frees whatever the last world registered it with
     void SetVehicle(btRaycastVehicle* vehicle)
     {
-        m_vehicle = vehicle;
+        m_vehicle.reset(vehicle);
     }
     void SetRaycaster(btVehicleRaycaster* vehicleRayCaster)
     {
-        m_vehicleRayCaster = vehicleRayCaster;
+        m_vehicleRayCaster.reset(vehicleRayCaster);
     }
     btRigidBody* GetVehicleRigidBody()
     {
@@ -126,12 +160,17 @@ public:
     }
     btVehicleRaycaster* GetRaycaster()
     {
-        return m_vehicleRayCaster;
+        return m_vehicleRayCaster.get();
     }
     btRaycastVehicle* GetVehicle()
     {
-        return m_vehicle;
+        return m_vehicle.get();
+    }
+    const VehiclePose& GetPose() const
+    {
+        return m_pose;
     }
+    VehicleTelemetry GetTelemetry() const;
 
     std::string name;
     std::string id;
@@ -143,6 +182,7 @@ public:
     VehicleState vehicleState{};
     RangefinderInfo rangefinderInfo{};
     RenderInfo renderInfo{};
+    VehicleTelemetry renderTelemetry{}; // From the snapshot the meshes were last placed from, render thread only
 
     // Meshes and Headlights
     Spotlight leftHeadlight{};
@@ -158,11 +198,13 @@ public:
     btRaycastVehicle::btVehicleTuning tuning;
 
 private:
-    void _UpdateMeshesToMatchPhysics();
+    void _UpdatePose();
     void _ApplyInputs();
     void _LoadTextures();
     void _GenPhysicsModel();
     void _GenRaycasts(btDynamicsWorld* dynamicsWorld);
+    void _CastRangefindersWorld(btDynamicsWorld* dynamicsWorld, const glm::vec3& carBodyPosition);
+    void _CastUpDownWorld(btDynamicsWorld* dynamicsWorld, const glm::vec3& carBodyPosition);
     void _SetModels(std::vector<CarModel> carModels);
     void _SetVehicleProperties();
 
@@ -170,6 +212,12 @@ private:
     btDefaultMotionState* m_vehicleMotionState{}; // Retrieving vehicle location in world
     btRigidBody* m_carChassis{};
     btAlignedObjectArray<btCollisionShape*> m_collisionShapes;
-    btVehicleRaycaster* m_vehicleRayCaster{}; // Wheel simulation
-    btRaycastVehicle* m_vehicle{};
+    std::unique_ptr<btVehicleRaycaster> m_vehicleRayCaster; // Wheel simulation
+    std::unique_ptr<btRaycastVehicle> m_vehicle;
+
+    // Last transforms read back from Bullet, owned by whichever thread steps the physics
+    VehiclePose m_pose{};
+
+    RangefinderType m_rangefinderType = WORLD_RANGEFINDER;
+    std::shared_ptr<VroadRangefinder> m_vroadRangefinder;
 };
@@ -0,0 +1,28 @@
+#include "CullingBounds.h"
+
+void CullingBounds::Add(const AABB &aabb)
+{
+    if (m_nBoxes % kCullingBatchSize == 0)
+    {
+        for (auto *axis : {&minX, &minY, &minZ, &maxX, &maxY, &maxZ})
+        {
+            axis->resize(m_nBoxes + kCullingBatchSize, 0.f);
+        }
+    }
+    minX[m_nBoxes] = aabb.position.x + aabb.min.x;
+    minY[m_nBoxes] = aabb.position.y + aabb.min.y;
+    minZ[m_nBoxes] = aabb.position.z + aabb.min.z;
+    maxX[m_nBoxes] = aabb.position.x + aabb.max.x;
+    maxY[m_nBoxes] = aabb.position.y + aabb.max.y;
+    maxZ[m_nBoxes] = aabb.position.z + aabb.max.z;
+    ++m_nBoxes;
+}
+
+void CullingBounds::Clear()
+{
+    for (auto *axis : {&minX, &minY, &minZ, &maxX, &maxY, &maxZ})
+    {
+        axis->clear();
+    }
+    m_nBoxes = 0;
+}
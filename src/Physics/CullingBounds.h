@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "AABB.h"
+
+// Number of boxes Frustum::CheckIntersections tests at once
+constexpr size_t kCullingBatchSize = 4;
+
+// World space AABBs in structure of arrays layout, for testing against a frustum a batch at a time. Corners are stored rather than
+// centre and extents as position + min/max is exactly what Frustum::CheckIntersection tests, so the two can't disagree on a box.
+// The arrays are padded out to a whole batch, the padding is never reported visible.
+class CullingBounds
+{
+public:
+    void Add(const AABB &aabb);
+    void Clear();
+    size_t Size() const
+    {
+        return m_nBoxes;
+    }
+
+    std::vector<float> minX, minY, minZ;
+    std::vector<float> maxX, maxY, maxZ;
+
+private:
+    size_t m_nBoxes = 0;
+};
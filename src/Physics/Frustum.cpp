@@ -1,9 +1,21 @@
 #include "Frustum.h"
 
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define ONFS_SSE_CULLING
+#include <xmmintrin.h>
+#endif
+
 void Frustum::Update(const glm::mat4 &projectionViewMatrix)
 {
     this->_ExtractPlanes(projectionViewMatrix);
     this->_CalculatePlaneIntersections();
+
+    m_pointsMin = m_pointsMax = points[0];
+    for (auto &point : points)
+    {
+        m_pointsMin = glm::min(m_pointsMin, point);
+        m_pointsMax = glm::max(m_pointsMax, point);
+    }
 }
 
 bool Frustum::CheckIntersection(const AABB &other) const
@@ -62,6 +74,74 @@ bool Frustum::CheckIntersection(const AABB &other) const
     return true;
 }
 
+// The same tests as CheckIntersection(const AABB &), rearranged. A box is behind a plane if its corner furthest along the plane normal is, and
+// rounding can't make any other corner come out further, so testing that one corner gives exactly the answer testing all 8 did.
+// The frustum's corners are all past a face of the box if the nearest of them is.
+void Frustum::CheckIntersections(const CullingBounds &bounds, std::vector<uint32_t> &visibilityMask) const
+{
+    visibilityMask.assign((bounds.Size() + 31) / 32, 0u);
+
+#ifdef ONFS_SSE_CULLING
+    const __m128 zero = _mm_setzero_ps();
+    for (size_t boxIdx = 0; boxIdx < bounds.Size(); boxIdx += kCullingBatchSize)
+    {
+        __m128 minX = _mm_loadu_ps(&bounds.minX[boxIdx]);
+        __m128 minY = _mm_loadu_ps(&bounds.minY[boxIdx]);
+        __m128 minZ = _mm_loadu_ps(&bounds.minZ[boxIdx]);
+        __m128 maxX = _mm_loadu_ps(&bounds.maxX[boxIdx]);
+        __m128 maxY = _mm_loadu_ps(&bounds.maxY[boxIdx]);
+        __m128 maxZ = _mm_loadu_ps(&bounds.maxZ[boxIdx]);
+
+        __m128 culled = _mm_or_ps(_mm_cmpgt_ps(_mm_set1_ps(m_pointsMin.x), maxX), _mm_cmplt_ps(_mm_set1_ps(m_pointsMax.x), minX));
+        culled        = _mm_or_ps(culled, _mm_or_ps(_mm_cmpgt_ps(_mm_set1_ps(m_pointsMin.y), maxY), _mm_cmplt_ps(_mm_set1_ps(m_pointsMax.y), minY)));
+        culled        = _mm_or_ps(culled, _mm_or_ps(_mm_cmpgt_ps(_mm_set1_ps(m_pointsMin.z), maxZ), _mm_cmplt_ps(_mm_set1_ps(m_pointsMax.z), minZ)));
+        for (auto &plane : m_planes)
+        {
+            // Summed in the same order as glm::dot, and without fusing, so the distances match CheckIntersection's to the bit
+            __m128 distance = _mm_mul_ps(_mm_set1_ps(plane.x), plane.x >= 0.f ? maxX : minX);
+            distance        = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(plane.y), plane.y >= 0.f ? maxY : minY));
+            distance        = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(plane.z), plane.z >= 0.f ? maxZ : minZ));
+            distance        = _mm_add_ps(distance, _mm_set1_ps(plane.w));
+            culled          = _mm_or_ps(culled, _mm_cmplt_ps(distance, zero));
+        }
+        uint32_t visible = ~(uint32_t) _mm_movemask_ps(culled) & 0xF;
+        visibilityMask[boxIdx / 32] |= visible << (boxIdx % 32);
+    }
+    // Drop the padding
+    if (bounds.Size() % 32 != 0)
+    {
+        visibilityMask.back() &= (1u << (bounds.Size() % 32)) - 1;
+    }
+#else
+    for (size_t boxIdx = 0; boxIdx < bounds.Size(); ++boxIdx)
+    {
+        glm::vec3 min(bounds.minX[boxIdx], bounds.minY[boxIdx], bounds.minZ[boxIdx]);
+        glm::vec3 max(bounds.maxX[boxIdx], bounds.maxY[boxIdx], bounds.maxZ[boxIdx]);
+        if (this->CheckIntersection(min, max))
+        {
+            visibilityMask[boxIdx / 32] |= 1u << (boxIdx % 32);
+        }
+    }
+#endif
+}
+
+bool Frustum::CheckIntersection(const glm::vec3 &min, const glm::vec3 &max) const
+{
+    if (glm::any(glm::greaterThan(m_pointsMin, max)) || glm::any(glm::lessThan(m_pointsMax, min)))
+    {
+        return false;
+    }
+    for (auto &plane : m_planes)
+    {
+        glm::vec3 furthest(plane.x >= 0.f ? max.x : min.x, plane.y >= 0.f ? max.y : min.y, plane.z >= 0.f ? max.z : min.z);
+        if (glm::dot(glm::vec3(plane), furthest) + plane.w < 0.f)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
 template <FrustumPlanes a, FrustumPlanes b, FrustumPlanes c>
 inline glm::vec3 Frustum::GetPlaneIntersection(const glm::vec3 *crosses) const
 {
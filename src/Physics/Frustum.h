@@ -2,8 +2,10 @@
 
 #include <glm/glm.hpp>
 #include <array>
+#include <vector>
 
 #include "AABB.h"
+#include "CullingBounds.h"
 
 enum FrustumPlanes : uint8_t
 {
@@ -23,6 +25,11 @@ public:
     Frustum() = default;
     void Update(const glm::mat4 &projectionViewMatrix);
     bool CheckIntersection(const AABB &other) const;
+    // The same test for a box already in world space, min and max being position + min/max of an AABB
+    bool CheckIntersection(const glm::vec3 &min, const glm::vec3 &max) const;
+    // Sets bit i of visibilityMask, a 32 box word at a time, if box i would pass CheckIntersection. Tests kCullingBatchSize boxes
+    // at once where SSE is available.
+    void CheckIntersections(const CullingBounds &bounds, std::vector<uint32_t> &visibilityMask) const;
     std::array<glm::vec3, 8> points;
 
 private:
@@ -42,4 +49,5 @@ private:
     void _CalculatePlaneIntersections();
 
     std::array<glm::vec4, FrustumPlanes::Length> m_planes;
+    glm::vec3 m_pointsMin, m_pointsMax; // Bounds of the corner points
 };
\ No newline at end of file
@@ -0,0 +1,278 @@
+#include "OcclusionBuffer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define ONFS_SSE_CULLING
+#include <xmmintrin.h>
+#endif
+
+namespace
+{
+    constexpr float kGuardBand            = 2.f;    // Occluders are clipped to twice the screen's extent, keeping edge functions precise
+    constexpr float kDepthSlack           = 1.001f; // AABBs are tested a little nearer than they are, for rounding in 1/w
+    constexpr int32_t kMaxClippedVertices = 8;      // A triangle gains at most one vertex per clip plane
+
+    // Clip space planes occluders are clipped to, each keeping dot(plane, vertex) >= 0
+    const glm::vec4 kClipPlanes[] = {glm::vec4(0.f, 0.f, 1.f, 1.f), // Near
+                                     glm::vec4(-1.f, 0.f, 0.f, kGuardBand), glm::vec4(1.f, 0.f, 0.f, kGuardBand),
+                                     glm::vec4(0.f, -1.f, 0.f, kGuardBand), glm::vec4(0.f, 1.f, 0.f, kGuardBand)};
+
+    int32_t ClipPolygon(const glm::vec4 *vertices, int32_t nVertices, const glm::vec4 &plane, glm::vec4 *clippedVertices)
+    {
+        int32_t nClippedVertices = 0;
+        for (int32_t vertIdx = 0; vertIdx < nVertices; ++vertIdx)
+        {
+            const glm::vec4 &current = vertices[vertIdx];
+            const glm::vec4 &next    = vertices[(vertIdx + 1) % nVertices];
+            float currentDistance    = glm::dot(plane, current);
+            float nextDistance       = glm::dot(plane, next);
+            if (currentDistance >= 0.f)
+            {
+                clippedVertices[nClippedVertices++] = current;
+            }
+            if ((currentDistance >= 0.f) != (nextDistance >= 0.f))
+            {
+                clippedVertices[nClippedVertices++] = current + (next - current) * (currentDistance / (currentDistance - nextDistance));
+            }
+        }
+        return nClippedVertices;
+    }
+} // namespace
+
+OcclusionBuffer::OcclusionBuffer(uint32_t width, uint32_t height) : m_width(width), m_height(height), m_viewProjection(1.f)
+{
+    // Rows are drawn 4 pixels at a time, and each level has to halve evenly
+    assert(width % std::max(4u, 1u << (kOcclusionLevels - 1)) == 0 && height % kOcclusionBandHeight == 0);
+    for (uint32_t level = 0; level < kOcclusionLevels; ++level)
+    {
+        m_levels.emplace_back((width >> level) * (height >> level), 0.f);
+    }
+}
+
+void OcclusionBuffer::SetViewProjection(const glm::mat4 &viewProjection)
+{
+    m_viewProjection = viewProjection;
+}
+
+void OcclusionBuffer::SetupTriangles(const glm::vec3 *vertices, size_t nTriangles, std::vector<OcclusionTriangle> &triangles) const
+{
+    glm::vec4 polygon[kMaxClippedVertices], clippedPolygon[kMaxClippedVertices];
+    for (size_t triangleIdx = 0; triangleIdx < nTriangles; ++triangleIdx)
+    {
+        int32_t nVertices = 3;
+        for (int32_t vertIdx = 0; vertIdx < nVertices; ++vertIdx)
+        {
+            polygon[vertIdx] = m_viewProjection * glm::vec4(vertices[triangleIdx * 3 + vertIdx], 1.f);
+        }
+        for (auto &plane : kClipPlanes)
+        {
+            nVertices = ClipPolygon(polygon, nVertices, plane, clippedPolygon);
+            std::copy(clippedPolygon, clippedPolygon + nVertices, polygon);
+        }
+        if (nVertices < 3)
+        {
+            continue;
+        }
+
+        // To pixels, keeping 1/w as depth, then back into triangles as a fan
+        glm::vec3 screen[kMaxClippedVertices];
+        for (int32_t vertIdx = 0; vertIdx < nVertices; ++vertIdx)
+        {
+            float invW      = 1.f / polygon[vertIdx].w;
+            screen[vertIdx] = glm::vec3((polygon[vertIdx].x * invW * 0.5f + 0.5f) * m_width, (polygon[vertIdx].y * invW * 0.5f + 0.5f) * m_height, invW);
+        }
+        for (int32_t vertIdx = 1; vertIdx + 1 < nVertices; ++vertIdx)
+        {
+            this->_SetupTriangle(screen[0], screen[vertIdx], screen[vertIdx + 1], triangles);
+        }
+    }
+}
+
+void OcclusionBuffer::_SetupTriangle(const glm::vec3 &vertex0, const glm::vec3 &vertex1, const glm::vec3 &vertex2, std::vector<OcclusionTriangle> &triangles) const
+{
+    // Set up in double, only the per pixel work is done in float
+    const double x[3] = {vertex0.x, vertex1.x, vertex2.x};
+    const double y[3] = {vertex0.y, vertex1.y, vertex2.y};
+    const double z[3] = {vertex0.z, vertex1.z, vertex2.z};
+    double area2      = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+    // Either winding occludes
+    if (area2 == 0.0)
+    {
+        return;
+    }
+
+    // Pixels whose centres are within the triangle's bounds
+    OcclusionTriangle triangle;
+    triangle.minX = (int32_t) std::ceil(std::max(std::min({x[0], x[1], x[2]}), 0.0) - 0.5);
+    triangle.maxX = (int32_t) std::floor(std::min(std::max({x[0], x[1], x[2]}), (double) m_width) - 0.5);
+    triangle.minY = (int32_t) std::ceil(std::max(std::min({y[0], y[1], y[2]}), 0.0) - 0.5);
+    triangle.maxY = (int32_t) std::floor(std::min(std::max({y[0], y[1], y[2]}), (double) m_height) - 0.5);
+    if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY)
+    {
+        return;
+    }
+
+    double sign = area2 > 0.0 ? 1.0 : -1.0;
+    for (uint32_t edgeIdx = 0; edgeIdx < 3; ++edgeIdx)
+    {
+        uint32_t nextIdx        = (edgeIdx + 1) % 3;
+        double a                = sign * (y[edgeIdx] - y[nextIdx]);
+        double b                = sign * (x[nextIdx] - x[edgeIdx]);
+        double c                = sign * (x[edgeIdx] * y[nextIdx] - x[nextIdx] * y[edgeIdx]);
+        triangle.edgeA[edgeIdx] = (float) a;
+        triangle.edgeB[edgeIdx] = (float) b;
+        triangle.edgeC[edgeIdx] = (float) c;
+    }
+
+    double depthA = ((z[1] - z[0]) * (y[2] - y[0]) - (z[2] - z[0]) * (y[1] - y[0])) / area2;
+    double depthB = ((z[2] - z[0]) * (x[1] - x[0]) - (z[1] - z[0]) * (x[2] - x[0])) / area2;
+    // 1/w is linear over the pixel, so it's furthest at a corner, half a pixel from the centre on each axis
+    double depthC     = z[0] - depthA * x[0] - depthB * y[0] - (std::abs(depthA) + std::abs(depthB)) * 0.5;
+    triangle.depthA   = (float) depthA;
+    triangle.depthB   = (float) depthB;
+    triangle.depthC   = (float) depthC;
+    triangle.maxDepth = (float) std::max({z[0], z[1], z[2]});
+    triangles.emplace_back(triangle);
+}
+
+void OcclusionBuffer::ClearBand(uint32_t bandIdx)
+{
+    auto bandStart = m_levels[0].begin() + bandIdx * kOcclusionBandHeight * m_width;
+    std::fill(bandStart, bandStart + kOcclusionBandHeight * m_width, 0.f);
+}
+
+void OcclusionBuffer::DrawTriangles(const std::vector<OcclusionTriangle> &triangles, uint32_t bandIdx)
+{
+    auto bandMinY = (int32_t) (bandIdx * kOcclusionBandHeight);
+    auto bandMaxY = bandMinY + (int32_t) kOcclusionBandHeight - 1;
+    float *depth  = m_levels[0].data();
+
+    for (auto &triangle : triangles)
+    {
+        int32_t minY = std::max(triangle.minY, bandMinY);
+        int32_t maxY = std::min(triangle.maxY, bandMaxY);
+#ifdef ONFS_SSE_CULLING
+        // A row of 4 pixels at a time, rows are a multiple of 4 so the last never runs past the end
+        const __m128 laneOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+        const __m128 zero        = _mm_setzero_ps();
+        const __m128 edgeA0      = _mm_set1_ps(triangle.edgeA[0]);
+        const __m128 edgeA1      = _mm_set1_ps(triangle.edgeA[1]);
+        const __m128 edgeA2      = _mm_set1_ps(triangle.edgeA[2]);
+        const __m128 depthA      = _mm_set1_ps(triangle.depthA);
+        const __m128 maxDepth    = _mm_set1_ps(triangle.maxDepth);
+        int32_t minX             = triangle.minX & ~3;
+        for (int32_t y = minY; y <= maxY; ++y)
+        {
+            float pixelY          = (float) y + 0.5f;
+            const __m128 rowEdge0 = _mm_set1_ps(triangle.edgeB[0] * pixelY + triangle.edgeC[0]);
+            const __m128 rowEdge1 = _mm_set1_ps(triangle.edgeB[1] * pixelY + triangle.edgeC[1]);
+            const __m128 rowEdge2 = _mm_set1_ps(triangle.edgeB[2] * pixelY + triangle.edgeC[2]);
+            const __m128 rowDepth = _mm_set1_ps(triangle.depthB * pixelY + triangle.depthC);
+            float *row            = depth + y * m_width;
+            for (int32_t x = minX; x <= triangle.maxX; x += 4)
+            {
+                __m128 pixelX = _mm_add_ps(_mm_set1_ps((float) x), laneOffsets);
+                __m128 inside = _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA0, pixelX), rowEdge0), zero);
+                inside        = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA1, pixelX), rowEdge1), zero));
+                inside        = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA2, pixelX), rowEdge2), zero));
+                // Outside pixels come out as 0, which is never nearer than what's there
+                __m128 pixelDepth = _mm_min_ps(_mm_add_ps(_mm_mul_ps(depthA, pixelX), rowDepth), maxDepth);
+                _mm_storeu_ps(row + x, _mm_max_ps(_mm_loadu_ps(row + x), _mm_and_ps(inside, pixelDepth)));
+            }
+        }
+#else
+        for (int32_t y = minY; y <= maxY; ++y)
+        {
+            float pixelY   = (float) y + 0.5f;
+            float rowEdge0 = triangle.edgeB[0] * pixelY + triangle.edgeC[0];
+            float rowEdge1 = triangle.edgeB[1] * pixelY + triangle.edgeC[1];
+            float rowEdge2 = triangle.edgeB[2] * pixelY + triangle.edgeC[2];
+            float rowDepth = triangle.depthB * pixelY + triangle.depthC;
+            float *row     = depth + y * m_width;
+            for (int32_t x = triangle.minX; x <= triangle.maxX; ++x)
+            {
+                float pixelX = (float) x + 0.5f;
+                if (triangle.edgeA[0] * pixelX + rowEdge0 >= 0.f && triangle.edgeA[1] * pixelX + rowEdge1 >= 0.f && triangle.edgeA[2] * pixelX + rowEdge2 >= 0.f)
+                {
+                    row[x] = std::max(row[x], std::min(triangle.depthA * pixelX + rowDepth, triangle.maxDepth));
+                }
+            }
+        }
+#endif
+    }
+}
+
+void OcclusionBuffer::BuildHierarchy(uint32_t bandIdx)
+{
+    for (uint32_t level = 1; level < kOcclusionLevels; ++level)
+    {
+        uint32_t levelWidth   = m_width >> level;
+        uint32_t childWidth   = levelWidth * 2;
+        const float *children = m_levels[level - 1].data();
+        float *texels         = m_levels[level].data();
+        for (uint32_t y = (bandIdx * kOcclusionBandHeight) >> level; y < ((bandIdx + 1) * kOcclusionBandHeight) >> level; ++y)
+        {
+            const float *childRow0 = children + (y * 2) * childWidth;
+            const float *childRow1 = childRow0 + childWidth;
+            for (uint32_t x = 0; x < levelWidth; ++x)
+            {
+                texels[y * levelWidth + x] = std::min(std::min(childRow0[x * 2], childRow0[x * 2 + 1]), std::min(childRow1[x * 2], childRow1[x * 2 + 1]));
+            }
+        }
+    }
+}
+
+bool OcclusionBuffer::IsVisible(const glm::vec3 &min, const glm::vec3 &max) const
+{
+    glm::vec2 screenMin(FLT_MAX), screenMax(-FLT_MAX);
+    float nearestDepth = 0.f;
+    for (uint8_t cornerIdx = 0; cornerIdx < 8; ++cornerIdx)
+    {
+        glm::vec3 corner(cornerIdx & 1 ? max.x : min.x, cornerIdx & 2 ? max.y : min.y, cornerIdx & 4 ? max.z : min.z);
+        glm::vec4 clip = m_viewProjection * glm::vec4(corner, 1.f);
+        // Reaching through the near plane, it's too close to be worth testing
+        if (clip.w <= 0.f || clip.z < -clip.w)
+        {
+            return true;
+        }
+        float invW = 1.f / clip.w;
+        glm::vec2 screen((clip.x * invW * 0.5f + 0.5f) * m_width, (clip.y * invW * 0.5f + 0.5f) * m_height);
+        screenMin    = glm::min(screenMin, screen);
+        screenMax    = glm::max(screenMax, screen);
+        nearestDepth = std::max(nearestDepth, invW);
+    }
+
+    // Off screen
+    if (screenMax.x < 0.f || screenMin.x > (float) m_width || screenMax.y < 0.f || screenMin.y > (float) m_height)
+    {
+        return false;
+    }
+    // Every pixel the box's rectangle touches, and those around them as occluders can cover up to half a pixel past their edges
+    auto minX = std::max((int32_t) std::floor(std::max(screenMin.x, 0.f)) - 1, 0);
+    auto maxX = std::min((int32_t) std::floor(std::min(screenMax.x, (float) m_width)) + 1, (int32_t) m_width - 1);
+    auto minY = std::max((int32_t) std::floor(std::max(screenMin.y, 0.f)) - 1, 0);
+    auto maxY = std::min((int32_t) std::floor(std::min(screenMax.y, (float) m_height)) + 1, (int32_t) m_height - 1);
+
+    // The finest level the rectangle is at most 2x2 texels at, texels are the furthest of the pixels under them so this is conservative
+    uint32_t level = 0;
+    while (level + 1 < kOcclusionLevels && (((maxX >> level) - (minX >> level)) > 1 || ((maxY >> level) - (minY >> level)) > 1))
+    {
+        ++level;
+    }
+    float testDepth = nearestDepth * kDepthSlack;
+    for (int32_t y = minY >> level; y <= maxY >> level; ++y)
+    {
+        for (int32_t x = minX >> level; x <= maxX >> level; ++x)
+        {
+            if (this->GetDepth(level, (uint32_t) x, (uint32_t) y) <= testDepth)
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
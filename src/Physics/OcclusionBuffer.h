@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+constexpr uint32_t kOcclusionBufferWidth  = 256;
+constexpr uint32_t kOcclusionBufferHeight = 128;
+constexpr uint32_t kOcclusionBandHeight   = 16; // Rows drawn and reduced together, each band can go to a different thread
+constexpr uint32_t kOcclusionLevels       = 5;  // Full resolution and 4 halvings, so the coarsest texels are a band high
+
+// An occluder triangle once projected, clipped and set up for rasterising. Its edges and 1/w are planes over the screen, taken at
+// pixel centres. 1/w is pulled back to the furthest the triangle's plane gets anywhere over the pixel.
+struct OcclusionTriangle
+{
+    float edgeA[3], edgeB[3], edgeC[3]; // Positive inside
+    float depthA, depthB, depthC;
+    float maxDepth;                 // Nearest vertex, the depth plane is clamped to it
+    int32_t minX, maxX, minY, maxY; // Inclusive pixel bounds, within the buffer
+};
+
+// Coarse depth buffer of the occluders in front of a camera, drawn on the CPU, and a hierarchy of it to test AABBs against. Depth is
+// 1/w: nearer is larger, nothing drawn is 0, and it is linear across the screen. Occluders cover the pixels whose centres they
+// cover, at the furthest they are across each, and an AABB is only hidden if every pixel around it is nearer than the nearest of its
+// corners. Growing the pixels tested by one makes up for occluders covering up to half a pixel more than they should at their
+// outlines, so the only thing that can wrongly hide a box is a gap between occluders thinner than a pixel.
+// Bands of rows are cleared, drawn and reduced on their own, so they can be split between threads without sharing any pixels.
+class OcclusionBuffer
+{
+public:
+    OcclusionBuffer(uint32_t width, uint32_t height);
+    void SetViewProjection(const glm::mat4 &viewProjection);
+    // Projects world space triangles, three vertices each, clipping them to the near plane and a guard band around the screen.
+    // Appends those that still cover any pixel centres.
+    void SetupTriangles(const glm::vec3 *vertices, size_t nTriangles, std::vector<OcclusionTriangle> &triangles) const;
+    void ClearBand(uint32_t bandIdx);
+    void DrawTriangles(const std::vector<OcclusionTriangle> &triangles, uint32_t bandIdx);
+    // Once all of a band's triangles are drawn
+    void BuildHierarchy(uint32_t bandIdx);
+    // World space AABB, false only if it's hidden by the occluders or off screen
+    bool IsVisible(const glm::vec3 &min, const glm::vec3 &max) const;
+
+    uint32_t GetWidth() const
+    {
+        return m_width;
+    }
+    uint32_t GetHeight() const
+    {
+        return m_height;
+    }
+    uint32_t GetNumBands() const
+    {
+        return m_height / kOcclusionBandHeight;
+    }
+    float GetDepth(uint32_t level, uint32_t x, uint32_t y) const
+    {
+        return m_levels[level][y * (m_width >> level) + x];
+    }
+
+private:
+    void _SetupTriangle(const glm::vec3 &vertex0, const glm::vec3 &vertex1, const glm::vec3 &vertex2, std::vector<OcclusionTriangle> &triangles) const;
+
+    uint32_t m_width, m_height;
+    glm::mat4 m_viewProjection;
+    std::vector<std::vector<float>> m_levels; // Full resolution first, each texel after holds the furthest of the 2x2 under it
+};
@@ -34,37 +34,115 @@ WorldRay ScreenPosToWorldRay(int mouseX, int mouseY, int screenWidth, int screen
     return worldRay;
 }
 
-PhysicsEngine::PhysicsEngine() : debugDrawer(std::make_shared<BulletDebugDrawer>())
+// Keeps the triangle index of the closest hit, so hits against merged track meshes can be resolved to their Entity
+struct PickingRayResultCallback : public btCollisionWorld::ClosestRayResultCallback
 {
-    m_pBroadphase = new btDbvtBroadphase();
+    PickingRayResultCallback(const btVector3 &rayFromWorld, const btVector3 &rayToWorld) : ClosestRayResultCallback(rayFromWorld, rayToWorld)
+    {
+    }
+
+    btScalar addSingleResult(btCollisionWorld::LocalRayResult &rayResult, bool normalInWorldSpace) override
+    {
+        m_triangleIndex = rayResult.m_localShapeInfo != nullptr ? rayResult.m_localShapeInfo->m_triangleIndex : -1;
+        return ClosestRayResultCallback::addSingleResult(rayResult, normalInWorldSpace);
+    }
+
+    int m_triangleIndex = -1;
+};
+
+// Comfortably larger than any NFS2/3 track once scaled into ONFS space
+constexpr float kAxisSweepWorldExtent = 10000.f;
+constexpr int kVehicleCollisionMask   = COL_TRACK | COL_RAY | COL_DYNAMIC_TRACK | COL_VROAD | COL_CAR;
+
+struct CarUpdateLoop : public btIParallelForBody
+{
+    CarUpdateLoop(std::vector<std::shared_ptr<Car>> &cars, btDynamicsWorld *dynamicsWorld) : m_cars(cars), m_dynamicsWorld(dynamicsWorld)
+    {
+    }
+
+    void forLoop(int iBegin, int iEnd) const override
+    {
+        for (int carIdx = iBegin; carIdx < iEnd; ++carIdx)
+        {
+            if (m_cars[carIdx]->GetVehicleRigidBody()->getActivationState() == DISABLE_SIMULATION)
+            {
+                continue;
+            }
+            m_cars[carIdx]->Update(m_dynamicsWorld);
+        }
+    }
+
+    std::vector<std::shared_ptr<Car>> &m_cars;
+    btDynamicsWorld *m_dynamicsWorld;
+};
+
+PhysicsEngine::PhysicsEngine(const PhysicsSettings &settings) : debugDrawer(std::make_shared<BulletDebugDrawer>())
+{
+    // Tools and tests that never set up the task scheduler still need one for btParallelFor
+    if (btGetTaskScheduler() == nullptr)
+    {
+        btSetTaskScheduler(btGetSequentialTaskScheduler());
+    }
+    // A multithreaded world steps over however many threads the scheduler has, it can't use fewer of them on its own
+    uint32_t nSchedulerThreads = (uint32_t) btGetTaskScheduler()->getNumThreadsUsed();
+    m_nThreads                 = settings.nThreads > 1 ? nSchedulerThreads : 1;
+    if (settings.nThreads > 1 && nSchedulerThreads <= 1)
+    {
+        LOG(WARNING) << "Physics engine asked for " << settings.nThreads << " threads but the task scheduler is single threaded, stepping the single threaded world";
+    }
+
+    m_fixedTimeStep      = settings.fixedTimeStep;
+    m_activeBlockRadius  = settings.activeBlockRadius;
+    m_wheelRaycasterType = settings.wheelRaycaster;
+    m_pBroadphase        = this->_CreateBroadphase(settings.broadphase);
     // Set up the collision configuration and dispatcher
     m_pCollisionConfiguration = new btDefaultCollisionConfiguration();
-    m_pDispatcher             = new btCollisionDispatcher(m_pCollisionConfiguration);
-    // The actual physics solver
-    m_pSolver = new btSequentialImpulseConstraintSolver;
-    // The world.
-    m_pDynamicsWorld = new btDiscreteDynamicsWorld(m_pDispatcher, m_pBroadphase, m_pSolver, m_pCollisionConfiguration);
+
+    if (m_nThreads > 1)
+    {
+        // Narrowphase and island solving are spread over the task scheduler, each worker thread gets its own solver from the pool
+        m_pDispatcher    = new btCollisionDispatcherMt(m_pCollisionConfiguration);
+        m_pSolverPool    = new btConstraintSolverPoolMt(m_nThreads);
+        m_pSolver        = new btSequentialImpulseConstraintSolverMt;
+        m_pDynamicsWorld = new btDiscreteDynamicsWorldMt(m_pDispatcher, m_pBroadphase, m_pSolverPool, m_pSolver, m_pCollisionConfiguration);
+    }
+    else
+    {
+        m_pDispatcher = new btCollisionDispatcher(m_pCollisionConfiguration);
+        // The actual physics solver
+        m_pSolver = new btSequentialImpulseConstraintSolver;
+        // The world.
+        m_pDynamicsWorld = new btDiscreteDynamicsWorld(m_pDispatcher, m_pBroadphase, m_pSolver, m_pCollisionConfiguration);
+    }
     m_pDynamicsWorld->setGravity(btVector3(0, -9.81f, 0));
     m_pDynamicsWorld->setDebugDrawer(debugDrawer.get());
+    // Vehicles are stepped together by a single action rather than one action each, so they can be updated in parallel
+    m_pDynamicsWorld->addAction(&m_vehicleUpdateAction);
+
+    LOG(INFO) << "Physics engine stepping with " << m_nThreads << " thread" << (m_nThreads > 1 ? "s" : "") << " using " << ToString(settings.broadphase) << " and "
+              << ToString(settings.wheelRaycaster);
 }
 
 void PhysicsEngine::StepSimulation(float time, const std::vector<uint32_t> &racerResidentTrackblockIDs)
 {
-    m_pDynamicsWorld->stepSimulation(time, 100);
+    this->_UpdateActiveTrackblocks(racerResidentTrackblockIDs);
 
-    for (auto &car : m_activeVehicles)
-    {
-        car->Update(m_pDynamicsWorld);
-    }
+    m_pDynamicsWorld->stepSimulation(time, 100, m_fixedTimeStep);
 
+    this->_UpdateVehicles();
+
+    // Read back dynamic object transforms for active track blocks. The meshes are moved by whoever renders them, as that may not be
+    // the thread stepping physics.
+    m_dynamicObjectPoses.clear();
     if (m_track != nullptr)
     {
-        // TrackModel updates propagate for active track blocks, based upon track blocks racer vehicles are on
-        for (auto &residentTrackblockID : racerResidentTrackblockIDs)
+        for (auto &activeTrackblockID : m_activeTrackblockIDs)
         {
-            for (auto &objects : m_track->trackBlocks[residentTrackblockID].objects)
+            for (auto &dynamicBody : m_blockDynamicBodies[activeTrackblockID])
             {
-                objects.Update();
+                btTransform trans;
+                dynamicBody->getMotionState()->getWorldTransform(trans);
+                m_dynamicObjectPoses.push_back({static_cast<Entity *>(dynamicBody->getUserPointer()), Utils::bulletToGlm(trans.getOrigin()), Utils::bulletToGlm(trans.getRotation())});
             }
         }
     }
@@ -75,7 +153,7 @@ Entity *PhysicsEngine::CheckForPicking(const glm::mat4 &viewMatrix, const glm::m
     WorldRay worldRayFromScreenPosition = ScreenPosToWorldRay(Config::get().resX / 2, Config::get().resY / 2, Config::get().resX, Config::get().resY, viewMatrix, projectionMatrix);
     glm::vec3 outEnd                    = worldRayFromScreenPosition.origin + worldRayFromScreenPosition.direction * 1000.0f;
 
-    btCollisionWorld::ClosestRayResultCallback rayCallback(Utils::glmToBullet(worldRayFromScreenPosition.origin), Utils::glmToBullet(outEnd));
+    PickingRayResultCallback rayCallback(Utils::glmToBullet(worldRayFromScreenPosition.origin), Utils::glmToBullet(outEnd));
     rayCallback.m_collisionFilterMask = COL_CAR | COL_TRACK | COL_DYNAMIC_TRACK;
 
     m_pDynamicsWorld->rayTest(Utils::glmToBullet(worldRayFromScreenPosition.origin), Utils::glmToBullet(outEnd), rayCallback);
@@ -83,7 +161,7 @@ Entity *PhysicsEngine::CheckForPicking(const glm::mat4 &viewMatrix, const glm::m
     if (rayCallback.hasHit())
     {
         entityTargeted = true;
-        return static_cast<Entity *>(rayCallback.m_collisionObject->getUserPointer());
+        return TrackCollision::GetEntity(rayCallback.m_collisionObject, rayCallback.m_triangleIndex);
     }
     else
     {
@@ -96,35 +174,59 @@ void PhysicsEngine::RegisterTrack(const std::shared_ptr<Track> &track)
 {
     m_track = track;
 
+    if (m_pTrackBroadphase != nullptr)
+    {
+        m_pTrackBroadphase->SetTrack(m_track);
+    }
+
+    // Static geometry is merged per trackblock once per track, then shared between every world the track is registered with
+    if (m_track->collision == nullptr)
+    {
+        m_track->collision = std::make_shared<TrackCollision>(*m_track);
+    }
+
+    // Everything starts in the world, until racers tell us where they are
+    m_blockBodies.resize(m_track->trackBlocks.size());
+    m_blockDynamicBodies.resize(m_track->trackBlocks.size());
+    m_trackblockActive.assign(m_track->trackBlocks.size(), true);
+    m_activeTrackblockIDs.clear();
+    m_residentTrackblockIDs.clear();
+    ++m_trackBodiesRevision;
     for (auto &trackBlock : m_track->trackBlocks)
     {
-        for (auto &road : trackBlock.track)
+        m_activeTrackblockIDs.push_back(trackBlock.id);
+        for (auto &collisionMesh : m_track->collision->GetBlockMeshes(trackBlock.id))
         {
-            road._GenCollisionMesh();
-            m_pDynamicsWorld->addRigidBody(road.rigidBody, COL_TRACK, COL_CAR | COL_RAY | COL_DYNAMIC_TRACK);
+            auto *trackBody = new btRigidBody(btRigidBody::btRigidBodyConstructionInfo(0.f, nullptr, collisionMesh->shape.get()));
+            trackBody->setFriction(btScalar(1.f));
+            trackBody->setUserPointer(collisionMesh.get());
+            trackBody->setUserIndex(trackBlock.id);
+            trackBody->setUserIndex2(TrackCollision::kMergedMeshTag);
+            m_pDynamicsWorld->addRigidBody(trackBody, collisionMesh->collisionGroup, collisionMesh->collisionMask);
+            m_blockBodies[trackBlock.id].push_back(trackBody);
         }
         for (auto &object : trackBlock.objects)
         {
+            if (!object.dynamic)
+            {
+                continue;
+            }
+            // The body belongs to this world rather than the Entity, so the track can be registered with several worlds at once
             object._GenCollisionMesh();
-            uint32_t collisionMask = COL_RAY;
+            btRigidBody *dynamicBody = object.rigidBody;
+            object.rigidBody         = nullptr;
+            uint32_t collisionMask   = COL_RAY | COL_TRACK;
             // Set collision masks
             if (object.collideable)
             {
                 collisionMask |= COL_CAR;
             }
-            if (object.dynamic)
-            {
-                collisionMask |= COL_TRACK;
-            }
             // Move Rigid body to correct place in world
             btTransform initialTransform = Utils::MakeTransform(boost::get<TrackModel>(object.raw).initialPosition, boost::get<TrackModel>(object.raw).orientation);
-            object.rigidBody->setWorldTransform(initialTransform);
-            m_pDynamicsWorld->addRigidBody(object.rigidBody, COL_DYNAMIC_TRACK, collisionMask);
-        }
-        for (auto &light : trackBlock.lights)
-        {
-            light._GenCollisionMesh();
-            m_pDynamicsWorld->addRigidBody(light.rigidBody, COL_TRACK, COL_RAY);
+            dynamicBody->setWorldTransform(initialTransform);
+            dynamicBody->setUserIndex(trackBlock.id);
+            m_pDynamicsWorld->addRigidBody(dynamicBody, COL_DYNAMIC_TRACK, collisionMask);
+            m_blockDynamicBodies[trackBlock.id].push_back(dynamicBody);
         }
     }
 
@@ -133,14 +235,15 @@ void PhysicsEngine::RegisterTrack(const std::shared_ptr<Track> &track)
 
 void PhysicsEngine::RegisterVehicle(const std::shared_ptr<Car> &car)
 {
-    car->SetRaycaster(new btDefaultVehicleRaycaster(m_pDynamicsWorld));
+    car->SetRaycaster(new VehicleRaycaster(m_pDynamicsWorld, m_track, m_blockBodies, m_trackBodiesRevision, m_wheelRaycasterType));
     car->SetVehicle(new btRaycastVehicle(car->tuning, car->GetVehicleRigidBody(), car->GetRaycaster()));
-    car->GetVehicleRigidBody()->setActivationState(DISABLE_DEACTIVATION);
+    // Forced, as a car last parked in another world is still DISABLE_SIMULATION and setActivationState won't change that
+    car->GetVehicleRigidBody()->forceActivationState(DISABLE_DEACTIVATION);
     car->GetVehicle()->setCoordinateSystem(0, 1, 2);
 
     m_pDynamicsWorld->getBroadphase()->getOverlappingPairCache()->cleanProxyFromPairs(car->GetVehicleRigidBody()->getBroadphaseHandle(), m_pDynamicsWorld->getDispatcher());
-    m_pDynamicsWorld->addRigidBody(car->GetVehicleRigidBody(), COL_CAR, COL_TRACK | COL_RAY | COL_DYNAMIC_TRACK | COL_VROAD | COL_CAR);
-    m_pDynamicsWorld->addVehicle(car->GetVehicle());
+    m_pDynamicsWorld->addRigidBody(car->GetVehicleRigidBody(), COL_CAR, kVehicleCollisionMask);
+    m_vehicleUpdateAction.AddVehicle(car->GetVehicle());
 
     // Wire up the wheels
     float wheelRadius    = car->vehicleProperties.wheelRadius;
@@ -168,38 +271,80 @@ void PhysicsEngine::RegisterVehicle(const std::shared_ptr<Car> &car)
     m_activeVehicles.push_back(car);
 }
 
+void PhysicsEngine::UnregisterVehicle(const std::shared_ptr<Car> &car)
+{
+    m_vehicleUpdateAction.RemoveVehicle(car->GetVehicle());
+    m_pDynamicsWorld->removeRigidBody(car->GetVehicleRigidBody());
+    m_activeVehicles.erase(std::remove(m_activeVehicles.begin(), m_activeVehicles.end(), car), m_activeVehicles.end());
+    // Both are bound to this world, the next registration makes new ones
+    car->SetVehicle(nullptr);
+    car->SetRaycaster(nullptr);
+}
+
+// A parked vehicle stays registered, but isn't integrated or updated, and nothing collides with or casts rays against it. Cheaper
+// than removing and re-adding it when pooled vehicles go in and out of use.
+void PhysicsEngine::SetVehicleParked(const std::shared_ptr<Car> &car, bool parked)
+{
+    btRigidBody *chassis = car->GetVehicleRigidBody();
+    if ((chassis->getActivationState() == DISABLE_SIMULATION) != parked)
+    {
+        chassis->forceActivationState(parked ? DISABLE_SIMULATION : DISABLE_DEACTIVATION);
+        chassis->getBroadphaseHandle()->m_collisionFilterGroup = parked ? 0 : COL_CAR;
+        chassis->getBroadphaseHandle()->m_collisionFilterMask  = parked ? 0 : kVehicleCollisionMask;
+        // Recreates the proxy under the new filter, dropping or picking up its overlapping pairs
+        m_pDynamicsWorld->refreshBroadphaseProxy(chassis);
+    }
+
+    // The activation state alone decides whether anything is done, so check it still agrees with the filters of whatever proxy the
+    // broadphase holds now. A parked car left with live filters would sit frozen on the track for the next racers to run into.
+    btBroadphaseProxy *broadphaseHandle = chassis->getBroadphaseHandle();
+    ASSERT(broadphaseHandle->m_collisionFilterGroup == (parked ? 0 : COL_CAR) && broadphaseHandle->m_collisionFilterMask == (parked ? 0 : kVehicleCollisionMask),
+           "Vehicle " << (parked ? "parked" : "unparked") << " with the wrong collision filters");
+}
+
 btDiscreteDynamicsWorld *PhysicsEngine::GetDynamicsWorld()
 {
     return m_pDynamicsWorld;
 }
 
+const std::vector<EntityPose> &PhysicsEngine::GetDynamicObjectPoses() const
+{
+    return m_dynamicObjectPoses;
+}
+
+const std::vector<uint32_t> &PhysicsEngine::GetActiveTrackblockIDs() const
+{
+    return m_activeTrackblockIDs;
+}
+
 PhysicsEngine::~PhysicsEngine()
 {
     for (auto &car : m_activeVehicles)
     {
-        m_pDynamicsWorld->removeVehicle(car->GetVehicle());
+        m_vehicleUpdateAction.RemoveVehicle(car->GetVehicle());
     }
+    m_pDynamicsWorld->removeAction(&m_vehicleUpdateAction);
     if (m_track != nullptr)
     {
         for (auto &trackBlock : m_track->trackBlocks)
         {
-            for (auto &road : trackBlock.track)
-            {
-                m_pDynamicsWorld->removeRigidBody(road.rigidBody);
-                delete road.rigidBody->getMotionState();
-                delete road.rigidBody;
-            }
-            for (auto &object : trackBlock.objects)
+            for (auto &trackBody : m_blockBodies[trackBlock.id])
             {
-                m_pDynamicsWorld->removeRigidBody(object.rigidBody);
-                delete object.rigidBody->getMotionState();
-                delete object.rigidBody;
+                if (m_trackblockActive[trackBlock.id])
+                {
+                    m_pDynamicsWorld->removeRigidBody(trackBody);
+                }
+                delete trackBody;
             }
-            for (auto &light : trackBlock.lights)
+            for (auto &dynamicBody : m_blockDynamicBodies[trackBlock.id])
             {
-                m_pDynamicsWorld->removeRigidBody(light.rigidBody);
-                delete light.rigidBody->getMotionState();
-                delete light.rigidBody;
+                m_pDynamicsWorld->removeRigidBody(dynamicBody);
+                // The shape and its mesh were made for this world by Entity::_GenCollisionMesh
+                auto *collisionShape = static_cast<btConvexTriangleMeshShape *>(dynamicBody->getCollisionShape());
+                delete collisionShape->getMeshInterface();
+                delete collisionShape;
+                delete dynamicBody->getMotionState();
+                delete dynamicBody;
             }
         }
         for (auto &vroadBarrier : m_track->vroadBarriers)
@@ -211,11 +356,158 @@ PhysicsEngine::~PhysicsEngine()
     }
     delete m_pDynamicsWorld;
     delete m_pSolver;
+    delete m_pSolverPool;
     delete m_pDispatcher;
     delete m_pCollisionConfiguration;
     delete m_pBroadphase;
 }
 
+void PhysicsEngine::_UpdateVehicles()
+{
+    // Each car only reads the world and writes its own meshes and rangefinders, so they can be updated independently
+    btParallelFor(0, (int) m_activeVehicles.size(), 1, CarUpdateLoop(m_activeVehicles, m_pDynamicsWorld));
+}
+
+// Keep only the track collision within m_activeBlockRadius neighbour hops of a racer in the world, so broadphase pair management
+// and ray tests scale with the racers rather than the length of the track. Only blocks entering or leaving the set are touched.
+void PhysicsEngine::_UpdateActiveTrackblocks(const std::vector<uint32_t> &racerResidentTrackblockIDs)
+{
+    // Without any racer positions there is nothing to centre on, so leave the world as it is
+    if (m_track == nullptr || racerResidentTrackblockIDs.empty())
+    {
+        return;
+    }
+    std::vector<uint32_t> residentTrackblockIDs(racerResidentTrackblockIDs);
+    std::sort(residentTrackblockIDs.begin(), residentTrackblockIDs.end());
+    residentTrackblockIDs.erase(std::unique(residentTrackblockIDs.begin(), residentTrackblockIDs.end()), residentTrackblockIDs.end());
+    if (residentTrackblockIDs == m_residentTrackblockIDs)
+    {
+        return;
+    }
+    m_residentTrackblockIDs = residentTrackblockIDs;
+
+    // Breadth first walk of the trackblock neighbour graph out to the activation radius
+    std::vector<bool> inRange(m_track->trackBlocks.size(), false);
+    std::vector<uint32_t> activeTrackblockIDs;
+    std::vector<uint32_t> frontier;
+    for (auto &residentTrackblockID : residentTrackblockIDs)
+    {
+        if (residentTrackblockID < inRange.size())
+        {
+            inRange[residentTrackblockID] = true;
+            frontier.push_back(residentTrackblockID);
+        }
+    }
+    activeTrackblockIDs = frontier;
+    for (uint32_t hopIdx = 0; hopIdx < m_activeBlockRadius && !frontier.empty(); ++hopIdx)
+    {
+        std::vector<uint32_t> nextFrontier;
+        for (auto &trackblockID : frontier)
+        {
+            for (auto &neighbourID : m_track->trackBlocks[trackblockID].neighbourIds)
+            {
+                if (neighbourID < inRange.size() && !inRange[neighbourID])
+                {
+                    inRange[neighbourID] = true;
+                    nextFrontier.push_back(neighbourID);
+                    activeTrackblockIDs.push_back(neighbourID);
+                }
+            }
+        }
+        frontier.swap(nextFrontier);
+    }
+
+    for (auto &trackblockID : m_activeTrackblockIDs)
+    {
+        if (!inRange[trackblockID])
+        {
+            this->_SetTrackblockActive(trackblockID, false);
+        }
+    }
+    for (auto &trackblockID : activeTrackblockIDs)
+    {
+        if (!m_trackblockActive[trackblockID])
+        {
+            this->_SetTrackblockActive(trackblockID, true);
+        }
+    }
+    m_activeTrackblockIDs.swap(activeTrackblockIDs);
+}
+
+void PhysicsEngine::_SetTrackblockActive(uint32_t trackblockID, bool active)
+{
+    ++m_trackBodiesRevision;
+    for (auto &trackBody : m_blockBodies[trackblockID])
+    {
+        if (active)
+        {
+            auto *collisionMesh = static_cast<TrackCollisionMesh *>(trackBody->getUserPointer());
+            m_pDynamicsWorld->addRigidBody(trackBody, collisionMesh->collisionGroup, collisionMesh->collisionMask);
+        }
+        else
+        {
+            m_pDynamicsWorld->removeRigidBody(trackBody);
+        }
+    }
+    // Dynamic objects stay in the world so they keep their state, but don't simulate (and can't fall through removed track) while out of range
+    for (auto &dynamicBody : m_blockDynamicBodies[trackblockID])
+    {
+        if (active)
+        {
+            dynamicBody->forceActivationState(ACTIVE_TAG);
+            dynamicBody->activate(true);
+        }
+        else
+        {
+            dynamicBody->forceActivationState(DISABLE_SIMULATION);
+        }
+    }
+    m_trackblockActive[trackblockID] = active;
+}
+
+btBroadphaseInterface *PhysicsEngine::_CreateBroadphase(BroadphaseType broadphaseType)
+{
+    switch (broadphaseType)
+    {
+    case AXIS_SWEEP_BROADPHASE:
+        // Sweep and prune needs fixed world bounds up front, before any track is registered
+        return new bt32BitAxisSweep3(btVector3(-kAxisSweepWorldExtent, -kAxisSweepWorldExtent, -kAxisSweepWorldExtent),
+                                     btVector3(kAxisSweepWorldExtent, kAxisSweepWorldExtent, kAxisSweepWorldExtent));
+    case TRACK_BROADPHASE:
+        m_pTrackBroadphase = new TrackBroadphase();
+        return m_pTrackBroadphase;
+    case DBVT_BROADPHASE:
+    default:
+        return new btDbvtBroadphase();
+    }
+}
+
+// Bullet only supports a single process wide task scheduler, shared by every world and btParallelFor. Set up once at startup, worlds
+// then only pick whether to step multithreaded.
+uint32_t PhysicsEngine::InitTaskScheduler(uint32_t nThreads)
+{
+    static btITaskScheduler *taskScheduler = btCreateDefaultTaskScheduler();
+
+    if (nThreads <= 1)
+    {
+        btSetTaskScheduler(btGetSequentialTaskScheduler());
+        return 1;
+    }
+    if (taskScheduler == nullptr)
+    {
+        LOG(WARNING) << "Bullet was built without BT_THREADSAFE, falling back to single threaded physics";
+        btSetTaskScheduler(btGetSequentialTaskScheduler());
+        return 1;
+    }
+
+    nThreads = std::min(nThreads, (uint32_t) taskScheduler->getMaxNumThreads());
+    taskScheduler->setNumThreadsUsed(nThreads);
+    btSetTaskScheduler(taskScheduler);
+    LOG(INFO) << "Bullet task scheduler running " << nThreads << " threads";
+
+    return nThreads;
+}
+
 void PhysicsEngine::_GenerateVroadBarriers()
 {
     /*if ((m_track->nfsVersion == NFS_3 || m_track->nfsVersion == NFS_4) && !Config::get().sparkMode)
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <algorithm>
 #include <vector>
 #include <GL/glew.h>
 #include <glm/glm.hpp>
@@ -11,18 +12,28 @@
 #include <BulletCollision/CollisionShapes/btBoxShape.h>
 #include <BulletCollision/BroadphaseCollision/btBroadphaseInterface.h>
 #include <BulletCollision/BroadphaseCollision/btDbvtBroadphase.h>
+#include <BulletCollision/BroadphaseCollision/btAxisSweep3.h>
 #include <BulletCollision/CollisionDispatch/btDefaultCollisionConfiguration.h>
 #include <BulletCollision/CollisionDispatch/btCollisionDispatcher.h>
 #include <BulletDynamics/ConstraintSolver/btSequentialImpulseConstraintSolver.h>
 #include <BulletDynamics/Dynamics/btDiscreteDynamicsWorld.h>
+#include <BulletDynamics/Dynamics/btDiscreteDynamicsWorldMt.h>
+#include <BulletDynamics/ConstraintSolver/btSequentialImpulseConstraintSolverMt.h>
+#include <BulletCollision/CollisionDispatch/btCollisionDispatcherMt.h>
+#include <LinearMath/btThreads.h>
 #include <BulletCollision/CollisionShapes/btTriangleMesh.h>
 #include <BulletCollision/CollisionShapes/btBvhTriangleMeshShape.h>
 #include <BulletCollision/CollisionDispatch/btGhostObject.h>
 
+#include "../Config.h"
 #include "../Util/Utils.h"
 #include "../Scene/Track.h"
 #include "../Renderer/BulletDebugDrawer.h"
 #include "Car.h"
+#include "VehicleRaycaster.h"
+#include "VehicleUpdateAction.h"
+#include "TrackCollision.h"
+#include "TrackBroadphase.h"
 
 struct WorldRay
 {
@@ -30,28 +41,69 @@ struct WorldRay
     glm::vec3 direction;
 };
 
+// Transform of a dynamic track object, read back after a step
+struct EntityPose
+{
+    Entity *entity;
+    glm::vec3 position;
+    glm::quat orientation;
+};
+
+struct PhysicsSettings
+{
+    uint32_t nThreads                 = Config::get().physicsThreads;     // Above 1 steps a multithreaded world over the task scheduler's threads
+    float fixedTimeStep               = 1.f / 60.f;                       // Bullet internal substep length
+    uint32_t activeBlockRadius        = Config::get().physicsBlockRadius; // Neighbour hops from each racer's resident trackblock that keep track collision in the world
+    BroadphaseType broadphase         = getBroadphaseType(Config::get().broadphase);
+    WheelRaycasterType wheelRaycaster = getWheelRaycasterType(Config::get().wheelRaycaster);
+};
+
 class PhysicsEngine
 {
 public:
-    PhysicsEngine();
+    explicit PhysicsEngine(const PhysicsSettings &settings = PhysicsSettings());
     ~PhysicsEngine();
+    static uint32_t InitTaskScheduler(uint32_t nThreads);
     void StepSimulation(float time, const std::vector<uint32_t> &racerResidentTrackblockIDs);
     void RegisterVehicle(const std::shared_ptr<Car> &car);
+    void UnregisterVehicle(const std::shared_ptr<Car> &car);
+    void SetVehicleParked(const std::shared_ptr<Car> &car, bool parked);
     void RegisterTrack(const std::shared_ptr<Track> &track);
     Entity *CheckForPicking(const glm::mat4 &viewMatrix, const glm::mat4 &projectionMatrix, bool &entityTargeted);
     btDiscreteDynamicsWorld *GetDynamicsWorld();
+    const std::vector<EntityPose> &GetDynamicObjectPoses() const;
+    const std::vector<uint32_t> &GetActiveTrackblockIDs() const;
 
     std::shared_ptr<BulletDebugDrawer> debugDrawer;
 
 private:
     void _GenerateVroadBarriers();
+    void _UpdateVehicles();
+    void _UpdateActiveTrackblocks(const std::vector<uint32_t> &racerResidentTrackblockIDs);
+    void _SetTrackblockActive(uint32_t trackblockID, bool active);
+    btBroadphaseInterface *_CreateBroadphase(BroadphaseType broadphaseType);
 
     std::shared_ptr<Track> m_track;
     std::vector<std::shared_ptr<Car>> m_activeVehicles;
+    std::vector<EntityPose> m_dynamicObjectPoses;
+    // This world's rigid bodies around the track's shared merged collision meshes, per trackblock. Only blocks near racers are in the world.
+    std::vector<std::vector<btRigidBody *>> m_blockBodies;
+    std::vector<std::vector<btRigidBody *>> m_blockDynamicBodies; // Owned by this world, user pointer is the dynamic object's Entity
+    std::vector<bool> m_trackblockActive;
+    std::vector<uint32_t> m_activeTrackblockIDs;
+    std::vector<uint32_t> m_residentTrackblockIDs; // Sorted racer resident trackblocks the active set was last built around
+    uint32_t m_trackBodiesRevision = 0;            // Bumped whenever track bodies enter or leave the world, so raycasters can drop cached triangles
+    VehicleUpdateAction m_vehicleUpdateAction;
+    uint32_t m_nThreads;
+    float m_fixedTimeStep;
+    uint32_t m_activeBlockRadius;
+    WheelRaycasterType m_wheelRaycasterType;
 
     btBroadphaseInterface *m_pBroadphase;
+    TrackBroadphase *m_pTrackBroadphase = nullptr; // Same object as m_pBroadphase when the trackblock broadphase is in use
     btDefaultCollisionConfiguration *m_pCollisionConfiguration;
     btCollisionDispatcher *m_pDispatcher;
-    btSequentialImpulseConstraintSolver *m_pSolver;
+    btConstraintSolverPoolMt *m_pSolverPool = nullptr;
+    btConstraintSolver *m_pSolver;
     btDiscreteDynamicsWorld *m_pDynamicsWorld;
 };
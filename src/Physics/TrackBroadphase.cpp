@@ -0,0 +1,443 @@
+#include "TrackBroadphase.h"
+
+namespace
+{
+    // Adds a pair between the proxy being collided and every proxy in the tree whose bounds it overlaps
+    struct PairCollector : btDbvt::ICollide
+    {
+        PairCollector(btOverlappingPairCache *pairCache, TrackBroadphaseProxy *proxy) : m_pairCache(pairCache), m_proxy(proxy)
+        {
+        }
+
+        void Process(const btDbvtNode *leaf)
+        {
+            auto *otherProxy = static_cast<TrackBroadphaseProxy *>(leaf->data);
+            if (otherProxy != m_proxy)
+            {
+                // The pair cache is hashed, so a pair found again from the other side or another bucket isn't duplicated
+                m_pairCache->addOverlappingPair(m_proxy, otherProxy);
+            }
+        }
+
+        btOverlappingPairCache *m_pairCache;
+        TrackBroadphaseProxy *m_proxy;
+    };
+
+    struct RayTester : btDbvt::ICollide
+    {
+        explicit RayTester(btBroadphaseRayCallback &rayCallback) : m_rayCallback(rayCallback)
+        {
+        }
+
+        void Process(const btDbvtNode *leaf)
+        {
+            m_rayCallback.process(static_cast<btBroadphaseProxy *>(leaf->data));
+        }
+
+        btBroadphaseRayCallback &m_rayCallback;
+    };
+
+    struct AabbTester : btDbvt::ICollide
+    {
+        explicit AabbTester(btBroadphaseAabbCallback &aabbCallback) : m_aabbCallback(aabbCallback)
+        {
+        }
+
+        void Process(const btDbvtNode *leaf)
+        {
+            m_aabbCallback.process(static_cast<btBroadphaseProxy *>(leaf->data));
+        }
+
+        btBroadphaseAabbCallback &m_aabbCallback;
+    };
+
+    // Buckets whose bounds a query touches, gathered before searching them as the ray traversal stack can't be shared
+    template <typename Bucket>
+    struct BucketCollector : btDbvt::ICollide
+    {
+        void Process(const btDbvtNode *leaf)
+        {
+            buckets.push_back(static_cast<Bucket *>(leaf->data));
+        }
+
+        std::vector<Bucket *> buckets;
+    };
+
+    struct ProxyCollector : btDbvt::ICollide
+    {
+        void Process(const btDbvtNode *leaf)
+        {
+            proxies.push_back(static_cast<TrackBroadphaseProxy *>(leaf->data));
+        }
+
+        std::vector<TrackBroadphaseProxy *> proxies;
+    };
+} // namespace
+
+TrackBroadphase::TrackBroadphase() : m_pairCache(new btHashedOverlappingPairCache())
+{
+}
+
+TrackBroadphase::~TrackBroadphase()
+{
+    delete m_pairCache;
+}
+
+void TrackBroadphase::SetTrack(const std::shared_ptr<Track> &track)
+{
+    // Pull every proxy out, then re-file them against the new trackblocks
+    ProxyCollector proxyCollector;
+    auto collectTree = [&proxyCollector](const btDbvt &tree) {
+        if (tree.m_root != nullptr)
+        {
+            btDbvt::enumLeaves(tree.m_root, proxyCollector);
+        }
+    };
+    for (auto &bucket : m_blockBuckets)
+    {
+        collectTree(bucket->staticTree);
+        collectTree(bucket->movingTree);
+    }
+    collectTree(m_globalBucket.staticTree);
+    collectTree(m_globalBucket.movingTree);
+    for (auto &proxy : proxyCollector.proxies)
+    {
+        this->_RemoveFromBucket(proxy);
+        proxy->bucket = kUnassignedBucket;
+    }
+
+    m_track = track;
+    m_blockBuckets.clear();
+    for (size_t trackblockIdx = 0; trackblockIdx < m_track->trackBlocks.size(); ++trackblockIdx)
+    {
+        m_blockBuckets.emplace_back(std::make_unique<Bucket>());
+    }
+
+    for (auto &proxy : proxyCollector.proxies)
+    {
+        this->_InsertIntoBucket(proxy, this->_FindBucket(proxy));
+    }
+}
+
+btBroadphaseProxy *TrackBroadphase::createProxy(
+  const btVector3 &aabbMin, const btVector3 &aabbMax, int shapeType, void *userPtr, int collisionFilterGroup, int collisionFilterMask, btDispatcher *dispatcher)
+{
+    auto *proxy        = new TrackBroadphaseProxy(aabbMin, aabbMax, userPtr, collisionFilterGroup, collisionFilterMask);
+    proxy->m_uniqueId  = ++m_nextUniqueId;
+    auto *collisionObj = static_cast<btCollisionObject *>(userPtr);
+    proxy->isStatic    = collisionObj != nullptr && collisionObj->isStaticObject();
+    if (!proxy->isStatic)
+    {
+        proxy->movingIdx = (int32_t) m_movingProxies.size();
+        m_movingProxies.push_back(proxy);
+    }
+    this->_InsertIntoBucket(proxy, this->_FindBucket(proxy));
+    ++m_nProxies;
+
+    return proxy;
+}
+
+void TrackBroadphase::destroyProxy(btBroadphaseProxy *proxy, btDispatcher *dispatcher)
+{
+    auto *trackProxy = static_cast<TrackBroadphaseProxy *>(proxy);
+    this->_RemoveFromBucket(trackProxy);
+    if (trackProxy->movingIdx >= 0)
+    {
+        m_movingProxies[trackProxy->movingIdx]            = m_movingProxies.back();
+        m_movingProxies[trackProxy->movingIdx]->movingIdx = trackProxy->movingIdx;
+        m_movingProxies.pop_back();
+    }
+    m_pairCache->removeOverlappingPairsContainingProxy(trackProxy, dispatcher);
+    delete trackProxy;
+    --m_nProxies;
+}
+
+void TrackBroadphase::setAabb(btBroadphaseProxy *proxy, const btVector3 &aabbMin, const btVector3 &aabbMax, btDispatcher *dispatcher)
+{
+    auto *trackProxy = static_cast<TrackBroadphaseProxy *>(proxy);
+    // Bullet updates the bounds of every object every step by default, static track collision never changes
+    if (trackProxy->m_aabbMin == aabbMin && trackProxy->m_aabbMax == aabbMax)
+    {
+        return;
+    }
+    trackProxy->m_aabbMin = aabbMin;
+    trackProxy->m_aabbMax = aabbMax;
+
+    if (!trackProxy->isStatic && m_track != nullptr)
+    {
+        int32_t nearestBucket = this->_ClimbToNearestBucket(trackProxy->bucket, (aabbMin + aabbMax) * 0.5f);
+        if (nearestBucket != trackProxy->bucket)
+        {
+            this->_RemoveFromBucket(trackProxy);
+            this->_InsertIntoBucket(trackProxy, nearestBucket);
+            return;
+        }
+    }
+
+    Bucket &bucket      = this->_GetBucket(trackProxy->bucket);
+    btDbvt &tree        = trackProxy->isStatic ? bucket.staticTree : bucket.movingTree;
+    btDbvtVolume volume = btDbvtVolume::FromMM(aabbMin, aabbMax);
+    tree.update(trackProxy->leaf, volume);
+    this->_UpdateBucketBounds(trackProxy->bucket);
+}
+
+void TrackBroadphase::getAabb(btBroadphaseProxy *proxy, btVector3 &aabbMin, btVector3 &aabbMax) const
+{
+    aabbMin = proxy->m_aabbMin;
+    aabbMax = proxy->m_aabbMax;
+}
+
+void TrackBroadphase::rayTest(const btVector3 &rayFrom, const btVector3 &rayTo, btBroadphaseRayCallback &rayCallback, const btVector3 &aabbMin, const btVector3 &aabbMax)
+{
+    // Vehicles cast their wheel rays from worker threads, so each thread needs its own traversal stack
+    static thread_local btAlignedObjectArray<const btDbvtNode *> rayStack;
+    static thread_local BucketCollector<Bucket> bucketCollector;
+    RayTester rayTester(rayCallback);
+
+    auto testBucket = [&](Bucket &bucket) {
+        // Empty trees are skipped inside rayTestInternal, and lambda_max is re-read so each tree benefits from closer hits in the last
+        bucket.staticTree.rayTestInternal(bucket.staticTree.m_root, rayFrom, rayTo, rayCallback.m_rayDirectionInverse, rayCallback.m_signs, rayCallback.m_lambda_max, aabbMin,
+                                          aabbMax, rayStack, rayTester);
+        bucket.movingTree.rayTestInternal(bucket.movingTree.m_root, rayFrom, rayTo, rayCallback.m_rayDirectionInverse, rayCallback.m_signs, rayCallback.m_lambda_max, aabbMin,
+                                          aabbMax, rayStack, rayTester);
+    };
+    bucketCollector.buckets.clear();
+    m_bucketTree.rayTestInternal(m_bucketTree.m_root, rayFrom, rayTo, rayCallback.m_rayDirectionInverse, rayCallback.m_signs, rayCallback.m_lambda_max, aabbMin, aabbMax, rayStack,
+                                 bucketCollector);
+    for (auto &bucket : bucketCollector.buckets)
+    {
+        testBucket(*bucket);
+    }
+    testBucket(m_globalBucket);
+}
+
+void TrackBroadphase::aabbTest(const btVector3 &aabbMin, const btVector3 &aabbMax, btBroadphaseAabbCallback &callback)
+{
+    static thread_local BucketCollector<Bucket> bucketCollector;
+    AabbTester aabbTester(callback);
+    btDbvtVolume volume = btDbvtVolume::FromMM(aabbMin, aabbMax);
+
+    auto testBucket = [&](Bucket &bucket) {
+        bucket.staticTree.collideTV(bucket.staticTree.m_root, volume, aabbTester);
+        bucket.movingTree.collideTV(bucket.movingTree.m_root, volume, aabbTester);
+    };
+    bucketCollector.buckets.clear();
+    m_bucketTree.collideTV(m_bucketTree.m_root, volume, bucketCollector);
+    for (auto &bucket : bucketCollector.buckets)
+    {
+        testBucket(*bucket);
+    }
+    testBucket(m_globalBucket);
+}
+
+void TrackBroadphase::calculateOverlappingPairs(btDispatcher *dispatcher)
+{
+    // Static proxies never need pairs amongst themselves, so only moving proxies look for overlaps, and only nearby
+    for (auto &proxy : m_movingProxies)
+    {
+        this->_CollideWithBucket(proxy, proxy->bucket);
+        if (proxy->bucket != kUnassignedBucket)
+        {
+            for (auto &neighbourID : m_track->trackBlocks[proxy->bucket].neighbourIds)
+            {
+                if ((int32_t) neighbourID != proxy->bucket && neighbourID < m_blockBuckets.size())
+                {
+                    this->_CollideWithBucket(proxy, neighbourID);
+                }
+            }
+            this->_CollideWithBucket(proxy, kUnassignedBucket);
+        }
+    }
+
+    // Drop pairs whose bounds have separated. Removal swaps the last pair into the hole, so walk backwards to visit every pair.
+    btBroadphasePairArray &pairs = m_pairCache->getOverlappingPairArray();
+    for (int pairIdx = pairs.size() - 1; pairIdx >= 0; --pairIdx)
+    {
+        btBroadphaseProxy *proxy0 = pairs[pairIdx].m_pProxy0;
+        btBroadphaseProxy *proxy1 = pairs[pairIdx].m_pProxy1;
+        if (!TestAabbAgainstAabb2(proxy0->m_aabbMin, proxy0->m_aabbMax, proxy1->m_aabbMin, proxy1->m_aabbMax))
+        {
+            m_pairCache->removeOverlappingPair(proxy0, proxy1, dispatcher);
+        }
+    }
+}
+
+btOverlappingPairCache *TrackBroadphase::getOverlappingPairCache()
+{
+    return m_pairCache;
+}
+
+const btOverlappingPairCache *TrackBroadphase::getOverlappingPairCache() const
+{
+    return m_pairCache;
+}
+
+void TrackBroadphase::getBroadphaseAabb(btVector3 &aabbMin, btVector3 &aabbMax) const
+{
+    btDbvtVolume bounds;
+    bool hasBounds = false;
+
+    auto mergeTree = [&](const btDbvt &tree) {
+        if (tree.m_root == nullptr)
+        {
+            return;
+        }
+        if (hasBounds)
+        {
+            Merge(bounds, tree.m_root->volume, bounds);
+        }
+        else
+        {
+            bounds    = tree.m_root->volume;
+            hasBounds = true;
+        }
+    };
+    for (auto &bucket : m_blockBuckets)
+    {
+        mergeTree(bucket->staticTree);
+        mergeTree(bucket->movingTree);
+    }
+    mergeTree(m_globalBucket.staticTree);
+    mergeTree(m_globalBucket.movingTree);
+
+    if (!hasBounds)
+    {
+        bounds = btDbvtVolume::FromCR(btVector3(0, 0, 0), 0);
+    }
+    aabbMin = bounds.Mins();
+    aabbMax = bounds.Maxs();
+}
+
+void TrackBroadphase::printStats()
+{
+    LOG(INFO) << "TrackBroadphase: " << m_nProxies << " proxies (" << m_movingProxies.size() << " moving) over " << m_blockBuckets.size() << " trackblocks, "
+              << m_pairCache->getNumOverlappingPairs() << " pairs";
+}
+
+TrackBroadphase::Bucket &TrackBroadphase::_GetBucket(int32_t bucketIdx)
+{
+    return bucketIdx == kUnassignedBucket ? m_globalBucket : *m_blockBuckets[bucketIdx];
+}
+
+int32_t TrackBroadphase::_FindBucket(const TrackBroadphaseProxy *proxy) const
+{
+    if (m_track == nullptr)
+    {
+        return kUnassignedBucket;
+    }
+
+    // Track collision bodies carry their trackblock ID
+    auto *collisionObj = static_cast<btCollisionObject *>(proxy->m_clientObject);
+    if (collisionObj != nullptr && collisionObj->getUserIndex() >= 0 && collisionObj->getUserIndex() < (int) m_blockBuckets.size())
+    {
+        return collisionObj->getUserIndex();
+    }
+
+    return this->_ClimbToNearestBucket(kUnassignedBucket, (proxy->m_aabbMin + proxy->m_aabbMax) * 0.5f);
+}
+
+// Walk the neighbour graph towards the trackblock centre closest to position. Moving bodies travel at most a block or so per step,
+// so starting from their last bucket this is a handful of distance checks. Without a start, ask the track's spatial index.
+int32_t TrackBroadphase::_ClimbToNearestBucket(int32_t startBucket, const btVector3 &position) const
+{
+    if (m_blockBuckets.empty())
+    {
+        return kUnassignedBucket;
+    }
+
+    glm::vec3 glmPosition = Utils::bulletToGlm(position);
+    if (startBucket == kUnassignedBucket)
+    {
+        return m_track->spatialIndex.GetNearestTrackblock(glmPosition);
+    }
+
+    int32_t nearestBucket = startBucket;
+    float lowestDistance  = glm::distance(glmPosition, m_track->trackBlocks[startBucket].position);
+    for (size_t stepIdx = 0; stepIdx < m_blockBuckets.size(); ++stepIdx)
+    {
+        int32_t currentBucket = nearestBucket;
+        for (auto &neighbourID : m_track->trackBlocks[currentBucket].neighbourIds)
+        {
+            if (neighbourID >= m_blockBuckets.size())
+            {
+                continue;
+            }
+            float distance = glm::distance(glmPosition, m_track->trackBlocks[neighbourID].position);
+            if (distance < lowestDistance)
+            {
+                nearestBucket  = neighbourID;
+                lowestDistance = distance;
+            }
+        }
+        if (nearestBucket == currentBucket)
+        {
+            break;
+        }
+    }
+    return nearestBucket;
+}
+
+void TrackBroadphase::_InsertIntoBucket(TrackBroadphaseProxy *proxy, int32_t bucketIdx)
+{
+    Bucket &bucket = this->_GetBucket(bucketIdx);
+    btDbvt &tree   = proxy->isStatic ? bucket.staticTree : bucket.movingTree;
+    proxy->bucket  = bucketIdx;
+    proxy->leaf    = tree.insert(btDbvtVolume::FromMM(proxy->m_aabbMin, proxy->m_aabbMax), proxy);
+    this->_UpdateBucketBounds(bucketIdx);
+}
+
+void TrackBroadphase::_RemoveFromBucket(TrackBroadphaseProxy *proxy)
+{
+    Bucket &bucket = this->_GetBucket(proxy->bucket);
+    btDbvt &tree   = proxy->isStatic ? bucket.staticTree : bucket.movingTree;
+    tree.remove(proxy->leaf);
+    proxy->leaf = nullptr;
+    this->_UpdateBucketBounds(proxy->bucket);
+}
+
+void TrackBroadphase::_CollideWithBucket(TrackBroadphaseProxy *proxy, int32_t bucketIdx)
+{
+    Bucket &bucket = this->_GetBucket(bucketIdx);
+    PairCollector pairCollector(m_pairCache, proxy);
+    btDbvtVolume volume = btDbvtVolume::FromMM(proxy->m_aabbMin, proxy->m_aabbMax);
+    bucket.staticTree.collideTV(bucket.staticTree.m_root, volume, pairCollector);
+    bucket.movingTree.collideTV(bucket.movingTree.m_root, volume, pairCollector);
+}
+
+// Keeps the bucket's leaf in m_bucketTree bounding both its trees exactly, so queries neither miss it nor visit it for nothing
+void TrackBroadphase::_UpdateBucketBounds(int32_t bucketIdx)
+{
+    if (bucketIdx == kUnassignedBucket)
+    {
+        return;
+    }
+    Bucket &bucket         = *m_blockBuckets[bucketIdx];
+    const btDbvtNode *root = bucket.staticTree.m_root, *movingRoot = bucket.movingTree.m_root;
+    if (root == nullptr && movingRoot == nullptr)
+    {
+        if (bucket.boundsLeaf != nullptr)
+        {
+            m_bucketTree.remove(bucket.boundsLeaf);
+            bucket.boundsLeaf = nullptr;
+        }
+        return;
+    }
+
+    btDbvtVolume volume;
+    if (root != nullptr && movingRoot != nullptr)
+    {
+        Merge(root->volume, movingRoot->volume, volume);
+    }
+    else
+    {
+        volume = root != nullptr ? root->volume : movingRoot->volume;
+    }
+    if (bucket.boundsLeaf == nullptr)
+    {
+        bucket.boundsLeaf = m_bucketTree.insert(volume, &bucket);
+    }
+    else if (bucket.boundsLeaf->volume.Mins() != volume.Mins() || bucket.boundsLeaf->volume.Maxs() != volume.Maxs())
+    {
+        m_bucketTree.update(bucket.boundsLeaf, volume);
+    }
+}
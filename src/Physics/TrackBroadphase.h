@@ -0,0 +1,82 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <BulletCollision/BroadphaseCollision/btBroadphaseInterface.h>
+#include <BulletCollision/BroadphaseCollision/btBroadphaseProxy.h>
+#include <BulletCollision/BroadphaseCollision/btDbvt.h>
+#include <BulletCollision/BroadphaseCollision/btOverlappingPairCache.h>
+#include <BulletCollision/CollisionDispatch/btCollisionObject.h>
+
+#include "../Scene/Track.h"
+
+constexpr int32_t kUnassignedBucket = -1;
+
+struct TrackBroadphaseProxy : public btBroadphaseProxy
+{
+    TrackBroadphaseProxy(const btVector3 &aabbMin, const btVector3 &aabbMax, void *userPtr, int collisionFilterGroup, int collisionFilterMask)
+        : btBroadphaseProxy(aabbMin, aabbMax, userPtr, collisionFilterGroup, collisionFilterMask)
+    {
+    }
+
+    btDbvtNode *leaf  = nullptr;
+    int32_t bucket    = kUnassignedBucket; // Trackblock the proxy is filed under, or the global bucket
+    int32_t movingIdx = -1;                // Index into the moving proxy list, -1 for static proxies
+    bool isStatic     = false;
+};
+
+// Broadphase that exploits the track being a chain of trackblocks with known neighbours. Each trackblock gets its own pair of
+// DBVTs (static and moving), static track collision is filed under the trackblock stored in its collision object's user index,
+// and moving bodies are re-filed under their nearest trackblock by walking neighbours. Pairs are only generated for moving
+// proxies, against the trees of their trackblock and its neighbours. Proxies created before a track is set live in a global bucket.
+// Ray and AABB queries first find the trackblock buckets whose bounds they touch in a tree over the buckets, so they cost about the
+// same on a long track as a short one.
+class TrackBroadphase : public btBroadphaseInterface
+{
+public:
+    TrackBroadphase();
+    ~TrackBroadphase() override;
+    void SetTrack(const std::shared_ptr<Track> &track);
+
+    btBroadphaseProxy *createProxy(const btVector3 &aabbMin, const btVector3 &aabbMax, int shapeType, void *userPtr, int collisionFilterGroup, int collisionFilterMask, btDispatcher *dispatcher) override;
+    void destroyProxy(btBroadphaseProxy *proxy, btDispatcher *dispatcher) override;
+    void setAabb(btBroadphaseProxy *proxy, const btVector3 &aabbMin, const btVector3 &aabbMax, btDispatcher *dispatcher) override;
+    void getAabb(btBroadphaseProxy *proxy, btVector3 &aabbMin, btVector3 &aabbMax) const override;
+    void rayTest(const btVector3 &rayFrom,
+                 const btVector3 &rayTo,
+                 btBroadphaseRayCallback &rayCallback,
+                 const btVector3 &aabbMin = btVector3(0, 0, 0),
+                 const btVector3 &aabbMax = btVector3(0, 0, 0)) override;
+    void aabbTest(const btVector3 &aabbMin, const btVector3 &aabbMax, btBroadphaseAabbCallback &callback) override;
+    void calculateOverlappingPairs(btDispatcher *dispatcher) override;
+    btOverlappingPairCache *getOverlappingPairCache() override;
+    const btOverlappingPairCache *getOverlappingPairCache() const override;
+    void getBroadphaseAabb(btVector3 &aabbMin, btVector3 &aabbMax) const override;
+    void printStats() override;
+
+private:
+    struct Bucket
+    {
+        btDbvt staticTree;
+        btDbvt movingTree;
+        btDbvtNode *boundsLeaf = nullptr; // In m_bucketTree while the bucket holds anything, trackblock buckets only
+    };
+
+    Bucket &_GetBucket(int32_t bucketIdx);
+    int32_t _FindBucket(const TrackBroadphaseProxy *proxy) const;
+    int32_t _ClimbToNearestBucket(int32_t startBucket, const btVector3 &position) const;
+    void _InsertIntoBucket(TrackBroadphaseProxy *proxy, int32_t bucketIdx);
+    void _RemoveFromBucket(TrackBroadphaseProxy *proxy);
+    void _CollideWithBucket(TrackBroadphaseProxy *proxy, int32_t bucketIdx);
+    void _UpdateBucketBounds(int32_t bucketIdx);
+
+    std::shared_ptr<Track> m_track;
+    std::vector<std::unique_ptr<Bucket>> m_blockBuckets;
+    Bucket m_globalBucket;
+    btDbvt m_bucketTree; // Bounds of each non-empty trackblock bucket's trees, leaf data is the Bucket
+    std::vector<TrackBroadphaseProxy *> m_movingProxies;
+    btOverlappingPairCache *m_pairCache;
+    int m_nextUniqueId  = 0;
+    uint32_t m_nProxies = 0;
+};
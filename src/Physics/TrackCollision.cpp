@@ -0,0 +1,306 @@
+#include "TrackCollision.h"
+
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <boost/filesystem.hpp>
+
+#include "../Config.h"
+#include "../Scene/Track.h"
+#include "../Scene/Lights/TrackLight.h"
+
+namespace
+{
+    constexpr uint32_t kBvhCacheMagic   = 0x48564255; // 'UBVH'
+    constexpr uint32_t kBvhCacheVersion = 1;
+    // Light meshes are billboarded, so the full size mesh gives far too large a bound
+    constexpr float kLightBoundScaleFactor = 10.f;
+
+    struct BvhCacheHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t bulletVersion;
+        uint32_t nTriangles;
+        uint64_t meshHash;
+        uint64_t bufferSize;
+    };
+} // namespace
+
+TrackCollisionMesh::TrackCollisionMesh(uint32_t trackblockID, TrackCollisionLayer layer) : trackblockID(trackblockID), layer(layer), mesh(new btTriangleMesh())
+{
+    switch (layer)
+    {
+    case TrackCollisionLayer::Road:
+        collisionGroup = COL_TRACK;
+        collisionMask  = COL_CAR | COL_RAY | COL_DYNAMIC_TRACK;
+        break;
+    case TrackCollisionLayer::SolidObjects:
+        collisionGroup = COL_DYNAMIC_TRACK;
+        collisionMask  = COL_RAY | COL_CAR;
+        break;
+    case TrackCollisionLayer::PassableObjects:
+        collisionGroup = COL_DYNAMIC_TRACK;
+        collisionMask  = COL_RAY;
+        break;
+    case TrackCollisionLayer::Lights:
+    default:
+        collisionGroup = COL_TRACK;
+        collisionMask  = COL_RAY;
+        break;
+    }
+}
+
+TrackCollisionMesh::~TrackCollisionMesh()
+{
+    // A BVH deserialized in place lives inside bvhBuffer, so the shape must go first
+    shape.reset();
+    if (bvhBuffer != nullptr)
+    {
+        btAlignedFree(bvhBuffer);
+    }
+}
+
+Entity *TrackCollisionMesh::GetEntity(int triangleIndex) const
+{
+    if (triangleIndex < 0 || triangleIndex >= (int) triangleEntities.size())
+    {
+        return nullptr;
+    }
+    return triangleEntities[triangleIndex];
+}
+
+TrackCollision::TrackCollision(Track &track) : m_cacheDir(TRACK_PATH + ToString(track.nfsVersion) + "/" + track.name + "/collision/")
+{
+    if (!boost::filesystem::exists(m_cacheDir))
+    {
+        boost::filesystem::create_directories(m_cacheDir);
+    }
+
+    m_blockMeshes.resize(track.trackBlocks.size());
+
+    // Each trackblock is independent, so blocks are merged, hashed and (on a cache miss) have their BVH built in parallel
+    uint32_t nWorkers = std::max(1u, std::min(std::thread::hardware_concurrency(), (uint32_t) track.trackBlocks.size()));
+    std::atomic<uint32_t> nextTrackblockID(0);
+    auto worker = [&]() {
+        for (uint32_t trackblockID = nextTrackblockID++; trackblockID < track.trackBlocks.size(); trackblockID = nextTrackblockID++)
+        {
+            this->_GenBlockCollision(track, trackblockID);
+        }
+    };
+    std::vector<std::thread> workers;
+    for (uint32_t workerIdx = 1; workerIdx < nWorkers; ++workerIdx)
+    {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for (auto &workerThread : workers)
+    {
+        workerThread.join();
+    }
+
+    LOG(INFO) << "Generated track collision for " << track.trackBlocks.size() << " trackblocks (" << m_nCacheHits << " BVHs cached, " << m_nCacheMisses << " built) using "
+              << nWorkers << " thread" << (nWorkers > 1 ? "s" : "");
+}
+
+const std::vector<std::unique_ptr<TrackCollisionMesh>> &TrackCollision::GetBlockMeshes(uint32_t trackblockID) const
+{
+    return m_blockMeshes[trackblockID];
+}
+
+Entity *TrackCollision::GetEntity(const btCollisionObject *collisionObject, int triangleIndex)
+{
+    if (collisionObject->getUserIndex2() == kMergedMeshTag)
+    {
+        return static_cast<const TrackCollisionMesh *>(collisionObject->getUserPointer())->GetEntity(triangleIndex);
+    }
+    return static_cast<Entity *>(collisionObject->getUserPointer());
+}
+
+void TrackCollision::_GenBlockCollision(Track &track, uint32_t trackblockID)
+{
+    OpenNFS::TrackBlock &trackBlock = track.trackBlocks[trackblockID];
+
+    std::unique_ptr<TrackCollisionMesh> layerMeshes[(uint8_t) TrackCollisionLayer::Length];
+    for (uint8_t layerIdx = 0; layerIdx < (uint8_t) TrackCollisionLayer::Length; ++layerIdx)
+    {
+        layerMeshes[layerIdx] = std::make_unique<TrackCollisionMesh>(trackblockID, (TrackCollisionLayer) layerIdx);
+    }
+
+    for (auto &road : trackBlock.track)
+    {
+        _AddEntity(*layerMeshes[(uint8_t) TrackCollisionLayer::Road], road);
+    }
+    for (auto &object : trackBlock.objects)
+    {
+        // Dynamic objects keep their own convex body, as they need to move independently
+        if (object.dynamic)
+        {
+            continue;
+        }
+        _AddEntity(*layerMeshes[(uint8_t) (object.collideable ? TrackCollisionLayer::SolidObjects : TrackCollisionLayer::PassableObjects)], object);
+    }
+    for (auto &light : trackBlock.lights)
+    {
+        _AddEntity(*layerMeshes[(uint8_t) TrackCollisionLayer::Lights], light);
+    }
+
+    for (auto &collisionMesh : layerMeshes)
+    {
+        if (collisionMesh->triangleEntities.empty())
+        {
+            continue;
+        }
+        uint64_t meshHash = _HashMesh(*collisionMesh);
+        if (this->_LoadBvh(*collisionMesh, meshHash))
+        {
+            ++m_nCacheHits;
+        }
+        else
+        {
+            collisionMesh->shape = std::make_unique<btBvhTriangleMeshShape>(collisionMesh->mesh.get(), true, true);
+            this->_SaveBvh(*collisionMesh, meshHash);
+            ++m_nCacheMisses;
+        }
+        m_blockMeshes[trackblockID].push_back(std::move(collisionMesh));
+    }
+}
+
+void TrackCollision::_AddEntity(TrackCollisionMesh &collisionMesh, Entity &entity)
+{
+    std::vector<glm::vec3> vertices;
+    btTransform transform;
+    float vertexScale = 1.f;
+
+    switch (entity.type)
+    {
+    case LIGHT:
+    {
+        std::shared_ptr<BaseLight> baseLight = boost::get<std::shared_ptr<BaseLight>>(entity.raw);
+        vertices                             = std::static_pointer_cast<TrackLight>(baseLight)->model.m_vertices;
+        // Same placement as the per-entity light bodies used to have
+        transform   = Utils::MakeTransform(baseLight->position, glm::quat(0, 0, 0, 1));
+        vertexScale = 1.f / kLightBoundScaleFactor;
+    }
+    break;
+    case ROAD:
+    case GLOBAL:
+    case XOBJ:
+    case OBJ_POLY:
+    {
+        TrackModel &trackModel = boost::get<TrackModel>(entity.raw);
+        vertices               = trackModel.m_vertices;
+        transform              = Utils::MakeTransform(trackModel.initialPosition, trackModel.orientation);
+    }
+    break;
+    default:
+        return;
+    }
+
+    for (size_t vertIdx = 0; vertIdx + 2 < vertices.size(); vertIdx += 3)
+    {
+        collisionMesh.mesh->addTriangle(transform * Utils::glmToBullet(vertices[vertIdx] * vertexScale),
+                                        transform * Utils::glmToBullet(vertices[vertIdx + 1] * vertexScale),
+                                        transform * Utils::glmToBullet(vertices[vertIdx + 2] * vertexScale),
+                                        false);
+        collisionMesh.triangleEntities.push_back(&entity);
+    }
+}
+
+bool TrackCollision::_LoadBvh(TrackCollisionMesh &collisionMesh, uint64_t meshHash) const
+{
+    std::ifstream cacheFile(this->_GetCachePath(collisionMesh), std::ios::in | std::ios::binary);
+    if (!cacheFile.is_open())
+    {
+        return false;
+    }
+
+    BvhCacheHeader header{};
+    if (!cacheFile.read((char *) &header, sizeof(BvhCacheHeader)) || header.magic != kBvhCacheMagic || header.version != kBvhCacheVersion ||
+        header.bulletVersion != BT_BULLET_VERSION || header.nTriangles != collisionMesh.triangleEntities.size() || header.meshHash != meshHash)
+    {
+        return false;
+    }
+
+    void *bvhBuffer = btAlignedAlloc(header.bufferSize, 16);
+    if (!cacheFile.read((char *) bvhBuffer, header.bufferSize))
+    {
+        btAlignedFree(bvhBuffer);
+        return false;
+    }
+    btOptimizedBvh *bvh = btOptimizedBvh::deSerializeInPlace(bvhBuffer, (unsigned int) header.bufferSize, false);
+    if (bvh == nullptr)
+    {
+        btAlignedFree(bvhBuffer);
+        return false;
+    }
+
+    collisionMesh.shape = std::make_unique<btBvhTriangleMeshShape>(collisionMesh.mesh.get(), true, false);
+    collisionMesh.shape->setOptimizedBvh(bvh);
+    collisionMesh.bvhBuffer = bvhBuffer;
+
+    return true;
+}
+
+void TrackCollision::_SaveBvh(const TrackCollisionMesh &collisionMesh, uint64_t meshHash) const
+{
+    const btOptimizedBvh *bvh = collisionMesh.shape->getOptimizedBvh();
+
+    BvhCacheHeader header{};
+    header.magic         = kBvhCacheMagic;
+    header.version       = kBvhCacheVersion;
+    header.bulletVersion = BT_BULLET_VERSION;
+    header.nTriangles    = (uint32_t) collisionMesh.triangleEntities.size();
+    header.meshHash      = meshHash;
+    header.bufferSize    = bvh->calculateSerializeBufferSize();
+
+    void *bvhBuffer = btAlignedAlloc(header.bufferSize, 16);
+    if (bvh->serializeInPlace(bvhBuffer, (unsigned int) header.bufferSize, false))
+    {
+        std::ofstream cacheFile(this->_GetCachePath(collisionMesh), std::ios::out | std::ios::binary | std::ios::trunc);
+        cacheFile.write((char *) &header, sizeof(BvhCacheHeader));
+        cacheFile.write((char *) bvhBuffer, header.bufferSize);
+    }
+    else
+    {
+        LOG(WARNING) << "Failed to serialize collision BVH for trackblock " << collisionMesh.trackblockID;
+    }
+    btAlignedFree(bvhBuffer);
+}
+
+std::string TrackCollision::_GetCachePath(const TrackCollisionMesh &collisionMesh) const
+{
+    std::stringstream cachePath;
+    cachePath << m_cacheDir << "block" << collisionMesh.trackblockID << "_" << (uint32_t) collisionMesh.layer << ".bvh";
+    return cachePath.str();
+}
+
+// FNV-1a over the world space triangle soup, the BVH is a pure function of it
+uint64_t TrackCollision::_HashMesh(const TrackCollisionMesh &collisionMesh)
+{
+    uint64_t hash = 14695981039346656037ull;
+    auto hashBytes = [&hash](const void *data, size_t size) {
+        for (size_t byteIdx = 0; byteIdx < size; ++byteIdx)
+        {
+            hash ^= ((const uint8_t *) data)[byteIdx];
+            hash *= 1099511628211ull;
+        }
+    };
+
+    const unsigned char *vertexBase = nullptr;
+    const unsigned char *indexBase  = nullptr;
+    int nVertices = 0, vertexStride = 0, indexStride = 0, nFaces = 0;
+    PHY_ScalarType vertexType, indexType;
+    collisionMesh.mesh->getLockedReadOnlyVertexIndexBase(&vertexBase, nVertices, vertexType, vertexStride, &indexBase, indexStride, nFaces, indexType);
+    for (int faceIdx = 0; faceIdx < nFaces; ++faceIdx)
+    {
+        const auto *face = (const uint32_t *) (indexBase + faceIdx * indexStride);
+        for (uint8_t vertIdx = 0; vertIdx < 3; ++vertIdx)
+        {
+            hashBytes(vertexBase + face[vertIdx] * vertexStride, 3 * sizeof(btScalar));
+        }
+    }
+    collisionMesh.mesh->unLockReadOnlyVertexBase(0);
+
+    return hash;
+}
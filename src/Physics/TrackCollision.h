@@ -0,0 +1,69 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <btBulletDynamicsCommon.h>
+#include <BulletCollision/CollisionShapes/btTriangleMesh.h>
+#include <BulletCollision/CollisionShapes/btBvhTriangleMeshShape.h>
+#include <BulletCollision/CollisionShapes/btOptimizedBvh.h>
+
+#include "../Enums.h"
+
+class Track;
+class Entity;
+
+// Static track geometry is merged per trackblock into one mesh for each set of collision filters
+enum class TrackCollisionLayer : uint8_t
+{
+    Road = 0,
+    SolidObjects,
+    PassableObjects,
+    Lights,
+    Length
+};
+
+// All static entities of a single layer of a trackblock, in world space, sharing one BVH
+struct TrackCollisionMesh
+{
+    TrackCollisionMesh(uint32_t trackblockID, TrackCollisionLayer layer);
+    ~TrackCollisionMesh();
+    Entity *GetEntity(int triangleIndex) const;
+
+    uint32_t trackblockID;
+    TrackCollisionLayer layer;
+    int collisionGroup;
+    int collisionMask;
+    std::vector<Entity *> triangleEntities; // Source Entity of each triangle, indexed by Bullet triangle index
+    std::unique_ptr<btTriangleMesh> mesh;
+    std::unique_ptr<btBvhTriangleMeshShape> shape;
+    void *bvhBuffer = nullptr; // Aligned storage of a BVH deserialized in place from the cache, the shape doesn't own it
+};
+
+// Shared, world independent static collision of a track. Each PhysicsEngine creates its own rigid bodies around these shapes.
+class TrackCollision
+{
+public:
+    explicit TrackCollision(Track &track);
+    const std::vector<std::unique_ptr<TrackCollisionMesh>> &GetBlockMeshes(uint32_t trackblockID) const;
+    // Maps a ray or contact result back to the Entity it hit, for merged meshes and per-entity bodies alike
+    static Entity *GetEntity(const btCollisionObject *collisionObject, int triangleIndex);
+
+    // Tag stored in btCollisionObject::m_userIndex2 of rigid bodies wrapping a TrackCollisionMesh
+    static constexpr int kMergedMeshTag = 0x7C01;
+
+private:
+    void _GenBlockCollision(Track &track, uint32_t trackblockID);
+    static void _AddEntity(TrackCollisionMesh &collisionMesh, Entity &entity);
+    bool _LoadBvh(TrackCollisionMesh &collisionMesh, uint64_t meshHash) const;
+    void _SaveBvh(const TrackCollisionMesh &collisionMesh, uint64_t meshHash) const;
+    std::string _GetCachePath(const TrackCollisionMesh &collisionMesh) const;
+    static uint64_t _HashMesh(const TrackCollisionMesh &collisionMesh);
+
+    std::string m_cacheDir;
+    std::vector<std::vector<std::unique_ptr<TrackCollisionMesh>>> m_blockMeshes;
+    std::atomic<uint32_t> m_nCacheHits{0};
+    std::atomic<uint32_t> m_nCacheMisses{0};
+};
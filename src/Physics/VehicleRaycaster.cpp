@@ -0,0 +1,295 @@
+#include "VehicleRaycaster.h"
+
+#include <algorithm>
+#include <BulletCollision/CollisionShapes/btTriangleCallback.h>
+#include <LinearMath/btAabbUtil2.h>
+
+// Slack around the first ray of a gather, big enough that the other three wheels' rays (and the next few ticks of them) fall inside
+constexpr btScalar kCandidateMargin = 3.f;
+
+std::atomic<uint64_t> VehicleRaycaster::s_nValidatedRays(0);
+std::atomic<uint64_t> VehicleRaycaster::s_nValidationMismatches(0);
+
+namespace
+{
+    class CandidateCollector : public btTriangleCallback
+    {
+    public:
+        CandidateCollector(btAlignedObjectArray<VehicleRaycaster::CandidateTriangle> &candidates, btRigidBody *body) : m_candidates(candidates), m_body(body)
+        {
+        }
+
+        void processTriangle(btVector3 *triangle, int partId, int triangleIndex) override
+        {
+            VehicleRaycaster::CandidateTriangle &candidate = m_candidates.expandNonInitializing();
+            candidate.aabbMin                              = triangle[0];
+            candidate.aabbMax                              = triangle[0];
+            for (uint8_t vertIdx = 0; vertIdx < 3; ++vertIdx)
+            {
+                candidate.vertices[vertIdx] = triangle[vertIdx];
+                candidate.aabbMin.setMin(triangle[vertIdx]);
+                candidate.aabbMax.setMax(triangle[vertIdx]);
+            }
+            candidate.body = m_body;
+        }
+
+    private:
+        btAlignedObjectArray<VehicleRaycaster::CandidateTriangle> &m_candidates;
+        btRigidBody *m_body;
+    };
+
+    // Wheel impulses applied to bodies with zero inverse mass are no-ops, so only those can be driven on from worker threads
+    class StaticRayResultCallback : public btCollisionWorld::ClosestRayResultCallback
+    {
+    public:
+        using btCollisionWorld::ClosestRayResultCallback::ClosestRayResultCallback;
+
+        bool needsCollision(btBroadphaseProxy *proxy0) const override
+        {
+            if (!ClosestRayResultCallback::needsCollision(proxy0))
+            {
+                return false;
+            }
+            const btRigidBody *body = btRigidBody::upcast(static_cast<const btCollisionObject *>(proxy0->m_clientObject));
+            return body != nullptr && body->getInvMass() == btScalar(0.f);
+        }
+    };
+} // namespace
+
+VehicleRaycaster::VehicleRaycaster(btDynamicsWorld *dynamicsWorld,
+                                   const std::shared_ptr<Track> &track,
+                                   const std::vector<std::vector<btRigidBody *>> &blockBodies,
+                                   const uint32_t &trackBodiesRevision,
+                                   WheelRaycasterType raycasterType) :
+    m_dynamicsWorld(dynamicsWorld), m_track(track), m_blockBodies(blockBodies), m_trackBodiesRevision(trackBodiesRevision), m_raycasterType(raycasterType)
+{
+}
+
+void *VehicleRaycaster::castRay(const btVector3 &from, const btVector3 &to, btVehicleRaycasterResult &result)
+{
+    // Nothing to scope the rays to until a track has been registered
+    if (m_track == nullptr || m_blockBodies.empty())
+    {
+        return this->_CastRayWorld(from, to, result);
+    }
+
+    switch (m_raycasterType)
+    {
+    case WORLD_RAYCASTER:
+        return this->_CastRayWorld(from, to, result);
+    case VALIDATING_RAYCASTER:
+    {
+        btVehicleRaycasterResult trackResult;
+        void *trackHit = this->_CastRayTrack(from, to, trackResult);
+        void *worldHit = this->_CastRayWorld(from, to, result);
+        ++s_nValidatedRays;
+        // Different bodies at the same fraction are ties between coincident triangles, not disagreements
+        if ((trackHit == nullptr) != (worldHit == nullptr) || (worldHit != nullptr && btFabs(trackResult.m_distFraction - result.m_distFraction) > kValidationFractionTolerance))
+        {
+            if (s_nValidationMismatches++ == 0)
+            {
+                LOG(WARNING) << "Track raycaster disagrees with world rayTest: fraction " << (trackHit ? trackResult.m_distFraction : 1.f) << " vs "
+                             << (worldHit ? result.m_distFraction : 1.f);
+            }
+        }
+        return worldHit;
+    }
+    case TRACK_RAYCASTER:
+    default:
+        return this->_CastRayTrack(from, to, result);
+    }
+}
+
+RaycastValidationStats VehicleRaycaster::GetValidationStats()
+{
+    RaycastValidationStats stats;
+    stats.nRays       = s_nValidatedRays;
+    stats.nMismatches = s_nValidationMismatches;
+    return stats;
+}
+
+void VehicleRaycaster::ResetValidationStats()
+{
+    s_nValidatedRays        = 0;
+    s_nValidationMismatches = 0;
+}
+
+void *VehicleRaycaster::_CastRayWorld(const btVector3 &from, const btVector3 &to, btVehicleRaycasterResult &result)
+{
+    StaticRayResultCallback rayCallback(from, to);
+    // Static solid objects are ground too, roadsigns and the like are skipped by their mass rather than their group
+    rayCallback.m_collisionFilterMask = COL_TRACK | COL_DYNAMIC_TRACK;
+    m_dynamicsWorld->rayTest(from, to, rayCallback);
+
+    if (rayCallback.hasHit())
+    {
+        const btRigidBody *body = btRigidBody::upcast(rayCallback.m_collisionObject);
+        if (body && body->hasContactResponse())
+        {
+            result.m_hitPointInWorld  = rayCallback.m_hitPointWorld;
+            result.m_hitNormalInWorld = rayCallback.m_hitNormalWorld;
+            result.m_hitNormalInWorld.normalize();
+            result.m_distFraction = rayCallback.m_closestHitFraction;
+            return (void *) body;
+        }
+    }
+    return nullptr;
+}
+
+void *VehicleRaycaster::_CastRayTrack(const btVector3 &from, const btVector3 &to, btVehicleRaycasterResult &result)
+{
+    btVector3 rayMin = from, rayMax = from;
+    rayMin.setMin(to);
+    rayMax.setMax(to);
+
+    bool rayInsideCandidates = m_candidatesValid && m_candidatesRevision == m_trackBodiesRevision && rayMin.x() >= m_candidateMin.x() && rayMin.y() >= m_candidateMin.y() &&
+                               rayMin.z() >= m_candidateMin.z() && rayMax.x() <= m_candidateMax.x() && rayMax.y() <= m_candidateMax.y() && rayMax.z() <= m_candidateMax.z();
+    if (!rayInsideCandidates)
+    {
+        this->_GatherCandidates(rayMin, rayMax);
+    }
+
+    btScalar closestHitFraction = 1.f;
+    btVector3 closestHitNormal;
+    int closestCandidate = -1;
+    auto testCandidate   = [&](int candidateIdx) {
+        const CandidateTriangle &candidate = m_candidates[candidateIdx];
+        if (!TestAabbAgainstAabb2(rayMin, rayMax, candidate.aabbMin, candidate.aabbMax))
+        {
+            return;
+        }
+        if (_RayTriangle(from, to, candidate, closestHitFraction, closestHitNormal))
+        {
+            closestCandidate = candidateIdx;
+        }
+    };
+
+    // Last tick's hits first, so the full pass below mostly fails the fraction test early
+    for (auto &candidateIdx : m_lastHitCandidates)
+    {
+        if (candidateIdx >= 0)
+        {
+            testCandidate(candidateIdx);
+        }
+    }
+    for (int candidateIdx = 0; candidateIdx < m_candidates.size(); ++candidateIdx)
+    {
+        testCandidate(candidateIdx);
+    }
+
+    if (closestCandidate < 0)
+    {
+        return nullptr;
+    }
+
+    // Move to front, dropping the least recent hit if it wasn't already cached
+    int *lastHit = std::find(m_lastHitCandidates, m_lastHitCandidates + kLastHitCacheSize - 1, closestCandidate);
+    std::copy_backward(m_lastHitCandidates, lastHit, lastHit + 1);
+    m_lastHitCandidates[0] = closestCandidate;
+
+    // Same as ClosestRayResultCallback fills in, track bodies sit at the identity so local and world space are one
+    result.m_hitPointInWorld.setInterpolate3(from, to, closestHitFraction);
+    result.m_hitNormalInWorld = closestHitNormal;
+    result.m_hitNormalInWorld.normalize();
+    result.m_distFraction = closestHitFraction;
+    return (void *) m_candidates[closestCandidate].body;
+}
+
+void VehicleRaycaster::_GatherCandidates(const btVector3 &rayMin, const btVector3 &rayMax)
+{
+    m_candidateMin = rayMin - btVector3(kCandidateMargin, kCandidateMargin, kCandidateMargin);
+    m_candidateMax = rayMax + btVector3(kCandidateMargin, kCandidateMargin, kCandidateMargin);
+    m_candidates.resize(0);
+    std::fill(m_lastHitCandidates, m_lastHitCandidates + kLastHitCacheSize, -1);
+
+    m_track->spatialIndex.UpdateLocation(Utils::bulletToGlm((rayMin + rayMax) * 0.5f), m_trackLocation);
+    OpenNFS::TrackBlock &trackBlock = m_track->trackBlocks[m_trackLocation.trackblockID];
+    uint32_t nTrackblocks           = (uint32_t) m_track->trackBlocks.size();
+    std::vector<uint32_t> trackblockIDs{trackBlock.id, (trackBlock.id + 1) % nTrackblocks, (trackBlock.id + nTrackblocks - 1) % nTrackblocks};
+    for (auto &neighbourID : trackBlock.neighbourIds)
+    {
+        if (neighbourID < nTrackblocks && std::find(trackblockIDs.begin(), trackblockIDs.end(), neighbourID) == trackblockIDs.end())
+        {
+            trackblockIDs.push_back(neighbourID);
+        }
+    }
+
+    for (auto &trackblockID : trackblockIDs)
+    {
+        for (auto &trackBody : m_blockBodies[trackblockID])
+        {
+            // Only what rayTest would consider: in the world, ray-visible track, and solid
+            btBroadphaseProxy *broadphaseHandle = trackBody->getBroadphaseHandle();
+            if (broadphaseHandle == nullptr || !(broadphaseHandle->m_collisionFilterGroup & (COL_TRACK | COL_DYNAMIC_TRACK)) ||
+                !(broadphaseHandle->m_collisionFilterMask & btBroadphaseProxy::DefaultFilter) || !trackBody->hasContactResponse())
+            {
+                continue;
+            }
+            CandidateCollector candidateCollector(m_candidates, trackBody);
+            trackBody->getCollisionShape()->processAllTriangles(&candidateCollector, m_candidateMin, m_candidateMax);
+        }
+    }
+
+    m_candidatesRevision = m_trackBodiesRevision;
+    m_candidatesValid    = true;
+}
+
+// btTriangleRaycastCallback::processTriangle, operation for operation, so fractions and normals come out bit identical
+bool VehicleRaycaster::_RayTriangle(const btVector3 &from, const btVector3 &to, const CandidateTriangle &triangle, btScalar &hitFraction, btVector3 &hitNormal)
+{
+    const btVector3 &vert0 = triangle.vertices[0];
+    const btVector3 &vert1 = triangle.vertices[1];
+    const btVector3 &vert2 = triangle.vertices[2];
+
+    btVector3 v10            = vert1 - vert0;
+    btVector3 v20            = vert2 - vert0;
+    btVector3 triangleNormal = v10.cross(v20);
+
+    const btScalar dist = vert0.dot(triangleNormal);
+    btScalar dist_a     = triangleNormal.dot(from);
+    dist_a -= dist;
+    btScalar dist_b = triangleNormal.dot(to);
+    dist_b -= dist;
+
+    if (dist_a * dist_b >= btScalar(0.0))
+    {
+        return false;
+    }
+
+    const btScalar proj_length = dist_a - dist_b;
+    const btScalar distance    = (dist_a) / (proj_length);
+    if (!(distance < hitFraction))
+    {
+        return false;
+    }
+
+    btScalar edge_tolerance = triangleNormal.length2();
+    edge_tolerance *= btScalar(-0.0001);
+    btVector3 point;
+    point.setInterpolate3(from, to, distance);
+
+    btVector3 v0p = vert0 - point;
+    btVector3 v1p = vert1 - point;
+    btVector3 cp0 = v0p.cross(v1p);
+    if (!((btScalar) (cp0.dot(triangleNormal)) >= edge_tolerance))
+    {
+        return false;
+    }
+    btVector3 v2p = vert2 - point;
+    btVector3 cp1 = v1p.cross(v2p);
+    if (!((btScalar) (cp1.dot(triangleNormal)) >= edge_tolerance))
+    {
+        return false;
+    }
+    btVector3 cp2 = v2p.cross(v0p);
+    if (!((btScalar) (cp2.dot(triangleNormal)) >= edge_tolerance))
+    {
+        return false;
+    }
+
+    triangleNormal.normalize();
+    // Normals are flipped to face the ray, as rayTest does without kF_KeepUnflippedNormal
+    hitNormal   = (dist_a <= btScalar(0.0)) ? -triangleNormal : triangleNormal;
+    hitFraction = distance;
+    return true;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <BulletDynamics/Vehicle/btVehicleRaycaster.h>
+#include <BulletDynamics/Dynamics/btDynamicsWorld.h>
+
+#include "../Enums.h"
+#include "../Scene/Track.h"
+
+constexpr uint8_t kLastHitCacheSize             = 4;     // One per wheel
+constexpr btScalar kValidationFractionTolerance = 1e-4f; // Of the ray length, anything closer is the same hit, whichever triangle it was on
+
+// Totals over every VehicleRaycaster running in VALIDATING_RAYCASTER mode
+struct RaycastValidationStats
+{
+    uint64_t nRays       = 0;
+    uint64_t nMismatches = 0; // Hit/miss differed between the track and world casts, or hit fraction by more than kValidationFractionTolerance
+};
+
+// Casts wheel suspension rays against the static track only. The default raycaster can return another car or a roadsign as ground,
+// and btRaycastVehicle then pushes friction impulses into that body, which prevents vehicles from being updated in parallel.
+// In TRACK_RAYCASTER mode the rays skip the world's broadphase and BVH walks entirely: triangles from the ray-visible track
+// meshes of the car's trackblock and its neighbours are gathered once into a box around the car, and reused by all four wheels
+// until a ray leaves it. The triangle test is Bullet's own, so hits match rayTest bar ties between triangles at the same fraction.
+class VehicleRaycaster : public btVehicleRaycaster
+{
+public:
+    struct CandidateTriangle
+    {
+        btVector3 vertices[3];
+        btVector3 aabbMin, aabbMax;
+        btRigidBody *body;
+    };
+
+    VehicleRaycaster(btDynamicsWorld *dynamicsWorld,
+                     const std::shared_ptr<Track> &track,
+                     const std::vector<std::vector<btRigidBody *>> &blockBodies,
+                     const uint32_t &trackBodiesRevision,
+                     WheelRaycasterType raycasterType);
+    void *castRay(const btVector3 &from, const btVector3 &to, btVehicleRaycasterResult &result) override;
+    static RaycastValidationStats GetValidationStats();
+    static void ResetValidationStats();
+
+private:
+    void *_CastRayWorld(const btVector3 &from, const btVector3 &to, btVehicleRaycasterResult &result);
+    void *_CastRayTrack(const btVector3 &from, const btVector3 &to, btVehicleRaycasterResult &result);
+    void _GatherCandidates(const btVector3 &rayMin, const btVector3 &rayMax);
+    static bool _RayTriangle(const btVector3 &from, const btVector3 &to, const CandidateTriangle &triangle, btScalar &hitFraction, btVector3 &hitNormal);
+
+    btDynamicsWorld *m_dynamicsWorld;
+    // Owned by the PhysicsEngine, which outlives its vehicles, and only filled in once a track is registered
+    const std::shared_ptr<Track> &m_track;
+    const std::vector<std::vector<btRigidBody *>> &m_blockBodies;
+    const uint32_t &m_trackBodiesRevision;
+    WheelRaycasterType m_raycasterType;
+
+    btAlignedObjectArray<CandidateTriangle> m_candidates;
+    btVector3 m_candidateMin, m_candidateMax; // Region every triangle that could be hit inside of has been gathered for
+    uint32_t m_candidatesRevision = 0;
+    bool m_candidatesValid        = false;
+    TrackLocation m_trackLocation;
+    int m_lastHitCandidates[kLastHitCacheSize] = {-1, -1, -1, -1}; // Most recent hits first, each wheel tends to hit the same triangle as last tick
+
+    static std::atomic<uint64_t> s_nValidatedRays;
+    static std::atomic<uint64_t> s_nValidationMismatches;
+};
@@ -0,0 +1,50 @@
+#include "VehicleUpdateAction.h"
+
+struct VehicleUpdateLoop : public btIParallelForBody
+{
+    VehicleUpdateLoop(btAlignedObjectArray<btRaycastVehicle *> &vehicles, btCollisionWorld *collisionWorld, btScalar deltaTimeStep) :
+        m_vehicles(vehicles), m_collisionWorld(collisionWorld), m_deltaTimeStep(deltaTimeStep)
+    {
+    }
+
+    void forLoop(int iBegin, int iEnd) const override
+    {
+        for (int vehicleIdx = iBegin; vehicleIdx < iEnd; ++vehicleIdx)
+        {
+            // Parked vehicles are left exactly as they are
+            if (m_vehicles[vehicleIdx]->getRigidBody()->getActivationState() == DISABLE_SIMULATION)
+            {
+                continue;
+            }
+            m_vehicles[vehicleIdx]->updateAction(m_collisionWorld, m_deltaTimeStep);
+        }
+    }
+
+    btAlignedObjectArray<btRaycastVehicle *> &m_vehicles;
+    btCollisionWorld *m_collisionWorld;
+    btScalar m_deltaTimeStep;
+};
+
+void VehicleUpdateAction::AddVehicle(btRaycastVehicle *vehicle)
+{
+    m_vehicles.push_back(vehicle);
+}
+
+void VehicleUpdateAction::RemoveVehicle(btRaycastVehicle *vehicle)
+{
+    m_vehicles.remove(vehicle);
+}
+
+void VehicleUpdateAction::updateAction(btCollisionWorld *collisionWorld, btScalar deltaTimeStep)
+{
+    // One vehicle per task, each update casts four wheel rays so there's plenty of work to go round
+    btParallelFor(0, m_vehicles.size(), 1, VehicleUpdateLoop(m_vehicles, collisionWorld, deltaTimeStep));
+}
+
+void VehicleUpdateAction::debugDraw(btIDebugDraw *debugDrawer)
+{
+    for (int vehicleIdx = 0; vehicleIdx < m_vehicles.size(); ++vehicleIdx)
+    {
+        m_vehicles[vehicleIdx]->debugDraw(debugDrawer);
+    }
+}
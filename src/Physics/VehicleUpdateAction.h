@@ -0,0 +1,19 @@
+#pragma once
+
+#include <BulletDynamics/Dynamics/btActionInterface.h>
+#include <BulletDynamics/Vehicle/btRaycastVehicle.h>
+#include <LinearMath/btThreads.h>
+
+// Updates every registered vehicle from a single world action, spreading them across the Bullet task scheduler.
+// Vehicles must use a VehicleRaycaster so that an update only ever writes to its own chassis.
+class VehicleUpdateAction : public btActionInterface
+{
+public:
+    void AddVehicle(btRaycastVehicle *vehicle);
+    void RemoveVehicle(btRaycastVehicle *vehicle);
+    void updateAction(btCollisionWorld *collisionWorld, btScalar deltaTimeStep) override;
+    void debugDraw(btIDebugDraw *debugDrawer) override;
+
+private:
+    btAlignedObjectArray<btRaycastVehicle *> m_vehicles;
+};
@@ -0,0 +1,231 @@
+#include "VroadRangefinder.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Car.h"
+
+// Walls are only seen by rays passing from a little below their base to this far above it, so the road crossing over or under
+// another stretch of track doesn't block the rays
+constexpr float kWallHeight     = 2.5f;
+constexpr float kWallBaseSlack  = 1.f;
+constexpr float kNoHit          = 2.f; // Beyond the end of any ray, whose hits run from 0 to 1
+
+std::atomic<uint64_t> VroadRangefinder::s_nValidatedReadings(0);
+std::atomic<uint64_t> VroadRangefinder::s_nValidationHitMismatches(0);
+std::atomic<uint64_t> VroadRangefinder::s_nValidatedHits(0);
+std::atomic<uint64_t> VroadRangefinder::s_totalValidationErrorMicrons(0);
+std::atomic<uint64_t> VroadRangefinder::s_maxValidationErrorMicrons(0);
+
+namespace
+{
+    struct ReadingErrors
+    {
+        uint64_t nMismatches     = 0;
+        uint64_t nHits           = 0;
+        uint64_t errorMicrons    = 0;
+        uint64_t maxErrorMicrons = 0;
+    };
+
+    void RecordReading(float reading, float reference, ReadingErrors &errors)
+    {
+        bool hit = reading != kFarDistance, referenceHit = reference != kFarDistance;
+        if (hit != referenceHit)
+        {
+            ++errors.nMismatches;
+            return;
+        }
+        if (!hit)
+        {
+            return;
+        }
+        auto error = (uint64_t) (std::abs(reading - reference) * 1e6f);
+        ++errors.nHits;
+        errors.errorMicrons += error;
+        errors.maxErrorMicrons = std::max(errors.maxErrorMicrons, error);
+    }
+} // namespace
+
+void WallSegments::Add(const glm::vec3 &start, const glm::vec3 &end)
+{
+    startX.push_back(start.x);
+    startY.push_back(start.y);
+    startZ.push_back(start.z);
+    deltaX.push_back(end.x - start.x);
+    deltaY.push_back(end.y - start.y);
+    deltaZ.push_back(end.z - start.z);
+}
+
+VroadWalls::VroadWalls(const Track &track)
+{
+    uint32_t nVroad       = (uint32_t) track.virtualRoad.size();
+    uint32_t nTrackblocks = (uint32_t) track.trackBlocks.size();
+    m_nearbySegments.resize(nTrackblocks);
+    if (nVroad < 2 || nTrackblocks == 0)
+    {
+        return;
+    }
+
+    // Same convention as the debug renderer draws them in
+    std::vector<glm::vec3> leftWall(nVroad), rightWall(nVroad);
+    float maxSpacing = 0.f;
+    for (uint32_t vroadIdx = 0; vroadIdx < nVroad; ++vroadIdx)
+    {
+        leftWall[vroadIdx]  = track.virtualRoad[vroadIdx].position - track.virtualRoad[vroadIdx].leftWall;
+        rightWall[vroadIdx] = track.virtualRoad[vroadIdx].position + track.virtualRoad[vroadIdx].rightWall;
+        if (vroadIdx > 0)
+        {
+            maxSpacing = std::max(maxSpacing, glm::distance(track.virtualRoad[vroadIdx - 1].position, track.virtualRoad[vroadIdx].position));
+        }
+    }
+    // Circuits close back on their first node, point to point tracks have a gap there that mustn't be walled off
+    bool closed = glm::distance(track.virtualRoad.back().position, track.virtualRoad.front().position) <= maxSpacing;
+
+    // Each segment belongs to the trackblock of the node it starts at
+    std::vector<std::vector<uint32_t>> blockSegmentStarts(nTrackblocks);
+    for (auto &trackBlock : track.trackBlocks)
+    {
+        for (uint32_t vroadIdx = trackBlock.virtualRoadStartIndex; vroadIdx < trackBlock.virtualRoadStartIndex + trackBlock.nVirtualRoadPositions; ++vroadIdx)
+        {
+            if (vroadIdx < nVroad && (vroadIdx + 1 < nVroad || closed))
+            {
+                blockSegmentStarts[trackBlock.id].push_back(vroadIdx);
+            }
+        }
+    }
+
+    for (auto &trackBlock : track.trackBlocks)
+    {
+        std::vector<uint32_t> nearbyTrackblockIDs{trackBlock.id, (trackBlock.id + 1) % nTrackblocks, (trackBlock.id + nTrackblocks - 1) % nTrackblocks};
+        for (auto &neighbourID : trackBlock.neighbourIds)
+        {
+            if (neighbourID < nTrackblocks)
+            {
+                nearbyTrackblockIDs.push_back(neighbourID);
+            }
+        }
+        std::sort(nearbyTrackblockIDs.begin(), nearbyTrackblockIDs.end());
+        nearbyTrackblockIDs.erase(std::unique(nearbyTrackblockIDs.begin(), nearbyTrackblockIDs.end()), nearbyTrackblockIDs.end());
+
+        WallSegments &segments = m_nearbySegments[trackBlock.id];
+        for (auto &nearbyTrackblockID : nearbyTrackblockIDs)
+        {
+            for (auto &vroadIdx : blockSegmentStarts[nearbyTrackblockID])
+            {
+                uint32_t nextVroadIdx = (vroadIdx + 1) % nVroad;
+                segments.Add(leftWall[vroadIdx], leftWall[nextVroadIdx]);
+                segments.Add(rightWall[vroadIdx], rightWall[nextVroadIdx]);
+            }
+        }
+    }
+}
+
+const WallSegments &VroadWalls::GetNearbySegments(uint32_t trackblockID) const
+{
+    return m_nearbySegments[trackblockID];
+}
+
+VroadRangefinder::VroadRangefinder(const std::shared_ptr<Track> &track) : m_track(track)
+{
+    // Built by the first car to need them, cars are set up before anything steps in parallel
+    if (m_track->vroadWalls == nullptr)
+    {
+        m_track->vroadWalls = std::make_shared<VroadWalls>(*m_track);
+    }
+}
+
+void VroadRangefinder::Cast(const glm::vec3 &origin, RangefinderInfo &rangefinderInfo)
+{
+    m_track->spatialIndex.UpdateLocation(origin, m_trackLocation);
+    if (!m_trackLocation.valid || m_track->virtualRoad.empty())
+    {
+        std::fill(rangefinderInfo.rangefinders, rangefinderInfo.rangefinders + kNumRangefinders, kFarDistance);
+        return;
+    }
+
+    // Padding rays have no length, so never hit
+    alignas(32) float rayX[kPaddedRangefinders] = {}, rayY[kPaddedRangefinders] = {}, rayZ[kPaddedRangefinders] = {};
+    alignas(32) float closest[kPaddedRangefinders];
+    for (uint8_t rangeIdx = 0; rangeIdx < kNumRangefinders; ++rangeIdx)
+    {
+        glm::vec3 ray  = rangefinderInfo.castPositions[rangeIdx] - origin;
+        rayX[rangeIdx] = ray.x;
+        rayY[rangeIdx] = ray.y;
+        rayZ[rangeIdx] = ray.z;
+    }
+    std::fill(closest, closest + kPaddedRangefinders, kNoHit);
+
+    // Ray and segment crossing in the ground plane: origin + t * ray = start + u * delta, each with 0 <= t, u <= 1. Every ray
+    // against one segment per pass, so the inner loop is branch free across lanes.
+    const WallSegments &segments = m_track->vroadWalls->GetNearbySegments(m_trackLocation.trackblockID);
+    for (size_t segmentIdx = 0; segmentIdx < segments.Size(); ++segmentIdx)
+    {
+        float toStartX = segments.startX[segmentIdx] - origin.x;
+        float toStartZ = segments.startZ[segmentIdx] - origin.z;
+        float startY   = segments.startY[segmentIdx] - origin.y;
+        float deltaX   = segments.deltaX[segmentIdx];
+        float deltaY   = segments.deltaY[segmentIdx];
+        float deltaZ   = segments.deltaZ[segmentIdx];
+        float tCross   = toStartX * deltaZ - toStartZ * deltaX;
+        for (uint8_t rangeIdx = 0; rangeIdx < kPaddedRangefinders; ++rangeIdx)
+        {
+            float denominator = rayX[rangeIdx] * deltaZ - rayZ[rangeIdx] * deltaX;
+            float t           = tCross / denominator;
+            float u           = (toStartX * rayZ[rangeIdx] - toStartZ * rayX[rangeIdx]) / denominator;
+            float heightAbove = t * rayY[rangeIdx] - (startY + u * deltaY);
+            bool hit          = t >= 0.f && t <= 1.f && t < closest[rangeIdx] && u >= 0.f && u <= 1.f && heightAbove >= -kWallBaseSlack && heightAbove <= kWallHeight;
+            closest[rangeIdx] = hit ? t : closest[rangeIdx];
+        }
+    }
+    for (uint8_t rangeIdx = 0; rangeIdx < kNumRangefinders; ++rangeIdx)
+    {
+        float rayLength                        = std::sqrt(rayX[rangeIdx] * rayX[rangeIdx] + rayY[rangeIdx] * rayY[rangeIdx] + rayZ[rangeIdx] * rayZ[rangeIdx]);
+        rangefinderInfo.rangefinders[rangeIdx] = closest[rangeIdx] != kNoHit ? closest[rangeIdx] * rayLength : kFarDistance;
+    }
+}
+
+void VroadRangefinder::Validate(const glm::vec3 &origin, const RangefinderInfo &reference)
+{
+    RangefinderInfo rangefinderInfo = reference;
+    this->Cast(origin, rangefinderInfo);
+
+    ReadingErrors errors;
+    for (uint8_t rangeIdx = 0; rangeIdx < kNumRangefinders; ++rangeIdx)
+    {
+        RecordReading(rangefinderInfo.rangefinders[rangeIdx], reference.rangefinders[rangeIdx], errors);
+    }
+
+    s_nValidatedReadings += kNumRangefinders;
+    s_nValidationHitMismatches += errors.nMismatches;
+    s_nValidatedHits += errors.nHits;
+    s_totalValidationErrorMicrons += errors.errorMicrons;
+    uint64_t previousMax = s_maxValidationErrorMicrons;
+    while (errors.maxErrorMicrons > previousMax && !s_maxValidationErrorMicrons.compare_exchange_weak(previousMax, errors.maxErrorMicrons))
+    {
+    }
+}
+
+void VroadRangefinder::ResetLocation()
+{
+    m_trackLocation.valid = false;
+}
+
+RangefinderValidationStats VroadRangefinder::GetValidationStats()
+{
+    RangefinderValidationStats stats;
+    stats.nReadings      = s_nValidatedReadings;
+    stats.nHitMismatches = s_nValidationHitMismatches;
+    uint64_t nHits       = s_nValidatedHits;
+    stats.meanError      = nHits ? s_totalValidationErrorMicrons / 1e6 / nHits : 0.0;
+    stats.maxError       = s_maxValidationErrorMicrons / 1e6;
+    return stats;
+}
+
+void VroadRangefinder::ResetValidationStats()
+{
+    s_nValidatedReadings          = 0;
+    s_nValidationHitMismatches    = 0;
+    s_nValidatedHits              = 0;
+    s_totalValidationErrorMicrons = 0;
+    s_maxValidationErrorMicrons   = 0;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "../Scene/Track.h"
+
+// Rays are padded out to a whole number of SIMD lanes, so the intersection loop has a fixed trip count
+constexpr uint8_t kPaddedRangefinders = 24;
+
+// Totals over every VroadRangefinder running in VALIDATING_RANGEFINDER mode
+struct RangefinderValidationStats
+{
+    uint64_t nReadings      = 0; // Rangefinders compared
+    uint64_t nHitMismatches = 0; // One backend saw a wall within range and the other didn't
+    double meanError        = 0; // Over readings where both backends hit
+    double maxError         = 0;
+};
+
+// Left and right virtual road walls as vertical segments, base to base between consecutive vroad nodes, stored structure of arrays
+struct WallSegments
+{
+    void Add(const glm::vec3 &start, const glm::vec3 &end);
+    size_t Size() const
+    {
+        return startX.size();
+    }
+
+    std::vector<float> startX, startY, startZ;
+    std::vector<float> deltaX, deltaY, deltaZ;
+};
+
+// The walls every trackblock's cars can see: its own, its neighbours', and the blocks either side. Built once per track and shared by
+// every car on it, like TrackCollision.
+class VroadWalls
+{
+public:
+    explicit VroadWalls(const Track &track);
+    const WallSegments &GetNearbySegments(uint32_t trackblockID) const;
+
+private:
+    std::vector<WallSegments> m_nearbySegments;
+};
+
+// Rangefinders for AI that only care where the road edge is. Rather than Bullet ray tests against the track's triangle BVHs, each
+// ray is intersected in the ground plane with the nearby vroad wall segments, all rays at once per segment. The up/down casts stay
+// Bullet ray tests, as training's inside the vroad check needs the ceiling they hit. Walls are extruded from the vroad, not the track
+// geometry, so readings differ from the world rangefinders wherever the real barriers don't follow the vroad;
+// VALIDATING_RANGEFINDER measures by how much.
+class VroadRangefinder
+{
+public:
+    explicit VroadRangefinder(const std::shared_ptr<Track> &track);
+    // Fills in distances for the cast positions already in rangefinderInfo
+    void Cast(const glm::vec3 &origin, RangefinderInfo &rangefinderInfo);
+    // Casts, and records how far the result is from reference without touching it
+    void Validate(const glm::vec3 &origin, const RangefinderInfo &reference);
+    // The car has jumped, so don't walk on from where it was
+    void ResetLocation();
+    static RangefinderValidationStats GetValidationStats();
+    static void ResetValidationStats();
+
+private:
+    std::shared_ptr<Track> m_track;
+    TrackLocation m_trackLocation;
+
+    static std::atomic<uint64_t> s_nValidatedReadings;
+    static std::atomic<uint64_t> s_nValidationHitMismatches;
+    static std::atomic<uint64_t> s_nValidatedHits;
+    static std::atomic<uint64_t> s_totalValidationErrorMicrons; // Fixed point, so it can be summed atomically
+    static std::atomic<uint64_t> s_maxValidationErrorMicrons;
+};
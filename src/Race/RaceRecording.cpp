@@ -0,0 +1,186 @@
+#include "RaceRecording.h"
+
+#include <algorithm>
+
+#include "../Config.h"
+#include "../Util/Logger.h"
+
+// Tick flags, the low bits are PlayerInputs::Pack
+constexpr uint8_t kTickSimulateCars = 1 << 6;
+constexpr uint8_t kTickChecksum     = 1 << 7;
+
+namespace
+{
+    template <typename T>
+    void Write(std::ostream &o, const T &value)
+    {
+        o.write(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    void WriteString(std::ostream &o, const std::string &value)
+    {
+        Write(o, (uint16_t) value.size());
+        o.write(value.data(), value.size());
+    }
+
+    template <typename T>
+    T Read(std::istream &i)
+    {
+        T value{};
+        i.read(reinterpret_cast<char *>(&value), sizeof(T));
+        return value;
+    }
+
+    std::string ReadString(std::istream &i)
+    {
+        std::string value(Read<uint16_t>(i), '\0');
+        i.read(&value[0], value.size());
+        return value;
+    }
+} // namespace
+
+RaceRecordingHeader RaceRecordingHeader::FromConfig(uint32_t seed, float timeStep, uint32_t checksumInterval)
+{
+    RaceRecordingHeader header;
+    header.seed               = seed;
+    header.timeStep           = timeStep;
+    header.checksumInterval   = checksumInterval;
+    header.carTag             = Config::get().carTag;
+    header.car                = Config::get().car;
+    header.trackTag           = Config::get().trackTag;
+    header.track              = Config::get().track;
+    header.nRacers            = Config::get().nRacers;
+    header.racerLodDistance   = Config::get().racerLodDistance;
+    header.racerLodHysteresis = Config::get().racerLodHysteresis;
+    return header;
+}
+
+void RaceRecordingHeader::ApplyToConfig() const
+{
+    Config::get().carTag             = carTag;
+    Config::get().car                = car;
+    Config::get().trackTag           = trackTag;
+    Config::get().track              = track;
+    Config::get().nRacers            = nRacers;
+    Config::get().racerLodDistance   = racerLodDistance;
+    Config::get().racerLodHysteresis = racerLodHysteresis;
+}
+
+RaceRecorder::RaceRecorder(const std::string &path, const RaceRecordingHeader &header) : m_file(path, std::ios::binary), m_header(header)
+{
+    Write(m_file, RACE_RECORDING_MAGIC);
+    Write(m_file, RACE_RECORDING_VERSION);
+    Write(m_file, m_header.seed);
+    Write(m_file, m_header.timeStep);
+    Write(m_file, m_header.checksumInterval);
+    WriteString(m_file, m_header.carTag);
+    WriteString(m_file, m_header.car);
+    WriteString(m_file, m_header.trackTag);
+    WriteString(m_file, m_header.track);
+    Write(m_file, m_header.nRacers);
+    Write(m_file, m_header.racerLodDistance);
+    Write(m_file, m_header.racerLodHysteresis);
+}
+
+bool RaceRecorder::ChecksumDue() const
+{
+    return m_header.checksumInterval > 0 && (m_nTicks + 1) % m_header.checksumInterval == 0;
+}
+
+void RaceRecorder::RecordTick(const RecordedTick &tick)
+{
+    uint8_t flags = tick.playerInputs | (tick.simulateCars ? kTickSimulateCars : 0) | (tick.hasChecksum ? kTickChecksum : 0);
+    Write(m_file, flags);
+    if (m_header.racerLodDistance > 0.f)
+    {
+        Write(m_file, tick.cameraPosition);
+    }
+    if (tick.hasChecksum)
+    {
+        Write(m_file, tick.checksum);
+    }
+    ++m_nTicks;
+}
+
+bool RaceReplay::Load(const std::string &path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (Read<uint32_t>(file) != RACE_RECORDING_MAGIC || Read<uint32_t>(file) != RACE_RECORDING_VERSION)
+    {
+        return false;
+    }
+
+    RaceRecordingHeader header;
+    header.seed               = Read<uint32_t>(file);
+    header.timeStep           = Read<float>(file);
+    header.checksumInterval   = Read<uint32_t>(file);
+    header.carTag             = ReadString(file);
+    header.car                = ReadString(file);
+    header.trackTag           = ReadString(file);
+    header.track              = ReadString(file);
+    header.nRacers            = Read<uint16_t>(file);
+    header.racerLodDistance   = Read<float>(file);
+    header.racerLodHysteresis = Read<float>(file);
+    if (!file.good())
+    {
+        return false;
+    }
+
+    // A recording cut short by a crash still replays up to its last whole tick
+    std::vector<RecordedTick> ticks;
+    while (true)
+    {
+        RecordedTick tick;
+        auto flags = Read<uint8_t>(file);
+        if (header.racerLodDistance > 0.f)
+        {
+            tick.cameraPosition = Read<glm::vec3>(file);
+        }
+        tick.hasChecksum = (flags & kTickChecksum) != 0;
+        if (tick.hasChecksum)
+        {
+            tick.checksum = Read<uint64_t>(file);
+        }
+        if (!file.good())
+        {
+            break;
+        }
+        tick.playerInputs = flags & ~(kTickSimulateCars | kTickChecksum);
+        tick.simulateCars = (flags & kTickSimulateCars) != 0;
+        ticks.emplace_back(tick);
+    }
+
+    m_header = header;
+    m_ticks  = std::move(ticks);
+    m_stats  = ReplayStats();
+    return true;
+}
+
+void RaceReplay::Verify(uint64_t tickIdx, uint64_t checksum)
+{
+    m_stats.nTicks = std::max(m_stats.nTicks, tickIdx + 1);
+    if (tickIdx >= m_ticks.size() || !m_ticks[tickIdx].hasChecksum)
+    {
+        return;
+    }
+    ++m_stats.nChecksums;
+    if (checksum != m_ticks[tickIdx].checksum && m_stats.nDiverged++ == 0)
+    {
+        m_stats.firstDivergence = tickIdx;
+        LOG(WARNING) << "Replay diverged from the recording at tick " << tickIdx;
+    }
+}
+
+void RaceReplay::Report(double seconds) const
+{
+    LOG(INFO) << "Replayed " << m_stats.nTicks << " of " << m_ticks.size() << " ticks in " << seconds << "s (" << (seconds > 0.0 ? m_stats.nTicks / seconds : 0.0)
+              << " ticks/s)";
+    if (m_stats.nDiverged > 0)
+    {
+        LOG(WARNING) << m_stats.nDiverged << " of " << m_stats.nChecksums << " checksums diverged, from tick " << m_stats.firstDivergence;
+    }
+    else
+    {
+        LOG(INFO) << "All " << m_stats.nChecksums << " checksums matched the recording";
+    }
+}
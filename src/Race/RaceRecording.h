@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+
+static const uint32_t RACE_RECORDING_MAGIC   = 0x43455252; // "RREC"
+static const uint32_t RACE_RECORDING_VERSION = 1;
+
+// The workload a race was recorded with. Replays load the same assets and racers, and seed Utils::RandomFloat the same way, but
+// take how to simulate them (broadphase, raycasters, threads) from the command line, so implementations can be compared on it.
+struct RaceRecordingHeader
+{
+    uint32_t seed             = 0;
+    float timeStep            = 0.f; // Fixed simulation step (s) every tick was taken with
+    uint32_t checksumInterval = 0;   // Ticks between racer pose checksums, 0 for none
+    std::string carTag, car, trackTag, track;
+    uint16_t nRacers         = 0;
+    float racerLodDistance   = 0.f;
+    float racerLodHysteresis = 0.f;
+
+    // From the current Config
+    static RaceRecordingHeader FromConfig(uint32_t seed, float timeStep, uint32_t checksumInterval);
+    void ApplyToConfig() const;
+};
+
+// Everything outside of the simulation that fed into one tick of it
+struct RecordedTick
+{
+    uint8_t playerInputs = 0; // PlayerInputs::Pack
+    bool simulateCars    = true;
+    glm::vec3 cameraPosition{0.f}; // Only kept when racer LOD is on, nothing else in the simulation sees the camera
+    bool hasChecksum  = false;     // Racer poses were checksummed after this tick
+    uint64_t checksum = 0;
+};
+
+// Streams ticks out as they are simulated. Each is a byte of flags, plus the camera and checksum only when there are any.
+class RaceRecorder
+{
+public:
+    RaceRecorder(const std::string &path, const RaceRecordingHeader &header);
+    bool IsOpen() const
+    {
+        return m_file.good();
+    }
+    // Whether the tick about to be recorded should carry a checksum
+    bool ChecksumDue() const;
+    void RecordTick(const RecordedTick &tick);
+
+private:
+    std::ofstream m_file;
+    RaceRecordingHeader m_header;
+    uint64_t m_nTicks = 0;
+};
+
+// How closely a replay reproduced its recording
+struct ReplayStats
+{
+    uint64_t nTicks          = 0;
+    uint64_t nChecksums      = 0;
+    uint64_t nDiverged       = 0; // Checksums that didn't match
+    uint64_t firstDivergence = 0; // Tick of the first, when nDiverged isn't 0
+};
+
+class RaceReplay
+{
+public:
+    // False, leaving the replay as it was, if path isn't a recording this version can read
+    bool Load(const std::string &path);
+    const RaceRecordingHeader &GetHeader() const
+    {
+        return m_header;
+    }
+    const std::vector<RecordedTick> &GetTicks() const
+    {
+        return m_ticks;
+    }
+    // Called after replaying each tick, with the racers' checksum if the tick has one to compare against. Logs the first divergence.
+    void Verify(uint64_t tickIdx, uint64_t checksum);
+    void Report(double seconds) const;
+    ReplayStats GetStats() const
+    {
+        return m_stats;
+    }
+
+private:
+    RaceRecordingHeader m_header;
+    std::vector<RecordedTick> m_ticks;
+    ReplayStats m_stats;
+};
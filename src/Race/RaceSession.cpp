@@ -1,16 +1,37 @@
 #include "RaceSession.h"
 
+#include <chrono>
 #include <imgui.h>
 
+// Give up on catching the fixed rate after falling this many ticks behind, rather than spiralling
+constexpr uint32_t kMaxSimulationTicksBehind = 10;
+
+static double SteadyClockSeconds()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static PhysicsSettings FixedRatePhysicsSettings()
+{
+    PhysicsSettings settings;
+    settings.fixedTimeStep = kSimulationTimeStep;
+    return settings;
+}
+
 RaceSession::RaceSession(const std::shared_ptr<GLFWwindow> &window,
                          const std::shared_ptr<Logger> &onfsLogger,
                          const std::vector<NfsAssetList> &installedNFS,
                          const std::shared_ptr<Track> &currentTrack,
-                         const std::shared_ptr<Car> &currentCar) :
+                         const std::shared_ptr<Car> &currentCar,
+                         const std::shared_ptr<RaceRecorder> &recorder,
+                         const std::shared_ptr<RaceReplay> &replay) :
     m_window(window),
     m_track(currentTrack),
     m_playerAgent(std::make_shared<PlayerAgent>(window, currentCar, currentTrack)),
-    m_renderer(window, onfsLogger, installedNFS, m_track, m_physicsEngine.debugDrawer)
+    m_physicsEngine(FixedRatePhysicsSettings()),
+    m_renderer(window, onfsLogger, installedNFS, m_track, m_physicsEngine.debugDrawer),
+    m_recorder(recorder),
+    m_replay(replay)
 {
     m_loadedAssets = {m_playerAgent->vehicle->tag, m_playerAgent->vehicle->id, m_track->nfsVersion, m_track->name};
 
@@ -24,6 +45,196 @@ RaceSession::RaceSession(const std::shared_ptr<GLFWwindow> &window,
 
     // Set up the Racer Manager to spawn vehicles on track
     m_racerManager = RacerManager(m_playerAgent, m_track, m_physicsEngine);
+
+    // Seed the renderer with the spawn positions until the first tick lands
+    this->_PublishSnapshot();
+}
+
+RaceSession::~RaceSession()
+{
+    this->_StopSimulation();
+}
+
+void RaceSession::_StartSimulation()
+{
+    if (m_simulationRunning)
+    {
+        return;
+    }
+    m_simulationRunning = true;
+    m_simulationThread  = std::thread(&RaceSession::_SimulationLoop, this);
+}
+
+void RaceSession::_StopSimulation()
+{
+    m_simulationRunning = false;
+    if (m_simulationThread.joinable())
+    {
+        m_simulationThread.join();
+    }
+}
+
+void RaceSession::_SimulationLoop()
+{
+    const auto tickDuration = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(kSimulationTimeStep));
+    auto nextTickTime       = std::chrono::steady_clock::now();
+    auto startTime          = nextTickTime;
+
+    while (m_simulationRunning)
+    {
+        RecordedTick tick;
+        if (m_replay)
+        {
+            if (m_simulationTicks == m_replay->GetTicks().size())
+            {
+                m_replayFinished = true;
+                break;
+            }
+            tick = m_replay->GetTicks()[m_simulationTicks];
+        }
+        else
+        {
+            tick.playerInputs = m_playerAgent->GetSampledInputs().Pack();
+            tick.simulateCars = m_simulateCars;
+            tick.hasChecksum  = m_recorder && m_recorder->ChecksumDue();
+            std::lock_guard<std::mutex> lock(m_cameraMutex);
+            tick.cameraPosition = m_cameraPosition;
+        }
+
+        // Edits from the debug UI land between ticks, so a tick never sees a half made change
+        m_simulationCommands.Run();
+        _SimulateTick(*m_playerAgent, m_racerManager, m_physicsEngine, tick);
+        if (m_physicsDebugDrawRequested.exchange(false))
+        {
+            m_physicsEngine.GetDynamicsWorld()->debugDrawWorld();
+        }
+
+        uint64_t checksum = tick.hasChecksum ? m_racerManager.GetPoseChecksum() : 0;
+        if (m_replay)
+        {
+            m_replay->Verify(m_simulationTicks, checksum);
+        }
+        else if (m_recorder)
+        {
+            tick.checksum = checksum;
+            m_recorder->RecordTick(tick);
+        }
+        ++m_simulationTicks;
+
+        this->_PublishSnapshot();
+
+        // Replays run as fast as they can be simulated
+        if (m_replay)
+        {
+            continue;
+        }
+        nextTickTime += tickDuration;
+        auto currentTime = std::chrono::steady_clock::now();
+        if (currentTime - nextTickTime > tickDuration * kMaxSimulationTicksBehind)
+        {
+            nextTickTime = currentTime;
+        }
+        std::this_thread::sleep_until(nextTickTime);
+    }
+
+    if (m_replay)
+    {
+        m_replay->Report(std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count());
+    }
+}
+
+void RaceSession::_SimulateTick(PlayerAgent &playerAgent, RacerManager &racerManager, PhysicsEngine &physicsEngine, const RecordedTick &tick)
+{
+    playerAgent.SetTickInputs(PlayerInputs::Unpack(tick.playerInputs));
+    if (tick.simulateCars)
+    {
+        racerManager.Simulate(kSimulationTimeStep, tick.cameraPosition);
+    }
+
+    // Exactly one Bullet substep per tick, the world is configured with the same fixed step
+    physicsEngine.StepSimulation(kSimulationTimeStep, racerManager.GetRacerResidentTrackblocks());
+}
+
+void RaceSession::ReplayHeadless(const std::shared_ptr<Track> &track, const std::shared_ptr<Car> &car, RaceReplay &replay)
+{
+    // Built in the same order as a rendered session, so the random car colours come out the same
+    PhysicsEngine physicsEngine(FixedRatePhysicsSettings());
+    physicsEngine.RegisterTrack(track);
+    auto playerAgent = std::make_shared<PlayerAgent>(nullptr, car, track);
+    RacerManager racerManager(playerAgent, track, physicsEngine);
+
+    auto startTime = std::chrono::steady_clock::now();
+    for (uint64_t tickIdx = 0; tickIdx < replay.GetTicks().size(); ++tickIdx)
+    {
+        const RecordedTick &tick = replay.GetTicks()[tickIdx];
+        _SimulateTick(*playerAgent, racerManager, physicsEngine, tick);
+        replay.Verify(tickIdx, tick.hasChecksum ? racerManager.GetPoseChecksum() : 0);
+    }
+    replay.Report(std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count());
+}
+
+void RaceSession::_PublishSnapshot()
+{
+    SimulationFrame &frame = m_snapshots.Back();
+    frame.previous         = m_lastSnapshot;
+
+    frame.current.publishTime = SteadyClockSeconds();
+    frame.current.vehiclePoses.clear();
+    frame.current.vehicleTelemetry.clear();
+    for (auto &racer : m_racerManager.racers)
+    {
+        frame.current.vehiclePoses.push_back(racer->vehicle->GetPose());
+        frame.current.vehicleTelemetry.push_back(racer->vehicle->GetTelemetry());
+    }
+    frame.current.entityPoses = m_physicsEngine.GetDynamicObjectPoses();
+    frame.current.lodStats    = m_racerManager.GetLodStats();
+
+    // The first snapshot has nothing before it, so it interpolates against itself
+    m_lastSnapshot = frame.current;
+    if (frame.previous.vehiclePoses.size() != frame.current.vehiclePoses.size())
+    {
+        frame.previous = frame.current;
+    }
+    m_snapshots.Publish();
+}
+
+void RaceSession::_ApplySnapshot()
+{
+    m_snapshots.Acquire();
+    const SimulationFrame &frame = m_snapshots.Front();
+    if (frame.current.vehiclePoses.size() != m_racerManager.racers.size())
+    {
+        return;
+    }
+
+    // Render one tick behind the simulation, blending towards the latest tick as time passes since it was published
+    float alpha = static_cast<float>((SteadyClockSeconds() - frame.current.publishTime) / kSimulationTimeStep);
+    alpha       = std::max(0.f, std::min(alpha, 1.f));
+
+    m_userParams.nFullRacers      = frame.current.lodStats.nFull;
+    m_userParams.nKinematicRacers = frame.current.lodStats.nKinematic;
+
+    for (size_t racerIdx = 0; racerIdx < m_racerManager.racers.size(); ++racerIdx)
+    {
+        m_racerManager.racers[racerIdx]->vehicle->UpdateMeshes(VehiclePose::Interpolate(frame.previous.vehiclePoses[racerIdx], frame.current.vehiclePoses[racerIdx], alpha));
+        m_racerManager.racers[racerIdx]->vehicle->renderTelemetry = frame.current.vehicleTelemetry[racerIdx];
+    }
+
+    for (auto &entityPose : frame.current.entityPoses)
+    {
+        glm::vec3 position    = entityPose.position;
+        glm::quat orientation = entityPose.orientation;
+        for (auto &previousEntityPose : frame.previous.entityPoses)
+        {
+            if (previousEntityPose.entity == entityPose.entity)
+            {
+                position    = glm::mix(previousEntityPose.position, entityPose.position, alpha);
+                orientation = glm::slerp(previousEntityPose.orientation, entityPose.orientation, alpha);
+                break;
+            }
+        }
+        entityPose.entity->Update(position, orientation);
+    }
 }
 
 void RaceSession::_UpdateCameras(float deltaTime)
@@ -68,7 +279,9 @@ std::shared_ptr<BaseCamera> RaceSession::_GetActiveCamera()
 
 AssetData RaceSession::Simulate()
 {
-    while (!glfwWindowShouldClose(m_window.get()))
+    this->_StartSimulation();
+
+    while (!glfwWindowShouldClose(m_window.get()) && !m_replayFinished)
     {
         // glfwGetTime is called only once, the first time this function is called
         static double lastTime = glfwGetTime();
@@ -79,27 +292,29 @@ AssetData RaceSession::Simulate()
 
         // Clear the screen for next input and grab focus
         this->_GetInputsAndClear();
+        m_playerAgent->SampleInputs();
+
+        // Move the car and track meshes to the latest simulation state before the cameras follow them
+        this->_ApplySnapshot();
 
         // Update Cameras
         this->_UpdateCameras(deltaTime);
 
         // Set the active camera dependent upon user input
         std::shared_ptr<BaseCamera> activeCamera = this->_GetActiveCamera();
-
-        if (m_userParams.simulateCars)
         {
-            m_racerManager.Simulate();
+            std::lock_guard<std::mutex> lock(m_cameraMutex);
+            m_cameraPosition = activeCamera->position;
         }
 
-        m_orbitalManager.Update(activeCamera, m_userParams.timeScaleFactor);
-
-        // Step the physics simulation
-        m_physicsEngine.StepSimulation(deltaTime, m_racerManager.GetRacerResidentTrackblocks());
+        m_simulateCars = m_userParams.simulateCars;
         if (m_userParams.physicsDebugView)
         {
-            m_physicsEngine.GetDynamicsWorld()->debugDrawWorld();
+            m_physicsDebugDrawRequested = true;
         }
 
+        m_orbitalManager.Update(activeCamera, m_userParams.timeScaleFactor);
+
         bool assetChange =
           m_renderer.Render(m_totalTime, activeCamera, m_hermiteCamera, m_orbitalManager.GetActiveGlobalLight(), m_userParams, m_loadedAssets, m_racerManager.racers);
 
@@ -111,12 +326,13 @@ AssetData RaceSession::Simulate()
             Entity *targetedEntity = m_physicsEngine.CheckForPicking(activeCamera->viewMatrix, activeCamera->projectionMatrix,
         entityTargeted); if (entityTargeted)
             {
-                Renderer::DrawMetadata(targetedEntity);
+                Renderer::DrawMetadata(targetedEntity, m_simulationCommands);
             }
         }*/
 
         if (assetChange)
         {
+            this->_StopSimulation();
             return m_loadedAssets;
         }
 
@@ -127,6 +343,8 @@ AssetData RaceSession::Simulate()
         ++m_ticks;
     }
 
+    this->_StopSimulation();
+
     // Just set a flag temporarily to let main know that we outta here
     m_loadedAssets.trackTag = UNKNOWN;
     return m_loadedAssets;
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <atomic>
+#include <mutex>
+#include <thread>
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 
@@ -12,9 +15,16 @@
 #include "../Renderer/Renderer.h"
 #include "../RaceNet/Agents/PlayerAgent.h"
 #include "../Util/Logger.h"
+#include "../Util/TripleBuffer.h"
+#include "../Util/CommandQueue.h"
 #include "../Config.h"
 #include "RacerManager.h"
+#include "RaceRecording.h"
 #include "OrbitalManager.h"
+#include "SimulationSnapshot.h"
+
+constexpr uint32_t kSimulationTickRate = 120; // Hz
+constexpr float kSimulationTimeStep    = 1.f / kSimulationTickRate;
 
 class RaceSession
 {
@@ -23,10 +33,22 @@ public:
                 const std::shared_ptr<Logger> &onfsLogger,
                 const std::vector<NfsAssetList> &installedNFS,
                 const std::shared_ptr<Track> &currentTrack,
-                const std::shared_ptr<Car> &currentCar);
+                const std::shared_ptr<Car> &currentCar,
+                const std::shared_ptr<RaceRecorder> &recorder = nullptr,
+                const std::shared_ptr<RaceReplay> &replay     = nullptr);
+    ~RaceSession();
     AssetData Simulate();
+    // Runs a recording's ticks back to back without a window, then reports how long they took and whether they diverged from it
+    static void ReplayHeadless(const std::shared_ptr<Track> &track, const std::shared_ptr<Car> &car, RaceReplay &replay);
 
 private:
+    // One fixed step of the race, shared with headless replays so that both simulate exactly the same thing
+    static void _SimulateTick(PlayerAgent &playerAgent, RacerManager &racerManager, PhysicsEngine &physicsEngine, const RecordedTick &tick);
+    void _StartSimulation();
+    void _StopSimulation();
+    void _SimulationLoop();
+    void _PublishSnapshot();
+    void _ApplySnapshot();
     std::shared_ptr<BaseCamera> _GetActiveCamera();
     void _UpdateCameras(float deltaTime);
     void _GetInputsAndClear();
@@ -50,4 +72,21 @@ private:
     ParamData m_userParams;
     uint64_t m_ticks  = 0; // Engine ticks elapsed
     float m_totalTime = 0;
+
+    // Simulation (AI and physics) runs at a fixed rate on its own thread, the render thread only sees the snapshots it publishes
+    std::thread m_simulationThread;
+    std::atomic<bool> m_simulationRunning{false};
+    std::atomic<bool> m_simulateCars{true};
+    std::atomic<bool> m_physicsDebugDrawRequested{false};
+    std::mutex m_cameraMutex;
+    glm::vec3 m_cameraPosition{0.f}; // Last frame's active camera, for racer LOD
+
+    // At most one of these, the session either records the ticks it simulates or simulates the ones recorded
+    std::shared_ptr<RaceRecorder> m_recorder;
+    std::shared_ptr<RaceReplay> m_replay;
+    uint64_t m_simulationTicks = 0; // Simulation thread only
+    std::atomic<bool> m_replayFinished{false};
+    TripleBuffer<SimulationFrame> m_snapshots;
+    CommandQueue m_simulationCommands; // Run by the simulation thread before each tick
+    SimulationSnapshot m_lastSnapshot; // Simulation thread only
 };
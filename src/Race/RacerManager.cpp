@@ -1,30 +1,147 @@
 #include "RacerManager.h"
 
-RacerManager::RacerManager(const std::shared_ptr<PlayerAgent> &playerAgent, const std::shared_ptr<Track> &track, PhysicsEngine &physicsEngine) : m_currentTrack(track)
+#include <algorithm>
+
+// Marks a racer that isn't keeping any trackblock resident
+constexpr uint32_t kNotResident = UINT32_MAX;
+
+struct RacerThinkLoop : public btIParallelForBody
+{
+    explicit RacerThinkLoop(const std::vector<RacerAgent *> &racers) : m_racers(racers)
+    {
+    }
+
+    void forLoop(int iBegin, int iEnd) const override
+    {
+        for (int racerIdx = iBegin; racerIdx < iEnd; ++racerIdx)
+        {
+            m_racers[racerIdx]->Think();
+        }
+    }
+
+    const std::vector<RacerAgent *> &m_racers;
+};
+
+RacerManager::RacerManager(const std::shared_ptr<PlayerAgent> &playerAgent, const std::shared_ptr<Track> &track, PhysicsEngine &physicsEngine) :
+    m_currentTrack(track), m_physicsEngine(&physicsEngine)
 {
     this->_InitialisePlayerVehicle(playerAgent, physicsEngine);
     this->_SpawnRacers(physicsEngine);
+
+    m_trackblockRacerCounts.assign(m_currentTrack->trackBlocks.size(), 0);
+    m_racerResidentTrackblocks.assign(racers.size(), kNotResident);
+    this->_UpdateResidentTrackblocks();
 }
 
-void RacerManager::Simulate()
+void RacerManager::Simulate(float stepTime, const glm::vec3 &cameraPosition)
 {
-    for (auto &racer : racers)
+    this->_UpdateLod(cameraPosition);
+
+    // Think: every racer on physics decides what to do from the last step's sensor readings at once, on the physics task scheduler
+    m_thinkingRacers.clear();
+    for (auto &racer : m_aiRacers)
     {
-        racer->Simulate();
+        if (!racer->IsKinematic())
+        {
+            m_thinkingRacers.emplace_back(racer.get());
+        }
     }
+    btParallelFor(0, (int) m_thinkingRacers.size(), 1, RacerThinkLoop(m_thinkingRacers));
+
+    // Apply: anything that writes to a car or Bullet happens here, one racer at a time
+    racers.front()->Simulate();
+    for (auto &racer : m_aiRacers)
+    {
+        if (racer->IsKinematic())
+        {
+            racer->SimulateKinematic(stepTime);
+        }
+        else
+        {
+            racer->ApplyControls();
+        }
+    }
+
+    this->_UpdateResidentTrackblocks();
 }
 
-// Return a list of trackblocks on which racers directly reside
-std::vector<uint32_t> RacerManager::GetRacerResidentTrackblocks()
+void RacerManager::_UpdateLod(const glm::vec3 &cameraPosition)
 {
-    std::unordered_set<uint32_t> activeTrackblockIDs;
+    float lodDistance = Config::get().racerLodDistance;
+    m_lodStats        = RacerLodStats();
+    m_lodStats.nFull  = 1;
+
+    glm::vec3 playerPosition = racers.front()->vehicle->GetPose().chassisPosition;
+    for (auto &racer : m_aiRacers)
+    {
+        if (lodDistance > 0.f)
+        {
+            glm::vec3 racerPosition = racer->vehicle->GetPose().chassisPosition;
+            float distance          = std::min(glm::distance(racerPosition, playerPosition), glm::distance(racerPosition, cameraPosition));
+            if (!racer->IsKinematic() && distance > lodDistance + Config::get().racerLodHysteresis)
+            {
+                racer->SetKinematic(true, *m_physicsEngine);
+            }
+            else if (racer->IsKinematic() && distance < lodDistance)
+            {
+                racer->SetKinematic(false, *m_physicsEngine);
+            }
+        }
+        else if (racer->IsKinematic())
+        {
+            racer->SetKinematic(false, *m_physicsEngine);
+        }
+        racer->IsKinematic() ? ++m_lodStats.nKinematic : ++m_lodStats.nFull;
+    }
+}
 
+uint64_t RacerManager::GetPoseChecksum() const
+{
+    uint64_t checksum = 14695981039346656037ULL;
+    auto hash         = [&checksum](const void *data, size_t size) {
+        for (size_t byteIdx = 0; byteIdx < size; ++byteIdx)
+        {
+            checksum = (checksum ^ static_cast<const uint8_t *>(data)[byteIdx]) * 1099511628211ULL;
+        }
+    };
     for (auto &racer : racers)
     {
-        activeTrackblockIDs.insert(racer->nearestTrackblockID);
+        const VehiclePose &pose = racer->vehicle->GetPose();
+        hash(&pose.chassisPosition, sizeof(pose.chassisPosition));
+        hash(&pose.chassisOrientation, sizeof(pose.chassisOrientation));
     }
+    return checksum;
+}
+
+// Only the racers that changed trackblock since the last tick touch the counts. Kinematic racers are parked, nothing around them
+// needs simulating.
+void RacerManager::_UpdateResidentTrackblocks()
+{
+    for (size_t racerIdx = 0; racerIdx < racers.size(); ++racerIdx)
+    {
+        uint32_t residentTrackblockID = racers[racerIdx]->nearestTrackblockID;
+        if (racerIdx > 0 && m_aiRacers[racerIdx - 1]->IsKinematic())
+        {
+            residentTrackblockID = kNotResident;
+        }
+        uint32_t &lastResidentTrackblockID = m_racerResidentTrackblocks[racerIdx];
+        if (residentTrackblockID == lastResidentTrackblockID)
+        {
+            continue;
+        }
 
-    return std::vector<uint32_t>(activeTrackblockIDs.begin(), activeTrackblockIDs.end());
+        if (lastResidentTrackblockID != kNotResident && --m_trackblockRacerCounts[lastResidentTrackblockID] == 0)
+        {
+            auto residentIt = std::find(m_residentTrackblockIDs.begin(), m_residentTrackblockIDs.end(), lastResidentTrackblockID);
+            *residentIt     = m_residentTrackblockIDs.back();
+            m_residentTrackblockIDs.pop_back();
+        }
+        if (residentTrackblockID != kNotResident && m_trackblockRacerCounts[residentTrackblockID]++ == 0)
+        {
+            m_residentTrackblockIDs.emplace_back(residentTrackblockID);
+        }
+        lastResidentTrackblockID = residentTrackblockID;
+    }
 }
 
 // Reset player character to start and add the player vehicle into the list of racers
@@ -50,5 +167,6 @@ void RacerManager::_SpawnRacers(PhysicsEngine &physicsEngine)
         racer->ResetToIndexInTrackblock(0, racerIdx + 1, racerSpawnOffset);
         racerSpawnOffset = -racerSpawnOffset;
         racers.emplace_back(racer);
+        m_aiRacers.emplace_back(racer);
     }
 }
@@ -5,22 +5,50 @@
 #include "../RaceNet/Agents/PlayerAgent.h"
 #include "../RaceNet/Agents/RacerAgent.h"
 
-#include <unordered_set>
 #include <vector>
 
+// How the racers were simulated on the last tick
+struct RacerLodStats
+{
+    uint32_t nFull      = 0; // Stepped by physics, player included
+    uint32_t nKinematic = 0; // Slid along the vroad, see RacerAgent::SetKinematic
+};
+
 class RacerManager
 {
 public:
     explicit RacerManager() = default;
     RacerManager(const std::shared_ptr<PlayerAgent> &playerAgent, const std::shared_ptr<Track> &track, PhysicsEngine &physicsEngine);
-    void Simulate();
-    std::vector<uint32_t> GetRacerResidentTrackblocks();
+    // AI racers further than Config::racerLodDistance from both the player and the camera go kinematic, and only come back to full
+    // physics once inside it again, less the hysteresis so racers on the boundary don't flip every tick
+    void Simulate(float stepTime, const glm::vec3 &cameraPosition);
+    // Trackblocks racers on physics are on, in no particular order and kept up to date by Simulate
+    const std::vector<uint32_t> &GetRacerResidentTrackblocks() const
+    {
+        return m_residentTrackblockIDs;
+    }
+    // FNV-1a over every racer's pose, to check a replay against its recording
+    uint64_t GetPoseChecksum() const;
+    RacerLodStats GetLodStats() const
+    {
+        return m_lodStats;
+    }
 
     std::vector<std::shared_ptr<CarAgent>> racers;
 
 private:
     void _InitialisePlayerVehicle(const std::shared_ptr<PlayerAgent> &playerAgent, PhysicsEngine &physicsEngine);
     void _SpawnRacers(PhysicsEngine &physicsEngine);
+    void _UpdateLod(const glm::vec3 &cameraPosition);
+    void _UpdateResidentTrackblocks();
 
     std::shared_ptr<Track> m_currentTrack;
+    PhysicsEngine *m_physicsEngine = nullptr;
+    std::vector<std::shared_ptr<RacerAgent>> m_aiRacers; // Also in racers, after the player
+    std::vector<RacerAgent *> m_thinkingRacers;          // AI racers on physics this tick, kept to save reallocating it
+    RacerLodStats m_lodStats;
+
+    std::vector<uint32_t> m_residentTrackblockIDs;    // Every trackblock with a non zero count
+    std::vector<uint32_t> m_trackblockRacerCounts;    // Racers on physics in each trackblock
+    std::vector<uint32_t> m_racerResidentTrackblocks; // Indexed as racers, the trackblock each is counted in
 };
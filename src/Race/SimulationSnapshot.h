@@ -0,0 +1,23 @@
+#pragma once
+
+#include <vector>
+
+#include "../Physics/PhysicsEngine.h"
+#include "RacerManager.h"
+
+// Everything the renderer needs from a simulation tick to place moving meshes, so it never reads live physics state
+struct SimulationSnapshot
+{
+    double publishTime = 0.0;              // Steady clock time (s) the tick finished at
+    std::vector<VehiclePose> vehiclePoses; // Indexed as RacerManager::racers
+    std::vector<VehicleTelemetry> vehicleTelemetry;
+    std::vector<EntityPose> entityPoses;   // Dynamic track objects in racer resident trackblocks
+    RacerLodStats lodStats;
+};
+
+// Published once per simulation tick. Carries the tick before too, so the renderer always has a consecutive pair to interpolate
+struct SimulationFrame
+{
+    SimulationSnapshot previous;
+    SimulationSnapshot current;
+};
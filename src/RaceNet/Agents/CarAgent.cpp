@@ -3,6 +3,10 @@
 CarAgent::CarAgent(AgentType agentType, const std::shared_ptr<Car> &car, const std::shared_ptr<Track> &track) :
     vehicle(std::make_shared<Car>(car->assetData, car->tag, car->id)), m_track(track), m_agentType(agentType)
 {
+    std::string rangefinderType = m_agentType == TRAINING ? Config::get().trainingRangefinder :
+                                  m_agentType == RACING   ? Config::get().racerRangefinder :
+                                                            Config::get().playerRangefinder;
+    vehicle->SetRangefinders(getRangefinderType(rangefinderType), m_track);
 }
 
 void CarAgent::ResetToIndexInTrackblock(int trackBlockIndex, int posIndex, float offset)
@@ -55,42 +59,59 @@ void CarAgent::ResetToVroad(int vroadIndex, float offset)
 
     // Go and find the Vroad Data to reset to
     vehicle->SetPosition(vroadPoint, carOrientation);
+    // The car has jumped, so don't walk on from where it was
+    m_trackLocation.valid = false;
 }
 
-void CarAgent::_UpdateNearestTrackblock()
+// Walks on from the last known location, so this is a handful of distance checks per tick rather than a scan of the track
+void CarAgent::_UpdateTrackLocation()
 {
-    float lowestDistance = FLT_MAX;
-
-    // Get closest track block to car body position
-    for (auto &trackblock : m_track->trackBlocks)
-    {
-        float distance = glm::distance(vehicle->carBodyModel.position, trackblock.position);
-        if (distance < lowestDistance)
-        {
-            nearestTrackblockID = trackblock.id;
-            lowestDistance      = distance;
-        }
-    }
+    m_track->spatialIndex.UpdateLocation(vehicle->GetPosition(), m_trackLocation);
+    nearestTrackblockID = m_trackLocation.trackblockID;
+    m_nearestVroadID    = m_trackLocation.vroadID;
 }
 
-void CarAgent::_UpdateNearestVroad()
+void CarAgent::_GetNetworkInputs(float *networkInputs)
 {
-    float lowestDistance     = FLT_MAX;
-    glm::quat rotationMatrix = glm::normalize(glm::quat(glm::vec3(-SIMD_PI / 2, 0, 0)));
+    // Use maximum from front 3 sensors, as per Luigi Cardamone
+    float maxForwardDistance = std::max({vehicle->rangefinderInfo.rangefinders[RayDirection::FORWARD_RAY], vehicle->rangefinderInfo.rangefinders[RayDirection::FORWARD_LEFT_RAY],
+                                         vehicle->rangefinderInfo.rangefinders[RayDirection::FORWARD_RIGHT_RAY]});
+    // Feed car speed into network so NN can regulate speed
+    float carSpeed = vehicle->GetVehicle()->getCurrentSpeedKmHour();
 
-    // Use the nearest trackblock ID to avoid skipping the entire set of Vroad data
-    uint32_t nodeNumber = m_track->trackBlocks[nearestTrackblockID].virtualRoadStartIndex;
-    uint32_t nPositions = m_track->trackBlocks[nearestTrackblockID].nVirtualRoadPositions;
+    // All inputs roughly between 0 and 5. Speed/10 to bring it into line.
+    // -90, -60, -30, maxForwardDistance {-10, 0, 10}, 30, 60, 90, currentSpeed/10.f
+    networkInputs[0] = vehicle->rangefinderInfo.rangefinders[RayDirection::LEFT_RAY];
+    networkInputs[1] = vehicle->rangefinderInfo.rangefinders[3];
+    networkInputs[2] = vehicle->rangefinderInfo.rangefinders[6];
+    networkInputs[3] = maxForwardDistance;
+    networkInputs[4] = vehicle->rangefinderInfo.rangefinders[12];
+    networkInputs[5] = vehicle->rangefinderInfo.rangefinders[15];
+    networkInputs[6] = vehicle->rangefinderInfo.rangefinders[RayDirection::RIGHT_RAY];
+    networkInputs[7] = carSpeed / 10.f;
+}
 
-    // Get closest vroad in trackblock set to car body position
-    for (uint32_t vroadIdx = nodeNumber; vroadIdx < nodeNumber + nPositions; ++vroadIdx)
-    {
-        float distance = glm::distance(vehicle->carBodyModel.position, m_track->virtualRoad[vroadIdx].position);
+void CarAgent::_ApplyNetworkOutputs(const float *networkOutputs)
+{
+    this->_ApplyControls(_DecodeNetworkOutputs(networkOutputs));
+}
 
-        if (distance < lowestDistance)
-        {
-            m_nearestVroadID = vroadIdx;
-            lowestDistance   = distance;
-        }
-    }
+CarControls CarAgent::_DecodeNetworkOutputs(const float *networkOutputs)
+{
+    CarControls controls;
+    controls.accelerate = networkOutputs[0] > 0.1f;
+    controls.brake      = networkOutputs[1] > 0.1f;
+    // car->applyAbsoluteSteerAngle(networkOutputs[2]);
+    // Mutex steering
+    controls.steerLeft  = networkOutputs[2] > 0.1f && networkOutputs[3] < 0.1f;
+    controls.steerRight = networkOutputs[3] > 0.1f && networkOutputs[2] < 0.1f;
+    return controls;
+}
+
+void CarAgent::_ApplyControls(const CarControls &controls)
+{
+    vehicle->ApplyAccelerationForce(controls.accelerate, false);
+    vehicle->ApplyBrakingForce(controls.brake);
+    vehicle->ApplySteeringLeft(controls.steerLeft);
+    vehicle->ApplySteeringRight(controls.steerRight);
 }
@@ -5,6 +5,19 @@
 #include "../../Loaders/CarLoader.h"
 #include "../../Scene/Track.h"
 
+// Rangefinder and speed readings fed to every driving network, and the control outputs read back from it
+constexpr uint32_t kNetworkInputs  = 8;
+constexpr uint32_t kNetworkOutputs = 4;
+
+// What an agent has decided to do with its car this tick, worked out without touching the car so agents can decide in parallel
+struct CarControls
+{
+    bool accelerate = false;
+    bool brake      = false;
+    bool steerLeft  = false;
+    bool steerRight = false;
+};
+
 enum AgentType : uint8_t
 {
     TRAINING = 0,
@@ -26,10 +39,14 @@ public:
     uint32_t nearestTrackblockID = 0;
 
 protected:
-    void _UpdateNearestTrackblock();
-    void _UpdateNearestVroad();
+    void _UpdateTrackLocation();
+    void _GetNetworkInputs(float *networkInputs);
+    void _ApplyNetworkOutputs(const float *networkOutputs);
+    static CarControls _DecodeNetworkOutputs(const float *networkOutputs);
+    void _ApplyControls(const CarControls &controls);
 
     std::shared_ptr<Track> m_track;
     AgentType m_agentType;
     uint32_t m_nearestVroadID = 0;
+    TrackLocation m_trackLocation;
 };
\ No newline at end of file
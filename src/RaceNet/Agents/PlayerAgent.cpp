@@ -6,20 +6,46 @@ PlayerAgent::PlayerAgent(const std::shared_ptr<GLFWwindow> &window, const std::s
     name = "DumbPanda";
 }
 
+void PlayerAgent::SampleInputs()
+{
+    PlayerInputs inputs;
+    inputs.accelerate = glfwGetKey(m_window.get(), GLFW_KEY_W) == GLFW_PRESS;
+    inputs.reverse    = glfwGetKey(m_window.get(), GLFW_KEY_S) == GLFW_PRESS;
+    inputs.brake      = glfwGetKey(m_window.get(), GLFW_KEY_SPACE) == GLFW_PRESS;
+    inputs.steerRight = glfwGetKey(m_window.get(), GLFW_KEY_D) == GLFW_PRESS;
+    inputs.steerLeft  = glfwGetKey(m_window.get(), GLFW_KEY_A) == GLFW_PRESS;
+    inputs.reset      = glfwGetKey(m_window.get(), GLFW_KEY_R) == GLFW_PRESS;
+
+    std::lock_guard<std::mutex> inputsLock(m_inputsMutex);
+    m_inputs = inputs;
+}
+
+PlayerInputs PlayerAgent::GetSampledInputs()
+{
+    std::lock_guard<std::mutex> inputsLock(m_inputsMutex);
+    return m_inputs;
+}
+
+void PlayerAgent::SetTickInputs(const PlayerInputs &inputs)
+{
+    m_tickInputs = inputs;
+}
+
 void PlayerAgent::Simulate()
 {
     // Update data required for efficient track physics update
-    this->_UpdateNearestTrackblock();
-    this->_UpdateNearestVroad();
+    this->_UpdateTrackLocation();
+
+    const PlayerInputs &inputs = m_tickInputs;
 
     // if (userParams.windowActive && !ImGui::GetIO().MouseDown[1]) { }
-    vehicle->ApplyAccelerationForce(glfwGetKey(m_window.get(), GLFW_KEY_W) == GLFW_PRESS, glfwGetKey(m_window.get(), GLFW_KEY_S) == GLFW_PRESS);
-    vehicle->ApplyBrakingForce(glfwGetKey(m_window.get(), GLFW_KEY_SPACE) == GLFW_PRESS);
-    vehicle->ApplySteeringRight(glfwGetKey(m_window.get(), GLFW_KEY_D) == GLFW_PRESS);
-    vehicle->ApplySteeringLeft(glfwGetKey(m_window.get(), GLFW_KEY_A) == GLFW_PRESS);
+    vehicle->ApplyAccelerationForce(inputs.accelerate, inputs.reverse);
+    vehicle->ApplyBrakingForce(inputs.brake);
+    vehicle->ApplySteeringRight(inputs.steerRight);
+    vehicle->ApplySteeringLeft(inputs.steerLeft);
 
-    if (glfwGetKey(m_window.get(), GLFW_KEY_R) == GLFW_PRESS)
+    if (inputs.reset)
     {
         ResetToVroad(m_nearestVroadID, 0.f);
     }
-}
\ No newline at end of file
+}
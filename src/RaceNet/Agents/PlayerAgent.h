@@ -2,15 +2,51 @@
 
 #include "CarAgent.h"
 
+#include <mutex>
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 
+// Player controls for a single simulation tick
+struct PlayerInputs
+{
+    bool accelerate = false;
+    bool reverse    = false;
+    bool brake      = false;
+    bool steerLeft  = false;
+    bool steerRight = false;
+    bool reset      = false;
+
+    // Into the low six bits of a byte, for race recordings
+    uint8_t Pack() const
+    {
+        return accelerate | reverse << 1 | brake << 2 | steerLeft << 3 | steerRight << 4 | reset << 5;
+    }
+    static PlayerInputs Unpack(uint8_t packed)
+    {
+        PlayerInputs inputs;
+        inputs.accelerate = packed & 1;
+        inputs.reverse    = packed & 1 << 1;
+        inputs.brake      = packed & 1 << 2;
+        inputs.steerLeft  = packed & 1 << 3;
+        inputs.steerRight = packed & 1 << 4;
+        inputs.reset      = packed & 1 << 5;
+        return inputs;
+    }
+};
+
 class PlayerAgent : public CarAgent
 {
 public:
     PlayerAgent(const std::shared_ptr<GLFWwindow> &window, const std::shared_ptr<Car> &car, const std::shared_ptr<Track> &raceTrack);
+    void SampleInputs(); // GLFW input can only be read on the main thread, so it is sampled there and picked up by the simulation
+    PlayerInputs GetSampledInputs();
+    // What the next Simulate drives with: the latest sampled inputs in a live race, or recorded ones in a replay
+    void SetTickInputs(const PlayerInputs &inputs);
     void Simulate() override;
 
 private:
     std::shared_ptr<GLFWwindow> m_window;
+    std::mutex m_inputsMutex;
+    PlayerInputs m_inputs;
+    PlayerInputs m_tickInputs; // Simulation thread only
 };
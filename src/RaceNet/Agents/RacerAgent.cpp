@@ -2,6 +2,12 @@
 
 #include <glm/gtx/vector_angle.hpp>
 
+#include "../../Physics/PhysicsEngine.h"
+
+// How quickly a kinematic racer gets to the track's AI speed, roughly what the cars manage under physics
+constexpr float kKinematicAcceleration = 6.f;  // m/s²
+constexpr float kKinematicBraking      = 12.f; // m/s²
+
 // TODO: Read this from file
 char const *RACER_NAMES[23] = {"DumbPanda",       "Spark198rus", "Keiiko",    "N/A",       "Patas De Pavo", "Dopamine Flint", "Oh Hansssss", "scaryred24",
                                "MaximilianVeers", "Keith",       "AJ_Lethal", "Sirius-R",  "Ewil",          "Zipper",         "heyitsleo",   "MADMAN_nfs",
@@ -10,13 +16,28 @@ char const *RACER_NAMES[23] = {"DumbPanda",       "Spark198rus", "Keiiko",    "N
 RacerAgent::RacerAgent(uint16_t racerID, const std::string &networkPath, const std::shared_ptr<Car> &car, const std::shared_ptr<Track> &raceTrack) :
     CarAgent(AgentType::RACING, car, raceTrack)
 {
+    std::string networkName                = boost::filesystem::path(networkPath).stem().string();
+    const CompiledRaceNet *compiledRaceNet = CompiledRaceNets::Find(networkName);
     if (boost::filesystem::exists(networkPath))
     {
         raceNet.import_fromfile(networkPath);
+        // Only trust the compiled driver if it was generated from this exact network, a retrained one is interpreted until rebuilt
+        if (compiledRaceNet != nullptr && compiledRaceNet->fingerprint == raceNet.fingerprint())
+        {
+            m_compiledRaceNet = compiledRaceNet->evaluate;
+        }
+        else if (compiledRaceNet != nullptr)
+        {
+            LOG(WARNING) << "Compiled network " << networkName << " doesn't match " << networkPath << ", interpreting it instead";
+        }
+    }
+    else if (compiledRaceNet != nullptr)
+    {
+        m_compiledRaceNet = compiledRaceNet->evaluate;
     }
     else
     {
-        LOG(WARNING) << "AI Neural network couldn't be loaded from " << BEST_NETWORK_PATH << ", randomising weights";
+        LOG(WARNING) << "AI Neural network couldn't be loaded from " << networkPath << ", randomising weights";
     }
     name          = RACER_NAMES[racerID];
     this->vehicle = std::make_shared<Car>(car->assetData, car->tag, car->id);
@@ -26,93 +47,178 @@ RacerAgent::RacerAgent(uint16_t racerID, const std::string &networkPath, const s
 }
 
 void RacerAgent::Simulate()
+{
+    this->Think();
+    this->ApplyControls();
+}
+
+void RacerAgent::Think()
 {
     // Update data required for track physics update
-    this->_UpdateNearestTrackblock();
-    this->_UpdateNearestVroad();
+    this->_UpdateTrackLocation();
 
     switch (m_mode)
     {
     case FollowTrack:
-        this->_FollowTrack();
+        m_controls = this->_FollowTrack();
         break;
     case NeuralNet:
-        this->_UseNeuralNetAI();
+        m_controls = this->_UseNeuralNetAI();
         break;
     case Primitive:
-        this->_UsePrimitiveAI();
+        m_controls = this->_UsePrimitiveAI();
         break;
     }
 
     // If during simulation, car flips, reset.
-    if ((vehicle->rangefinderInfo.upDistance <= 0.1f || vehicle->rangefinderInfo.downDistance > 1.f || vehicle->rangefinderInfo.rangefinders[RayDirection::FORWARD_RAY] < 0.25f) &&
-        m_ticksAlive > 5000)
+    m_flipped = (vehicle->rangefinderInfo.upDistance <= 0.1f || vehicle->rangefinderInfo.downDistance > 1.f || vehicle->rangefinderInfo.rangefinders[RayDirection::FORWARD_RAY] < 0.25f) &&
+                m_ticksAlive > 5000;
+    if (m_flipped)
     {
         m_ticksAlive = 0;
-        ResetToVroad(m_nearestVroadID, 0.f);
     }
     else
     {
         ++m_ticksAlive;
     }
 }
-void RacerAgent::_FollowTrack()
+
+void RacerAgent::ApplyControls()
+{
+    if (m_flipped)
+    {
+        ResetToVroad(m_nearestVroadID, 0.f);
+    }
+    this->_ApplyControls(m_controls);
+}
+
+CarControls RacerAgent::_FollowTrack()
 {
     glm::vec3 target = m_track->virtualRoad[(m_nearestVroadID + 10) % m_track->virtualRoad.size()].position;
     float angle      = glm::orientedAngle(glm::normalize(Utils::bulletToGlm(this->vehicle->GetVehicle()->getForwardVector())),
-                                     glm::normalize(target - this->vehicle->carBodyModel.position), glm::vec3(0, 1, 0));
+                                     glm::normalize(target - this->vehicle->GetPosition()), glm::vec3(0, 1, 0));
     // vehicle->ApplyAbsoluteSteerAngle(angle);
-    if (angle < -0.15f)
+    CarControls controls;
+    controls.steerRight = angle < -0.15f;
+    controls.steerLeft  = angle > 0.15f;
+    controls.accelerate = true;
+    return controls;
+}
+
+CarControls RacerAgent::_UsePrimitiveAI()
+{
+    CarControls controls;
+    controls.accelerate = true;
+    controls.steerLeft  = vehicle->rangefinderInfo.rangefinders[RayDirection::FORWARD_RIGHT_RAY] < 1.f;
+    controls.steerRight = vehicle->rangefinderInfo.rangefinders[RayDirection::FORWARD_LEFT_RAY] < 1.f;
+    return controls;
+}
+
+CarControls RacerAgent::_UseNeuralNetAI()
+{
+    float networkInputs[kNetworkInputs];
+    float networkOutputs[kNetworkOutputs] = {};
+    this->_GetNetworkInputs(networkInputs);
+
+    // Inference on the network
+    if (m_compiledRaceNet)
     {
-        vehicle->ApplySteeringRight(true);
+        m_compiledRaceNet(networkInputs, kNetworkInputs, networkOutputs, kNetworkOutputs);
     }
-    else if (angle > 0.15f)
+    else
     {
-        vehicle->ApplySteeringLeft(true);
+        raceNet.evaluate(networkInputs, kNetworkInputs, networkOutputs, kNetworkOutputs);
+    }
+
+    return _DecodeNetworkOutputs(networkOutputs);
+}
+
+void RacerAgent::SetKinematic(bool kinematic, PhysicsEngine &physicsEngine)
+{
+    if (kinematic == m_kinematic || m_track->virtualRoad.size() < 2)
+    {
+        return;
+    }
+    m_kinematic = kinematic;
+
+    if (m_kinematic)
+    {
+        // Pick up from wherever physics left the car: the vroad segment it's on, how far across the road, and its speed along it
+        this->_UpdateTrackLocation();
+        const VirtualRoad &vroad   = m_track->virtualRoad[m_nearestVroadID];
+        glm::vec3 chassisPosition  = vehicle->GetPose().chassisPosition;
+        glm::vec3 segmentStart     = this->_GetVroadBase(m_nearestVroadID);
+        glm::vec3 segment          = this->_GetVroadBase((m_nearestVroadID + 1) % m_track->virtualRoad.size()) - segmentStart;
+        float segmentLength2       = glm::dot(segment, segment);
+        m_kinematicVroadID         = m_nearestVroadID;
+        m_kinematicFraction        = segmentLength2 > 0.f ? glm::clamp(glm::dot(chassisPosition - segmentStart, segment) / segmentLength2, 0.f, 1.f) : 0.f;
+        glm::vec3 centre           = segmentStart + m_kinematicFraction * segment;
+        m_kinematicOffset          = glm::clamp(glm::dot(chassisPosition - centre, glm::normalize(vroad.right)), -glm::length(vroad.leftWall), glm::length(vroad.rightWall));
+        m_kinematicSpeed           = std::max(0.f, vehicle->GetVehicle()->getCurrentSpeedKmHour() / 3.6f);
+
+        physicsEngine.SetVehicleParked(vehicle, true);
+        vehicle->ResetState();
+        this->SimulateKinematic(0.f);
     }
     else
     {
-        vehicle->ApplySteeringRight(false);
-        vehicle->ApplySteeringLeft(false);
+        glm::vec3 position, forward;
+        glm::quat orientation;
+        this->_GetKinematicPose(position, orientation, forward);
+        physicsEngine.SetVehicleParked(vehicle, false);
+        vehicle->SetPosition(position, orientation);
+        vehicle->SetLinearVelocity(forward * m_kinematicSpeed);
     }
-    vehicle->ApplyAccelerationForce(true, false);
 }
 
-void RacerAgent::_UsePrimitiveAI()
+void RacerAgent::SimulateKinematic(float stepTime)
 {
-    vehicle->ApplyAccelerationForce(true, false);
-    vehicle->ApplySteeringLeft(vehicle->rangefinderInfo.rangefinders[RayDirection::FORWARD_RIGHT_RAY] < 1.f);
-    vehicle->ApplySteeringRight(vehicle->rangefinderInfo.rangefinders[RayDirection::FORWARD_LEFT_RAY] < 1.f);
+    // Ease towards the track's speed for this stretch, but never past what the car would be allowed under physics
+    float targetSpeed = vehicle->vehicleProperties.maxSpeed / 3.6f;
+    if (m_kinematicVroadID < m_track->vroadSpeeds.size())
+    {
+        targetSpeed = std::min(targetSpeed, m_track->vroadSpeeds[m_kinematicVroadID]);
+    }
+    m_kinematicSpeed += glm::clamp(targetSpeed - m_kinematicSpeed, -kKinematicBraking * stepTime, kKinematicAcceleration * stepTime);
+
+    // The vroad is treated as a loop, as _FollowTrack does
+    float distance = m_kinematicSpeed * stepTime;
+    for (size_t nodesPassed = 0; distance > 0.f && nodesPassed < m_track->virtualRoad.size(); ++nodesPassed)
+    {
+        uint32_t nextVroadID = (m_kinematicVroadID + 1) % m_track->virtualRoad.size();
+        float segmentLength  = glm::distance(this->_GetVroadBase(m_kinematicVroadID), this->_GetVroadBase(nextVroadID));
+        float remaining      = (1.f - m_kinematicFraction) * segmentLength;
+        if (distance < remaining)
+        {
+            m_kinematicFraction += distance / segmentLength;
+            break;
+        }
+        distance -= remaining;
+        m_kinematicVroadID  = nextVroadID;
+        m_kinematicFraction = 0.f;
+    }
+
+    glm::vec3 position, forward;
+    glm::quat orientation;
+    this->_GetKinematicPose(position, orientation, forward);
+    vehicle->SetKinematicPose(position, orientation);
+    this->_UpdateTrackLocation();
 }
 
-void RacerAgent::_UseNeuralNetAI()
+// Where ResetToVroad would put a car on this node
+glm::vec3 RacerAgent::_GetVroadBase(uint32_t vroadID) const
 {
-    // Use maximum from front 3 sensors, as per Luigi Cardamone
-    float maxForwardDistance = std::max({vehicle->rangefinderInfo.rangefinders[RayDirection::FORWARD_RAY], vehicle->rangefinderInfo.rangefinders[RayDirection::FORWARD_LEFT_RAY],
-                                         vehicle->rangefinderInfo.rangefinders[RayDirection::FORWARD_RIGHT_RAY]});
-    // Feed car speed into network so NN can regulate speed
-    float carSpeed = vehicle->GetVehicle()->getCurrentSpeedKmHour();
-
-    // All inputs roughly between 0 and 5. Speed/10 to bring it into line.
-    // -90, -60, -30, maxForwardDistance {-10, 0, 10}, 30, 60, 90, currentSpeed/10.f
-    std::vector<double> networkInputs  = {vehicle->rangefinderInfo.rangefinders[RayDirection::LEFT_RAY],
-                                         vehicle->rangefinderInfo.rangefinders[3],
-                                         vehicle->rangefinderInfo.rangefinders[6],
-                                         maxForwardDistance,
-                                         vehicle->rangefinderInfo.rangefinders[12],
-                                         vehicle->rangefinderInfo.rangefinders[15],
-                                         vehicle->rangefinderInfo.rangefinders[RayDirection::RIGHT_RAY],
-                                         carSpeed / 10.f};
-    std::vector<double> networkOutputs = {0, 0, 0, 0};
+    return m_track->virtualRoad[vroadID].position + m_track->virtualRoad[vroadID].respawn;
+}
 
-    // Inference on the network
-    raceNet.evaluate(networkInputs, networkOutputs);
-
-    // Control the vehicle with the neural network outputs
-    vehicle->ApplyAccelerationForce(networkOutputs[0] > 0.1f, false);
-    vehicle->ApplyBrakingForce(networkOutputs[1] > 0.1f);
-    // car->applyAbsoluteSteerAngle(networkOutputs[2]);
-    // Mutex steering
-    vehicle->ApplySteeringLeft(networkOutputs[2] > 0.1f && networkOutputs[3] < 0.1f);
-    vehicle->ApplySteeringRight(networkOutputs[3] > 0.1f && networkOutputs[2] < 0.1f);
+void RacerAgent::_GetKinematicPose(glm::vec3 &position, glm::quat &orientation, glm::vec3 &forward) const
+{
+    uint32_t nextVroadID       = (m_kinematicVroadID + 1) % m_track->virtualRoad.size();
+    const VirtualRoad &vroad   = m_track->virtualRoad[m_kinematicVroadID];
+    const VirtualRoad &next    = m_track->virtualRoad[nextVroadID];
+    glm::vec3 right            = glm::normalize(glm::mix(glm::normalize(vroad.right), glm::normalize(next.right), m_kinematicFraction));
+    glm::vec3 normal           = glm::normalize(glm::mix(glm::normalize(vroad.normal), glm::normalize(next.normal), m_kinematicFraction));
+    forward                    = glm::normalize(glm::mix(glm::normalize(vroad.forward), glm::normalize(next.forward), m_kinematicFraction));
+    position                   = glm::mix(this->_GetVroadBase(m_kinematicVroadID), this->_GetVroadBase(nextVroadID), m_kinematicFraction) + m_kinematicOffset * right;
+    orientation                = glm::conjugate(glm::toQuat(glm::lookAt(position, position - forward, normal)));
 }
@@ -1,6 +1,9 @@
 #pragma once
 
 #include "CarAgent.h"
+#include "../CompiledRaceNets.h"
+
+class PhysicsEngine;
 
 enum RacerAIMode
 {
@@ -14,12 +17,36 @@ class RacerAgent : public CarAgent
 public:
     RacerAgent(uint16_t racerID, const std::string &networkPath, const std::shared_ptr<Car> &car, const std::shared_ptr<Track> &raceTrack);
     void Simulate() override;
+    // Simulate split in two. Think only reads the car, the track and the sensor readings from the last physics step, and writes
+    // nothing but this agent, so every racer can think at once. ApplyControls writes the decision to the car, and must be serial.
+    void Think();
+    void ApplyControls();
+    // Level of detail for racers nobody is watching. A kinematic racer is parked in the physics world and slid along the virtual
+    // road at the track's AI speeds instead, with no sensors, network or contacts. Switching back hands physics the same position,
+    // orientation and speed.
+    void SetKinematic(bool kinematic, PhysicsEngine &physicsEngine);
+    void SimulateKinematic(float stepTime);
+    bool IsKinematic() const
+    {
+        return m_kinematic;
+    }
 
 private:
-    void _UseNeuralNetAI();
-    void _UsePrimitiveAI();
-    void _FollowTrack();
+    CarControls _UseNeuralNetAI();
+    CarControls _UsePrimitiveAI();
+    CarControls _FollowTrack();
+    glm::vec3 _GetVroadBase(uint32_t vroadID) const;
+    void _GetKinematicPose(glm::vec3 &position, glm::quat &orientation, glm::vec3 &forward) const;
+
+    RacerAIMode m_mode                  = RacerAIMode::FollowTrack;
+    uint32_t m_ticksAlive               = 0;
+    CompiledRaceNetFn m_compiledRaceNet = nullptr; // Used in place of raceNet when the network was compiled into the binary
+    CarControls m_controls;                        // Decided by Think, applied by ApplyControls
+    bool m_flipped                      = false;   // Reset to the vroad on ApplyControls
 
-    RacerAIMode m_mode    = RacerAIMode::FollowTrack;
-    uint32_t m_ticksAlive = 0;
+    bool m_kinematic            = false;
+    uint32_t m_kinematicVroadID = 0;
+    float m_kinematicFraction   = 0.f; // Along the vroad segment to the next node
+    float m_kinematicOffset     = 0.f; // Metres right of the vroad centre line
+    float m_kinematicSpeed      = 0.f; // m/s
 };
\ No newline at end of file
@@ -26,11 +26,32 @@ bool TrainingAgent::IsWinner()
     return fitness > pow(nVroad - 30, 1);
 }
 
+void TrainingAgent::Rebind(const genome &newGenome)
+{
+    raceNet.from_genome(newGenome);
+    fitness             = 0;
+    isDead              = false;
+    benched             = false;
+    ticksInsideVroad    = 0;
+    averageSpeed        = 0.f;
+    ticksRaced          = 0;
+    m_droveBack         = false;
+    m_ticksSpentAlive   = 0;
+    m_lastVroadPosition = 0;
+}
+
 void TrainingAgent::Reset()
 {
+    vehicle->ResetState();
     ResetToVroad(0, 0.f);
 }
 
+void TrainingAgent::Bench()
+{
+    benched = true;
+    isDead  = true;
+}
+
 int TrainingAgent::_EvaluateFitness(int vroadPosition)
 {
     // F = C1 − Tout + C2 · s¯+ d, where Tout is the number of game tics the car is outside the track;
@@ -51,17 +72,28 @@ int TrainingAgent::_EvaluateFitness(int vroadPosition)
 
 void TrainingAgent::Simulate()
 {
-    // Update data required for track physics update
-    this->_UpdateNearestTrackblock();
-    this->_UpdateNearestVroad();
+    float networkInputs[kNetworkInputs];
+    float networkOutputs[kNetworkOutputs] = {};
+    if (!this->Sense(networkInputs))
+    {
+        return;
+    }
+
+    // Inference on the network
+    raceNet.evaluate(networkInputs, kNetworkInputs, networkOutputs, kNetworkOutputs);
 
-    // TrackModel our old position
-    static int vroadPosition;
+    this->Act(networkOutputs);
+}
+
+bool TrainingAgent::Sense(float *networkInputs)
+{
+    // Update data required for track physics update
+    this->_UpdateTrackLocation();
 
     // If the agent is dead, there is no need to simulate it.
     if (isDead)
     {
-        return;
+        return false;
     }
 
     // If during simulation, car flips, reset. Not during training, or for player!
@@ -70,34 +102,16 @@ void TrainingAgent::Simulate()
         ResetToVroad(m_nearestVroadID, 0.f);
     }
 
-    // Use maximum from front 3 sensors, as per Luigi Cardamone
-    float maxForwardDistance = std::max({vehicle->rangefinderInfo.rangefinders[RayDirection::FORWARD_RAY], vehicle->rangefinderInfo.rangefinders[RayDirection::FORWARD_LEFT_RAY],
-                                         vehicle->rangefinderInfo.rangefinders[RayDirection::FORWARD_RIGHT_RAY]});
-    // Feed car speed into network so NN can regulate speed
-    float carSpeed = vehicle->GetVehicle()->getCurrentSpeedKmHour();
-
-    // All inputs roughly between 0 and 5. Speed/10 to bring it into line.
-    // -90, -60, -30, maxForwardDistance {-10, 0, 10}, 30, 60, 90, currentSpeed/10.f
-    std::vector<double> networkInputs  = {vehicle->rangefinderInfo.rangefinders[RayDirection::LEFT_RAY],
-                                         vehicle->rangefinderInfo.rangefinders[3],
-                                         vehicle->rangefinderInfo.rangefinders[6],
-                                         maxForwardDistance,
-                                         vehicle->rangefinderInfo.rangefinders[12],
-                                         vehicle->rangefinderInfo.rangefinders[15],
-                                         vehicle->rangefinderInfo.rangefinders[RayDirection::RIGHT_RAY],
-                                         carSpeed / 10.f};
-    std::vector<double> networkOutputs = {0, 0, 0, 0};
+    this->_GetNetworkInputs(networkInputs);
+    return true;
+}
 
-    // Inference on the network
-    raceNet.evaluate(networkInputs, networkOutputs);
+void TrainingAgent::Act(const float *networkOutputs)
+{
+    this->_ApplyNetworkOutputs(networkOutputs);
+    ++ticksRaced;
 
-    // Control the vehicle with the neural network outputs
-    vehicle->ApplyAccelerationForce(networkOutputs[0] > 0.1f, false);
-    vehicle->ApplyBrakingForce(networkOutputs[1] > 0.1f);
-    // car->applyAbsoluteSteerAngle(networkOutputs[2]);
-    // Mutex steering
-    vehicle->ApplySteeringLeft(networkOutputs[2] > 0.1f && networkOutputs[3] < 0.1f);
-    vehicle->ApplySteeringRight(networkOutputs[3] > 0.1f && networkOutputs[2] < 0.1f);
+    float carSpeed = vehicle->GetVehicle()->getCurrentSpeedKmHour();
 
     // Count how long the car has been inside vroad, to evaluate fitness later
     if (vehicle->rangefinderInfo.upDistance < 0.5f)
@@ -113,21 +127,21 @@ void TrainingAgent::Simulate()
     int newVroadPosition = m_nearestVroadID;
 
     // If the vroad position jumps this much between ticks, we probably reversed over the start line.
-    if (abs(newVroadPosition - vroadPosition) > 100)
+    if (abs(newVroadPosition - m_lastVroadPosition) > 100)
     {
         isDead = m_droveBack = true;
         return;
     }
 
     // If not moved in more than 100 ticks of the game engine, we're dead
-    if (abs(newVroadPosition - vroadPosition) == 0 && m_ticksSpentAlive > 100)
+    if (abs(newVroadPosition - m_lastVroadPosition) == 0 && m_ticksSpentAlive > 100)
     {
         isDead = true;
         return;
     }
 
     // Calculate new fitness after moving
-    int newFitness = _EvaluateFitness(vroadPosition);
+    int newFitness = _EvaluateFitness(m_lastVroadPosition);
 
     // The fitness has increased, set it to the new value and reset the stale tick count
     if (newFitness > fitness)
@@ -143,5 +157,5 @@ void TrainingAgent::Simulate()
     }
 
     // Our current position is the new position
-    vroadPosition = m_nearestVroadID;
+    m_lastVroadPosition = m_nearestVroadID;
 }
\ No newline at end of file
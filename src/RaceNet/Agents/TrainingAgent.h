@@ -9,7 +9,12 @@ class TrainingAgent : public CarAgent
 public:
     TrainingAgent(uint16_t populationID, const std::shared_ptr<Car> &trainingCar, const std::shared_ptr<Track> &trainingTrack);
     void Simulate() override;
-    void Reset(); // Wrapper to reset to start of training track
+    // Simulate split either side of the network, so a population can be evaluated in one batch. Sense returns false if dead.
+    bool Sense(float *networkInputs);
+    void Act(const float *networkOutputs);
+    void Rebind(const genome &newGenome); // Swap in the network of a new genome, and forget everything the last one achieved
+    void Reset();                         // Wrapper to reset to start of training track
+    void Bench();                         // Sit out a species that has fewer genomes than there are pooled agents
     bool IsWinner();
 
     int fitness           = 0;
@@ -17,10 +22,13 @@ public:
     int ticksInsideVroad  = 0;
     float averageSpeed    = 0.f;
     uint16_t populationID = UINT16_MAX;
+    bool benched          = false; // Pooled without a genome to evaluate, its car is parked
+    uint32_t ticksRaced   = 0;     // Since the last Rebind
 
 private:
     int _EvaluateFitness(int vroadPosition);
 
-    bool m_droveBack      = false;
-    int m_ticksSpentAlive = 0;
+    bool m_droveBack        = false;
+    int m_ticksSpentAlive   = 0;
+    int m_lastVroadPosition = 0; // Vroad position at the end of the previous tick, per agent so the population can be simulated in parallel
 };
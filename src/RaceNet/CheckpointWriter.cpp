@@ -0,0 +1,153 @@
+#include "CheckpointWriter.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include <boost/filesystem.hpp>
+
+#include "../Util/Logger.h"
+
+namespace
+{
+    const std::string kCheckpointPrefix    = "gen";
+    const std::string kCheckpointExtension = ".ckpt";
+
+    // Generation of a checkpoint file name, false for anything else in the directory
+    bool ParseGeneration(const boost::filesystem::path &path, uint32_t &generation)
+    {
+        std::string name = path.filename().string();
+        if (path.extension() != kCheckpointExtension || name.compare(0, kCheckpointPrefix.size(), kCheckpointPrefix) != 0)
+        {
+            return false;
+        }
+        std::string digits = path.stem().string().substr(kCheckpointPrefix.size());
+        if (digits.empty() || !std::all_of(digits.begin(), digits.end(), ::isdigit))
+        {
+            return false;
+        }
+        generation = (uint32_t) std::stoul(digits);
+        return true;
+    }
+
+    std::vector<std::pair<uint32_t, boost::filesystem::path>> ListCheckpoints(const std::string &directory)
+    {
+        std::vector<std::pair<uint32_t, boost::filesystem::path>> checkpoints;
+        if (!boost::filesystem::is_directory(directory))
+        {
+            return checkpoints;
+        }
+        for (auto &entry : boost::filesystem::directory_iterator(directory))
+        {
+            uint32_t generation;
+            if (ParseGeneration(entry.path(), generation))
+            {
+                checkpoints.emplace_back(generation, entry.path());
+            }
+        }
+        std::sort(checkpoints.begin(), checkpoints.end());
+        return checkpoints;
+    }
+} // namespace
+
+CheckpointWriter::CheckpointWriter(const std::string &directory, uint32_t keepLast, uint32_t keepEvery, bool packed) :
+    m_directory(directory), m_keepLast(std::max(keepLast, 1u)), m_keepEvery(keepEvery), m_packed(packed)
+{
+    boost::filesystem::create_directories(m_directory);
+    m_writer = std::thread(&CheckpointWriter::_WriterLoop, this);
+}
+
+CheckpointWriter::~CheckpointWriter()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        m_stopping = true;
+    }
+    m_queueCondition.notify_one();
+    m_writer.join();
+}
+
+void CheckpointWriter::Save(pool &pool)
+{
+    auto start = std::chrono::steady_clock::now();
+    std::ostringstream bytes;
+    pool.export_checkpoint(bytes, m_packed);
+    LOG(INFO) << "Snapshotted generation " << pool.generation() << " (" << bytes.tellp() / 1024 << "KB) in "
+              << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() << "ms";
+
+    {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        m_queue.push_back(Snapshot{pool.generation(), bytes.str()});
+    }
+    m_queueCondition.notify_one();
+}
+
+std::string CheckpointWriter::Latest(const std::string &directory)
+{
+    auto checkpoints = ListCheckpoints(directory);
+    return checkpoints.empty() ? std::string() : checkpoints.back().second.string();
+}
+
+void CheckpointWriter::_WriterLoop()
+{
+    while (true)
+    {
+        Snapshot snapshot;
+        {
+            std::unique_lock<std::mutex> lock(m_queueMutex);
+            m_queueCondition.wait(lock, [this] { return m_stopping || !m_queue.empty(); });
+            // Drain the queue before stopping, so the last generation trained is never lost
+            if (m_queue.empty())
+            {
+                return;
+            }
+            snapshot = std::move(m_queue.front());
+            m_queue.pop_front();
+        }
+
+        this->_Write(snapshot);
+        this->_ApplyRetention();
+    }
+}
+
+void CheckpointWriter::_Write(const Snapshot &snapshot)
+{
+    std::ostringstream name;
+    name << kCheckpointPrefix << std::setw(6) << std::setfill('0') << snapshot.generation << kCheckpointExtension;
+    boost::filesystem::path path    = boost::filesystem::path(m_directory) / name.str();
+    boost::filesystem::path tmpPath = path.string() + ".tmp";
+
+    // Written aside then renamed over, so a crash mid write never leaves a truncated checkpoint to resume from
+    {
+        std::ofstream out(tmpPath.string(), std::ios::binary | std::ios::trunc);
+        out.write(snapshot.bytes.data(), snapshot.bytes.size());
+        if (!out.good())
+        {
+            LOG(WARNING) << "Failed to write checkpoint " << tmpPath;
+            return;
+        }
+    }
+    boost::system::error_code error;
+    boost::filesystem::rename(tmpPath, path, error);
+    if (error)
+    {
+        LOG(WARNING) << "Failed to move checkpoint into place at " << path << ": " << error.message();
+    }
+}
+
+void CheckpointWriter::_ApplyRetention()
+{
+    auto checkpoints = ListCheckpoints(m_directory);
+    for (size_t checkpointIdx = 0; checkpointIdx + m_keepLast < checkpoints.size(); ++checkpointIdx)
+    {
+        uint32_t generation = checkpoints[checkpointIdx].first;
+        if (m_keepEvery != 0 && generation % m_keepEvery == 0)
+        {
+            continue;
+        }
+        boost::system::error_code error;
+        boost::filesystem::remove(checkpoints[checkpointIdx].second, error);
+    }
+}
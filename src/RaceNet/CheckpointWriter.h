@@ -0,0 +1,44 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "RaceNEAT.h"
+
+// Saves a pool checkpoint per generation without holding up training. The pool is serialised into memory on the calling thread,
+// which is quick, then a background thread writes it to disk and prunes old checkpoints: the newest keepLast are kept, along with
+// every keepEvery-th generation (0 keeps none beyond the newest).
+class CheckpointWriter
+{
+public:
+    CheckpointWriter(const std::string &directory, uint32_t keepLast, uint32_t keepEvery, bool packed);
+    ~CheckpointWriter(); // Waits for queued checkpoints to be written
+    void Save(pool &pool);
+    // Path of the highest generation checkpoint in directory, empty if there are none
+    static std::string Latest(const std::string &directory);
+
+private:
+    struct Snapshot
+    {
+        uint32_t generation;
+        std::string bytes;
+    };
+
+    void _WriterLoop();
+    void _Write(const Snapshot &snapshot);
+    void _ApplyRetention();
+
+    std::string m_directory;
+    uint32_t m_keepLast;
+    uint32_t m_keepEvery;
+    bool m_packed;
+
+    std::thread m_writer;
+    std::mutex m_queueMutex;
+    std::condition_variable m_queueCondition;
+    std::deque<Snapshot> m_queue;
+    bool m_stopping = false;
+};
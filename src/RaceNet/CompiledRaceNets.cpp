@@ -0,0 +1,24 @@
+#include "CompiledRaceNets.h"
+
+void CompiledRaceNets::Register(const std::string &name, uint64_t fingerprint, CompiledRaceNetFn evaluate)
+{
+    _Registry()[name] = CompiledRaceNet{fingerprint, evaluate};
+}
+
+const CompiledRaceNet *CompiledRaceNets::Find(const std::string &name)
+{
+    auto compiledRaceNet = _Registry().find(name);
+    return compiledRaceNet == _Registry().end() ? nullptr : &compiledRaceNet->second;
+}
+
+const std::map<std::string, CompiledRaceNet> &CompiledRaceNets::All()
+{
+    return _Registry();
+}
+
+// Function local, so it exists before the first generated registrar runs whatever order static initialisation goes in
+std::map<std::string, CompiledRaceNet> &CompiledRaceNets::_Registry()
+{
+    static std::map<std::string, CompiledRaceNet> registry;
+    return registry;
+}
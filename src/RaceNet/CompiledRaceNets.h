@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+
+typedef void (*CompiledRaceNetFn)(const float *input, size_t n_inputs, float *output, size_t n_outputs);
+
+struct CompiledRaceNet
+{
+    uint64_t fingerprint; // RaceNet::fingerprint of the network it was generated from
+    CompiledRaceNetFn evaluate;
+};
+
+// Networks compiled into the binary at build time by RaceNetCodegen, from the .net files in resources/racenets. Each generated
+// evaluate gives the same outputs as RaceNet::evaluate on the network it came from, without the program walk.
+class CompiledRaceNets
+{
+public:
+    // Called by the generated sources during static initialisation
+    static void Register(const std::string &name, uint64_t fingerprint, CompiledRaceNetFn evaluate);
+    // Looked up by the network file's name without its extension, nullptr if there's no compiled driver of that name
+    static const CompiledRaceNet *Find(const std::string &name);
+    static const std::map<std::string, CompiledRaceNet> &All();
+
+private:
+    static std::map<std::string, CompiledRaceNet> &_Registry();
+};
+
+struct CompiledRaceNetRegistrar
+{
+    CompiledRaceNetRegistrar(const char *name, uint64_t fingerprint, CompiledRaceNetFn evaluate)
+    {
+        CompiledRaceNets::Register(name, fingerprint, evaluate);
+    }
+};
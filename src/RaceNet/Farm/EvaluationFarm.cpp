@@ -0,0 +1,283 @@
+#include "EvaluationFarm.h"
+
+#include <algorithm>
+#include <thread>
+
+#ifndef _WIN32
+#include <csignal>
+#include <unistd.h>
+#include <sys/wait.h>
+#endif
+
+#include "../../Util/Logger.h"
+
+EvaluationFarm::EvaluationFarm(const std::string &endpoint, uint32_t timeoutMs) :
+    m_endpoint(endpoint), m_timeout(timeoutMs), m_listener(FarmSocket::Listen(endpoint))
+{
+    if (m_listener.IsOpen())
+    {
+        LOG(INFO) << "Training farm listening for workers on " << m_endpoint;
+    }
+}
+
+EvaluationFarm::~EvaluationFarm()
+{
+    for (auto &worker : m_workers)
+    {
+        worker.socket.Send(FarmMessage::Shutdown, std::string());
+        worker.socket.Close();
+    }
+    m_listener.Close();
+
+#ifndef _WIN32
+    // Workers exit as soon as they see the shutdown or the connection close, anything still around after that is stuck
+    auto deadline = std::chrono::steady_clock::now() + m_timeout;
+    for (auto &pid : m_spawnedPids)
+    {
+        while (waitpid(pid, nullptr, WNOHANG) == 0)
+        {
+            if (std::chrono::steady_clock::now() >= deadline)
+            {
+                kill(pid, SIGKILL);
+                waitpid(pid, nullptr, 0);
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+#endif
+}
+
+bool EvaluationFarm::IsListening() const
+{
+    return m_listener.IsOpen();
+}
+
+const std::string &EvaluationFarm::Endpoint() const
+{
+    return m_endpoint;
+}
+
+void EvaluationFarm::SpawnLocalWorkers(uint32_t nWorkers, const std::string &executable, const std::vector<std::string> &args)
+{
+#ifndef _WIN32
+    std::vector<std::string> workerArgs{executable};
+    workerArgs.insert(workerArgs.end(), args.begin(), args.end());
+    workerArgs.emplace_back("--farm-worker");
+    workerArgs.emplace_back(m_endpoint);
+    // Built before forking, only async signal safe calls are allowed in the child
+    std::vector<char *> argv;
+    for (auto &arg : workerArgs)
+    {
+        argv.push_back(const_cast<char *>(arg.c_str()));
+    }
+    argv.push_back(nullptr);
+
+    for (uint32_t workerIdx = 0; workerIdx < nWorkers; ++workerIdx)
+    {
+        int pid = fork();
+        if (pid == 0)
+        {
+            execv(argv[0], argv.data());
+            _exit(127);
+        }
+        if (pid < 0)
+        {
+            LOG(WARNING) << "Couldn't start farm worker " << workerIdx << " of " << nWorkers;
+            continue;
+        }
+        m_spawnedPids.push_back(pid);
+    }
+    LOG(INFO) << "Started " << m_spawnedPids.size() << " local farm workers";
+#else
+    LOG(WARNING) << "Local farm workers can't be started on Windows";
+#endif
+}
+
+bool EvaluationFarm::Evaluate(const std::vector<std::string> &batches, std::vector<std::string> &results)
+{
+    results.assign(batches.size(), std::string());
+    std::vector<bool> done(batches.size(), false);
+    size_t nDone = 0;
+    m_pendingBatches.clear();
+    for (size_t batchIdx = 0; batchIdx < batches.size(); ++batchIdx)
+    {
+        m_pendingBatches.push_back(batchIdx);
+    }
+
+    auto lastProgress = std::chrono::steady_clock::now();
+    while (nDone < batches.size())
+    {
+        this->_AcceptWorkers();
+
+        // Hand out work, a worker that died between batches is only noticed once its send fails
+        for (auto &worker : m_workers)
+        {
+            if (!worker.ready || !worker.socket.IsOpen() || worker.batchIdx >= 0 || m_pendingBatches.empty())
+            {
+                continue;
+            }
+            size_t batchIdx = m_pendingBatches.front();
+            FarmWriter batch;
+            batch.U32(++m_nDispatches);
+            batch.U32(static_cast<uint32_t>(batchIdx));
+            batch.bytes += batches[batchIdx];
+            if (!worker.socket.Send(FarmMessage::Batch, batch.bytes))
+            {
+                this->_DropWorker(worker, "disconnected");
+                continue;
+            }
+            m_pendingBatches.pop_front();
+            worker.batchIdx = static_cast<int64_t>(batchIdx);
+            worker.dispatch = m_nDispatches;
+        }
+
+        // Sleep until a worker or the listener has something for us, waking regularly to check on heartbeats
+        std::vector<const FarmSocket *> sockets{&m_listener};
+        for (auto &worker : m_workers)
+        {
+            sockets.push_back(&worker.socket);
+        }
+        FarmSocket::WaitAny(sockets, 100);
+
+        size_t nDoneBefore = nDone;
+        auto now           = std::chrono::steady_clock::now();
+        for (auto &worker : m_workers)
+        {
+            if (!worker.socket.IsOpen())
+            {
+                continue;
+            }
+            this->_ReadWorker(worker, results, done, nDone);
+            if (worker.socket.IsOpen() && now - worker.lastHeard > m_timeout)
+            {
+                this->_DropWorker(worker, "stopped heartbeating");
+            }
+        }
+        m_workers.erase(std::remove_if(m_workers.begin(), m_workers.end(), [](const Worker &worker) { return !worker.socket.IsOpen(); }), m_workers.end());
+
+        if (nDone != nDoneBefore)
+        {
+            lastProgress = now;
+        }
+        else if (!this->_AnyWorkerAlive())
+        {
+            LOG(WARNING) << "Every farm worker has gone, " << batches.size() - nDone << " batches left unevaluated";
+            return false;
+        }
+        else if (now - lastProgress > 10 * m_timeout && m_workers.empty())
+        {
+            LOG(INFO) << "Waiting for farm workers to connect to " << m_endpoint;
+            lastProgress = now;
+        }
+    }
+    return true;
+}
+
+FarmStats EvaluationFarm::GetStats() const
+{
+    FarmStats stats    = m_stats;
+    stats.nWorkersReady = (uint32_t) std::count_if(m_workers.begin(), m_workers.end(), [](const Worker &worker) { return worker.ready; });
+    return stats;
+}
+
+void EvaluationFarm::_AcceptWorkers()
+{
+    while (true)
+    {
+        FarmSocket socket = m_listener.Accept();
+        if (!socket.IsOpen())
+        {
+            return;
+        }
+        Worker worker;
+        worker.socket    = std::move(socket);
+        worker.lastHeard = std::chrono::steady_clock::now();
+        m_workers.emplace_back(std::move(worker));
+    }
+}
+
+void EvaluationFarm::_ReadWorker(Worker &worker, std::vector<std::string> &results, std::vector<bool> &done, size_t &nDone)
+{
+    worker.socket.Pump();
+    FarmMessage type;
+    std::string payload;
+    while (worker.socket.Next(type, payload))
+    {
+        worker.lastHeard = std::chrono::steady_clock::now();
+        switch (type)
+        {
+        case FarmMessage::Hello:
+        {
+            FarmReader hello(payload);
+            if (hello.U32() != kFarmProtocolVersion)
+            {
+                this->_DropWorker(worker, "speaks a different protocol version");
+                return;
+            }
+            worker.ready = true;
+            break;
+        }
+        case FarmMessage::Result:
+        {
+            FarmReader result(payload);
+            uint32_t dispatch = result.U32();
+            uint32_t batchIdx = result.U32();
+            if (!result.Good() || dispatch != worker.dispatch || batchIdx != worker.batchIdx)
+            {
+                break;
+            }
+            // The batch may have been given to someone else while this worker was presumed dead, first result wins
+            if (batchIdx < done.size() && !done[batchIdx])
+            {
+                results[batchIdx] = payload.substr(8);
+                done[batchIdx]    = true;
+                ++nDone;
+                ++m_stats.nBatches;
+            }
+            worker.batchIdx = -1;
+            break;
+        }
+        default:
+            break;
+        }
+    }
+    // Pump closes the socket once the worker has gone, but whatever it sent before going still counts
+    if (!worker.socket.IsOpen())
+    {
+        this->_DropWorker(worker, "disconnected");
+    }
+}
+
+void EvaluationFarm::_DropWorker(Worker &worker, const char *reason)
+{
+    LOG(WARNING) << "Dropping farm worker that " << reason << (worker.batchIdx >= 0 ? ", reassigning its batch" : "");
+    if (worker.batchIdx >= 0)
+    {
+        // To the front, it's been waited on longest
+        m_pendingBatches.push_front(static_cast<size_t>(worker.batchIdx));
+        worker.batchIdx = -1;
+        ++m_stats.nReassigned;
+    }
+    worker.socket.Close();
+    ++m_stats.nWorkersLost;
+}
+
+bool EvaluationFarm::_AnyWorkerAlive()
+{
+    if (!m_workers.empty())
+    {
+        return true;
+    }
+#ifndef _WIN32
+    // Only knowable for workers we started, others may still be on their way
+    if (m_spawnedPids.empty())
+    {
+        return true;
+    }
+    m_spawnedPids.erase(std::remove_if(m_spawnedPids.begin(), m_spawnedPids.end(), [](int pid) { return waitpid(pid, nullptr, WNOHANG) != 0; }), m_spawnedPids.end());
+    return !m_spawnedPids.empty();
+#else
+    return true;
+#endif
+}
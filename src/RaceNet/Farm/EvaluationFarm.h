@@ -0,0 +1,61 @@
+#pragma once
+
+#include <chrono>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "FarmSocket.h"
+
+constexpr uint32_t kFarmProtocolVersion = 1;
+
+// Totals over the life of a farm
+struct FarmStats
+{
+    uint64_t nBatches      = 0; // Results received
+    uint64_t nReassigned   = 0; // Batches handed to another worker after theirs died or went quiet
+    uint64_t nWorkersLost  = 0;
+    uint32_t nWorkersReady = 0; // Connected and greeted right now
+};
+
+// Coordinator side of a multi process evaluation farm. Batches are opaque payloads handed out one at a time to whichever worker is
+// idle, and their results come back by index, so the caller sees exactly what it would have evaluating them in order itself.
+// Workers that stop heartbeating for the timeout, or disconnect, are dropped and their batch goes back on the queue.
+class EvaluationFarm
+{
+public:
+    EvaluationFarm(const std::string &endpoint, uint32_t timeoutMs);
+    ~EvaluationFarm(); // Tells every worker to shut down, and reaps the ones it spawned
+    bool IsListening() const;
+    const std::string &Endpoint() const;
+    // Starts nWorkers copies of executable with args, plus --farm-worker pointing back at this farm
+    void SpawnLocalWorkers(uint32_t nWorkers, const std::string &executable, const std::vector<std::string> &args);
+    // Blocks until every batch has a result. Returns false only if no worker is left to ever finish them: nobody is connected and
+    // every spawned worker has exited.
+    bool Evaluate(const std::vector<std::string> &batches, std::vector<std::string> &results);
+    FarmStats GetStats() const;
+
+private:
+    struct Worker
+    {
+        FarmSocket socket;
+        bool ready        = false; // Said hello, so has loaded whatever it needs to evaluate
+        int64_t batchIdx  = -1;    // Batch being evaluated, -1 when idle
+        uint32_t dispatch = 0;     // Dispatch the batch was sent under, a result for any other is stale
+        std::chrono::steady_clock::time_point lastHeard;
+    };
+
+    void _AcceptWorkers();
+    void _ReadWorker(Worker &worker, std::vector<std::string> &results, std::vector<bool> &done, size_t &nDone);
+    void _DropWorker(Worker &worker, const char *reason);
+    bool _AnyWorkerAlive();
+
+    std::string m_endpoint;
+    std::chrono::milliseconds m_timeout;
+    FarmSocket m_listener;
+    std::vector<Worker> m_workers;
+    std::deque<size_t> m_pendingBatches;
+    std::vector<int> m_spawnedPids;
+    uint32_t m_nDispatches = 0;
+    FarmStats m_stats;
+};
@@ -0,0 +1,378 @@
+#include "FarmSocket.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <thread>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
+
+#include "../../Util/Logger.h"
+
+constexpr uint32_t kMaxMessageSize = 256u << 20; // Far beyond any batch, anything bigger is a corrupt stream
+
+#ifndef _WIN32
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0 // macOS, where SO_NOSIGPIPE is set on the socket instead
+#endif
+
+namespace
+{
+    void ConfigureStream(int fd)
+    {
+        int flags = fcntl(fd, F_GETFL, 0);
+        fcntl(fd, F_SETFL, flags & ~O_NONBLOCK);
+#ifdef SO_NOSIGPIPE
+        int noSigPipe = 1;
+        setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &noSigPipe, sizeof(noSigPipe));
+#endif
+    }
+
+    // Splits "tcp:<host>:<port>" and "unix:<path>", false for anything else
+    bool ParseEndpoint(const std::string &endpoint, bool &isUnix, std::string &address, std::string &port)
+    {
+        if (endpoint.compare(0, 5, "unix:") == 0)
+        {
+            isUnix  = true;
+            address = endpoint.substr(5);
+            return !address.empty() && address.size() < sizeof(sockaddr_un::sun_path);
+        }
+        if (endpoint.compare(0, 4, "tcp:") == 0)
+        {
+            size_t portSeparator = endpoint.rfind(':');
+            isUnix               = false;
+            address              = endpoint.substr(4, portSeparator - 4);
+            port                 = endpoint.substr(portSeparator + 1);
+            return portSeparator > 4 && !port.empty();
+        }
+        return false;
+    }
+
+    // Connects or binds a new socket to the endpoint, -1 on failure
+    int OpenEndpoint(const std::string &endpoint, bool listen)
+    {
+        bool isUnix;
+        std::string address, port;
+        if (!ParseEndpoint(endpoint, isUnix, address, port))
+        {
+            LOG(WARNING) << "Farm endpoint " << endpoint << " isn't unix:<path> or tcp:<host>:<port>";
+            return -1;
+        }
+
+        if (isUnix)
+        {
+            sockaddr_un unixAddress = {};
+            unixAddress.sun_family  = AF_UNIX;
+            strncpy(unixAddress.sun_path, address.c_str(), sizeof(unixAddress.sun_path) - 1);
+            int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+            if (fd < 0)
+            {
+                return -1;
+            }
+            if (listen)
+            {
+                unlink(address.c_str());
+            }
+            int result = listen ? bind(fd, (sockaddr *) &unixAddress, sizeof(unixAddress)) : connect(fd, (sockaddr *) &unixAddress, sizeof(unixAddress));
+            if (result != 0)
+            {
+                close(fd);
+                return -1;
+            }
+            return fd;
+        }
+
+        addrinfo hints = {}, *addresses = nullptr;
+        hints.ai_family   = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_flags    = listen ? AI_PASSIVE : 0;
+        if (getaddrinfo(address.empty() ? nullptr : address.c_str(), port.c_str(), &hints, &addresses) != 0)
+        {
+            return -1;
+        }
+        int fd = -1;
+        for (addrinfo *candidate = addresses; candidate != nullptr && fd < 0; candidate = candidate->ai_next)
+        {
+            fd = socket(candidate->ai_family, candidate->ai_socktype, candidate->ai_protocol);
+            if (fd < 0)
+            {
+                continue;
+            }
+            int enable = 1;
+            if (listen)
+            {
+                setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+            }
+            // Messages are sent whole and waited on, Nagle would only add latency
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+            int result = listen ? bind(fd, candidate->ai_addr, candidate->ai_addrlen) : connect(fd, candidate->ai_addr, candidate->ai_addrlen);
+            if (result != 0)
+            {
+                close(fd);
+                fd = -1;
+            }
+        }
+        freeaddrinfo(addresses);
+        return fd;
+    }
+} // namespace
+
+FarmSocket::FarmSocket(int fd) : m_fd(fd)
+{
+}
+
+FarmSocket::~FarmSocket()
+{
+    this->Close();
+}
+
+FarmSocket::FarmSocket(FarmSocket &&other) noexcept : m_fd(other.m_fd), m_unixPath(std::move(other.m_unixPath)), m_received(std::move(other.m_received))
+{
+    other.m_fd = -1;
+    other.m_unixPath.clear();
+}
+
+FarmSocket &FarmSocket::operator=(FarmSocket &&other) noexcept
+{
+    if (this != &other)
+    {
+        this->Close();
+        m_fd       = other.m_fd;
+        m_unixPath = std::move(other.m_unixPath);
+        m_received = std::move(other.m_received);
+        other.m_fd = -1;
+        other.m_unixPath.clear();
+    }
+    return *this;
+}
+
+FarmSocket FarmSocket::Listen(const std::string &endpoint)
+{
+    FarmSocket listener(OpenEndpoint(endpoint, true));
+    if (!listener.IsOpen() || ::listen(listener.m_fd, SOMAXCONN) != 0)
+    {
+        LOG(WARNING) << "Couldn't listen for farm workers on " << endpoint;
+        listener.Close();
+        return listener;
+    }
+    fcntl(listener.m_fd, F_SETFL, fcntl(listener.m_fd, F_GETFL, 0) | O_NONBLOCK);
+    if (endpoint.compare(0, 5, "unix:") == 0)
+    {
+        listener.m_unixPath = endpoint.substr(5);
+    }
+    return listener;
+}
+
+FarmSocket FarmSocket::Connect(const std::string &endpoint, uint32_t timeoutMs)
+{
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    while (true)
+    {
+        int fd = OpenEndpoint(endpoint, false);
+        if (fd >= 0)
+        {
+            ConfigureStream(fd);
+            return FarmSocket(fd);
+        }
+        if (std::chrono::steady_clock::now() >= deadline)
+        {
+            LOG(WARNING) << "Couldn't connect to farm coordinator at " << endpoint;
+            return FarmSocket();
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+}
+
+FarmSocket FarmSocket::Accept()
+{
+    int fd = accept(m_fd, nullptr, nullptr);
+    if (fd < 0)
+    {
+        return FarmSocket();
+    }
+    // Accepted sockets inherit the listener's non blocking flag on some platforms
+    ConfigureStream(fd);
+    int enable = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+    return FarmSocket(fd);
+}
+
+bool FarmSocket::Send(FarmMessage type, const std::string &payload)
+{
+    if (!this->IsOpen())
+    {
+        return false;
+    }
+    FarmWriter frame;
+    frame.U32(static_cast<uint32_t>(payload.size() + 1));
+    frame.bytes.push_back(static_cast<char>(type));
+    frame.bytes += payload;
+
+    size_t sent = 0;
+    while (sent < frame.bytes.size())
+    {
+        ssize_t result = send(m_fd, frame.bytes.data() + sent, frame.bytes.size() - sent, MSG_NOSIGNAL);
+        if (result <= 0)
+        {
+            if (result < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            // Left open, the reading side finds out the other end has gone and closes it
+            return false;
+        }
+        sent += result;
+    }
+    return true;
+}
+
+bool FarmSocket::Pump()
+{
+    char buffer[64 * 1024];
+    while (this->IsOpen())
+    {
+        ssize_t result = recv(m_fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+        if (result > 0)
+        {
+            m_received.append(buffer, result);
+            continue;
+        }
+        if (result < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+        {
+            return true;
+        }
+        this->Close();
+    }
+    return false;
+}
+
+bool FarmSocket::Next(FarmMessage &type, std::string &payload)
+{
+    if (m_received.size() < 4)
+    {
+        return false;
+    }
+    FarmReader header(m_received);
+    uint32_t size = header.U32();
+    if (size == 0 || size > kMaxMessageSize)
+    {
+        LOG(WARNING) << "Dropping farm connection with a corrupt message of " << size << " bytes";
+        this->Close();
+        return false;
+    }
+    if (m_received.size() < 4 + size)
+    {
+        return false;
+    }
+    type    = static_cast<FarmMessage>(m_received[4]);
+    payload = m_received.substr(5, size - 1);
+    m_received.erase(0, 4 + size);
+    return true;
+}
+
+bool FarmSocket::Receive(FarmMessage &type, std::string &payload, int timeoutMs)
+{
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    while (!this->Next(type, payload))
+    {
+        int remainingMs = timeoutMs < 0 ? -1 : (int) std::max<int64_t>(0, std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count());
+        if (!this->IsOpen() || (remainingMs == 0 && timeoutMs >= 0) || !this->WaitReadable(remainingMs) || !this->Pump())
+        {
+            // Whatever arrived before the other end closed still counts
+            return this->Next(type, payload);
+        }
+    }
+    return true;
+}
+
+bool FarmSocket::WaitReadable(int timeoutMs) const
+{
+    pollfd pollFd = {m_fd, POLLIN, 0};
+    return poll(&pollFd, 1, timeoutMs) > 0;
+}
+
+bool FarmSocket::WaitAny(const std::vector<const FarmSocket *> &sockets, int timeoutMs)
+{
+    std::vector<pollfd> pollFds;
+    for (auto &socket : sockets)
+    {
+        if (socket->IsOpen())
+        {
+            pollFds.push_back({socket->m_fd, POLLIN, 0});
+        }
+    }
+    return poll(pollFds.data(), pollFds.size(), timeoutMs) > 0;
+}
+
+void FarmSocket::Close()
+{
+    if (m_fd >= 0)
+    {
+        close(m_fd);
+        m_fd = -1;
+    }
+    if (!m_unixPath.empty())
+    {
+        unlink(m_unixPath.c_str());
+        m_unixPath.clear();
+    }
+}
+#else
+// The farm needs POSIX sockets, Windows builds train in a single process
+FarmSocket::FarmSocket(int fd) : m_fd(fd)
+{
+}
+FarmSocket::~FarmSocket() = default;
+FarmSocket::FarmSocket(FarmSocket &&other) noexcept = default;
+FarmSocket &FarmSocket::operator=(FarmSocket &&other) noexcept = default;
+FarmSocket FarmSocket::Listen(const std::string &endpoint)
+{
+    LOG(WARNING) << "The training farm isn't supported on Windows";
+    return FarmSocket();
+}
+FarmSocket FarmSocket::Connect(const std::string &endpoint, uint32_t timeoutMs)
+{
+    LOG(WARNING) << "The training farm isn't supported on Windows";
+    return FarmSocket();
+}
+FarmSocket FarmSocket::Accept()
+{
+    return FarmSocket();
+}
+bool FarmSocket::Send(FarmMessage type, const std::string &payload)
+{
+    return false;
+}
+bool FarmSocket::Pump()
+{
+    return false;
+}
+bool FarmSocket::Next(FarmMessage &type, std::string &payload)
+{
+    return false;
+}
+bool FarmSocket::Receive(FarmMessage &type, std::string &payload, int timeoutMs)
+{
+    return false;
+}
+bool FarmSocket::WaitReadable(int timeoutMs) const
+{
+    return false;
+}
+bool FarmSocket::WaitAny(const std::vector<const FarmSocket *> &sockets, int timeoutMs)
+{
+    return false;
+}
+void FarmSocket::Close()
+{
+}
+#endif
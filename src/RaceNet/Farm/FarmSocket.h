@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// What a frame carries, the payload layout is up to whoever sends it
+enum class FarmMessage : uint8_t
+{
+    Hello,     // Worker to coordinator, once connected
+    Batch,     // Coordinator to worker: batch index, then the batch
+    Result,    // Worker to coordinator: batch index, then the result
+    Heartbeat, // Worker to coordinator, regularly, even mid batch
+    Shutdown   // Coordinator to worker, training is over
+};
+
+// Length prefixed messages over a stream socket. Endpoints are "unix:<path>" for workers on the same host, or "tcp:<host>:<port>"
+// for workers on others (loopback works too). Only available on POSIX systems.
+class FarmSocket
+{
+public:
+    FarmSocket() = default;
+    explicit FarmSocket(int fd);
+    ~FarmSocket();
+    FarmSocket(FarmSocket &&other) noexcept;
+    FarmSocket &operator=(FarmSocket &&other) noexcept;
+    FarmSocket(const FarmSocket &) = delete;
+    FarmSocket &operator=(const FarmSocket &) = delete;
+
+    static FarmSocket Listen(const std::string &endpoint);
+    // Keeps retrying for up to timeoutMs, the coordinator may not be listening yet
+    static FarmSocket Connect(const std::string &endpoint, uint32_t timeoutMs);
+    // Never blocks, returns a closed socket when nobody is waiting to connect
+    FarmSocket Accept();
+
+    bool Send(FarmMessage type, const std::string &payload);
+    // Reads whatever has arrived without blocking. Returns false, closing the socket, once the other end has gone.
+    bool Pump();
+    // Pops the next whole message read by Pump, if there is one
+    bool Next(FarmMessage &type, std::string &payload);
+    // Pumps until a whole message arrives or timeoutMs passes, -1 waits forever
+    bool Receive(FarmMessage &type, std::string &payload, int timeoutMs);
+    // Waits until there's something to Pump or timeoutMs passes
+    bool WaitReadable(int timeoutMs) const;
+    // Same, for whichever of several open sockets is first
+    static bool WaitAny(const std::vector<const FarmSocket *> &sockets, int timeoutMs);
+
+    bool IsOpen() const
+    {
+        return m_fd >= 0;
+    }
+    int Fd() const
+    {
+        return m_fd;
+    }
+    void Close();
+
+private:
+    int m_fd = -1;
+    std::string m_unixPath; // Unlinked on close, for listening unix sockets
+    std::string m_received;
+};
+
+// Little endian encoding of message payloads
+class FarmWriter
+{
+public:
+    void U32(uint32_t value)
+    {
+        for (int byteIdx = 0; byteIdx < 4; ++byteIdx)
+        {
+            bytes.push_back(static_cast<char>((value >> (8 * byteIdx)) & 0xff));
+        }
+    }
+    void Bytes(const std::string &value)
+    {
+        this->U32(static_cast<uint32_t>(value.size()));
+        bytes += value;
+    }
+
+    std::string bytes;
+};
+
+class FarmReader
+{
+public:
+    explicit FarmReader(const std::string &bytes) : m_bytes(bytes)
+    {
+    }
+    uint32_t U32()
+    {
+        if (m_offset + 4 > m_bytes.size())
+        {
+            m_good = false;
+            return 0;
+        }
+        uint32_t value = 0;
+        for (int byteIdx = 0; byteIdx < 4; ++byteIdx)
+        {
+            value |= static_cast<uint32_t>(static_cast<uint8_t>(m_bytes[m_offset++])) << (8 * byteIdx);
+        }
+        return value;
+    }
+    std::string Bytes()
+    {
+        uint32_t size = this->U32();
+        if (!m_good || m_offset + size > m_bytes.size())
+        {
+            m_good = false;
+            return std::string();
+        }
+        m_offset += size;
+        return m_bytes.substr(m_offset - size, size);
+    }
+    bool Good() const
+    {
+        return m_good;
+    }
+
+private:
+    const std::string &m_bytes;
+    size_t m_offset = 0;
+    bool m_good     = true;
+};
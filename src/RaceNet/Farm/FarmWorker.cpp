@@ -0,0 +1,82 @@
+#include "FarmWorker.h"
+
+#include <thread>
+
+#include "EvaluationFarm.h"
+#include "../../Util/Logger.h"
+
+constexpr uint32_t kConnectTimeoutMs = 30000; // Workers started alongside the coordinator may beat it to listening
+
+FarmWorker::FarmWorker(const std::string &endpoint, uint32_t heartbeatIntervalMs) : m_endpoint(endpoint), m_heartbeatIntervalMs(heartbeatIntervalMs)
+{
+}
+
+bool FarmWorker::Run(const std::function<void()> &prepare, const std::function<std::string(const std::string &)> &evaluate)
+{
+    m_socket = FarmSocket::Connect(m_endpoint, kConnectTimeoutMs);
+    if (!m_socket.IsOpen())
+    {
+        return false;
+    }
+    LOG(INFO) << "Connected to training farm at " << m_endpoint;
+
+    m_stopping = false;
+    std::thread heartbeat(&FarmWorker::_HeartbeatLoop, this);
+
+    prepare();
+    FarmWriter hello;
+    hello.U32(kFarmProtocolVersion);
+    this->_Send(FarmMessage::Hello, hello.bytes);
+
+    uint64_t nBatches = 0;
+    FarmMessage type;
+    std::string payload;
+    while (m_socket.Receive(type, payload, -1))
+    {
+        if (type == FarmMessage::Shutdown)
+        {
+            break;
+        }
+        if (type != FarmMessage::Batch || payload.size() < 8)
+        {
+            continue;
+        }
+        // Dispatch and batch index go back as they came, ahead of the result
+        std::string result = payload.substr(0, 8);
+        result += evaluate(payload.substr(8));
+        if (!this->_Send(FarmMessage::Result, result))
+        {
+            break;
+        }
+        ++nBatches;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_heartbeatMutex);
+        m_stopping = true;
+    }
+    m_heartbeatCondition.notify_all();
+    heartbeat.join();
+    m_socket.Close();
+
+    LOG(INFO) << "Training farm worker done after " << nBatches << " batches";
+    return true;
+}
+
+bool FarmWorker::_Send(FarmMessage type, const std::string &payload)
+{
+    std::lock_guard<std::mutex> lock(m_sendMutex);
+    return m_socket.Send(type, payload);
+}
+
+void FarmWorker::_HeartbeatLoop()
+{
+    std::unique_lock<std::mutex> lock(m_heartbeatMutex);
+    while (!m_heartbeatCondition.wait_for(lock, std::chrono::milliseconds(m_heartbeatIntervalMs), [this] { return m_stopping; }))
+    {
+        if (!this->_Send(FarmMessage::Heartbeat, std::string()))
+        {
+            return;
+        }
+    }
+}
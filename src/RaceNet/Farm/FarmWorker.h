@@ -0,0 +1,30 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+
+#include "FarmSocket.h"
+
+// Worker side of the evaluation farm. Connects to the coordinator, heartbeats from a thread of its own so long batches (and loading)
+// don't look like a hang, and evaluates batches until told to shut down or the coordinator goes away.
+class FarmWorker
+{
+public:
+    FarmWorker(const std::string &endpoint, uint32_t heartbeatIntervalMs);
+    // prepare runs once connected, before the worker says it's ready for batches. Returns false if the coordinator couldn't be reached.
+    bool Run(const std::function<void()> &prepare, const std::function<std::string(const std::string &)> &evaluate);
+
+private:
+    bool _Send(FarmMessage type, const std::string &payload);
+    void _HeartbeatLoop();
+
+    std::string m_endpoint;
+    uint32_t m_heartbeatIntervalMs;
+    FarmSocket m_socket;
+    std::mutex m_sendMutex; // Heartbeats and results go out from different threads
+    std::mutex m_heartbeatMutex;
+    std::condition_variable m_heartbeatCondition;
+    bool m_stopping = false;
+};
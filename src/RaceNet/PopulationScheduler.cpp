@@ -0,0 +1,336 @@
+#include "PopulationScheduler.h"
+
+#include <algorithm>
+#include <chrono>
+
+struct AgentSenseLoop : public btIParallelForBody
+{
+    AgentSenseLoop(std::vector<TrainingAgent *> &agents, std::vector<float> &networkInputs, std::vector<uint8_t> &sensed) :
+        m_agents(agents), m_networkInputs(networkInputs), m_sensed(sensed)
+    {
+    }
+
+    void forLoop(int iBegin, int iEnd) const override
+    {
+        for (int agentIdx = iBegin; agentIdx < iEnd; ++agentIdx)
+        {
+            m_sensed[agentIdx] = !m_agents[agentIdx]->isDead && m_agents[agentIdx]->Sense(&m_networkInputs[agentIdx * kNetworkInputs]);
+        }
+    }
+
+    std::vector<TrainingAgent *> &m_agents;
+    std::vector<float> &m_networkInputs;
+    std::vector<uint8_t> &m_sensed;
+};
+
+struct AgentActLoop : public btIParallelForBody
+{
+    AgentActLoop(std::vector<TrainingAgent *> &agents, const std::vector<float> &networkOutputs, const std::vector<uint8_t> &sensed) :
+        m_agents(agents), m_networkOutputs(networkOutputs), m_sensed(sensed)
+    {
+    }
+
+    void forLoop(int iBegin, int iEnd) const override
+    {
+        for (int agentIdx = iBegin; agentIdx < iEnd; ++agentIdx)
+        {
+            if (m_sensed[agentIdx])
+            {
+                m_agents[agentIdx]->Act(&m_networkOutputs[agentIdx * kNetworkOutputs]);
+            }
+        }
+    }
+
+    std::vector<TrainingAgent *> &m_agents;
+    const std::vector<float> &m_networkOutputs;
+    const std::vector<uint8_t> &m_sensed;
+};
+
+PopulationScheduler::PopulationScheduler(const std::shared_ptr<Track> &track, uint32_t nShards) : m_track(track)
+{
+    nShards = std::max(nShards, 1u);
+
+    // Bullet's task scheduler is global and can't be nested, so once there are several worlds each steps on a single thread of its own
+    m_physicsSettings.nThreads = nShards > 1 ? 1 : Config::get().physicsThreads;
+
+    for (uint32_t shardIdx = 0; shardIdx < nShards; ++shardIdx)
+    {
+        m_shards.emplace_back(std::make_unique<Shard>());
+        m_shards.back()->physicsEngine = std::make_unique<PhysicsEngine>(m_physicsSettings);
+        m_shards.back()->physicsEngine->RegisterTrack(m_track);
+    }
+    for (uint32_t shardIdx = 1; shardIdx < nShards; ++shardIdx)
+    {
+        m_shards[shardIdx]->worker = std::thread(&PopulationScheduler::_WorkerLoop, this, shardIdx);
+    }
+
+    LOG(INFO) << "Training population split across " << nShards << " physics world" << (nShards > 1 ? "s" : "");
+}
+
+PopulationScheduler::~PopulationScheduler()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_dispatchMutex);
+        m_stopping = true;
+    }
+    m_dispatchCondition.notify_all();
+
+    for (auto &shard : m_shards)
+    {
+        if (shard->worker.joinable())
+        {
+            shard->worker.join();
+        }
+        // The cars may outlive this scheduler, so take them out of the worlds before those are torn down
+        for (auto &vehicle : shard->vehicles)
+        {
+            shard->physicsEngine->UnregisterVehicle(vehicle);
+        }
+    }
+}
+
+void PopulationScheduler::SetAgentPool(std::vector<TrainingAgent> &agents)
+{
+    for (auto &shard : m_shards)
+    {
+        for (auto &vehicle : shard->vehicles)
+        {
+            shard->physicsEngine->UnregisterVehicle(vehicle);
+        }
+        shard->vehicles.clear();
+        shard->agents.clear();
+    }
+
+    // Round robin, so however many of the pool are active each shard gets an even share of them
+    m_agentPool = &agents;
+    for (size_t agentIdx = 0; agentIdx < agents.size(); ++agentIdx)
+    {
+        Shard &shard = *m_shards[agentIdx % m_shards.size()];
+        shard.physicsEngine->RegisterVehicle(agents[agentIdx].vehicle);
+        shard.vehicles.emplace_back(agents[agentIdx].vehicle);
+        shard.agents.emplace_back(&agents[agentIdx]);
+    }
+    this->ActivateAgents(0);
+}
+
+void PopulationScheduler::ResetWorlds()
+{
+    // Resetting bodies in place isn't enough, Bullet's pair caches, manifolds and object arrays keep the order things were added and
+    // removed in, and that order changes the solver's results. Fresh worlds over the already merged track collision are cheap.
+    for (auto &shard : m_shards)
+    {
+        for (auto &vehicle : shard->vehicles)
+        {
+            shard->physicsEngine->UnregisterVehicle(vehicle);
+        }
+        shard->physicsEngine.reset();
+        shard->physicsEngine = std::make_unique<PhysicsEngine>(m_physicsSettings);
+        shard->physicsEngine->RegisterTrack(m_track);
+        for (auto &vehicle : shard->vehicles)
+        {
+            shard->physicsEngine->RegisterVehicle(vehicle);
+        }
+    }
+}
+
+void PopulationScheduler::ActivateAgents(size_t nAgents)
+{
+    for (auto &shard : m_shards)
+    {
+        shard->activeAgents.clear();
+    }
+    for (size_t agentIdx = 0; agentIdx < m_agentPool->size(); ++agentIdx)
+    {
+        TrainingAgent &agent = (*m_agentPool)[agentIdx];
+        Shard &shard         = *m_shards[agentIdx % m_shards.size()];
+        bool active          = agentIdx < nAgents;
+        shard.physicsEngine->SetVehicleParked(agent.vehicle, !active);
+        if (active)
+        {
+            agent.Reset();
+            shard.activeAgents.emplace_back(&agent);
+        }
+        else
+        {
+            agent.Bench();
+        }
+    }
+
+    // The agents have just been rebound to new genomes, so their networks need packing again
+    for (auto &shard : m_shards)
+    {
+        this->_PackShard(*shard);
+        shard->networkInputs.assign(shard->activeAgents.size() * kNetworkInputs, 0.f);
+        shard->networkOutputs.assign(shard->activeAgents.size() * kNetworkOutputs, 0.f);
+        shard->sensed.assign(shard->activeAgents.size(), 0);
+    }
+}
+
+void PopulationScheduler::SetAgentFinished(uint32_t nTicks, const AgentFinishedCallback &agentFinished)
+{
+    m_agentTicks    = nTicks;
+    m_agentFinished = agentFinished;
+}
+
+void PopulationScheduler::_PackShard(Shard &shard)
+{
+    std::vector<RaceNet *> raceNets;
+    for (auto &agent : shard.activeAgents)
+    {
+        raceNets.emplace_back(&agent->raceNet);
+    }
+    shard.raceNetBatch.build(raceNets);
+}
+
+// Done before sensing, so the replacements find where they've been reset to before the world steps around them
+void PopulationScheduler::_ReplaceFinishedAgents(Shard &shard)
+{
+    bool rebound = false;
+    for (auto &agent : shard.activeAgents)
+    {
+        if (agent->benched || (!agent->isDead && agent->ticksRaced < m_agentTicks))
+        {
+            continue;
+        }
+        if (m_agentFinished(*agent))
+        {
+            agent->Reset();
+            rebound = true;
+        }
+        else
+        {
+            agent->Bench();
+            shard.physicsEngine->SetVehicleParked(agent->vehicle, true);
+        }
+    }
+    // One network changing still repacks the whole batch, which is cheaper than a tick of evaluating it
+    if (rebound)
+    {
+        this->_PackShard(shard);
+    }
+}
+
+PopulationStats PopulationScheduler::Run(uint32_t nTicks, const std::function<bool(uint32_t)> &tickCallback)
+{
+    for (auto &shard : m_shards)
+    {
+        shard->nTicks      = 0;
+        shard->nAgentTicks = 0;
+        shard->finished    = false;
+    }
+
+    auto startTime = std::chrono::steady_clock::now();
+    if (tickCallback)
+    {
+        for (uint32_t tickIdx = 0; tickIdx < nTicks; ++tickIdx)
+        {
+            this->_RunShards(1);
+            bool allFinished = std::all_of(m_shards.begin(), m_shards.end(), [](const std::unique_ptr<Shard> &shard) { return shard->finished; });
+            if (allFinished || !tickCallback(tickIdx))
+            {
+                break;
+            }
+        }
+    }
+    else
+    {
+        this->_RunShards(nTicks);
+    }
+
+    PopulationStats stats;
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    for (auto &shard : m_shards)
+    {
+        stats.nTicks = std::max(stats.nTicks, shard->nTicks);
+        stats.nAgentTicks += shard->nAgentTicks;
+    }
+    return stats;
+}
+
+void PopulationScheduler::_RunShards(uint32_t nTicks)
+{
+    if (m_shards.size() > 1)
+    {
+        std::lock_guard<std::mutex> lock(m_dispatchMutex);
+        m_batchTicks  = nTicks;
+        m_nShardsBusy = (uint32_t) m_shards.size() - 1;
+        ++m_dispatchIdx;
+    }
+    m_dispatchCondition.notify_all();
+
+    this->_RunShard(*m_shards[0], nTicks);
+
+    std::unique_lock<std::mutex> lock(m_dispatchMutex);
+    m_doneCondition.wait(lock, [this] { return m_nShardsBusy == 0; });
+}
+
+void PopulationScheduler::_RunShard(Shard &shard, uint32_t nTicks)
+{
+    for (uint32_t tickIdx = 0; tickIdx < nTicks && !shard.finished; ++tickIdx)
+    {
+        shard.finished = !this->_TickShard(shard);
+    }
+}
+
+// Returns false once there is nobody left alive to simulate
+bool PopulationScheduler::_TickShard(Shard &shard)
+{
+    if (m_agentFinished)
+    {
+        this->_ReplaceFinishedAgents(shard);
+    }
+
+    auto nLiveAgents = (uint64_t) std::count_if(shard.activeAgents.begin(), shard.activeAgents.end(), [](const TrainingAgent *agent) { return !agent->isDead; });
+    if (nLiveAgents == 0)
+    {
+        return false;
+    }
+
+    // Each agent only reads the world and writes its own car's controls, so they can all sense and act at once
+    int nAgents = (int) shard.activeAgents.size();
+    btParallelFor(0, nAgents, 1, AgentSenseLoop(shard.activeAgents, shard.networkInputs, shard.sensed));
+    // Dead agents' rows go through the batch too, it's cheaper than repacking it as they drop out
+    shard.raceNetBatch.evaluate(shard.networkInputs.data(), kNetworkInputs, shard.networkOutputs.data(), kNetworkOutputs);
+    btParallelFor(0, nAgents, 1, AgentActLoop(shard.activeAgents, shard.networkOutputs, shard.sensed));
+
+    shard.residentTrackblockIDs.clear();
+    for (auto &agent : shard.activeAgents)
+    {
+        if (!agent->isDead)
+        {
+            shard.residentTrackblockIDs.emplace_back(agent->nearestTrackblockID);
+        }
+    }
+    shard.physicsEngine->StepSimulation(stepTime, shard.residentTrackblockIDs);
+
+    ++shard.nTicks;
+    shard.nAgentTicks += nLiveAgents;
+    return true;
+}
+
+void PopulationScheduler::_WorkerLoop(uint32_t shardIdx)
+{
+    uint64_t lastDispatchIdx = 0;
+    while (true)
+    {
+        uint32_t batchTicks;
+        {
+            std::unique_lock<std::mutex> lock(m_dispatchMutex);
+            m_dispatchCondition.wait(lock, [&] { return m_stopping || m_dispatchIdx != lastDispatchIdx; });
+            if (m_stopping)
+            {
+                return;
+            }
+            lastDispatchIdx = m_dispatchIdx;
+            batchTicks      = m_batchTicks;
+        }
+
+        this->_RunShard(*m_shards[shardIdx], batchTicks);
+
+        {
+            std::lock_guard<std::mutex> lock(m_dispatchMutex);
+            --m_nShardsBusy;
+        }
+        m_doneCondition.notify_one();
+    }
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Agents/TrainingAgent.h"
+#include "../Physics/PhysicsEngine.h"
+#include "../Scene/Track.h"
+
+static const float stepTime = 1 / 60.f;
+
+// Throughput of the last Run, across every shard
+struct PopulationStats
+{
+    uint64_t nTicks      = 0; // Ticks stepped by the longest running shard
+    uint64_t nAgentTicks = 0; // Live agents simulated, summed over every tick of every shard
+    double seconds       = 0.0;
+};
+
+// Handed an agent that has finished racing its genome, on the thread of the shard it raced in, so possibly from several shards at
+// once. Returns true having rebound the agent to a new genome, false to bench it.
+using AgentFinishedCallback = std::function<bool(TrainingAgent &)>;
+
+// Steps a training population, one world step per tick. Agents sense and act in parallel through the Bullet task scheduler, with
+// all of their networks evaluated in one batch in between, then their world steps once with all of their cars in it. With more than one shard the population is dealt across independent
+// PhysicsEngines over the same track, each stepped on its own thread. Cars in different shards can't collide with each other.
+class PopulationScheduler
+{
+public:
+    PopulationScheduler(const std::shared_ptr<Track> &track, uint32_t nShards);
+    ~PopulationScheduler();
+    // Registers every pooled agent's car once, agents must stay where they are in memory for the life of the scheduler
+    void SetAgentPool(std::vector<TrainingAgent> &agents);
+    // The first nAgents of the pool race from the start of the track, the rest are benched and their cars parked
+    void ActivateAgents(size_t nAgents);
+    // Steady state: from the next Run, an agent that dies or has raced nTicks of its own is handed to agentFinished at the start of
+    // the following tick. Rebound, it restarts from the start of the track while the rest race on, so Run only ends early once every
+    // agent is benched. A null callback goes back to racing each activated agent once.
+    void SetAgentFinished(uint32_t nTicks, const AgentFinishedCallback &agentFinished);
+    // Rebuilds every world with the pooled cars in it, so what is simulated next doesn't depend on anything simulated before
+    void ResetWorlds();
+    // Steps until every agent is dead or nTicks have passed. With a callback every shard is held in lockstep and the callback is run
+    // between ticks on the calling thread, returning false to stop early. Without one each shard runs flat out.
+    PopulationStats Run(uint32_t nTicks, const std::function<bool(uint32_t)> &tickCallback = nullptr);
+
+private:
+    struct Shard
+    {
+        std::unique_ptr<PhysicsEngine> physicsEngine;
+        std::vector<TrainingAgent *> agents;
+        std::vector<std::shared_ptr<Car>> vehicles; // Registered with physicsEngine, so they can be unregistered if they outlive it
+        std::vector<TrainingAgent *> activeAgents;  // Not benched, in the same order as raceNetBatch's networks
+        RaceNetBatch raceNetBatch;
+        std::vector<float> networkInputs;  // kNetworkInputs per active agent
+        std::vector<float> networkOutputs; // kNetworkOutputs per active agent
+        std::vector<uint8_t> sensed;       // Whether each active agent was alive to sense this tick
+        std::vector<uint32_t> residentTrackblockIDs;
+        uint64_t nTicks      = 0;
+        uint64_t nAgentTicks = 0;
+        bool finished        = false;
+        std::thread worker; // Unused for shard 0, which runs on the calling thread
+    };
+
+    void _PackShard(Shard &shard);
+    void _ReplaceFinishedAgents(Shard &shard);
+    void _RunShards(uint32_t nTicks);
+    void _RunShard(Shard &shard, uint32_t nTicks);
+    bool _TickShard(Shard &shard);
+    void _WorkerLoop(uint32_t shardIdx);
+
+    std::shared_ptr<Track> m_track;
+    PhysicsSettings m_physicsSettings;
+    std::vector<std::unique_ptr<Shard>> m_shards;
+    std::vector<TrainingAgent> *m_agentPool = nullptr;
+    AgentFinishedCallback m_agentFinished;
+    uint32_t m_agentTicks = 0;
+
+    // Hands batches of ticks to the worker threads
+    std::mutex m_dispatchMutex;
+    std::condition_variable m_dispatchCondition;
+    std::condition_variable m_doneCondition;
+    uint64_t m_dispatchIdx = 0;
+    uint32_t m_batchTicks  = 0;
+    uint32_t m_nShardsBusy = 0;
+    bool m_stopping        = false;
+};
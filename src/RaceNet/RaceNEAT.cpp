@@ -1,48 +1,112 @@
 #include "RaceNEAT.h"
 
+#include <cstring>
+#include <sstream>
+#include <thread>
+
+pool::pool(unsigned int input, unsigned int output, unsigned int bias, bool rec, uint32_t seed)
+{
+    this->network_info.input_size       = input;
+    this->network_info.output_size      = output;
+    this->network_info.bias_size        = bias;
+    this->network_info.functional_nodes = input + output + bias;
+    this->network_info.recurrent        = rec;
+
+    // seed the mersenne twister with
+    // a random number from our computer, unless we're asked to reproduce a run
+    this->seed_value = seed != 0 ? seed : rd();
+    generator.seed(this->seed_value);
+
+    // create a basic generation with default genomes
+    std::vector<genome> children(this->speciating_parameters.population, genome(this->network_info, this->mutation_rates));
+    this->parallel_for(children.size(), [&](size_t, size_t begin, size_t end) {
+        breeding_scratch scratch;
+        for (size_t i = begin; i < end; i++)
+        {
+            std::mt19937 rng = this->child_generator(0, i);
+            this->mutate(children[i], rng, scratch);
+        }
+    });
+    for (auto &child : children)
+        this->resolve_innovations(child);
+    this->add_to_species(children);
+}
+
+/* every child of every generation gets a stream of its own, mixed from the seed so neighbouring streams are unrelated */
+std::mt19937 pool::child_generator(unsigned int generation, size_t child_idx)
+{
+    uint64_t z = (uint64_t(this->seed_value) << 32) ^ (uint64_t(generation) << 20) ^ child_idx;
+    z += 0x9e3779b97f4a7c15ull;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    z = z ^ (z >> 31);
+    return std::mt19937(static_cast<uint32_t>(z ^ (z >> 32)));
+}
+
+/* splits [0, n) into one contiguous range per thread, run on the calling thread when there's only one */
+void pool::parallel_for(size_t n, const std::function<void(size_t worker, size_t begin, size_t end)> &body)
+{
+    size_t threads = this->n_threads != 0 ? this->n_threads : std::max(1u, std::thread::hardware_concurrency());
+    threads        = std::min(threads, std::max<size_t>(n / 16, 1));
+    if (threads <= 1)
+    {
+        body(0, 0, n);
+        return;
+    }
+
+    std::vector<std::thread> workers;
+    size_t chunk = (n + threads - 1) / threads;
+    for (size_t worker = 1; worker < threads; worker++)
+        workers.emplace_back(body, worker, std::min(n, worker * chunk), std::min(n, (worker + 1) * chunk));
+    body(0, 0, std::min(n, chunk));
+    for (auto &worker : workers)
+        worker.join();
+}
+
 /* now the evolutionary functions itself */
-genome pool::crossover(const genome &g1, const genome &g2)
+genome pool::crossover(const genome &g1, const genome &g2, std::mt19937 &rng)
 {
     // Make sure g1 has the higher fitness, so we will include only disjoint/excess
     // genes from the first genome.
     if (g2.fitness > g1.fitness)
-        return crossover(g2, g1);
+        return crossover(g2, g1, rng);
     genome child(this->network_info, this->mutation_rates);
-
-    auto it1 = g1.genes.begin();
+    child.genes.reserve(g1.genes.size());
 
     // coin flip random number distributor
     std::uniform_int_distribution<int> coin_flip(1, 2);
 
-    for (; it1 != g1.genes.end(); it1++)
+    // both are sorted by innovation, so matching genes are found in one walk
+    auto it2 = g2.genes.begin();
+    for (auto it1 = g1.genes.begin(); it1 != g1.genes.end(); it1++)
     {
         // if innovation marks match, do the crossover, else include from the first
         // genome because its fitness is not smaller than the second's
-
-        auto it2 = g2.genes.find((*it1).second.innovation_num);
-        if (it2 != g2.genes.end())
+        while (it2 != g2.genes.end() && (*it2).innovation_num < (*it1).innovation_num)
+            it2++;
+        if (it2 != g2.genes.end() && (*it2).innovation_num == (*it1).innovation_num)
         {
             // do the coin flip
-            int coin = coin_flip(this->generator);
+            int coin = coin_flip(rng);
 
             // now, after flipping the coin, we do the crossover.
 #ifdef INCLUDE_ENABLED_GENES_IF_POSSIBLE
             if (coin == 2 && (*it2).enabled)
-                child.genes[(*it1).second.innovation_num] = (*it2).second;
+                child.genes.push_back(*it2);
             else
-                child.genes[(*it1).second.innovation_num] = (*it1).second;
+                child.genes.push_back(*it1);
 #else
             if (coin == 2)
-                child.genes[(*it1).second.innovation_num] = (*it2).second;
+                child.genes.push_back(*it2);
             else
-                child.genes[(*it1).second.innovation_num] = (*it1).second;
+                child.genes.push_back(*it1);
 
 #endif
         }
         else
             // as said before, we include the disjoint gene
             // from the first (with larger fitness) otherwise
-            child.genes[(*it1).second.innovation_num] = (*it1).second;
+            child.genes.push_back(*it1);
     }
 
     child.max_neuron = std::max(g1.max_neuron, g2.max_neuron);
@@ -50,38 +114,40 @@ genome pool::crossover(const genome &g1, const genome &g2)
 }
 
 /* mutations */
-void pool::mutate_weight(genome &g)
+void pool::mutate_weight(genome &g, std::mt19937 &rng)
 {
     double step = this->mutation_rates.step_size;
     std::uniform_real_distribution<double> real_distributor(0.0, 1.0);
 
-    for (auto it = g.genes.begin(); it != g.genes.end(); it++)
+    for (auto &gene : g.genes)
     {
-        if (real_distributor(this->generator) < this->mutation_rates.perturb_chance)
-            (*it).second.weight += real_distributor(this->generator) * step * 2.0 - step;
+        if (real_distributor(rng) < this->mutation_rates.perturb_chance)
+            gene.weight += real_distributor(rng) * step * 2.0 - step;
         else
-            (*it).second.weight = real_distributor(this->generator) * 4.0 - 2.0;
+            gene.weight = real_distributor(rng) * 4.0 - 2.0;
     }
 }
 
-void pool::mutate_enable_disable(genome &g, bool enable)
+void pool::mutate_enable_disable(genome &g, bool enable, std::mt19937 &rng)
 {
-    // that shit is safe because there's no changings in map
-    // during this function
-    std::vector<gene *> v;
-
-    for (auto it = g.genes.begin(); it != g.genes.end(); it++)
-        if ((*it).second.enabled != enable)
-            v.push_back(&((*it).second));
+    // count the candidates, then walk again to the chosen one
+    auto candidate = [enable](const gene &gene) { return gene.enabled != enable; };
+    auto count     = std::count_if(g.genes.begin(), g.genes.end(), candidate);
 
-    if (v.size() == 0)
+    if (count == 0)
         return;
 
-    std::uniform_int_distribution<int> distributor(0, static_cast<int>(v.size() - 1));
-    v[distributor(this->generator)]->enabled = enable;
+    std::uniform_int_distribution<int> distributor(0, static_cast<int>(count - 1));
+    int chosen = distributor(rng);
+    for (auto &gene : g.genes)
+        if (candidate(gene) && chosen-- == 0)
+        {
+            gene.enabled = enable;
+            break;
+        }
 }
 
-void pool::mutate_link(genome &g, bool force_bias)
+void pool::mutate_link(genome &g, bool force_bias, std::mt19937 &rng, breeding_scratch &scratch)
 {
     /* network encoding:
      * | input nodes | bias | output nodes |
@@ -93,10 +159,10 @@ void pool::mutate_link(genome &g, bool force_bias)
     auto is_bias = [&](unsigned int node) -> bool { return node < (this->network_info.input_size + this->network_info.bias_size) && node >= this->network_info.input_size; };
 
     std::uniform_int_distribution<unsigned int> distributor1(0, g.max_neuron - 1);
-    unsigned int neuron1 = distributor1(this->generator);
+    unsigned int neuron1 = distributor1(rng);
 
     std::uniform_int_distribution<unsigned int> distributor2(this->network_info.input_size + this->network_info.bias_size, g.max_neuron - 1);
-    unsigned int neuron2 = distributor2(this->generator);
+    unsigned int neuron2 = distributor2(rng);
 
     if (is_output(neuron1) && is_output(neuron2))
         return;
@@ -110,7 +176,7 @@ void pool::mutate_link(genome &g, bool force_bias)
     if (force_bias)
     {
         std::uniform_int_distribution<unsigned int> bias_choose(this->network_info.input_size, this->network_info.input_size + this->network_info.output_size - 1);
-        neuron1 = bias_choose(this->generator);
+        neuron1 = bias_choose(rng);
     }
 
     if (!g.network_info.recurrent)
@@ -121,25 +187,32 @@ void pool::mutate_link(genome &g, bool force_bias)
             has_recurrence = false;
         else
         {
-            std::queue<unsigned int> que;
-            std::vector<std::vector<unsigned int>> connections(g.max_neuron);
-            for (auto it = g.genes.begin(); it != g.genes.end(); it++)
-                connections[(*it).second.from_node].push_back((*it).second.to_node);
+            auto &connections = scratch.connections;
+            if (connections.size() < g.max_neuron)
+                connections.resize(g.max_neuron);
+            for (unsigned int i = 0; i < g.max_neuron; i++)
+                connections[i].clear();
+            for (auto &gene : g.genes)
+                connections[gene.from_node].push_back(gene.to_node);
             connections[neuron1].push_back(neuron2);
 
-            for (size_t i = 0; i < connections[neuron1].size(); i++)
-                que.push(connections[neuron1][i]);
-            while (!que.empty())
+            // a node already queued can't lead anywhere new, which keeps the search linear
+            auto &que     = scratch.frontier;
+            auto &visited = scratch.visited;
+            que.assign(connections[neuron1].begin(), connections[neuron1].end());
+            visited.assign(g.max_neuron, false);
+            for (size_t head = 0; head < que.size(); head++)
             {
-                unsigned int tmp = que.front();
+                unsigned int tmp = que[head];
                 if (tmp == neuron1)
                 {
                     has_recurrence = true;
                     break;
                 }
-                que.pop();
-                for (size_t i = 0; i < connections[tmp].size(); i++)
-                    que.push(connections[tmp][i]);
+                if (visited[tmp])
+                    continue;
+                visited[tmp] = true;
+                que.insert(que.end(), connections[tmp].begin(), connections[tmp].end());
             }
         }
         if (has_recurrence)
@@ -154,21 +227,19 @@ void pool::mutate_link(genome &g, bool force_bias)
     new_gene.to_node   = neuron2;
 
     // if genome already has this connection
-    for (auto it = g.genes.begin(); it != g.genes.end(); it++)
-        if ((*it).second.from_node == neuron1 && (*it).second.to_node == neuron2)
+    for (auto &gene : g.genes)
+        if (gene.from_node == neuron1 && gene.to_node == neuron2)
             return;
 
-    // add new innovation if needed
-    new_gene.innovation_num = this->innovation.add_gene(new_gene);
-
     // mutate new link
     std::uniform_real_distribution<double> weight_generator(0.0, 1.0);
-    new_gene.weight = weight_generator(this->generator) * 4.0 - 2.0;
+    new_gene.weight = weight_generator(rng) * 4.0 - 2.0;
 
-    g.genes[new_gene.innovation_num] = new_gene;
+    // numbered once every child of the generation has been bred
+    this->add_pending_gene(g, new_gene);
 }
 
-void pool::mutate_node(genome &g)
+void pool::mutate_node(genome &g, std::mt19937 &rng)
 {
     if (g.genes.size() == 0)
         return;
@@ -177,138 +248,151 @@ void pool::mutate_node(genome &g)
 
     // randomly choose a gene to mutate
     std::uniform_int_distribution<unsigned int> distributor(0, static_cast<int>(g.genes.size() - 1));
-    unsigned int gene_id = distributor(this->generator);
-    auto it              = g.genes.begin();
-    std::advance(it, gene_id);
+    unsigned int gene_id = distributor(rng);
 
-    if ((*it).second.enabled == false)
+    if (g.genes[gene_id].enabled == false)
         return;
 
-    (*it).second.enabled = false;
+    g.genes[gene_id].enabled = false;
 
     gene new_gene1;
-    new_gene1.from_node      = (*it).second.from_node;
-    new_gene1.to_node        = g.max_neuron - 1; // to the last created neuron
-    new_gene1.weight         = 1.0;
-    new_gene1.innovation_num = this->innovation.add_gene(new_gene1);
-    new_gene1.enabled        = true;
+    new_gene1.from_node = g.genes[gene_id].from_node;
+    new_gene1.to_node   = g.max_neuron - 1; // to the last created neuron
+    new_gene1.weight    = 1.0;
+    new_gene1.enabled   = true;
 
     gene new_gene2;
-    new_gene2.from_node      = g.max_neuron - 1; // from the last created neuron
-    new_gene2.to_node        = (*it).second.to_node;
-    new_gene2.weight         = (*it).second.weight;
-    new_gene2.innovation_num = this->innovation.add_gene(new_gene2);
-    new_gene2.enabled        = true;
+    new_gene2.from_node = g.max_neuron - 1; // from the last created neuron
+    new_gene2.to_node   = g.genes[gene_id].to_node;
+    new_gene2.weight    = g.genes[gene_id].weight;
+    new_gene2.enabled   = true;
 
-    g.genes[new_gene1.innovation_num] = new_gene1;
-    g.genes[new_gene2.innovation_num] = new_gene2;
+    this->add_pending_gene(g, new_gene1);
+    this->add_pending_gene(g, new_gene2);
 }
 
-void pool::mutate(genome &g)
+void pool::mutate(genome &g, std::mt19937 &rng, breeding_scratch &scratch)
 {
     double coefficient[2] = {0.95, 1.05263};
 
     std::uniform_int_distribution<int> coin_flip(0, 1);
 
-    g.mutation_rates.enable_mutation_chance *= coefficient[coin_flip(this->generator)];
-    g.mutation_rates.disable_mutation_chance *= coefficient[coin_flip(this->generator)];
-    g.mutation_rates.connection_mutate_chance *= coefficient[coin_flip(this->generator)];
-    g.mutation_rates.node_mutation_chance *= coefficient[coin_flip(this->generator)];
-    g.mutation_rates.link_mutation_chance *= coefficient[coin_flip(this->generator)];
-    g.mutation_rates.bias_mutation_chance *= coefficient[coin_flip(this->generator)];
-    g.mutation_rates.crossover_chance *= coefficient[coin_flip(this->generator)];
-    g.mutation_rates.perturb_chance *= coefficient[coin_flip(this->generator)];
+    g.mutation_rates.enable_mutation_chance *= coefficient[coin_flip(rng)];
+    g.mutation_rates.disable_mutation_chance *= coefficient[coin_flip(rng)];
+    g.mutation_rates.connection_mutate_chance *= coefficient[coin_flip(rng)];
+    g.mutation_rates.node_mutation_chance *= coefficient[coin_flip(rng)];
+    g.mutation_rates.link_mutation_chance *= coefficient[coin_flip(rng)];
+    g.mutation_rates.bias_mutation_chance *= coefficient[coin_flip(rng)];
+    g.mutation_rates.crossover_chance *= coefficient[coin_flip(rng)];
+    g.mutation_rates.perturb_chance *= coefficient[coin_flip(rng)];
 
     std::uniform_real_distribution<double> mutate_or_not_mutate(0.0, 1.0);
 
-    if (mutate_or_not_mutate(this->generator) < g.mutation_rates.connection_mutate_chance)
-        this->mutate_weight(g);
+    if (mutate_or_not_mutate(rng) < g.mutation_rates.connection_mutate_chance)
+        this->mutate_weight(g, rng);
 
     double p;
 
     p = g.mutation_rates.link_mutation_chance;
     while (p > 0.0)
     {
-        if (mutate_or_not_mutate(this->generator) < p)
-            this->mutate_link(g, false);
+        if (mutate_or_not_mutate(rng) < p)
+            this->mutate_link(g, false, rng, scratch);
         p = p - 1.0;
     }
 
     p = g.mutation_rates.bias_mutation_chance;
     while (p > 0.0)
     {
-        if (mutate_or_not_mutate(this->generator) < p)
-            this->mutate_link(g, true);
+        if (mutate_or_not_mutate(rng) < p)
+            this->mutate_link(g, true, rng, scratch);
         p = p - 1.0;
     }
 
     p = g.mutation_rates.node_mutation_chance;
     while (p > 0.0)
     {
-        if (mutate_or_not_mutate(this->generator) < p)
-            this->mutate_node(g);
+        if (mutate_or_not_mutate(rng) < p)
+            this->mutate_node(g, rng);
         p = p - 1.0;
     }
 
     p = g.mutation_rates.enable_mutation_chance;
-    ;
     while (p > 0.0)
     {
-        if (mutate_or_not_mutate(this->generator) < p)
-            this->mutate_enable_disable(g, true);
+        if (mutate_or_not_mutate(rng) < p)
+            this->mutate_enable_disable(g, true, rng);
         p = p - 1.0;
     }
 
     p = g.mutation_rates.disable_mutation_chance;
     while (p > 0.0)
     {
-        if (mutate_or_not_mutate(this->generator) < p)
-            this->mutate_enable_disable(g, false);
+        if (mutate_or_not_mutate(rng) < p)
+            this->mutate_enable_disable(g, false, rng);
         p = p - 1.0;
     }
 }
 
-double pool::disjoint(const genome &g1, const genome &g2)
+/* pending numbers sort after every real one, in the order the genes were added */
+void pool::add_pending_gene(genome &g, gene &new_gene)
 {
-    auto it1 = g1.genes.begin();
-    auto it2 = g2.genes.begin();
+    auto first_pending = std::lower_bound(g.genes.begin(), g.genes.end(), PENDING_INNOVATION, [](const gene &a, unsigned int num) { return a.innovation_num < num; });
+    new_gene.innovation_num = PENDING_INNOVATION + static_cast<unsigned int>(g.genes.end() - first_pending);
+    g.genes.push_back(new_gene);
+}
 
-    unsigned int disjoint_count = 0;
-    for (; it1 != g1.genes.end(); it1++)
-        if (g2.genes.find((*it1).second.innovation_num) == g2.genes.end())
-            disjoint_count++;
+/* hands out innovation numbers to a child's new genes, called for each child in turn so the numbering never depends on threads */
+void pool::resolve_innovations(genome &g)
+{
+    auto first_pending = std::lower_bound(g.genes.begin(), g.genes.end(), PENDING_INNOVATION, [](const gene &a, unsigned int num) { return a.innovation_num < num; });
+    if (first_pending == g.genes.end())
+        return;
 
-    for (; it2 != g2.genes.end(); it2++)
-        if (g1.genes.find((*it2).second.innovation_num) == g1.genes.end())
-            disjoint_count++;
+    for (auto it = first_pending; it != g.genes.end(); it++)
+        (*it).innovation_num = this->innovation.add_gene(*it);
 
-    return (1. * disjoint_count) / (1. * std::max(g1.genes.size(), g2.genes.size()));
+    // a number seen earlier in the generation sorts before the child's older genes, and a repeated one keeps its last gene
+    std::stable_sort(g.genes.begin(), g.genes.end(), [](const gene &a, const gene &b) { return a.innovation_num < b.innovation_num; });
+    size_t kept = 0;
+    for (size_t i = 0; i < g.genes.size(); i++)
+    {
+        if (kept > 0 && g.genes[kept - 1].innovation_num == g.genes[i].innovation_num)
+            g.genes[kept - 1] = g.genes[i];
+        else
+            g.genes[kept++] = g.genes[i];
+    }
+    g.genes.resize(kept);
 }
 
-double pool::weights(const genome &g1, const genome &g2)
+bool pool::is_same_species(const genome &g1, const genome &g2)
 {
-    auto it1 = g1.genes.begin();
-
-    double sum              = 0.0;
-    unsigned int coincident = 0;
+    unsigned int disjoint_count = 0;
+    unsigned int coincident     = 0;
+    double sum                  = 0.0;
 
-    for (; it1 != g1.genes.end(); it1++)
+    auto it1 = g1.genes.begin();
+    auto it2 = g2.genes.begin();
+    while (it1 != g1.genes.end() && it2 != g2.genes.end())
     {
-        auto it2 = g2.genes.find((*it1).second.innovation_num);
-        if (it2 != g2.genes.end())
+        if ((*it1).innovation_num < (*it2).innovation_num)
+            disjoint_count++, it1++;
+        else if ((*it2).innovation_num < (*it1).innovation_num)
+            disjoint_count++, it2++;
+        else
         {
             coincident++;
-            sum += std::abs((*it1).second.weight - (*it2).second.weight);
+            sum += std::abs((*it1).weight - (*it2).weight);
+            it1++, it2++;
         }
     }
+    disjoint_count += static_cast<unsigned int>((g1.genes.end() - it1) + (g2.genes.end() - it2));
 
-    return 1. * sum / (1. * coincident);
-}
+    double disjoint = (1. * disjoint_count) / (1. * std::max(g1.genes.size(), g2.genes.size()));
+    double weights  = 1. * sum / (1. * coincident);
 
-bool pool::is_same_species(const genome &g1, const genome &g2)
-{
-    double dd = this->speciating_parameters.delta_disjoint * disjoint(g1, g2);
-    double dw = this->speciating_parameters.delta_weights * weights(g1, g2);
+    double dd = this->speciating_parameters.delta_disjoint * disjoint;
+    double dw = this->speciating_parameters.delta_weights * weights;
     return dd + dw < this->speciating_parameters.delta_threshold;
 }
 
@@ -357,30 +441,45 @@ void pool::cull_species(bool cut_to_one)
     }
 }
 
-genome pool::breed_child(specie &s)
+genome pool::breed_child(specie &s, std::mt19937 &rng, breeding_scratch &scratch)
 {
     genome child(this->network_info, this->mutation_rates);
     std::uniform_real_distribution<double> distributor(0.0, 1.0);
     std::uniform_int_distribution<unsigned int> choose_genome(0, static_cast<unsigned int>(s.genomes.size() - 1));
-    if (distributor(this->generator) < this->mutation_rates.crossover_chance)
+    if (distributor(rng) < this->mutation_rates.crossover_chance)
     {
         unsigned int g1id, g2id;
-        genome &g1 = s.genomes[g1id = choose_genome(this->generator)];
-        genome &g2 = s.genomes[g2id = choose_genome(this->generator)];
+        genome &g1 = s.genomes[g1id = choose_genome(rng)];
+        genome &g2 = s.genomes[g2id = choose_genome(rng)];
 
         // QUESTION: if g1 == g2, then you can make a baby by fapping?
-        child = this->crossover(g1, g2);
+        child = this->crossover(g1, g2, rng);
     }
     else
     {
-        genome &g = s.genomes[choose_genome(this->generator)];
+        genome &g = s.genomes[choose_genome(rng)];
         child     = g;
     }
 
-    this->mutate(child);
+    this->mutate(child, rng, scratch);
     return child;
 }
 
+/* breeds a child from each parent specie onto the end of children, in parallel. Only reads the species, so nothing else may touch them meanwhile */
+void pool::breed_children(const std::vector<specie *> &parents, std::vector<genome> &children)
+{
+    size_t first_child = children.size();
+    children.resize(first_child + parents.size(), genome(this->network_info, this->mutation_rates));
+    this->parallel_for(parents.size(), [&](size_t, size_t begin, size_t end) {
+        breeding_scratch scratch;
+        for (size_t i = begin; i < end; i++)
+        {
+            std::mt19937 rng          = this->child_generator(this->generation_number, first_child + i);
+            children[first_child + i] = this->breed_child(*parents[i], rng, scratch);
+        }
+    });
+}
+
 void pool::remove_stale_species()
 {
     auto s = this->species.begin();
@@ -417,24 +516,53 @@ void pool::remove_weak_species()
     }
 }
 
-void pool::add_to_species(genome &child)
+/* same result as placing the children one by one: each joins the first specie whose representative it matches. The existing
+ * species are compared against in parallel, only the children founding or joining new species are placed in turn */
+void pool::add_to_species(std::vector<genome> &children)
 {
-    auto s = this->species.begin();
-    while (s != this->species.end())
+    std::vector<specie *> existing;
+    for (auto s = this->species.begin(); s != this->species.end(); s++)
+        existing.push_back(&(*s));
+
+    std::vector<size_t> match(children.size(), existing.size());
+    this->parallel_for(children.size(), [&](size_t, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+            for (size_t j = 0; j < existing.size(); j++)
+                if (this->is_same_species(children[i], existing[j]->genomes[0]))
+                {
+                    match[i] = j;
+                    break;
+                }
+    });
+
+    auto first_new = this->species.end();
+    for (size_t i = 0; i < children.size(); i++)
     {
-        if (this->is_same_species(child, (*s).genomes[0]))
+        if (match[i] < existing.size())
         {
-            (*s).genomes.push_back(child);
-            break;
+            existing[match[i]]->genomes.push_back(children[i]);
+            continue;
         }
-        ++s;
-    }
 
-    if (s == this->species.end())
-    {
-        specie new_specie;
-        new_specie.genomes.push_back(child);
-        this->species.push_back(new_specie);
+        auto s = first_new;
+        while (s != this->species.end())
+        {
+            if (this->is_same_species(children[i], (*s).genomes[0]))
+            {
+                (*s).genomes.push_back(children[i]);
+                break;
+            }
+            ++s;
+        }
+
+        if (s == this->species.end())
+        {
+            specie new_specie;
+            new_specie.genomes.push_back(children[i]);
+            this->species.push_back(new_specie);
+            if (first_new == this->species.end())
+                first_new = std::prev(this->species.end());
+        }
     }
 }
 
@@ -450,13 +578,15 @@ void pool::new_generation()
     this->remove_weak_species();
 
     std::vector<genome> children;
+    std::vector<specie *> parents;
     unsigned int sum = this->total_average_fitness();
     for (auto s = this->species.begin(); s != this->species.end(); s++)
     {
         unsigned int breed = static_cast<unsigned int>(std::floor(((1. * (*s).average_fitness) / (1. * sum)) * 1. * this->speciating_parameters.population) - 1);
         for (unsigned int i = 0; i < breed; i++)
-            children.push_back(this->breed_child(*s));
+            parents.push_back(&(*s));
     }
+    this->breed_children(parents, children);
 
     this->cull_species(true); // now in each species we have only one genome
 
@@ -465,17 +595,127 @@ void pool::new_generation()
     std::vector<specie *> species_pointer(0);
     for (auto s = this->species.begin(); s != this->species.end(); s++)
         species_pointer.push_back(&(*s));
+    parents.clear();
     if (this->species.size() == 0)
         std::cerr << "Wtf? Zero species in the world! All dead? Where is that fucking NOAH and his fucking boat?\n";
     else
-        while (children.size() + this->species.size() < this->speciating_parameters.population)
-            children.push_back(this->breed_child(*species_pointer[choose_specie(this->generator)]));
+        while (children.size() + parents.size() + this->species.size() < this->speciating_parameters.population)
+            parents.push_back(species_pointer[choose_specie(this->generator)]);
+    this->breed_children(parents, children);
 
-    for (size_t i = 0; i < children.size(); i++)
-        this->add_to_species(children[i]);
+    for (auto &child : children)
+        this->resolve_innovations(child);
+    this->add_to_species(children);
     this->generation_number++;
 }
 
+std::vector<genome> pool::take_genomes()
+{
+    std::vector<genome> genomes;
+    for (auto &s : this->species)
+        for (auto &g : s.genomes)
+            genomes.push_back(std::move(g));
+    this->species.clear();
+    return genomes;
+}
+
+bool pool::add_evaluated(const genome &g)
+{
+    auto s = this->species.begin();
+    while (s != this->species.end() && !this->is_same_species(g, (*s).genomes[0]))
+        s++;
+    if (s == this->species.end())
+    {
+        this->species.push_back(specie());
+        s = std::prev(this->species.end());
+    }
+    (*s).genomes.push_back(g);
+    if (g.fitness > (*s).top_fitness)
+    {
+        (*s).top_fitness = g.fitness;
+        (*s).staleness   = 0;
+    }
+    this->max_fitness = std::max(this->max_fitness, g.fitness);
+
+    // sharing the fitness over the specie keeps a big specie from crowding the small ones out
+    size_t population = 0;
+    for (auto &sp : this->species)
+        population += sp.genomes.size();
+    if (population > this->speciating_parameters.population)
+    {
+        auto weakest_specie = this->species.end();
+        size_t weakest      = 0;
+        double lowest       = 0.0;
+        for (auto sp = this->species.begin(); sp != this->species.end(); sp++)
+            for (size_t i = 0; i < (*sp).genomes.size(); i++)
+            {
+                double shared = (*sp).genomes[i].fitness / (1. * (*sp).genomes.size());
+                if (weakest_specie == this->species.end() || shared < lowest)
+                    weakest_specie = sp, weakest = i, lowest = shared;
+            }
+        (*weakest_specie).genomes.erase((*weakest_specie).genomes.begin() + weakest);
+        if ((*weakest_specie).genomes.empty())
+            this->species.erase(weakest_specie);
+    }
+
+    if (++this->steady_state_evaluations < this->speciating_parameters.population)
+        return false;
+    // a generation's worth of new structure has been numbered, start matching mutations afresh as new_generation does
+    this->innovation.reset();
+    this->steady_state_evaluations = 0;
+    this->steady_state_children    = 0;
+    this->generation_number++;
+    return true;
+}
+
+const genome &pool::tournament_select(const specie &s, std::mt19937 &rng)
+{
+    std::uniform_int_distribution<size_t> choose_genome(0, s.genomes.size() - 1);
+    const genome *best = &s.genomes[choose_genome(rng)];
+    for (unsigned int i = 1; i < STEADY_STATE_TOURNAMENT_SIZE; i++)
+    {
+        const genome &g = s.genomes[choose_genome(rng)];
+        if (g.fitness > best->fitness)
+            best = &g;
+    }
+    return *best;
+}
+
+genome pool::breed_steady_state()
+{
+    std::mt19937 rng = this->child_generator(this->generation_number, this->steady_state_children++);
+    genome child(this->network_info, this->mutation_rates);
+
+    std::vector<const specie *> parents;
+    std::vector<double> weights;
+    for (auto &s : this->species)
+    {
+        double total = 0.0;
+        for (auto &g : s.genomes)
+            total += g.fitness;
+        parents.push_back(&s);
+        // every specie keeps a chance, or a pool that hasn't scored yet could never breed
+        weights.push_back(1.0 + total / s.genomes.size());
+    }
+
+    if (!parents.empty())
+    {
+        const specie &s = *parents[std::discrete_distribution<size_t>(weights.begin(), weights.end())(rng)];
+        std::uniform_real_distribution<double> distributor(0.0, 1.0);
+        if (distributor(rng) < this->mutation_rates.crossover_chance)
+            child = this->crossover(this->tournament_select(s, rng), this->tournament_select(s, rng), rng);
+        else
+            child = this->tournament_select(s, rng);
+    }
+
+    this->mutate(child, rng, this->steady_state_scratch);
+    this->resolve_innovations(child);
+    child.fitness          = 0;
+    child.adjusted_fitness = 0;
+    child.global_rank      = 0;
+    return child;
+}
+
 void pool::import_fromfile(std::string filename)
 {
     std::ifstream input;
@@ -551,7 +791,7 @@ void pool::import_fromfile(std::string filename)
                     input >> new_gene.to_node;
                     input >> new_gene.weight;
                     input >> new_gene.enabled;
-                    new_genome.genes[new_gene.innovation_num] = new_gene;
+                    new_genome.set_gene(new_gene);
                 }
 
                 new_specie.genomes.push_back(new_genome);
@@ -620,9 +860,8 @@ void pool::export_tofile(std::string filename)
             (*s).genomes[i].mutation_rates.write(output, "      ");
 
             output << "      " << (*s).genomes[i].max_neuron << " " << (*s).genomes[i].genes.size() << std::endl;
-            for (auto it = (*s).genomes[i].genes.begin(); it != (*s).genomes[i].genes.end(); it++)
+            for (auto &g : (*s).genomes[i].genes)
             {
-                gene &g = (*it).second;
                 output << "         ";
                 output << g.innovation_num << " " << g.from_node << " " << g.to_node << " " << g.weight << " " << g.enabled << std::endl;
             }
@@ -633,6 +872,335 @@ void pool::export_tofile(std::string filename)
     output.close();
 }
 
+namespace
+{
+    /* little endian whatever the host, integers either fixed width or LEB128 varints */
+    class checkpoint_writer
+    {
+    public:
+        checkpoint_writer(std::ostream &o, bool packed) : o(o), packed(packed)
+        {
+        }
+
+        void u32(uint32_t value)
+        {
+            if (packed)
+            {
+                do
+                {
+                    uint8_t byte = value & 0x7f;
+                    value >>= 7;
+                    o.put(static_cast<char>(value ? byte | 0x80 : byte));
+                } while (value);
+            }
+            else
+                raw(value, 4);
+        }
+
+        void f64(double value)
+        {
+            uint64_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            raw(bits, 8);
+        }
+
+        void str(const std::string &value)
+        {
+            u32(static_cast<uint32_t>(value.size()));
+            o.write(value.data(), value.size());
+        }
+
+        void raw(uint64_t value, int bytes)
+        {
+            for (int i = 0; i < bytes; i++)
+                o.put(static_cast<char>((value >> (8 * i)) & 0xff));
+        }
+
+    private:
+        std::ostream &o;
+        bool packed;
+    };
+
+    class checkpoint_reader
+    {
+    public:
+        explicit checkpoint_reader(std::istream &i) : i(i)
+        {
+        }
+
+        uint32_t u32()
+        {
+            if (!packed)
+                return static_cast<uint32_t>(raw(4));
+            uint32_t value = 0;
+            for (int shift = 0; shift < 35 && i; shift += 7)
+            {
+                uint8_t byte = static_cast<uint8_t>(i.get());
+                value |= static_cast<uint32_t>(byte & 0x7f) << shift;
+                if (!(byte & 0x80))
+                    break;
+            }
+            return value;
+        }
+
+        double f64()
+        {
+            uint64_t bits = raw(8);
+            double value;
+            std::memcpy(&value, &bits, sizeof(value));
+            return value;
+        }
+
+        std::string str()
+        {
+            uint32_t size = u32();
+            if (!i || size > (1u << 24))
+            {
+                i.setstate(std::ios::failbit);
+                return std::string();
+            }
+            std::string value(size, '\0');
+            i.read(&value[0], size);
+            return value;
+        }
+
+        uint64_t raw(int bytes)
+        {
+            uint64_t value = 0;
+            for (int b = 0; b < bytes; b++)
+                value |= static_cast<uint64_t>(static_cast<uint8_t>(i.get())) << (8 * b);
+            return value;
+        }
+
+        bool good() const
+        {
+            return !i.fail();
+        }
+
+        bool packed = false;
+
+    private:
+        std::istream &i;
+    };
+
+    void write_rates(checkpoint_writer &w, const mutation_rate_container &rates)
+    {
+        w.f64(rates.connection_mutate_chance);
+        w.f64(rates.perturb_chance);
+        w.f64(rates.crossover_chance);
+        w.f64(rates.link_mutation_chance);
+        w.f64(rates.node_mutation_chance);
+        w.f64(rates.bias_mutation_chance);
+        w.f64(rates.step_size);
+        w.f64(rates.disable_mutation_chance);
+        w.f64(rates.enable_mutation_chance);
+    }
+
+    void read_rates(checkpoint_reader &r, mutation_rate_container &rates)
+    {
+        rates.connection_mutate_chance = r.f64();
+        rates.perturb_chance           = r.f64();
+        rates.crossover_chance         = r.f64();
+        rates.link_mutation_chance     = r.f64();
+        rates.node_mutation_chance     = r.f64();
+        rates.bias_mutation_chance     = r.f64();
+        rates.step_size                = r.f64();
+        rates.disable_mutation_chance  = r.f64();
+        rates.enable_mutation_chance   = r.f64();
+    }
+
+    void write_genome(checkpoint_writer &w, const genome &g)
+    {
+        w.u32(g.fitness);
+        w.u32(g.adjusted_fitness);
+        w.u32(g.global_rank);
+        w.u32(g.max_neuron);
+        w.u32(g.can_be_recurrent);
+        write_rates(w, g.mutation_rates);
+
+        // genes are sorted, so innovation numbers are stored as the (small) step from the previous one
+        w.u32(static_cast<uint32_t>(g.genes.size()));
+        unsigned int previous_innovation = 0;
+        for (auto &gene : g.genes)
+        {
+            w.u32(gene.innovation_num - previous_innovation);
+            w.u32(gene.from_node);
+            w.u32(gene.to_node);
+            w.f64(gene.weight);
+            w.u32(gene.enabled);
+            previous_innovation = gene.innovation_num;
+        }
+    }
+
+    bool read_genome(checkpoint_reader &r, genome &g)
+    {
+        g.fitness          = r.u32();
+        g.adjusted_fitness = r.u32();
+        g.global_rank      = r.u32();
+        g.max_neuron       = r.u32();
+        g.can_be_recurrent = r.u32();
+        read_rates(r, g.mutation_rates);
+
+        unsigned int gene_number = r.u32();
+        if (!r.good() || gene_number > (1u << 24))
+            return false;
+        g.genes.resize(gene_number);
+        unsigned int previous_innovation = 0;
+        for (auto &new_gene : g.genes)
+        {
+            new_gene.innovation_num = previous_innovation + r.u32();
+            new_gene.from_node      = r.u32();
+            new_gene.to_node        = r.u32();
+            new_gene.weight         = r.f64();
+            new_gene.enabled        = r.u32() != 0;
+            previous_innovation     = new_gene.innovation_num;
+        }
+        return r.good();
+    }
+} // namespace
+
+void export_genome(std::ostream &o, const genome &g)
+{
+    checkpoint_writer w(o, true);
+    w.u32(g.network_info.input_size);
+    w.u32(g.network_info.output_size);
+    w.u32(g.network_info.bias_size);
+    w.u32(g.network_info.recurrent);
+    write_genome(w, g);
+}
+
+bool import_genome(std::istream &i, genome &g)
+{
+    checkpoint_reader r(i);
+    r.packed                        = true;
+    g.network_info.input_size       = r.u32();
+    g.network_info.output_size      = r.u32();
+    g.network_info.bias_size        = r.u32();
+    g.network_info.recurrent        = r.u32() != 0;
+    g.network_info.functional_nodes = g.network_info.input_size + g.network_info.output_size + g.network_info.bias_size;
+    return read_genome(r, g);
+}
+
+void pool::export_checkpoint(std::ostream &o, bool packed)
+{
+    checkpoint_writer header(o, false);
+    header.u32(POOL_CHECKPOINT_MAGIC);
+    header.u32(POOL_CHECKPOINT_VERSION);
+    header.u32(packed ? 1 : 0);
+
+    checkpoint_writer w(o, packed);
+
+    // current state
+    w.u32(this->innovation.number());
+    w.u32(this->generation_number);
+    w.u32(this->max_fitness);
+    w.u32(this->seed_value);
+    std::ostringstream generator_state;
+    generator_state << this->generator;
+    w.str(generator_state.str());
+
+    // network information
+    w.u32(this->network_info.input_size);
+    w.u32(this->network_info.output_size);
+    w.u32(this->network_info.bias_size);
+    w.u32(this->network_info.recurrent);
+
+    // population information
+    w.u32(this->speciating_parameters.population);
+    w.f64(this->speciating_parameters.delta_disjoint);
+    w.f64(this->speciating_parameters.delta_weights);
+    w.f64(this->speciating_parameters.delta_threshold);
+    w.u32(this->speciating_parameters.stale_species);
+
+    // mutation parameters
+    write_rates(w, this->mutation_rates);
+
+    // species information
+    w.u32(static_cast<uint32_t>(this->species.size()));
+    for (auto &s : this->species)
+    {
+#ifdef GIVING_NAMES_FOR_SPECIES
+        w.str(s.name);
+#endif
+        w.u32(s.top_fitness);
+        w.u32(s.average_fitness);
+        w.u32(s.staleness);
+        w.u32(static_cast<uint32_t>(s.genomes.size()));
+        for (auto &g : s.genomes)
+            write_genome(w, g);
+    }
+}
+
+bool pool::import_checkpoint(std::istream &i)
+{
+    checkpoint_reader r(i);
+    if (r.u32() != POOL_CHECKPOINT_MAGIC || r.u32() != POOL_CHECKPOINT_VERSION)
+        return false;
+    r.packed = (r.u32() & 1) != 0;
+
+    // read into locals, the pool only changes once the whole checkpoint has been read
+    unsigned int innovation_num = r.u32();
+    unsigned int generation     = r.u32();
+    unsigned int fitness        = r.u32();
+    uint32_t seed               = r.u32();
+    std::istringstream generator_state(r.str());
+    std::mt19937 restored_generator;
+    generator_state >> restored_generator;
+
+    network_info_container info;
+    info.input_size       = r.u32();
+    info.output_size      = r.u32();
+    info.bias_size        = r.u32();
+    info.recurrent        = r.u32() != 0;
+    info.functional_nodes = info.input_size + info.output_size + info.bias_size;
+
+    speciating_parameter_container speciating;
+    speciating.population      = r.u32();
+    speciating.delta_disjoint  = r.f64();
+    speciating.delta_weights   = r.f64();
+    speciating.delta_threshold = r.f64();
+    speciating.stale_species   = r.u32();
+
+    mutation_rate_container rates;
+    read_rates(r, rates);
+
+    std::list<specie> restored_species;
+    unsigned int species_number = r.u32();
+    for (unsigned int c = 0; c < species_number && r.good(); c++)
+    {
+        specie new_specie;
+#ifdef GIVING_NAMES_FOR_SPECIES
+        new_specie.name = r.str();
+#endif
+        new_specie.top_fitness     = r.u32();
+        new_specie.average_fitness = r.u32();
+        new_specie.staleness       = r.u32();
+
+        unsigned int specie_population = r.u32();
+        for (unsigned int j = 0; j < specie_population && r.good(); j++)
+        {
+            genome new_genome(info, rates);
+            if (!read_genome(r, new_genome))
+                return false;
+            new_specie.genomes.push_back(std::move(new_genome));
+        }
+        restored_species.push_back(std::move(new_specie));
+    }
+    if (!r.good() || generator_state.fail())
+        return false;
+
+    this->innovation.set_innovation_number(innovation_num);
+    this->generation_number     = generation;
+    this->max_fitness           = fitness;
+    this->seed_value            = seed;
+    this->generator             = restored_generator;
+    this->network_info          = info;
+    this->speciating_parameters = speciating;
+    this->mutation_rates        = rates;
+    this->species               = std::move(restored_species);
+    return true;
+}
+
 void mutation_rate_container::read(std::ifstream &o)
 {
     o >> this->connection_mutate_chance;
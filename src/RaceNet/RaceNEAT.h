@@ -10,6 +10,8 @@
 #include <algorithm>
 #include <list>
 #include <string>
+#include <cstdint>
+#include <functional>
 
 /* custom defines:
  * INCLUDE_ENABLED_GENES_IF_POSSIBLE  - if during experiment you found that too many genes are
@@ -67,6 +69,17 @@ typedef struct
     bool enabled                = true;
 } gene;
 
+/* binary checkpoints, see pool::export_checkpoint */
+static const uint32_t POOL_CHECKPOINT_MAGIC   = 0x4b50434e; // "NCPK"
+static const uint32_t POOL_CHECKPOINT_VERSION = 1;
+
+/* genes added by a mutation while breeding in parallel are numbered from here, in the order
+ * they were added, until the pool hands out their real innovation numbers afterwards */
+static const unsigned int PENDING_INNOVATION = 0x80000000u;
+
+/* genomes drawn from a specie for each steady state parent, the fittest of them breeds */
+static const unsigned int STEADY_STATE_TOURNAMENT_SIZE = 3;
+
 class genome
 {
 private:
@@ -82,7 +95,8 @@ public:
     mutation_rate_container mutation_rates;
     network_info_container network_info;
 
-    std::map<unsigned int, gene> genes;
+    /* sorted by innovation number, each number at most once */
+    std::vector<gene> genes;
 
     genome(network_info_container &info, mutation_rate_container &rates)
     {
@@ -92,8 +106,30 @@ public:
     }
 
     genome(const genome &) = default;
+
+    genome &operator=(const genome &) = default;
+
+    /* inserts g in innovation order, replacing any gene with the same number */
+    void set_gene(const gene &g)
+    {
+        if (genes.empty() || genes.back().innovation_num < g.innovation_num)
+        {
+            genes.push_back(g);
+            return;
+        }
+        auto it = std::lower_bound(genes.begin(), genes.end(), g.innovation_num, [](const gene &a, unsigned int num) { return a.innovation_num < num; });
+        if (it != genes.end() && (*it).innovation_num == g.innovation_num)
+            *it = g;
+        else
+            genes.insert(it, g);
+    }
 };
 
+/* a single genome in the packed checkpoint encoding, to hand genomes to another process */
+void export_genome(std::ostream &o, const genome &g);
+
+bool import_genome(std::istream &i, genome &g);
+
 /* a specie is group of genomes which differences is smaller than some threshold */
 typedef struct
 {
@@ -154,6 +190,14 @@ class pool
 private:
     pool(){};
 
+    /* reused by a breeding thread from one child to the next, so mutations don't allocate */
+    struct breeding_scratch
+    {
+        std::vector<std::vector<unsigned int>> connections;
+        std::vector<unsigned int> frontier;
+        std::vector<bool> visited;
+    };
+
     /* important part, only accecible for friend */
     innovation_container innovation;
 
@@ -162,23 +206,35 @@ private:
 
     unsigned int generation_number = 1;
 
-    /* evolutionary methods */
-    genome crossover(const genome &g1, const genome &g2);
+    /* seed every random stream is derived from */
+    uint32_t seed_value;
 
-    void mutate_weight(genome &g);
+    /* threads to breed and speciate with, 0 for one per core */
+    unsigned int n_threads = 0;
 
-    void mutate_enable_disable(genome &g, bool enable);
+    /* steady state progress through the current generation, which ends every population evaluations */
+    unsigned int steady_state_evaluations = 0;
+    size_t steady_state_children          = 0;
+    breeding_scratch steady_state_scratch;
 
-    void mutate_link(genome &g, bool force_bias);
+    /* evolutionary methods, each child mutates with a random stream of its own so children can be bred in any order */
+    genome crossover(const genome &g1, const genome &g2, std::mt19937 &rng);
 
-    void mutate_node(genome &g);
+    void mutate_weight(genome &g, std::mt19937 &rng);
 
-    void mutate(genome &g);
+    void mutate_enable_disable(genome &g, bool enable, std::mt19937 &rng);
 
-    double disjoint(const genome &g1, const genome &g2);
+    void mutate_link(genome &g, bool force_bias, std::mt19937 &rng, breeding_scratch &scratch);
 
-    double weights(const genome &g1, const genome &g2);
+    void mutate_node(genome &g, std::mt19937 &rng);
 
+    void mutate(genome &g, std::mt19937 &rng, breeding_scratch &scratch);
+
+    void add_pending_gene(genome &g, gene &new_gene);
+
+    void resolve_innovations(genome &g);
+
+    /* disjoint and weights from one walk over both gene lists */
     bool is_same_species(const genome &g1, const genome &g2);
 
     /* specie ranking */
@@ -191,13 +247,21 @@ private:
     /* evolution */
     void cull_species(bool cut_to_one);
 
-    genome breed_child(specie &s);
+    genome breed_child(specie &s, std::mt19937 &rng, breeding_scratch &scratch);
+
+    const genome &tournament_select(const specie &s, std::mt19937 &rng);
+
+    void breed_children(const std::vector<specie *> &parents, std::vector<genome> &children);
 
     void remove_stale_species();
 
     void remove_weak_species();
 
-    void add_to_species(genome &child);
+    void add_to_species(std::vector<genome> &children);
+
+    std::mt19937 child_generator(unsigned int generation, size_t child_idx);
+
+    void parallel_for(size_t n, const std::function<void(size_t worker, size_t begin, size_t end)> &body);
 
 public:
     /* pool parameters */
@@ -219,36 +283,42 @@ public:
     /* species */
     std::list<specie> species;
 
-    // constructor
-    pool(unsigned int input, unsigned int output, unsigned int bias = 1, bool rec = false)
-    {
-        this->network_info.input_size       = input;
-        this->network_info.output_size      = output;
-        this->network_info.bias_size        = bias;
-        this->network_info.functional_nodes = input + output + bias;
-        this->network_info.recurrent        = rec;
-
-        // seed the mersenne twister with
-        // a random number from our computer
-        generator.seed(rd());
-
-        // create a basic generation with default genomes
-        for (unsigned int i = 0; i < this->speciating_parameters.population; i++)
-        {
-            genome new_genome(this->network_info, this->mutation_rates);
-            this->mutate(new_genome);
-            this->add_to_species(new_genome);
-        }
-    }
+    // constructor, a seed of 0 takes a random number from our computer instead
+    pool(unsigned int input, unsigned int output, unsigned int bias = 1, bool rec = false, uint32_t seed = 0);
 
     /* next generation */
     void new_generation();
 
+    /* steady state evolution, where genomes are raced and replaced one at a time rather than a generation at once. not thread
+     * safe, callers racing genomes in parallel serialise their calls */
+
+    /* takes every genome out of the pool to be raced, leaving no species behind */
+    std::vector<genome> take_genomes();
+
+    /* puts a raced genome into the first specie it matches, then once the pool is over its population drops the genome with
+     * the lowest fitness shared over its specie, which might be this one. returns true when a generation's worth of genomes
+     * has been added since the last time it did */
+    bool add_evaluated(const genome &g);
+
+    /* a new genome to race, bred from a specie picked in proportion to its average fitness, parents chosen by tournament */
+    genome breed_steady_state();
+
     unsigned int generation()
     {
         return this->generation_number;
     }
 
+    /* the same seed, parameters and fitnesses give the same generations whatever the thread count */
+    uint32_t seed()
+    {
+        return this->seed_value;
+    }
+
+    void set_threads(unsigned int threads)
+    {
+        this->n_threads = threads;
+    }
+
     /* calculate fitness */
     std::vector<std::pair<specie *, genome *>> get_genomes()
     {
@@ -263,4 +333,10 @@ public:
     void import_fromfile(std::string filename);
 
     void export_tofile(std::string filename);
+
+    /* the whole pool, random state included, so a run resumed from a checkpoint breeds the generations it would have. packed
+     * writes integers as varints, most of which fit a byte. import leaves the pool as it was if the checkpoint can't be read */
+    void export_checkpoint(std::ostream &o, bool packed);
+
+    bool import_checkpoint(std::istream &i);
 };
@@ -92,55 +92,55 @@ void RaceNet::from_genome(const genome &a)
 
     this->recurrent = a.network_info.recurrent;
 
-    nodes.clear();
+    // Pooled training agents are rebound to a new genome every species, so reuse the node storage rather than reallocating it
     input_nodes.clear();
     bias_nodes.clear();
     output_nodes.clear();
+    size_t n_nodes = 0;
+    auto add_node  = [&](int type) {
+        if (n_nodes == nodes.size())
+            nodes.emplace_back();
+        Neuron &node = nodes[n_nodes];
+        node.type    = type;
+        node.value   = 0.0;
+        node.visited = false;
+        node.in_nodes.clear();
+        return n_nodes++;
+    };
 
-    Neuron tmp;
     for (unsigned int i = 0; i < input_size; i++)
-    {
-        nodes.push_back(tmp);
-        nodes.back().type = 1;
-        this->input_nodes.push_back(nodes.size() - 1);
-    }
+        this->input_nodes.push_back(add_node(1));
     for (unsigned int i = 0; i < bias_size; i++)
-    {
-        nodes.push_back(tmp);
-        nodes.back().type = 3;
-        this->bias_nodes.push_back(nodes.size() - 1);
-    }
+        this->bias_nodes.push_back(add_node(3));
     for (unsigned int i = 0; i < output_size; i++)
-    {
-        nodes.push_back(tmp);
-        nodes.back().type = 2;
-        this->output_nodes.push_back(nodes.size() - 1);
-    }
+        this->output_nodes.push_back(add_node(2));
 
-    std::map<unsigned int, unsigned int> table;
-    for (unsigned int i = 0; i < input_nodes.size() + output_nodes.size() + bias_nodes.size(); i++)
+    // Genome node id to index in nodes, SIZE_MAX until the node has been added
+    size_t table_size = n_nodes;
+    for (const auto &gene : a.genes)
+        table_size = std::max(table_size, (size_t) std::max(gene.from_node, gene.to_node) + 1);
+    table.assign(table_size, SIZE_MAX);
+    for (size_t i = 0; i < n_nodes; i++)
         table[i] = i;
 
     for (const auto &gene : a.genes)
     {
-        if (!gene.second.enabled)
+        if (!gene.enabled)
             continue;
 
-        Neuron n;
-        if (table.find(gene.second.from_node) == table.end())
-        {
-            nodes.push_back(n);
-            table[gene.second.from_node] = static_cast<unsigned int>(nodes.size() - 1);
-        }
-        if (table.find(gene.second.to_node) == table.end())
-        {
-            nodes.push_back(n);
-            table[gene.second.to_node] = static_cast<unsigned int>(nodes.size() - 1);
-        }
+        if (table[gene.from_node] == SIZE_MAX)
+            table[gene.from_node] = add_node(0);
+        if (table[gene.to_node] == SIZE_MAX)
+            table[gene.to_node] = add_node(0);
     }
+    nodes.resize(n_nodes);
 
+    // Disabled genes between nodes that were never added land on node 0, as they always have
+    auto node_index = [&](unsigned int genome_node) { return table[genome_node] == SIZE_MAX ? 0 : table[genome_node]; };
     for (const auto &gene : a.genes)
-        nodes[table[gene.second.to_node]].in_nodes.emplace_back(table[gene.second.from_node], gene.second.weight);
+        nodes[node_index(gene.to_node)].in_nodes.emplace_back(node_index(gene.from_node), gene.weight);
+
+    this->compile();
 }
 
 void RaceNet::evaluate(const std::vector<double> &input, std::vector<double> &output)
@@ -151,6 +151,110 @@ void RaceNet::evaluate(const std::vector<double> &input, std::vector<double> &ou
         this->evaluate_nonrecurrent(input, output);
 }
 
+void RaceNet::evaluate(const float *input, size_t n_inputs, float *output, size_t n_outputs)
+{
+    if (recurrent)
+    {
+        // Rare enough (nothing trains recurrent networks) that the allocations don't matter
+        std::vector<double> double_input(input, input + n_inputs), double_output(n_outputs);
+        this->evaluate_recurrent(double_input, double_output);
+        std::copy(double_output.begin(), double_output.end(), output);
+        return;
+    }
+
+    std::fill(values.begin(), values.end(), 0.f);
+    for (size_t i = 0; i < n_inputs && i < input_nodes.size(); i++)
+        values[input_nodes[i]] = input[i];
+    for (auto bias_node : bias_nodes)
+        values[bias_node] = 1.f;
+
+    for (size_t step = 0; step < step_nodes.size(); step++)
+    {
+        float sum = 0.f;
+        for (uint32_t edge = step_edge_start[step]; edge < step_edge_start[step + 1]; edge++)
+            sum += values[edge_sources[edge]] * edge_weights[edge];
+        values[step_nodes[step]] = sigmoidf(sum);
+    }
+
+    for (size_t i = 0; i < output_nodes.size() && i < n_outputs; i++)
+        output[i] = values[output_nodes[i]];
+}
+
+// Walks the graph exactly as evaluate_nonrecurrent does, recording each node computation instead of performing it. Inputs and
+// biases are assumed to be fed, as every caller does.
+void RaceNet::compile()
+{
+    step_nodes.clear();
+    step_edge_start.clear();
+    edge_sources.clear();
+    edge_weights.clear();
+    values.assign(nodes.size(), 0.f);
+    topology_hash = 14695981039346656037ull;
+
+    auto hash = [this](uint64_t value) {
+        topology_hash ^= value;
+        topology_hash *= 1099511628211ull;
+    };
+    hash(nodes.size());
+    for (auto input_node : input_nodes)
+        hash(input_node);
+    for (auto bias_node : bias_nodes)
+        hash(bias_node);
+    for (auto output_node : output_nodes)
+        hash(output_node);
+
+    if (recurrent)
+        return;
+
+    for (auto &node : nodes)
+        node.visited = false;
+    for (auto input_node : input_nodes)
+        nodes[input_node].visited = true;
+    for (auto bias_node : bias_nodes)
+        nodes[bias_node].visited = true;
+
+    std::stack<size_t> s;
+    for (auto output_node : output_nodes)
+        s.push(output_node);
+
+    step_edge_start.push_back(0);
+    while (!s.empty())
+    {
+        size_t t = s.top();
+
+        if (nodes[t].visited)
+        {
+            step_nodes.push_back((uint32_t) t);
+            hash(t);
+            for (auto &in_node : nodes[t].in_nodes)
+            {
+                edge_sources.push_back((uint32_t) in_node.first);
+                edge_weights.push_back((float) in_node.second);
+                hash(in_node.first);
+            }
+            step_edge_start.push_back((uint32_t) edge_sources.size());
+            s.pop();
+        }
+        else
+        {
+            nodes[t].visited = true;
+
+            for (auto &in_node : nodes[t].in_nodes)
+            {
+                if (!nodes[in_node.first].visited)
+                    s.push(in_node.first);
+            }
+        }
+    }
+}
+
+bool RaceNet::same_topology(const RaceNet &other) const
+{
+    return topology_hash == other.topology_hash && recurrent == other.recurrent && nodes.size() == other.nodes.size() && input_nodes == other.input_nodes &&
+           bias_nodes == other.bias_nodes && output_nodes == other.output_nodes && step_nodes == other.step_nodes && step_edge_start == other.step_edge_start &&
+           edge_sources == other.edge_sources;
+}
+
 void RaceNet::import_fromfile(std::string filename)
 {
     std::ifstream o;
@@ -158,6 +262,7 @@ void RaceNet::import_fromfile(std::string filename)
 
     this->nodes.clear();
     this->input_nodes.clear();
+    this->bias_nodes.clear();
     this->output_nodes.clear();
 
     try
@@ -208,6 +313,7 @@ void RaceNet::import_fromfile(std::string filename)
     }
 
     o.close();
+    this->compile();
 }
 
 void RaceNet::export_tofile(std::string filename)
@@ -233,3 +339,149 @@ void RaceNet::export_tofile(std::string filename)
     }
     o.close();
 }
+
+bool RaceNet::export_tocpp(const std::string &name, std::ostream &out) const
+{
+    if (recurrent)
+        return false;
+
+    // 9 significant digits round trip any float, so the generated table holds exactly the weights the program does
+    out << std::showpoint << std::setprecision(9);
+    out << "// Generated from the " << name << " network by RaceNetCodegen, regenerate it rather than editing" << std::endl;
+    out << "#include \"RaceNet/CompiledRaceNets.h\"" << std::endl;
+    out << "#include \"RaceNet/RaceNet.h\"" << std::endl << std::endl;
+    out << "namespace" << std::endl << "{" << std::endl;
+
+    if (!edge_weights.empty())
+    {
+        out << "    constexpr float kWeights[" << edge_weights.size() << "] = {" << std::endl;
+        for (auto weight : edge_weights)
+            out << "        " << weight << "f," << std::endl;
+        out << "    };" << std::endl << std::endl;
+    }
+
+    // The same statements in the same order as evaluate's program, with every index known, so the sums come out identical
+    out << "    void evaluate(const float *input, size_t n_inputs, float *output, size_t n_outputs)" << std::endl << "    {" << std::endl;
+    out << "        float v[" << std::max<size_t>(nodes.size(), 1) << "] = {};" << std::endl;
+    out << "        float sum;" << std::endl;
+    for (size_t i = 0; i < input_nodes.size(); i++)
+        out << "        if (n_inputs > " << i << ") v[" << input_nodes[i] << "] = input[" << i << "];" << std::endl;
+    for (auto bias_node : bias_nodes)
+        out << "        v[" << bias_node << "] = 1.f;" << std::endl;
+    for (size_t step = 0; step < step_nodes.size(); step++)
+    {
+        out << "        sum = 0.f;" << std::endl;
+        for (uint32_t edge = step_edge_start[step]; edge < step_edge_start[step + 1]; edge++)
+            out << "        sum += v[" << edge_sources[edge] << "] * kWeights[" << edge << "];" << std::endl;
+        out << "        v[" << step_nodes[step] << "] = sigmoidf(sum);" << std::endl;
+    }
+    for (size_t i = 0; i < output_nodes.size(); i++)
+        out << "        if (n_outputs > " << i << ") output[" << i << "] = v[" << output_nodes[i] << "];" << std::endl;
+    out << "    }" << std::endl << std::endl;
+
+    out << "    CompiledRaceNetRegistrar registrar(\"" << name << "\", " << std::hex << "0x" << this->fingerprint() << std::dec << "ull, evaluate);" << std::endl;
+    out << "} // namespace" << std::endl;
+    return true;
+}
+
+uint64_t RaceNet::fingerprint() const
+{
+    uint64_t fingerprint = topology_hash;
+    auto hash            = [&fingerprint](uint64_t value) {
+        fingerprint ^= value;
+        fingerprint *= 1099511628211ull;
+    };
+    hash(recurrent);
+    for (size_t step = 0; step < step_nodes.size(); step++)
+        hash(step_edge_start[step + 1]);
+    for (auto weight : edge_weights)
+    {
+        uint32_t weight_bits;
+        std::memcpy(&weight_bits, &weight, sizeof(weight_bits));
+        hash(weight_bits);
+    }
+    return fingerprint;
+}
+
+void RaceNetBatch::build(const std::vector<RaceNet *> &nets)
+{
+    batches.clear();
+    n_nets = nets.size();
+
+    size_t max_nodes = 0;
+    for (uint32_t net_idx = 0; net_idx < nets.size(); net_idx++)
+    {
+        RaceNet *net = nets[net_idx];
+        max_nodes    = std::max(max_nodes, net->nodes.size());
+
+        // Recurrent networks keep a batch to themselves, they're evaluated by the interpreter
+        auto batch = std::find_if(batches.begin(), batches.end(), [net](const Batch &candidate) {
+            return !net->recurrent && candidate.n_lanes < RACENET_BATCH_LANES && candidate.program->same_topology(*net);
+        });
+        if (batch == batches.end())
+        {
+            batches.emplace_back();
+            batch          = batches.end() - 1;
+            batch->program = net;
+            batch->n_lanes = 0;
+            // Unused lanes keep zero weights, their values are computed and thrown away
+            batch->edge_weights.assign(net->edge_weights.size() * RACENET_BATCH_LANES, 0.f);
+        }
+
+        uint32_t lane            = batch->n_lanes++;
+        batch->net_indices[lane] = net_idx;
+        for (size_t edge = 0; edge < net->edge_weights.size(); edge++)
+            batch->edge_weights[edge * RACENET_BATCH_LANES + lane] = net->edge_weights[edge];
+    }
+
+    values.assign(max_nodes * RACENET_BATCH_LANES, 0.f);
+}
+
+void RaceNetBatch::evaluate(const float *inputs, size_t n_inputs, float *outputs, size_t n_outputs)
+{
+    for (auto &batch : batches)
+    {
+        RaceNet &program = *batch.program;
+        // A network with no match gains nothing from the lanes, its own program is the batch's
+        if (program.recurrent || batch.n_lanes == 1)
+        {
+            uint32_t net_idx = batch.net_indices[0];
+            program.evaluate(inputs + net_idx * n_inputs, n_inputs, outputs + net_idx * n_outputs, n_outputs);
+            continue;
+        }
+
+        std::fill(values.begin(), values.begin() + program.nodes.size() * RACENET_BATCH_LANES, 0.f);
+        for (uint32_t lane = 0; lane < batch.n_lanes; lane++)
+        {
+            const float *input = inputs + batch.net_indices[lane] * n_inputs;
+            for (size_t i = 0; i < n_inputs && i < program.input_nodes.size(); i++)
+                values[program.input_nodes[i] * RACENET_BATCH_LANES + lane] = input[i];
+        }
+        for (auto bias_node : program.bias_nodes)
+            std::fill_n(&values[bias_node * RACENET_BATCH_LANES], RACENET_BATCH_LANES, 1.f);
+
+        // Same operations in the same order as RaceNet::evaluate, a lane at a time, so these loops vectorise across the lanes
+        for (size_t step = 0; step < program.step_nodes.size(); step++)
+        {
+            float sum[RACENET_BATCH_LANES] = {};
+            for (uint32_t edge = program.step_edge_start[step]; edge < program.step_edge_start[step + 1]; edge++)
+            {
+                const float *source = &values[program.edge_sources[edge] * RACENET_BATCH_LANES];
+                const float *weight = &batch.edge_weights[edge * RACENET_BATCH_LANES];
+                for (uint32_t lane = 0; lane < RACENET_BATCH_LANES; lane++)
+                    sum[lane] += source[lane] * weight[lane];
+            }
+            // exp doesn't vectorise portably, so don't spend it on empty lanes
+            float *node_values = &values[program.step_nodes[step] * RACENET_BATCH_LANES];
+            for (uint32_t lane = 0; lane < batch.n_lanes; lane++)
+                node_values[lane] = sigmoidf(sum[lane]);
+        }
+
+        for (uint32_t lane = 0; lane < batch.n_lanes; lane++)
+        {
+            float *output = outputs + batch.net_indices[lane] * n_outputs;
+            for (size_t i = 0; i < program.output_nodes.size() && i < n_outputs; i++)
+                output[i] = values[program.output_nodes[i] * RACENET_BATCH_LANES + lane];
+        }
+    }
+}
@@ -9,6 +9,9 @@
 #include <iostream>
 #include <fstream>
 #include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
 #include <vector>
 
 #include "RaceNEAT.h"
@@ -44,6 +47,14 @@ public:
     }
 };
 
+// Networks evaluated together per batch, a full AVX register of floats
+static const uint32_t RACENET_BATCH_LANES = 8;
+
+inline float sigmoidf(float x)
+{
+    return 2.f / (1.f + std::exp(-4.9f * x)) - 1.f;
+}
+
 class RaceNet
 {
 private:
@@ -53,6 +64,17 @@ private:
     std::vector<size_t> input_nodes;
     std::vector<size_t> bias_nodes;
     std::vector<size_t> output_nodes;
+    std::vector<size_t> table; // Scratch for from_genome, kept to avoid reallocating it for every genome
+
+    // Non-recurrent networks are compiled into a flat program: each step sets step_nodes[i] to the sigmoid of the weighted sum over
+    // edges [step_edge_start[i], step_edge_start[i + 1]). The steps are the order the graph walk computes nodes in, which is the
+    // same for every input, so replaying them gives the walk's answer without the walk.
+    std::vector<uint32_t> step_nodes;
+    std::vector<uint32_t> step_edge_start;
+    std::vector<uint32_t> edge_sources;
+    std::vector<float> edge_weights;
+    std::vector<float> values; // Scratch node values, so evaluation doesn't allocate
+    uint64_t topology_hash = 0;
 
     double sigmoid(double x)
     {
@@ -63,14 +85,62 @@ private:
 
     void evaluate_recurrent(const std::vector<double> &input, std::vector<double> &output);
 
+    void compile();
+
+    bool same_topology(const RaceNet &other) const;
+
+    friend class RaceNetBatch;
+
 public:
     explicit RaceNet() = default;
 
     void from_genome(const genome &a);
 
+    // Interprets the node graph, the reference the compiled program is checked against
     void evaluate(const std::vector<double> &input, std::vector<double> &output);
 
+    // Runs the compiled program without allocating. Inputs beyond n_inputs are 0, recurrent networks fall back to the interpreter.
+    void evaluate(const float *input, size_t n_inputs, float *output, size_t n_outputs);
+
     void import_fromfile(std::string filename);
 
     void export_tofile(std::string filename);
+
+    // Writes the compiled program out as a C++ translation unit registering an unrolled evaluate with CompiledRaceNets under name.
+    // Returns false for recurrent networks, which have no program to write.
+    bool export_tocpp(const std::string &name, std::ostream &out) const;
+
+    // Hash of the compiled program and its weights, so a generated driver can be matched to the network it was generated from
+    uint64_t fingerprint() const;
+};
+
+// Evaluates a whole population of compiled networks in one call. Networks with identical topologies are packed
+// RACENET_BATCH_LANES to a batch, node values and weights laid out lane-minor so each edge is one vector multiply-add across the batch.
+// Networks without a match are still evaluated, just with a lane to themselves.
+class RaceNetBatch
+{
+public:
+    // The networks must outlive the batch, and be rebuilt into it whenever one is rebound to a new genome
+    void build(const std::vector<RaceNet *> &nets);
+
+    // Row i of inputs and outputs belongs to the i-th network passed to build
+    void evaluate(const float *inputs, size_t n_inputs, float *outputs, size_t n_outputs);
+
+    size_t size() const
+    {
+        return n_nets;
+    }
+
+private:
+    struct Batch
+    {
+        RaceNet *program; // Any of the batch's networks, they all share its steps
+        uint32_t n_lanes;
+        uint32_t net_indices[RACENET_BATCH_LANES];
+        std::vector<float> edge_weights; // Edge major, one weight per lane
+    };
+
+    std::vector<Batch> batches;
+    std::vector<float> values;
+    size_t n_nets = 0;
 };
@@ -0,0 +1,128 @@
+#include "SpeciesEvaluator.h"
+
+#include <sstream>
+
+#include "Farm/FarmSocket.h"
+
+SpeciesEvaluator::SpeciesEvaluator(const std::shared_ptr<Track> &track, const std::shared_ptr<Car> &car, uint32_t nShards) :
+    m_track(track), m_car(car), m_populationScheduler(track, nShards)
+{
+}
+
+SpeciesResult SpeciesEvaluator::Evaluate(const std::vector<genome> &genomes, uint32_t nTicks)
+{
+    this->_GrowAgentPool(genomes.size());
+    m_populationScheduler.ResetWorlds();
+    for (size_t genomeIdx = 0; genomeIdx < genomes.size(); ++genomeIdx)
+    {
+        m_agents[genomeIdx].Rebind(genomes[genomeIdx]);
+    }
+    m_populationScheduler.ActivateAgents(genomes.size());
+    m_populationScheduler.Run(nTicks);
+
+    SpeciesResult result;
+    for (size_t genomeIdx = 0; genomeIdx < genomes.size(); ++genomeIdx)
+    {
+        // Finishing also brings the agent's fitness up to date with where it ended up
+        if (m_agents[genomeIdx].IsWinner() && result.winnerIdx < 0)
+        {
+            result.winnerIdx = (int32_t) genomeIdx;
+        }
+        result.fitnesses.emplace_back((uint32_t) m_agents[genomeIdx].fitness);
+    }
+    return result;
+}
+
+std::string SpeciesEvaluator::EvaluateBatch(const std::string &batch)
+{
+    std::vector<genome> genomes;
+    uint32_t nTicks;
+    if (!DecodeBatch(batch, genomes, nTicks))
+    {
+        LOG(WARNING) << "Couldn't decode a batch of " << batch.size() << " bytes, returning no fitnesses";
+        return EncodeResult(SpeciesResult());
+    }
+    return EncodeResult(this->Evaluate(genomes, nTicks));
+}
+
+std::string SpeciesEvaluator::EncodeBatch(const std::vector<genome> &genomes, uint32_t nTicks)
+{
+    std::ostringstream genomeBytes;
+    for (auto &batchGenome : genomes)
+    {
+        export_genome(genomeBytes, batchGenome);
+    }
+    FarmWriter batch;
+    batch.U32(nTicks);
+    batch.U32((uint32_t) genomes.size());
+    batch.Bytes(genomeBytes.str());
+    return batch.bytes;
+}
+
+bool SpeciesEvaluator::DecodeBatch(const std::string &batch, std::vector<genome> &genomes, uint32_t &nTicks)
+{
+    FarmReader reader(batch);
+    nTicks            = reader.U32();
+    uint32_t nGenomes = reader.U32();
+    std::istringstream genomeBytes(reader.Bytes());
+    if (!reader.Good())
+    {
+        return false;
+    }
+
+    // Everything about the genome, network shape included, is read in over these
+    network_info_container networkInfo = {};
+    mutation_rate_container mutationRates;
+    genomes.clear();
+    for (uint32_t genomeIdx = 0; genomeIdx < nGenomes; ++genomeIdx)
+    {
+        genomes.emplace_back(networkInfo, mutationRates);
+        if (!import_genome(genomeBytes, genomes.back()))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string SpeciesEvaluator::EncodeResult(const SpeciesResult &result)
+{
+    FarmWriter writer;
+    writer.U32((uint32_t) result.winnerIdx);
+    writer.U32((uint32_t) result.fitnesses.size());
+    for (auto &fitness : result.fitnesses)
+    {
+        writer.U32(fitness);
+    }
+    return writer.bytes;
+}
+
+bool SpeciesEvaluator::DecodeResult(const std::string &bytes, SpeciesResult &result)
+{
+    FarmReader reader(bytes);
+    result.winnerIdx    = (int32_t) reader.U32();
+    uint32_t nFitnesses = reader.U32();
+    result.fitnesses.clear();
+    for (uint32_t fitnessIdx = 0; fitnessIdx < nFitnesses && reader.Good(); ++fitnessIdx)
+    {
+        result.fitnesses.emplace_back(reader.U32());
+    }
+    return reader.Good();
+}
+
+void SpeciesEvaluator::_GrowAgentPool(size_t nAgents)
+{
+    if (nAgents <= m_agents.size())
+    {
+        return;
+    }
+    // The scheduler holds on to the agents, so they're all rebuilt into new storage and handed over again
+    std::vector<TrainingAgent> agents;
+    agents.reserve(nAgents);
+    for (size_t agentIdx = 0; agentIdx < nAgents; ++agentIdx)
+    {
+        agents.emplace_back((uint16_t) agentIdx, m_car, m_track);
+    }
+    m_agents.swap(agents);
+    m_populationScheduler.SetAgentPool(m_agents);
+}
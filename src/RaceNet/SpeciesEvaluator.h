@@ -0,0 +1,39 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "Agents/TrainingAgent.h"
+#include "PopulationScheduler.h"
+#include "RaceNEAT.h"
+
+// What racing a species earned each of its genomes
+struct SpeciesResult
+{
+    std::vector<uint32_t> fitnesses; // One per genome, in the species' order
+    int32_t winnerIdx = -1;          // Genome that finished the track, if any did
+};
+
+// Races species of genomes from a fresh start on a headless track. Every species gets rebuilt physics worlds, so its result only
+// depends on its genomes and not on what was raced before it, which lets species be evaluated in any order, in any process.
+class SpeciesEvaluator
+{
+public:
+    SpeciesEvaluator(const std::shared_ptr<Track> &track, const std::shared_ptr<Car> &car, uint32_t nShards);
+    SpeciesResult Evaluate(const std::vector<genome> &genomes, uint32_t nTicks);
+    // The same, through the encoding batches and results travel between farm processes in
+    std::string EvaluateBatch(const std::string &batch);
+
+    static std::string EncodeBatch(const std::vector<genome> &genomes, uint32_t nTicks);
+    static bool DecodeBatch(const std::string &batch, std::vector<genome> &genomes, uint32_t &nTicks);
+    static std::string EncodeResult(const SpeciesResult &result);
+    static bool DecodeResult(const std::string &bytes, SpeciesResult &result);
+
+private:
+    void _GrowAgentPool(size_t nAgents);
+
+    std::shared_ptr<Track> m_track;
+    std::shared_ptr<Car> m_car;
+    std::vector<TrainingAgent> m_agents;
+    PopulationScheduler m_populationScheduler;
+};
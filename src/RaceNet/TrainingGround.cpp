@@ -1,30 +1,58 @@
 #include "TrainingGround.h"
 
+#include <chrono>
+#include <thread>
+
 TrainingGround::TrainingGround(uint16_t nGenerations,
                                uint32_t nTicks,
                                const std::shared_ptr<Track> &training_track,
                                const std::shared_ptr<Car> &training_car,
                                const std::shared_ptr<Logger> &logger,
                                const std::shared_ptr<GLFWwindow> &window) :
-    m_window(window), raceNetRenderer(m_window, logger)
+    m_window(window), training_track(training_track), training_car(training_car)
 {
     LOG(INFO) << "Beginning GA evolution session. nGenerations Cap: " << nGenerations << " nTicks: " << nTicks << " Track: " << training_track->name << " ("
               << ToString(training_track->nfsVersion) << ")";
 
-    this->training_track = training_track;
-    this->training_car   = training_car;
-    physicsEngine.RegisterTrack(this->training_track);
-
-    TrainAgents(nGenerations, nTicks);
+    if (m_window != nullptr)
+    {
+        m_raceNetRenderer = std::make_unique<RaceNetRenderer>(m_window, logger);
+        std::thread trainingThread(&TrainingGround::_Train, this, nGenerations, nTicks);
+        this->_RenderUntilTrained();
+        trainingThread.join();
+    }
+    else
+    {
+        this->_Train(nGenerations, nTicks);
+    }
 
     LOG(INFO) << "Done";
 }
 
+void TrainingGround::_Train(uint16_t nGenerations, uint32_t nTicks)
+{
+    if (getEvolutionType(Config::get().evolution) == STEADY_STATE_EVOLUTION)
+    {
+        this->_TrainSteadyState(nGenerations, nTicks);
+    }
+    else if (m_window != nullptr)
+    {
+        TrainAgents(nGenerations, nTicks);
+    }
+    else
+    {
+        this->_TrainGenerations(nGenerations, nTicks);
+    }
+    m_trained = true;
+}
+
 void TrainingGround::TrainAgents(uint16_t nGenerations, uint32_t nTicks)
 {
     // 8 input, 4 output, 6 bias, cannot be recurrent
-    pool pool(8, 5, 4, false);
-    pool.import_fromfile("generation.dat");
+    pool pool(8, 5, 4, false, Config::get().trainingSeed);
+    this->_LoadPool(pool);
+    CheckpointWriter checkpointWriter(CHECKPOINT_PATH, Config::get().checkpointKeepLast, Config::get().checkpointKeepEvery, !Config::get().checkpointRaw);
+    TrainingMetrics trainingMetrics(ToString(GENERATIONAL_EVOLUTION), Config::get().trainingMetrics);
     bool haveWinner               = false;
     uint32_t gen_Idx              = 0;
     unsigned int globalMaxFitness = 0;
@@ -33,22 +61,25 @@ void TrainingGround::TrainAgents(uint16_t nGenerations, uint32_t nTicks)
     int specieCounter = 0;
     auto specieIter   = pool.species.begin();
 
-    // init initial
-    if (specieIter != pool.species.end())
-    {
-        for (size_t i = 0; i < (*specieIter).genomes.size(); i++)
+    // A species can hold at most the whole population, so pool an agent for each. Their cars are only built and registered once,
+    // each species rebinds them to its genomes rather than making new ones.
+    this->_RunOnMainThread([&]() {
+        trainingAgents.reserve(pool.speciating_parameters.population);
+        for (uint32_t agentIdx = 0; agentIdx < pool.speciating_parameters.population; ++agentIdx)
         {
-            // Create new cars from models loaded in training_car to avoid VIV extract again, each with new RaceNetworks
-            trainingAgents.emplace_back(i, this->training_car, this->training_track);
-            trainingAgents[i].raceNet.from_genome((*specieIter).genomes[i]);
-            physicsEngine.RegisterVehicle(trainingAgents[i].vehicle);
-            trainingAgents[i].Reset();
+            // Create new cars from models loaded in training_car to avoid VIV extract again
+            trainingAgents.emplace_back((uint16_t) agentIdx, this->training_car, this->training_track);
         }
-    }
+    });
+    m_populationScheduler = std::make_unique<PopulationScheduler>(training_track, Config::get().trainingShards);
+    m_populationScheduler->SetAgentPool(trainingAgents);
+
+    // init initial
+    size_t nActiveAgents = specieIter != pool.species.end() ? this->_BindSpecies(*specieIter) : 0;
     LOG(INFO) << "Agents initialised";
 
     // Start simulating GA generations
-    while (!glfwWindowShouldClose(m_window.get()) && (!haveWinner))
+    while (!this->_WindowClosed() && (!haveWinner))
     {
         gen_Idx++;
         // If user provided a generation cap and we've hit it, bail
@@ -75,9 +106,10 @@ void TrainingGround::TrainAgents(uint16_t nGenerations, uint32_t nTicks)
             if (specieIter != pool.species.end())
             {
                 size_t best_id = -1;
-                for (size_t i = 0; i < (*specieIter).genomes.size(); i++)
+                for (size_t i = 0; i < nActiveAgents; i++)
                 {
                     (*specieIter).genomes[i].fitness = trainingAgents[i].fitness;
+                    trainingMetrics.AddEvaluation((*specieIter).genomes[i].fitness);
                     if ((*specieIter).genomes[i].fitness > globalMaxFitness)
                     {
                         globalMaxFitness = (*specieIter).genomes[i].fitness;
@@ -90,67 +122,38 @@ void TrainingGround::TrainAgents(uint16_t nGenerations, uint32_t nTicks)
                 }
             }
 
-            // Change to a new species, and remove all current car agents operating with genome
+            // Change to a new species
             specieIter++;
             specieCounter++;
-            for (auto &carAgent : trainingAgents)
-            {
-                // physicsEngine.m_pDynamicsWorld->removeRigidBody(carAgent.car->getVehicleRigidBody());
-            }
-            trainingAgents.clear();
 
             // If TinyAI has gone through all of the species in the pool, begin a new generation
             if (specieIter == pool.species.end())
             {
+                trainingMetrics.Report(pool.generation());
                 pool.new_generation();
-                std::string fname = "gen";
-                fname += std::to_string(pool.generation());
-                pool.export_tofile(fname);
-                pool.export_tofile("generation.dat");
+                checkpointWriter.Save(pool);
                 std::cerr << "Starting new generation. Number = " << pool.generation() << std::endl;
                 specieIter    = pool.species.begin();
                 specieCounter = 0;
             }
 
-            // Generate new Car Agents from the latest species and corresponding genome
-            if (specieIter != pool.species.end())
-                for (size_t i = 0; i < (*specieIter).genomes.size(); i++)
-                {
-                    // Create new cars from models loaded in training_car to avoid VIV extract again, each with new RaceNetworks
-                    TrainingAgent trainingAgent((uint16_t) i, this->training_car, this->training_track);
-                    trainingAgent.raceNet.from_genome((*specieIter).genomes[i]);
-                    physicsEngine.RegisterVehicle(trainingAgent.vehicle);
-                    trainingAgent.Reset();
-                    trainingAgents.emplace_back(trainingAgent);
-                }
-        }
-
-        for (uint32_t tick_Idx = 0; tick_Idx < nTicks; ++tick_Idx)
-        {
-            // Simulate the population
-            for (auto &car_agent : trainingAgents)
+            // Rebind the pooled agents to the latest species and corresponding genomes
+            nActiveAgents = specieIter != pool.species.end() ? this->_BindSpecies(*specieIter) : 0;
+            if (nActiveAgents == 0)
             {
-                if (car_agent.isDead)
-                    continue;
-
-                car_agent.Simulate();
-
-                std::vector<uint32_t> dummy = {0, 1, 2, 3};
-                physicsEngine.StepSimulation(stepTime, dummy);
-
-                if (!Config::get().headless)
-                {
-                    raceNetRenderer.Render(tick_Idx, trainingAgents, training_track);
-                }
-                if (glfwWindowShouldClose(m_window.get()))
-                    break;
+                m_populationScheduler->ActivateAgents(0);
             }
         }
 
+        // Simulate the population, every world steps once per tick with all of its cars in it
+        PopulationStats populationStats = m_populationScheduler->Run(nTicks, this->_VisualisationCallback());
+        LOG(INFO) << "Simulated " << populationStats.nTicks << " ticks in " << populationStats.seconds << "s (" << populationStats.nTicks / populationStats.seconds
+                  << " ticks/s, " << populationStats.nAgentTicks / populationStats.seconds << " agent-ticks/s)";
+
         int localMaxFitness = 0;
         for (auto &carAgent : trainingAgents)
         {
-            if (carAgent.fitness > localMaxFitness)
+            if (!carAgent.benched && carAgent.fitness > localMaxFitness)
             {
                 localMaxFitness = carAgent.fitness;
             }
@@ -176,3 +179,356 @@ void TrainingGround::TrainAgents(uint16_t nGenerations, uint32_t nTicks)
         LOG(INFO) << gen_Idx << ", " << localMaxFitness << ", ";
     }
 }
+
+// Headless training evaluates a whole generation at a time, a species per batch, on farm workers when there are any and here when
+// there aren't. Either way each species is raced by a SpeciesEvaluator from a fresh world, so a seed breeds the same generations.
+void TrainingGround::_TrainGenerations(uint16_t nGenerations, uint32_t nTicks)
+{
+    pool pool(8, 5, 4, false, Config::get().trainingSeed);
+    this->_LoadPool(pool);
+    CheckpointWriter checkpointWriter(CHECKPOINT_PATH, Config::get().checkpointKeepLast, Config::get().checkpointKeepEvery, !Config::get().checkpointRaw);
+    TrainingMetrics trainingMetrics(ToString(GENERATIONAL_EVOLUTION), Config::get().trainingMetrics);
+    std::unique_ptr<EvaluationFarm> evaluationFarm = this->_StartFarm();
+    std::unique_ptr<SpeciesEvaluator> speciesEvaluator; // Only built if the farm can't be used, it needs a world per shard
+    unsigned int globalMaxFitness = 0;
+
+    for (uint32_t generationIdx = 0; nGenerations == 0 || generationIdx < nGenerations; ++generationIdx)
+    {
+        std::vector<specie *> species;
+        for (auto &poolSpecies : pool.species)
+        {
+            species.emplace_back(&poolSpecies);
+        }
+        std::vector<SpeciesResult> results(species.size());
+        auto startTime = std::chrono::steady_clock::now();
+
+        bool farmed = false;
+        if (evaluationFarm != nullptr)
+        {
+            std::vector<std::string> batches, resultBytes;
+            for (auto &batchSpecies : species)
+            {
+                batches.emplace_back(SpeciesEvaluator::EncodeBatch(batchSpecies->genomes, nTicks));
+            }
+            farmed = evaluationFarm->Evaluate(batches, resultBytes);
+            for (size_t speciesIdx = 0; farmed && speciesIdx < species.size(); ++speciesIdx)
+            {
+                farmed = SpeciesEvaluator::DecodeResult(resultBytes[speciesIdx], results[speciesIdx]) &&
+                         results[speciesIdx].fitnesses.size() == species[speciesIdx]->genomes.size();
+            }
+            if (!farmed)
+            {
+                LOG(WARNING) << "Training farm couldn't evaluate generation " << pool.generation() << ", evaluating here from now on";
+                evaluationFarm.reset();
+            }
+        }
+        if (!farmed)
+        {
+            if (speciesEvaluator == nullptr)
+            {
+                speciesEvaluator = std::make_unique<SpeciesEvaluator>(training_track, training_car, Config::get().trainingShards);
+            }
+            for (size_t speciesIdx = 0; speciesIdx < species.size(); ++speciesIdx)
+            {
+                results[speciesIdx] = speciesEvaluator->Evaluate(species[speciesIdx]->genomes, nTicks);
+            }
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+        const genome *bestGenome     = nullptr;
+        const genome *winnerGenome   = nullptr;
+        unsigned int localMaxFitness = 0;
+        for (size_t speciesIdx = 0; speciesIdx < species.size(); ++speciesIdx)
+        {
+            std::vector<genome> &genomes = species[speciesIdx]->genomes;
+            for (size_t genomeIdx = 0; genomeIdx < genomes.size(); ++genomeIdx)
+            {
+                genomes[genomeIdx].fitness = results[speciesIdx].fitnesses[genomeIdx];
+                localMaxFitness            = std::max(localMaxFitness, genomes[genomeIdx].fitness);
+                trainingMetrics.AddEvaluation(genomes[genomeIdx].fitness);
+                if (genomes[genomeIdx].fitness > globalMaxFitness)
+                {
+                    globalMaxFitness = genomes[genomeIdx].fitness;
+                    bestGenome       = &genomes[genomeIdx];
+                }
+            }
+            if (winnerGenome == nullptr && results[speciesIdx].winnerIdx >= 0)
+            {
+                winnerGenome = &genomes[results[speciesIdx].winnerIdx];
+            }
+        }
+        if (bestGenome != nullptr)
+        {
+            RaceNet bestNetwork;
+            bestNetwork.from_genome(*bestGenome);
+            bestNetwork.export_tofile("best_network");
+        }
+        LOG(INFO) << "Generation " << pool.generation() << ": " << species.size() << " species in " << seconds << "s" << (farmed ? " on the farm" : "")
+                  << ", max fitness " << localMaxFitness << " (best " << globalMaxFitness << ")";
+        trainingMetrics.Report(pool.generation());
+
+        if (winnerGenome != nullptr)
+        {
+            LOG(INFO) << "WINNER: Saving best agent network to " << BEST_NETWORK_PATH;
+            RaceNet winnerNetwork;
+            winnerNetwork.from_genome(*winnerGenome);
+            winnerNetwork.export_tofile(BEST_NETWORK_PATH);
+            break;
+        }
+
+        pool.new_generation();
+        checkpointWriter.Save(pool);
+    }
+}
+
+// Steady state training keeps every pooled agent racing. As soon as one finishes, its genome goes back into the pool with the fitness
+// it earned and the agent is rebound to a child bred from what has been raced so far, so nobody waits on the slowest agent of a
+// species. A generation is only a population's worth of evaluations, for checkpoints and reports. Always raced in this process,
+// and only reproducible from a seed with a single shard, since which agent finishes first then depends on thread timing.
+void TrainingGround::_TrainSteadyState(uint16_t nGenerations, uint32_t nTicks)
+{
+    pool pool(8, 5, 4, false, Config::get().trainingSeed);
+    this->_LoadPool(pool);
+    CheckpointWriter checkpointWriter(CHECKPOINT_PATH, Config::get().checkpointKeepLast, Config::get().checkpointKeepEvery, !Config::get().checkpointRaw);
+    TrainingMetrics trainingMetrics(ToString(STEADY_STATE_EVOLUTION), Config::get().trainingMetrics);
+    if (!Config::get().farmListen.empty() || Config::get().farmWorkers > 0)
+    {
+        LOG(WARNING) << "Steady state training races every agent in this process, the training farm is only used by generational training";
+    }
+
+    // Whatever was loaded is raced again, the fitnesses in a generational pool are its parents'. Each agent races the genome at its index.
+    std::vector<genome> racing = pool.take_genomes();
+    while (racing.size() < pool.speciating_parameters.population)
+    {
+        racing.emplace_back(pool.breed_steady_state());
+    }
+    this->_RunOnMainThread([&]() {
+        trainingAgents.reserve(racing.size());
+        for (uint32_t agentIdx = 0; agentIdx < racing.size(); ++agentIdx)
+        {
+            trainingAgents.emplace_back((uint16_t) agentIdx, this->training_car, this->training_track);
+        }
+    });
+    m_populationScheduler = std::make_unique<PopulationScheduler>(training_track, Config::get().trainingShards);
+    m_populationScheduler->SetAgentPool(trainingAgents);
+    for (uint32_t agentIdx = 0; agentIdx < racing.size(); ++agentIdx)
+    {
+        trainingAgents[agentIdx].Rebind(racing[agentIdx]);
+    }
+
+    std::mutex poolMutex;
+    uint32_t startGeneration      = pool.generation();
+    unsigned int globalMaxFitness = 0;
+    bool stopping                 = false;
+    m_populationScheduler->SetAgentFinished(nTicks, [&](TrainingAgent &agent) {
+        // Also brings the agent's fitness up to date with where it ended up
+        bool winner = agent.IsWinner();
+
+        std::lock_guard<std::mutex> lock(poolMutex);
+        genome &raced = racing[agent.populationID];
+        raced.fitness = (unsigned int) agent.fitness;
+        trainingMetrics.AddEvaluation(raced.fitness);
+        if (raced.fitness > globalMaxFitness)
+        {
+            globalMaxFitness = raced.fitness;
+            agent.raceNet.export_tofile("best_network");
+        }
+        if (winner && !stopping)
+        {
+            LOG(INFO) << "WINNER: Saving best agent network to " << BEST_NETWORK_PATH;
+            agent.raceNet.export_tofile(BEST_NETWORK_PATH);
+            stopping = true;
+        }
+
+        if (pool.add_evaluated(raced))
+        {
+            trainingMetrics.Report(pool.generation() - 1);
+            checkpointWriter.Save(pool);
+            stopping = stopping || (nGenerations != 0 && pool.generation() - startGeneration >= nGenerations);
+        }
+        // Once stopping, agents still racing finish their genomes and are benched, so nothing raced is thrown away
+        if (stopping)
+        {
+            return false;
+        }
+        raced = pool.breed_steady_state();
+        agent.Rebind(raced);
+        return true;
+    });
+    m_populationScheduler->ActivateAgents(racing.size());
+    LOG(INFO) << "Agents initialised, " << racing.size() << " racing at once";
+
+    PopulationStats populationStats = m_populationScheduler->Run(UINT32_MAX, this->_VisualisationCallback());
+    m_populationScheduler->SetAgentFinished(0, nullptr);
+    LOG(INFO) << "Simulated " << populationStats.nTicks << " ticks in " << populationStats.seconds << "s (" << populationStats.nAgentTicks / populationStats.seconds
+              << " agent-ticks/s)";
+}
+
+namespace
+{
+    std::chrono::steady_clock::duration RenderInterval()
+    {
+        return std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / std::max(Config::get().trainingRenderRate, 1u)));
+    }
+} // namespace
+
+// Between ticks, so the agents are only read while their worlds are idle. Copying them is all the simulation ever waits on.
+std::function<bool(uint32_t)> TrainingGround::_VisualisationCallback()
+{
+    if (m_window == nullptr)
+    {
+        return nullptr;
+    }
+    auto publishInterval = RenderInterval();
+    auto nextPublishTime = std::chrono::steady_clock::now();
+    return [this, publishInterval, nextPublishTime](uint32_t tickIdx) mutable {
+        auto currentTime = std::chrono::steady_clock::now();
+        if (currentTime >= nextPublishTime)
+        {
+            this->_PublishSnapshot(tickIdx);
+            nextPublishTime = currentTime + publishInterval;
+        }
+        return !m_stopRequested;
+    };
+}
+
+void TrainingGround::_PublishSnapshot(uint32_t tick)
+{
+    TrainingSnapshot &snapshot = m_snapshots.Back();
+    snapshot.tick              = tick;
+    snapshot.agents.clear();
+    for (auto &trainingAgent : trainingAgents)
+    {
+        if (trainingAgent.benched)
+        {
+            continue;
+        }
+        const VehiclePose &pose = trainingAgent.vehicle->GetPose();
+        snapshot.agents.push_back({trainingAgent.name.c_str(), pose.chassisPosition, pose.chassisOrientation, trainingAgent.vehicle->vehicleProperties.colour,
+                                   trainingAgent.fitness, trainingAgent.ticksInsideVroad, trainingAgent.averageSpeed});
+    }
+    m_snapshots.Publish();
+}
+
+// Renders at the publish rate whether or not the simulation has published anything new, so the view can still be panned and zoomed
+void TrainingGround::_RenderUntilTrained()
+{
+    const auto frameDuration = RenderInterval();
+    auto nextFrameTime       = std::chrono::steady_clock::now();
+
+    while (!m_trained)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mainThreadMutex);
+            for (auto &task : m_mainThreadTasks)
+            {
+                task();
+            }
+            m_mainThreadTasks.clear();
+        }
+
+        m_snapshots.Acquire();
+        m_raceNetRenderer->Render(m_snapshots.Front(), training_track, training_car->carBodyModel);
+        if (glfwWindowShouldClose(m_window.get()))
+        {
+            m_stopRequested = true;
+        }
+
+        nextFrameTime += frameDuration;
+        auto currentTime = std::chrono::steady_clock::now();
+        if (currentTime > nextFrameTime)
+        {
+            nextFrameTime = currentTime;
+        }
+        std::this_thread::sleep_until(nextFrameTime);
+    }
+}
+
+// Blocks until the main thread has run task, or runs it here when headless as there's no GL context to need
+void TrainingGround::_RunOnMainThread(const std::function<void()> &task)
+{
+    if (m_window == nullptr)
+    {
+        task();
+        return;
+    }
+    std::future<void> done;
+    {
+        std::lock_guard<std::mutex> lock(m_mainThreadMutex);
+        m_mainThreadTasks.emplace_back(task);
+        done = m_mainThreadTasks.back().get_future();
+    }
+    done.get();
+}
+
+void TrainingGround::_LoadPool(pool &pool)
+{
+    std::string checkpointPath = CheckpointWriter::Latest(CHECKPOINT_PATH);
+    if (!checkpointPath.empty())
+    {
+        std::ifstream checkpoint(checkpointPath, std::ios::binary);
+        if (pool.import_checkpoint(checkpoint))
+        {
+            LOG(INFO) << "Resuming from " << checkpointPath << " at generation " << pool.generation();
+        }
+        else
+        {
+            LOG(WARNING) << "Couldn't read checkpoint " << checkpointPath << ", starting afresh";
+        }
+    }
+    else if (boost::filesystem::exists("generation.dat"))
+    {
+        // Pools saved before checkpoints were binary
+        pool.import_fromfile("generation.dat");
+    }
+    LOG(INFO) << "NEAT pool seeded with " << pool.seed();
+}
+
+// Null unless asked for a farm, or if it can't listen for workers
+std::unique_ptr<EvaluationFarm> TrainingGround::_StartFarm()
+{
+    if (Config::get().farmListen.empty() && Config::get().farmWorkers == 0)
+    {
+        return nullptr;
+    }
+    std::string endpoint = Config::get().farmListen;
+    if (endpoint.empty())
+    {
+        endpoint = "unix:" + (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("onfs-farm-%%%%%%%%.sock")).string();
+    }
+
+    auto evaluationFarm = std::make_unique<EvaluationFarm>(endpoint, Config::get().farmTimeout);
+    if (!evaluationFarm->IsListening())
+    {
+        LOG(WARNING) << "Training farm unavailable, evaluating in this process";
+        return nullptr;
+    }
+    if (Config::get().farmWorkers > 0)
+    {
+        // argv[0] may only make sense to a shell's PATH lookup
+        std::string executable = boost::filesystem::exists("/proc/self/exe") ? "/proc/self/exe" : Config::get().executablePath;
+        evaluationFarm->SpawnLocalWorkers(Config::get().farmWorkers, executable, Config::get().commandLineArgs);
+    }
+    return evaluationFarm;
+}
+
+// Returns how many of the species' genomes have an agent racing them
+size_t TrainingGround::_BindSpecies(const specie &species)
+{
+    size_t nGenomes = std::min(species.genomes.size(), trainingAgents.size());
+    if (nGenomes < species.genomes.size())
+    {
+        LOG(WARNING) << "Species of " << species.genomes.size() << " genomes is larger than the pool of " << trainingAgents.size() << " agents, the rest go unevaluated";
+    }
+    for (size_t genomeIdx = 0; genomeIdx < nGenomes; ++genomeIdx)
+    {
+        trainingAgents[genomeIdx].Rebind(species.genomes[genomeIdx]);
+    }
+    m_populationScheduler->ActivateAgents(nGenomes);
+    return nGenomes;
+}
+
+bool TrainingGround::_WindowClosed() const
+{
+    return m_stopRequested;
+}
@@ -1,20 +1,28 @@
 #pragma once
 
+#include <atomic>
+#include <future>
+#include <mutex>
 #include <vector>
 #include "stdint.h"
 
 #include "Agents/TrainingAgent.h"
+#include "PopulationScheduler.h"
+#include "CheckpointWriter.h"
+#include "SpeciesEvaluator.h"
+#include "TrainingMetrics.h"
+#include "TrainingSnapshot.h"
+#include "Farm/EvaluationFarm.h"
 #include "../Scene/Track.h"
 #include "../Loaders/CarLoader.h"
 #include "../Physics/PhysicsEngine.h"
 #include "../Util/Utils.h"
+#include "../Util/TripleBuffer.h"
 #include "../Renderer/Renderer.h"
 #include "../Renderer/RaceNetRenderer.h"
 #include "../RaceNet/RaceNet.h"
 #include "../RaceNet/RaceNEAT.h"
 
-static const float stepTime = 1 / 60.f;
-
 class TrainingGround
 {
 public:
@@ -23,15 +31,33 @@ public:
                             const std::shared_ptr<Track> &training_track,
                             const std::shared_ptr<Car> &training_car,
                             const std::shared_ptr<Logger> &logger,
-                            const std::shared_ptr<GLFWwindow> &window);
+                            const std::shared_ptr<GLFWwindow> &window); // Null when headless, agents then train without any rendering
 
 private:
+    void _Train(uint16_t nGenerations, uint32_t nTicks);
     void TrainAgents(uint16_t nGenerations, uint32_t nTicks); // Train the agents, returning agent fitness data
+    void _TrainGenerations(uint16_t nGenerations, uint32_t nTicks);
+    void _TrainSteadyState(uint16_t nGenerations, uint32_t nTicks);
+    std::function<bool(uint32_t)> _VisualisationCallback(); // Null when headless
+    void _PublishSnapshot(uint32_t tick);
+    void _RenderUntilTrained();
+    void _RunOnMainThread(const std::function<void()> &task);
+    void _LoadPool(pool &pool);
+    std::unique_ptr<EvaluationFarm> _StartFarm();
+    size_t _BindSpecies(const specie &species);
+    bool _WindowClosed() const;
     std::shared_ptr<GLFWwindow> m_window;
     std::shared_ptr<Track> training_track;
     std::shared_ptr<Car> training_car;
     std::vector<TrainingAgent> trainingAgents;
-    RaceNetRenderer raceNetRenderer;
+    std::unique_ptr<RaceNetRenderer> m_raceNetRenderer; // Only created with a window, it needs a GL context
+
+    // With a window, training runs on a thread of its own and the main thread, which has the GL context, renders what it publishes
+    TripleBuffer<TrainingSnapshot> m_snapshots;
+    std::atomic<bool> m_stopRequested{false};
+    std::atomic<bool> m_trained{false};
+    std::mutex m_mainThreadMutex;
+    std::vector<std::packaged_task<void()>> m_mainThreadTasks; // Run between frames, for anything that makes GL objects
     /*------- BULLET --------*/
-    PhysicsEngine physicsEngine;
+    std::unique_ptr<PopulationScheduler> m_populationScheduler; // Windowed and steady state training, headless generations race species in a SpeciesEvaluator
 };
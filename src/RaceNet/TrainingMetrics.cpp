@@ -0,0 +1,55 @@
+#include "TrainingMetrics.h"
+
+#include <algorithm>
+#include <boost/filesystem.hpp>
+
+#include "../Util/Logger.h"
+
+TrainingMetrics::TrainingMetrics(const std::string &mode, const std::string &csvPath) :
+    m_mode(mode), m_startTime(std::chrono::steady_clock::now()), m_lastReportTime(m_startTime)
+{
+    if (csvPath.empty())
+    {
+        return;
+    }
+    bool newFile = !boost::filesystem::exists(csvPath) || boost::filesystem::file_size(csvPath) == 0;
+    m_csv.open(csvPath, std::ios::app);
+    if (!m_csv.is_open())
+    {
+        LOG(WARNING) << "Couldn't open " << csvPath << " for training metrics, only logging them";
+        return;
+    }
+    if (newFile)
+    {
+        m_csv << "mode,generation,seconds,evaluations,evaluations_per_second,mean_fitness,best_fitness" << std::endl;
+    }
+}
+
+void TrainingMetrics::AddEvaluation(uint32_t fitness)
+{
+    ++m_nEvaluations;
+    ++m_nReportEvaluations;
+    m_reportFitness += fitness;
+    m_bestFitness = std::max(m_bestFitness, fitness);
+}
+
+void TrainingMetrics::Report(uint32_t generation)
+{
+    auto now                    = std::chrono::steady_clock::now();
+    double seconds              = std::chrono::duration<double>(now - m_startTime).count();
+    double reportSeconds        = std::chrono::duration<double>(now - m_lastReportTime).count();
+    double evaluationsPerSecond = reportSeconds > 0.0 ? m_nReportEvaluations / reportSeconds : 0.0;
+    double meanFitness          = m_nReportEvaluations ? (double) m_reportFitness / m_nReportEvaluations : 0.0;
+
+    LOG(INFO) << m_mode << " generation " << generation << " at " << seconds << "s: " << m_nEvaluations << " evaluations, " << evaluationsPerSecond
+              << " evaluations/s, mean fitness " << meanFitness << " (best " << m_bestFitness << ")";
+    if (m_csv.is_open())
+    {
+        m_csv << m_mode << "," << generation << "," << seconds << "," << m_nEvaluations << "," << evaluationsPerSecond << "," << meanFitness << "," << m_bestFitness
+              << std::endl;
+    }
+
+    m_lastReportTime     = now;
+    m_nReportEvaluations = 0;
+    m_reportFitness      = 0;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <chrono>
+#include <fstream>
+#include <string>
+
+// Throughput and fitness against wall clock time, so generational and steady state training can be compared on the same track.
+// Every report is logged, and appended to a CSV when given a path, one row each tagged with the evolution mode that wrote it.
+class TrainingMetrics
+{
+public:
+    TrainingMetrics(const std::string &mode, const std::string &csvPath);
+    void AddEvaluation(uint32_t fitness);
+    // Evaluations per second and mean fitness are over the evaluations added since the last report
+    void Report(uint32_t generation);
+
+private:
+    std::string m_mode;
+    std::ofstream m_csv;
+    std::chrono::steady_clock::time_point m_startTime;
+    std::chrono::steady_clock::time_point m_lastReportTime;
+    uint64_t m_nEvaluations       = 0;
+    uint64_t m_nReportEvaluations = 0;
+    uint64_t m_reportFitness      = 0;
+    uint32_t m_bestFitness        = 0;
+};
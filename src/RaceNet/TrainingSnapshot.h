@@ -0,0 +1,23 @@
+#pragma once
+
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+// What the training visualisation shows of an agent, copied out between ticks so the renderer never reads live simulation state
+struct TrainingAgentSnapshot
+{
+    const char *name; // Agents keep their names for the whole session
+    glm::vec3 position;
+    glm::quat orientation;
+    glm::vec3 colour;
+    int fitness;
+    int ticksInsideVroad;
+    float averageSpeed;
+};
+
+struct TrainingSnapshot
+{
+    uint32_t tick = 0;
+    std::vector<TrainingAgentSnapshot> agents; // Benched agents are left out
+};
@@ -28,6 +28,7 @@ BulletDebugDrawer::BulletDebugDrawer()
 
 void BulletDebugDrawer::drawLine(const btVector3 &from, const btVector3 &to, const btVector3 &color)
 {
+    std::lock_guard<std::mutex> debugLinesLock(m_debugLinesMutex);
     if (m_debugLines.size() < MAX_NUM_LINES)
     {
         m_debugLines.emplace_back(BulletLine(from, to));
@@ -38,6 +39,8 @@ void BulletDebugDrawer::drawLine(const btVector3 &from, const btVector3 &to, con
 
 void BulletDebugDrawer::Render(const std::shared_ptr<BaseCamera> &camera)
 {
+    std::lock_guard<std::mutex> debugLinesLock(m_debugLinesMutex);
+
     // Activate corresponding render state
     m_bulletShader.use();
     m_bulletShader.loadProjectionViewMatrix(camera->projectionMatrix * camera->viewMatrix);
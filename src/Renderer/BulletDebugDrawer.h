@@ -1,5 +1,6 @@
 #pragma once
 
+#include <mutex>
 #include <LinearMath/btIDebugDraw.h>
 #include <glm/detail/type_mat4x4.hpp>
 
@@ -72,6 +73,8 @@ private:
     GLuint m_lineVAO{};
     // Render shaders
     BulletShader m_bulletShader;
+    // Lines come from both the render thread and the simulation thread drawing the physics world
+    std::mutex m_debugLinesMutex;
     std::vector<BulletLine> m_debugLines;
     std::vector<glm::vec3> m_debugLineColours;
 };
@@ -24,6 +24,14 @@ void DebugRenderer::DrawTrackCollision(const std::shared_ptr<Track> &track)
     }
 }
 
+void DebugRenderer::DrawVisibleSet(const VisibleSet &visibleSet)
+{
+    for (auto &entity : visibleSet.entities)
+    {
+        this->DrawAABB(entity->GetAABB());
+    }
+}
+
 void DebugRenderer::DrawAABB(const AABB &aabb)
 {
     btVector3 colour = btVector3(0, 0, 0);
@@ -56,21 +64,23 @@ void DebugRenderer::DrawFrustum(const std::shared_ptr<BaseCamera> &camera)
 
 void DebugRenderer::DrawCarRaycasts(const std::shared_ptr<Car> &car)
 {
-    glm::vec3 carBodyPosition = car->carBodyModel.position;
+    // Published with the snapshot the car body was placed from, so the rays start where the car is drawn
+    const RangefinderInfo &rangefinderInfo = car->renderTelemetry.rangefinderInfo;
+    glm::vec3 carBodyPosition              = car->carBodyModel.position;
     for (uint8_t rangeIdx = 0; rangeIdx < kNumRangefinders; ++rangeIdx)
     {
         m_bulletDebugDrawer->drawLine(Utils::glmToBullet(carBodyPosition),
-                                      Utils::glmToBullet(car->rangefinderInfo.castPositions[rangeIdx]),
-                                      btVector3(2.0f * (kFarDistance - car->rangefinderInfo.rangefinders[rangeIdx]), 2.0f * (car->rangefinderInfo.rangefinders[rangeIdx]), 0));
+                                      Utils::glmToBullet(rangefinderInfo.castPositions[rangeIdx]),
+                                      btVector3(2.0f * (kFarDistance - rangefinderInfo.rangefinders[rangeIdx]), 2.0f * (rangefinderInfo.rangefinders[rangeIdx]), 0));
     }
 
     // Draw up and down casts
     m_bulletDebugDrawer->drawLine(Utils::glmToBullet(carBodyPosition),
-                                  Utils::glmToBullet(car->rangefinderInfo.upCastPosition),
-                                  btVector3(2.0f * (kFarDistance - car->rangefinderInfo.upDistance), 2.0f * (car->rangefinderInfo.upDistance), 0));
+                                  Utils::glmToBullet(rangefinderInfo.upCastPosition),
+                                  btVector3(2.0f * (kFarDistance - rangefinderInfo.upDistance), 2.0f * (rangefinderInfo.upDistance), 0));
     m_bulletDebugDrawer->drawLine(Utils::glmToBullet(carBodyPosition),
-                                  Utils::glmToBullet(car->rangefinderInfo.downCastPosition),
-                                  btVector3(2.0f * (kFarDistance - car->rangefinderInfo.downDistance), 2.0f * (car->rangefinderInfo.downDistance), 0));
+                                  Utils::glmToBullet(rangefinderInfo.downCastPosition),
+                                  btVector3(2.0f * (kFarDistance - rangefinderInfo.downDistance), 2.0f * (rangefinderInfo.downDistance), 0));
 }
 
 void DebugRenderer::DrawVroad(const std::shared_ptr<Track> &track)
@@ -3,6 +3,7 @@
 #include "BulletDebugDrawer.h"
 #include "../Camera/BaseCamera.h"
 #include "../Scene/Track.h"
+#include "VisibleSet.h"
 
 class DebugRenderer
 {
@@ -10,6 +11,7 @@ public:
     explicit DebugRenderer(const std::shared_ptr<BulletDebugDrawer> &bulletDebugDrawer);
     void Render(const std::shared_ptr<BaseCamera> &camera);
     void DrawTrackCollision(const std::shared_ptr<Track> &track);
+    void DrawVisibleSet(const VisibleSet &visibleSet);
     void DrawAABB(const AABB &aabb);
     void DrawFrustum(const std::shared_ptr<BaseCamera> &camera);
     void DrawCarRaycasts(const std::shared_ptr<Car> &car);
@@ -0,0 +1,158 @@
+#include "OcclusionCuller.h"
+
+#include <algorithm>
+
+constexpr uint32_t kSetupChunksPerThread = 4;  // Occluders vary a lot in size, so more chunks than threads to even them out
+constexpr uint32_t kCandidatesPerItem    = 64;
+
+OcclusionCuller::OcclusionCuller(uint32_t nThreads, uint32_t width, uint32_t height) : m_buffer(width, height)
+{
+    nThreads = std::max(nThreads, 1u);
+    m_triangleChunks.resize(nThreads * kSetupChunksPerThread);
+    for (uint32_t workerIdx = 1; workerIdx < nThreads; ++workerIdx)
+    {
+        m_workers.emplace_back(&OcclusionCuller::_WorkerLoop, this);
+    }
+}
+
+OcclusionCuller::~OcclusionCuller()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_dispatchMutex);
+        m_stopping = true;
+    }
+    m_dispatchCondition.notify_all();
+    for (auto &worker : m_workers)
+    {
+        worker.join();
+    }
+}
+
+void OcclusionCuller::Cull(const glm::mat4 &viewProjection,
+                           const std::vector<const std::vector<glm::vec3> *> &occluders,
+                           const std::vector<AABB> &candidates,
+                           std::vector<uint8_t> &visible)
+{
+    m_occluders  = &occluders;
+    m_candidates = &candidates;
+    m_visible    = &visible;
+    visible.resize(candidates.size());
+
+    m_occluderStarts.clear();
+    m_nOccluderTriangles = 0;
+    for (auto &occluder : occluders)
+    {
+        m_occluderStarts.emplace_back(m_nOccluderTriangles);
+        m_nOccluderTriangles += occluder->size() / 3;
+    }
+
+    m_buffer.SetViewProjection(viewProjection);
+    this->_RunPhase(Phase::SETUP, (uint32_t) m_triangleChunks.size());
+    this->_RunPhase(Phase::RASTERISE, m_buffer.GetNumBands());
+    this->_RunPhase(Phase::TEST, (uint32_t) ((candidates.size() + kCandidatesPerItem - 1) / kCandidatesPerItem));
+
+    m_occluders  = nullptr;
+    m_candidates = nullptr;
+    m_visible    = nullptr;
+}
+
+size_t OcclusionCuller::GetNumTriangles() const
+{
+    size_t nTriangles = 0;
+    for (auto &triangleChunk : m_triangleChunks)
+    {
+        nTriangles += triangleChunk.size();
+    }
+    return nTriangles;
+}
+
+void OcclusionCuller::_RunPhase(Phase phase, uint32_t nItems)
+{
+    m_nextItem.store(0);
+    {
+        std::lock_guard<std::mutex> lock(m_dispatchMutex);
+        m_phase        = phase;
+        m_nItems       = nItems;
+        m_nWorkersBusy = (uint32_t) m_workers.size();
+        ++m_dispatchIdx;
+    }
+    m_dispatchCondition.notify_all();
+
+    this->_RunItems();
+
+    std::unique_lock<std::mutex> lock(m_dispatchMutex);
+    m_doneCondition.wait(lock, [this] { return m_nWorkersBusy == 0; });
+}
+
+void OcclusionCuller::_RunItems()
+{
+    for (uint32_t itemIdx = m_nextItem.fetch_add(1); itemIdx < m_nItems; itemIdx = m_nextItem.fetch_add(1))
+    {
+        this->_RunItem(itemIdx);
+    }
+}
+
+void OcclusionCuller::_RunItem(uint32_t itemIdx)
+{
+    switch (m_phase)
+    {
+    case Phase::SETUP:
+    {
+        // An even share of all the occluders' triangles, which can start and end part way through an occluder
+        std::vector<OcclusionTriangle> &triangles = m_triangleChunks[itemIdx];
+        triangles.clear();
+        size_t triangleIdx    = (m_nOccluderTriangles * itemIdx) / m_nItems;
+        size_t endTriangleIdx = (m_nOccluderTriangles * (itemIdx + 1)) / m_nItems;
+        auto occluderIdx      = (size_t) (std::upper_bound(m_occluderStarts.begin(), m_occluderStarts.end(), triangleIdx) - m_occluderStarts.begin());
+        for (occluderIdx = occluderIdx > 0 ? occluderIdx - 1 : 0; triangleIdx < endTriangleIdx; ++occluderIdx)
+        {
+            const std::vector<glm::vec3> &occluder = *(*m_occluders)[occluderIdx];
+            size_t firstTriangle                   = triangleIdx - m_occluderStarts[occluderIdx];
+            size_t nTriangles                      = std::min(occluder.size() / 3 - firstTriangle, endTriangleIdx - triangleIdx);
+            m_buffer.SetupTriangles(occluder.data() + firstTriangle * 3, nTriangles, triangles);
+            triangleIdx += nTriangles;
+        }
+    }
+    break;
+    case Phase::RASTERISE:
+        m_buffer.ClearBand(itemIdx);
+        for (auto &triangles : m_triangleChunks)
+        {
+            m_buffer.DrawTriangles(triangles, itemIdx);
+        }
+        m_buffer.BuildHierarchy(itemIdx);
+        break;
+    case Phase::TEST:
+        for (size_t candidateIdx = itemIdx * kCandidatesPerItem; candidateIdx < std::min((size_t) (itemIdx + 1) * kCandidatesPerItem, m_candidates->size()); ++candidateIdx)
+        {
+            const AABB &candidate      = (*m_candidates)[candidateIdx];
+            (*m_visible)[candidateIdx] = m_buffer.IsVisible(candidate.position + candidate.min, candidate.position + candidate.max);
+        }
+        break;
+    }
+}
+
+void OcclusionCuller::_WorkerLoop()
+{
+    uint64_t lastDispatchIdx = 0;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_dispatchMutex);
+            m_dispatchCondition.wait(lock, [&] { return m_stopping || m_dispatchIdx != lastDispatchIdx; });
+            if (m_stopping)
+            {
+                return;
+            }
+            lastDispatchIdx = m_dispatchIdx;
+        }
+
+        this->_RunItems();
+
+        {
+            std::lock_guard<std::mutex> lock(m_dispatchMutex);
+            --m_nWorkersBusy;
+        }
+        m_doneCondition.notify_one();
+    }
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "../Physics/AABB.h"
+#include "../Physics/OcclusionBuffer.h"
+
+// Occlusion culls a frame's candidate AABBs against occluder triangles, spread across threads of its own. It can't share the Bullet
+// task scheduler as the simulation thread steps physics on that at the same time as frames are culled.
+// Each frame goes through three phases: projecting chunks of occluder triangles, drawing and reducing bands of the occlusion buffer,
+// then testing chunks of candidates. The workers and the calling thread pull items of each phase off a shared counter. No two items
+// write to the same place and depth only ever keeps the nearest, so what's culled doesn't depend on how the work was split.
+class OcclusionCuller
+{
+public:
+    // nThreads counts the calling thread, so 1 culls without any workers
+    explicit OcclusionCuller(uint32_t nThreads, uint32_t width = kOcclusionBufferWidth, uint32_t height = kOcclusionBufferHeight);
+    ~OcclusionCuller();
+    // Sets visible[i] to whether candidates[i] could be seen past the occluders. Each occluder is a list of world space triangles,
+    // three vertices at a time, borrowed only for the call.
+    void Cull(const glm::mat4 &viewProjection, const std::vector<const std::vector<glm::vec3> *> &occluders, const std::vector<AABB> &candidates, std::vector<uint8_t> &visible);
+
+    const OcclusionBuffer &GetBuffer() const
+    {
+        return m_buffer;
+    }
+    uint32_t GetNumThreads() const
+    {
+        return (uint32_t) m_workers.size() + 1;
+    }
+    // Drawn in the last Cull, after clipping
+    size_t GetNumTriangles() const;
+
+private:
+    enum class Phase : uint8_t
+    {
+        SETUP,
+        RASTERISE,
+        TEST
+    };
+
+    void _RunPhase(Phase phase, uint32_t nItems);
+    void _RunItems();
+    void _RunItem(uint32_t itemIdx);
+    void _WorkerLoop();
+
+    OcclusionBuffer m_buffer;
+    std::vector<std::vector<OcclusionTriangle>> m_triangleChunks; // Set up triangles, one list per setup item
+
+    // This frame's work, only valid during Cull
+    const std::vector<const std::vector<glm::vec3> *> *m_occluders = nullptr;
+    const std::vector<AABB> *m_candidates                          = nullptr;
+    std::vector<uint8_t> *m_visible                                = nullptr;
+    std::vector<size_t> m_occluderStarts; // First triangle of each occluder, counting across all of them
+    size_t m_nOccluderTriangles = 0;
+
+    // Hands phases to the worker threads
+    std::vector<std::thread> m_workers;
+    std::mutex m_dispatchMutex;
+    std::condition_variable m_dispatchCondition;
+    std::condition_variable m_doneCondition;
+    uint64_t m_dispatchIdx  = 0;
+    uint32_t m_nWorkersBusy = 0;
+    bool m_stopping         = false;
+    Phase m_phase           = Phase::SETUP;
+    uint32_t m_nItems       = 0;
+    std::atomic<uint32_t> m_nextItem{0};
+};
@@ -11,7 +11,7 @@ RaceNetRenderer::RaceNetRenderer(const std::shared_ptr<GLFWwindow> &window, cons
     ImGui::StyleColorsDark();
 }
 
-void RaceNetRenderer::Render(uint32_t tick, std::vector<TrainingAgent> &carList, std::shared_ptr<Track> &trackToRender)
+void RaceNetRenderer::Render(const TrainingSnapshot &snapshot, const std::shared_ptr<Track> &trackToRender, CarModel &carModel)
 {
     raceNetShader.HotReload(); // Racenet shader hot reload
     glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
@@ -43,27 +43,26 @@ void RaceNetRenderer::Render(uint32_t tick, std::vector<TrainingAgent> &carList,
             }
         }
 
-        // Draw Cars
-        for (auto &car_agent : carList)
+        // Draw Cars, top down so with Y and Z swapped
+        for (auto &agent : snapshot.agents)
         {
-            std::swap(car_agent.vehicle->carBodyModel.position.y, car_agent.vehicle->carBodyModel.position.z);
-            std::swap(car_agent.vehicle->carBodyModel.orientation.y, car_agent.vehicle->carBodyModel.orientation.z);
-            car_agent.vehicle->carBodyModel.update();
+            glm::vec3 position(agent.position.x, agent.position.z, agent.position.y);
+            glm::quat orientation(agent.orientation.w, agent.orientation.x, agent.orientation.z, agent.orientation.y);
 
-            raceNetShader.loadColor(car_agent.vehicle->vehicleProperties.colour);
-            raceNetShader.loadTransformationMatrix(car_agent.vehicle->carBodyModel.ModelMatrix);
-            car_agent.vehicle->carBodyModel.render();
+            raceNetShader.loadColor(agent.colour);
+            raceNetShader.loadTransformationMatrix(glm::translate(glm::mat4(1.0), position) * glm::toMat4(orientation));
+            carModel.render();
         }
 
         raceNetShader.unbind();
     }
 
     // Draw some useful info
-    ImGui::Text("Tick %d", tick);
+    ImGui::Text("Tick %u", snapshot.tick);
     ImGui::Text("Name Fitness Vroad AvgSpeed");
-    for (auto &carAgent : carList)
+    for (auto &agent : snapshot.agents)
     {
-        ImGui::Text("%s %d %d %f", carAgent.name.c_str(), carAgent.fitness, carAgent.ticksInsideVroad, carAgent.averageSpeed);
+        ImGui::Text("%s %d %d %f", agent.name, agent.fitness, agent.ticksInsideVroad, agent.averageSpeed);
     }
 
     // Draw Logger UI
@@ -78,7 +77,7 @@ void RaceNetRenderer::Render(uint32_t tick, std::vector<TrainingAgent> &carList,
     glfwSwapBuffers(m_window.get());
 }
 
-std::vector<int> RaceNetRenderer::GetVisibleTrackBlocks(shared_ptr<Track> &track_to_render)
+std::vector<int> RaceNetRenderer::GetVisibleTrackBlocks(const shared_ptr<Track> &track_to_render)
 {
     std::vector<int> activeTrackBlockIds;
 
@@ -14,14 +14,16 @@
 #include "../Util/Logger.h"
 #include "../Config.h"
 #include "../Shaders/RaceNetShader.h"
-#include "../RaceNet/Agents/TrainingAgent.h"
+#include "../RaceNet/TrainingSnapshot.h"
+#include "../Scene/Models/CarModel.h"
 
 class RaceNetRenderer
 {
 public:
     explicit RaceNetRenderer(const std::shared_ptr<GLFWwindow> &window, const std::shared_ptr<Logger> &onfs_logger);
     ~RaceNetRenderer();
-    void Render(uint32_t tick, std::vector<TrainingAgent> &carList, std::shared_ptr<Track> &trackToRender);
+    // Every agent is drawn with carModel, which is only read
+    void Render(const TrainingSnapshot &snapshot, const std::shared_ptr<Track> &trackToRender, CarModel &carModel);
 
 private:
     std::shared_ptr<GLFWwindow> m_window;
@@ -30,6 +32,6 @@ private:
     RaceNetShader raceNetShader;
     float minX = -250.f, maxX = 250.f, minY = 140.625f, maxY = -140.625f; // Default area to display for start of training
 
-    std::vector<int> GetVisibleTrackBlocks(shared_ptr<Track> &track_to_render);
+    std::vector<int> GetVisibleTrackBlocks(const shared_ptr<Track> &track_to_render);
     void RescaleUI();
 };
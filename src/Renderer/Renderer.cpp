@@ -7,6 +7,10 @@ Renderer::Renderer(const std::shared_ptr<GLFWwindow> &window,
                    const std::shared_ptr<BulletDebugDrawer> &debugDrawer) :
     m_logger(onfsLogger), m_nfsAssetList(installedNFS), m_window(window), m_track(currentTrack), m_debugRenderer(debugDrawer)
 {
+    if (Config::get().occlusionThreads > 0)
+    {
+        m_occlusionCuller = std::make_unique<OcclusionCuller>(Config::get().occlusionThreads);
+    }
     this->_InitialiseIMGUI();
     LOG(DEBUG) << "Renderer Initialised";
 }
@@ -79,8 +83,13 @@ bool Renderer::Render(float totalTime,
     bool newAssetSelected = false;
 
     // Perform frustum culling to get visible entities, from perspective of active camera
-    VisibleSet visibleSet = _FrustumCull(m_track, activeCamera, userParams);
-    visibleSet.lights.insert(visibleSet.lights.begin(), activeLight);
+    FrustumCull(m_track, activeCamera, userParams, m_visibleSet);
+    bool occlusionCull = userParams.occlusionCull && m_occlusionCuller;
+    if (occlusionCull)
+    {
+        OcclusionCull(m_track, activeCamera, *m_occlusionCuller, m_visibleSet);
+    }
+    m_visibleSet.lights.insert(m_visibleSet.lights.begin(), activeLight);
 
     if (userParams.drawHermiteFrustum)
     {
@@ -92,22 +101,36 @@ bool Renderer::Render(float totalTime,
         m_debugRenderer.DrawTrackCollision(m_track);
     }
 
+    if (userParams.drawVisibleAABB)
+    {
+        m_debugRenderer.DrawVisibleSet(m_visibleSet);
+    }
+
     if (userParams.drawVroad)
     {
         m_debugRenderer.DrawVroad(m_track);
     }
 
+    if (userParams.drawRaycast)
+    {
+        for (auto &racer : racers)
+        {
+            m_debugRenderer.DrawCarRaycasts(racer->vehicle);
+        }
+    }
+
     // Render the environment
-    m_shadowMapRenderer.Render(userParams.nearPlane, userParams.farPlane, activeLight, m_track->textureArrayID, visibleSet.entities, racers);
+    m_shadowMapRenderer.Render(userParams.nearPlane, userParams.farPlane, activeLight, m_track->textureArrayID, occlusionCull ? m_visibleSet.shadowCasters : m_visibleSet.entities,
+                               racers);
     m_skyRenderer.Render(activeCamera, activeLight, totalTime);
-    m_trackRenderer.Render(racers, activeCamera, m_track->textureArrayID, visibleSet.entities, visibleSet.lights, userParams, m_shadowMapRenderer.m_depthTextureID, 0.5f);
-    m_trackRenderer.RenderLights(activeCamera, visibleSet.lights);
+    m_trackRenderer.Render(racers, activeCamera, m_track->textureArrayID, m_visibleSet.entities, m_visibleSet.lights, userParams, m_shadowMapRenderer.m_depthTextureID, 0.5f);
+    m_trackRenderer.RenderLights(activeCamera, m_visibleSet.lights);
     m_debugRenderer.Render(activeCamera);
 
     // Render the Car and racers
     for (auto &racer : racers)
     {
-        m_carRenderer.Render(racer->vehicle, activeCamera, visibleSet.lights);
+        m_carRenderer.Render(racer->vehicle, activeCamera, m_visibleSet.lights);
     }
 
     if (this->_DrawMenuBar(loadedAssets))
@@ -126,82 +149,98 @@ bool Renderer::Render(float totalTime,
     return newAssetSelected;
 }
 
-VisibleSet Renderer::_FrustumCull(const std::shared_ptr<Track> &track, const std::shared_ptr<BaseCamera> &camera, ParamData &userParams)
+void Renderer::FrustumCull(const std::shared_ptr<Track> &track, const std::shared_ptr<BaseCamera> &camera, const ParamData &userParams, VisibleSet &visibleSet)
 {
-    VisibleSet visibleSet;
+    visibleSet.Clear();
 
     // Only update the frustum of the camera when actually culling, to save some performance
     camera->UpdateFrustum();
 
     // Perform frustum culling on the current camera, on local trackblocks
-    for (auto &trackBlockID : _GetLocalTrackBlockIDs(track, camera, userParams))
+    _GetLocalTrackBlockIDs(track, camera, userParams, visibleSet.trackBlockIDs);
+    for (auto &trackBlockID : visibleSet.trackBlockIDs)
     {
-        for (auto &trackEntity : track->trackBlocks[trackBlockID].track)
-        {
-            if (camera->viewFrustum.CheckIntersection(trackEntity.GetAABB()))
-            {
-                visibleSet.entities.emplace_back(std::make_shared<Entity>(trackEntity));
-            }
-        }
-        for (auto &objectEntity : track->trackBlocks[trackBlockID].objects)
-        {
-            if (camera->viewFrustum.CheckIntersection(objectEntity.GetAABB()))
-            {
-                visibleSet.entities.emplace_back(std::make_shared<Entity>(objectEntity));
-            }
-        }
-        for (auto &laneEntity : track->trackBlocks[trackBlockID].lanes)
+        OpenNFS::TrackBlock &trackBlock = track->trackBlocks[trackBlockID];
+        camera->viewFrustum.CheckIntersections(trackBlock.trackBounds, visibleSet.visibilityMask);
+        _AddVisibleEntities(trackBlock.track, visibleSet.visibilityMask, visibleSet.entities);
+        camera->viewFrustum.CheckIntersections(trackBlock.objectBounds, visibleSet.visibilityMask);
+        _AddVisibleEntities(trackBlock.objects, visibleSet.visibilityMask, visibleSet.entities);
+        for (auto &laneEntity : trackBlock.lanes)
         {
             // It's not worth checking for Lane AABB intersections
-            visibleSet.entities.emplace_back(std::make_shared<Entity>(laneEntity));
-        }
-        for (auto &lightEntity : track->trackBlocks[trackBlockID].lights)
-        {
-            if (camera->viewFrustum.CheckIntersection(lightEntity.GetAABB()))
-            {
-                visibleSet.lights.emplace_back(boost::get<shared_ptr<BaseLight>>(lightEntity.raw));
-            }
+            visibleSet.entities.emplace_back(&laneEntity);
         }
     }
 
-    // Global Objects are always visible
-    for (auto &globalEntity : track->globalObjects)
+    track->globalObjectTree.QueryFrustum(camera->viewFrustum, visibleSet.treeObjects);
+    for (auto &globalObjectIdx : visibleSet.treeObjects)
     {
-        visibleSet.entities.emplace_back(std::make_shared<Entity>(globalEntity));
+        visibleSet.entities.emplace_back(&track->globalObjects[globalObjectIdx]);
     }
 
-    // TODO: Fix the AABB tree
-    // auto aabbCollisions = track->cullTree.queryOverlaps(camera->viewFrustum);
-    // for(auto &collision : aabbCollisions)
-    //{
-    //    visibleEntities.emplace_back(std::static_pointer_cast<Entity>(collision));
-    //}
-
-    return visibleSet;
+    // The shader only takes a handful of lights, so keep to those of the local trackblocks
+    visibleSet.treeObjects.clear();
+    track->lightTree.QueryFrustum(camera->viewFrustum, visibleSet.treeObjects);
+    for (auto &trackLightIdx : visibleSet.treeObjects)
+    {
+        const auto &trackLight = track->trackLights[trackLightIdx];
+        if (std::find(visibleSet.trackBlockIDs.begin(), visibleSet.trackBlockIDs.end(), trackLight.first) != visibleSet.trackBlockIDs.end())
+        {
+            visibleSet.lights.emplace_back(boost::get<shared_ptr<BaseLight>>(track->trackBlocks[trackLight.first].lights[trackLight.second].raw));
+        }
+    }
 }
 
-std::vector<uint32_t> Renderer::_GetLocalTrackBlockIDs(const std::shared_ptr<Track> &track, const std::shared_ptr<BaseCamera> &camera, ParamData &userParams)
+void Renderer::OcclusionCull(const std::shared_ptr<Track> &track, const std::shared_ptr<BaseCamera> &camera, OcclusionCuller &occlusionCuller, VisibleSet &visibleSet)
 {
-    std::vector<uint32_t> activeTrackBlockIds;
-    uint32_t closestBlockID = 0;
+    visibleSet.shadowCasters = visibleSet.entities;
 
-    float lowestDistance = FLT_MAX;
+    visibleSet.occluders.clear();
+    for (auto &trackBlockID : visibleSet.trackBlockIDs)
+    {
+        visibleSet.occluders.emplace_back(&track->trackBlocks[trackBlockID].occluders);
+    }
+    visibleSet.occlusionCandidates.clear();
+    for (auto &entity : visibleSet.entities)
+    {
+        visibleSet.occlusionCandidates.emplace_back(entity->GetAABB());
+    }
+    occlusionCuller.Cull(camera->projectionMatrix * camera->viewMatrix, visibleSet.occluders, visibleSet.occlusionCandidates, visibleSet.occlusionVisible);
 
-    // Get closest track block to camera position
-    for (auto &trackblock : track->trackBlocks)
+    size_t nVisible = 0;
+    for (size_t entityIdx = 0; entityIdx < visibleSet.entities.size(); ++entityIdx)
+    {
+        if (visibleSet.occlusionVisible[entityIdx])
+        {
+            visibleSet.entities[nVisible++] = visibleSet.entities[entityIdx];
+        }
+    }
+    visibleSet.entities.resize(nVisible);
+}
+
+void Renderer::_AddVisibleEntities(std::vector<Entity> &entities, const std::vector<uint32_t> &visibilityMask, std::vector<Entity *> &visibleEntities)
+{
+    for (size_t entityIdx = 0; entityIdx < entities.size(); ++entityIdx)
     {
-        float distance = glm::distance(camera->position, trackblock.position);
-        if (distance < lowestDistance)
+        if ((visibilityMask[entityIdx / 32] >> (entityIdx % 32)) & 1)
         {
-            closestBlockID = trackblock.id;
-            lowestDistance = distance;
+            visibleEntities.emplace_back(&entities[entityIdx]);
         }
     }
+}
+
+void Renderer::_GetLocalTrackBlockIDs(const std::shared_ptr<Track> &track,
+                                      const std::shared_ptr<BaseCamera> &camera,
+                                      const ParamData &userParams,
+                                      std::vector<uint32_t> &activeTrackBlockIds)
+{
+    // Get closest track block to camera position
+    uint32_t closestBlockID = track->spatialIndex.GetNearestTrackblock(camera->position);
 
     if (userParams.useNbData)
     {
         // Use the provided neighbour data to work out which blocks to render
-        activeTrackBlockIds = track->trackBlocks[closestBlockID].neighbourIds;
+        activeTrackBlockIds.assign(track->trackBlocks[closestBlockID].neighbourIds.begin(), track->trackBlocks[closestBlockID].neighbourIds.end());
     }
     else
     {
@@ -212,8 +251,6 @@ std::vector<uint32_t> Renderer::_GetLocalTrackBlockIDs(const std::shared_ptr<Tra
             activeTrackBlockIds.emplace_back(activeBlock);
         }
     }
-
-    return activeTrackBlockIds;
 }
 
 void Renderer::_InitialiseIMGUI()
@@ -225,7 +262,7 @@ void Renderer::_InitialiseIMGUI()
     ImGui::StyleColorsDark();
 }
 
-void Renderer::DrawMetadata(Entity *targetEntity)
+void Renderer::DrawMetadata(Entity *targetEntity, CommandQueue &simulationCommands)
 {
     ImGui::Begin("Engine Entity");
     ImGui::Text("%s", ToString(targetEntity->tag));
@@ -290,25 +327,52 @@ void Renderer::DrawMetadata(Entity *targetEntity)
             ImVec4 carColourIm(carColour.colour.x, carColour.colour.y, carColour.colour.z, 0);
             ImGui::ColorEdit4(carColour.colourName.c_str(), (float *) &carColourIm); // Edit 3 floats representing a color
         }
+        // Shown from the last snapshot, the live values belong to the simulation thread
+        VehicleTelemetry &telemetry = targetCar->renderTelemetry;
         ImGui::Text("Ray Distances U: %f F: %f R: %f L: %f",
-                    targetCar->rangefinderInfo.upDistance,
-                    targetCar->rangefinderInfo.rangefinders[RayDirection::FORWARD_RAY],
-                    targetCar->rangefinderInfo.rangefinders[RayDirection::RIGHT_RAY],
-                    targetCar->rangefinderInfo.rangefinders[RayDirection::LEFT_RAY]);
-        ImGui::Text("Speed %f", targetCar->GetVehicle()->getCurrentSpeedKmHour() / 10.f);
+                    telemetry.rangefinderInfo.upDistance,
+                    telemetry.rangefinderInfo.rangefinders[RayDirection::FORWARD_RAY],
+                    telemetry.rangefinderInfo.rangefinders[RayDirection::RIGHT_RAY],
+                    telemetry.rangefinderInfo.rangefinders[RayDirection::LEFT_RAY]);
+        ImGui::Text("Speed %f", telemetry.speed / 10.f);
         // Physics Parameters
-        ImGui::SliderFloat("Engine Force", &targetCar->vehicleState.gEngineForce, 0, 10000.0f);
-        ImGui::SliderFloat("Breaking Force", &targetCar->vehicleState.gBreakingForce, 0, 1000.0f);
-        ImGui::SliderFloat("Max Engine Force", &targetCar->vehicleProperties.maxEngineForce, 0, 10000.0f);
-        ImGui::SliderFloat("Max Breaking Force", &targetCar->vehicleProperties.maxBreakingForce, 0, 1000.0f);
-        ImGui::SliderFloat("Susp Rest.", &targetCar->vehicleProperties.suspensionRestLength, 0, 0.1f); // btScalar(0.030);
-        ImGui::SliderFloat("Susp Stiff.", &targetCar->vehicleProperties.suspensionStiffness, 0, 1000.f);
-        ImGui::SliderFloat("Susp Damp.", &targetCar->vehicleProperties.suspensionDamping, 0, 1000.f);
-        ImGui::SliderFloat("Susp Compr.", &targetCar->vehicleProperties.suspensionCompression, 0, 1000.f);
-        ImGui::SliderFloat("Friction.", &targetCar->vehicleProperties.wheelFriction, 0, 1.f);
-        ImGui::SliderFloat("Roll Infl.", &targetCar->vehicleProperties.rollInfluence, 0, 0.5);
-        ImGui::SliderFloat("Steer Incr.", &targetCar->vehicleProperties.steeringIncrement, 0.f, 0.1f);
-        ImGui::SliderFloat("Steer Clamp", &targetCar->vehicleProperties.steeringClamp, 0.f, 0.5f);
+        bool stateEdited = ImGui::SliderFloat("Engine Force", &telemetry.state.gEngineForce, 0, 10000.0f);
+        stateEdited |= ImGui::SliderFloat("Breaking Force", &telemetry.state.gBreakingForce, 0, 1000.0f);
+        bool propertiesEdited = ImGui::SliderFloat("Max Engine Force", &telemetry.properties.maxEngineForce, 0, 10000.0f);
+        propertiesEdited |= ImGui::SliderFloat("Max Breaking Force", &telemetry.properties.maxBreakingForce, 0, 1000.0f);
+        propertiesEdited |= ImGui::SliderFloat("Susp Rest.", &telemetry.properties.suspensionRestLength, 0, 0.1f); // btScalar(0.030);
+        propertiesEdited |= ImGui::SliderFloat("Susp Stiff.", &telemetry.properties.suspensionStiffness, 0, 1000.f);
+        propertiesEdited |= ImGui::SliderFloat("Susp Damp.", &telemetry.properties.suspensionDamping, 0, 1000.f);
+        propertiesEdited |= ImGui::SliderFloat("Susp Compr.", &telemetry.properties.suspensionCompression, 0, 1000.f);
+        propertiesEdited |= ImGui::SliderFloat("Friction.", &telemetry.properties.wheelFriction, 0, 1.f);
+        propertiesEdited |= ImGui::SliderFloat("Roll Infl.", &telemetry.properties.rollInfluence, 0, 0.5);
+        propertiesEdited |= ImGui::SliderFloat("Steer Incr.", &telemetry.properties.steeringIncrement, 0.f, 0.1f);
+        propertiesEdited |= ImGui::SliderFloat("Steer Clamp", &telemetry.properties.steeringClamp, 0.f, 0.5f);
+        if (stateEdited)
+        {
+            VehicleState state = telemetry.state;
+            simulationCommands.Push([targetCar, state] {
+                targetCar->vehicleState.gEngineForce   = state.gEngineForce;
+                targetCar->vehicleState.gBreakingForce = state.gBreakingForce;
+            });
+        }
+        if (propertiesEdited)
+        {
+            // Only the tuning, the renderer keeps reading the colour
+            VehicleProperties properties = telemetry.properties;
+            simulationCommands.Push([targetCar, properties] {
+                targetCar->vehicleProperties.maxEngineForce        = properties.maxEngineForce;
+                targetCar->vehicleProperties.maxBreakingForce      = properties.maxBreakingForce;
+                targetCar->vehicleProperties.suspensionRestLength  = properties.suspensionRestLength;
+                targetCar->vehicleProperties.suspensionStiffness   = properties.suspensionStiffness;
+                targetCar->vehicleProperties.suspensionDamping     = properties.suspensionDamping;
+                targetCar->vehicleProperties.suspensionCompression = properties.suspensionCompression;
+                targetCar->vehicleProperties.wheelFriction         = properties.wheelFriction;
+                targetCar->vehicleProperties.rollInfluence         = properties.rollInfluence;
+                targetCar->vehicleProperties.steeringIncrement     = properties.steeringIncrement;
+                targetCar->vehicleProperties.steeringClamp         = properties.steeringClamp;
+            });
+        }
         ImGui::Text("Roll (deg) x: %f y: %f z: %f",
                     glm::eulerAngles(targetCar->carBodyModel.orientation).x * 180 / SIMD_PI,
                     glm::eulerAngles(targetCar->carBodyModel.orientation).y * 180 / SIMD_PI,
@@ -340,9 +404,16 @@ void Renderer::_DrawDebugUI(ParamData &userParams, const std::shared_ptr<BaseCam
     ImGui::Checkbox("Hermite Curve Cam", &userParams.attachCamToHermite);
     ImGui::Checkbox("Car Cam", &userParams.attachCamToCar);
     ImGui::Text("X %f Y %f Z %f", camera->position.x, camera->position.y, camera->position.z);
+    ImGui::Text("Racers: %u full physics, %u kinematic", userParams.nFullRacers, userParams.nKinematicRacers);
     ImGui::Checkbox("Frustum Cull", &userParams.frustumCull);
+    ImGui::Checkbox("Occlusion Cull", &userParams.occlusionCull);
+    if (userParams.occlusionCull && m_occlusionCuller)
+    {
+        ImGui::Text("Unoccluded: %zu of %zu entities", m_visibleSet.entities.size(), m_visibleSet.shadowCasters.size());
+    }
     ImGui::Checkbox("Draw Herm Frustum", &userParams.drawHermiteFrustum);
     ImGui::Checkbox("Draw Track AABBs", &userParams.drawTrackAABB);
+    ImGui::Checkbox("Draw Visible AABBs", &userParams.drawVisibleAABB);
     ImGui::Checkbox("Raycast Viz", &userParams.drawRaycast);
     ImGui::Checkbox("AI Sim", &userParams.simulateCars);
     ImGui::Checkbox("Vroad Viz", &userParams.drawVroad);
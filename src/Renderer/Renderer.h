@@ -17,6 +17,7 @@
 #include "../Physics/PhysicsEngine.h"
 #include "../RaceNet/Agents/CarAgent.h"
 #include "../Util/Logger.h"
+#include "../Util/CommandQueue.h"
 #include "../Config.h"
 
 #include "HermiteCurve.h"
@@ -26,12 +27,8 @@
 #include "ShadowMapRenderer.h"
 #include "DebugRenderer.h"
 #include "MenuRenderer.h"
-
-struct VisibleSet
-{
-    std::vector<std::shared_ptr<Entity>> entities;
-    std::vector<std::shared_ptr<BaseLight>> lights;
-};
+#include "VisibleSet.h"
+#include "OcclusionCuller.h"
 
 class Renderer
 {
@@ -56,7 +53,8 @@ public:
     }
 
     static std::shared_ptr<GLFWwindow> InitOpenGL(uint32_t resolutionX, uint32_t resolutionY, const std::string &windowName);
-    static void DrawMetadata(Entity *targetEntity);
+    // Edits go through simulationCommands, as the simulation thread may be reading the entity
+    static void DrawMetadata(Entity *targetEntity, CommandQueue &simulationCommands);
     bool Render(float totalTime,
                 const std::shared_ptr<BaseCamera> &activeCamera,
                 const std::shared_ptr<HermiteCamera> &hermiteCamera,
@@ -64,13 +62,20 @@ public:
                 ParamData &userParams,
                 AssetData &loadedAssets,
                 const std::vector<std::shared_ptr<CarAgent>> &racers);
+    // Refills visibleSet with what camera can see of the trackblocks around it
+    static void FrustumCull(const std::shared_ptr<Track> &track, const std::shared_ptr<BaseCamera> &camera, const ParamData &userParams, VisibleSet &visibleSet);
+    // Then takes out the entities hidden behind the local trackblocks' occluders, keeping everything frustum culled as shadow casters
+    static void OcclusionCull(const std::shared_ptr<Track> &track, const std::shared_ptr<BaseCamera> &camera, OcclusionCuller &occlusionCuller, VisibleSet &visibleSet);
 
 private:
     void _InitialiseIMGUI();
     bool _DrawMenuBar(AssetData &loadedAssets);
     void _DrawDebugUI(ParamData &userParams, const std::shared_ptr<BaseCamera> &camera);
-    static std::vector<uint32_t> _GetLocalTrackBlockIDs(const shared_ptr<Track> &track, const std::shared_ptr<BaseCamera> &camera, ParamData &userParams);
-    static VisibleSet _FrustumCull(const std::shared_ptr<Track> &track, const std::shared_ptr<BaseCamera> &camera, ParamData &userParams);
+    static void _GetLocalTrackBlockIDs(const shared_ptr<Track> &track,
+                                       const std::shared_ptr<BaseCamera> &camera,
+                                       const ParamData &userParams,
+                                       std::vector<uint32_t> &activeTrackBlockIds);
+    static void _AddVisibleEntities(std::vector<Entity> &entities, const std::vector<uint32_t> &visibilityMask, std::vector<Entity *> &visibleEntities);
 
     std::shared_ptr<GLFWwindow> m_window;
     std::shared_ptr<Logger> m_logger;
@@ -83,4 +88,7 @@ private:
     ShadowMapRenderer m_shadowMapRenderer;
     DebugRenderer m_debugRenderer;
     MenuRenderer m_menuRenderer;
+
+    VisibleSet m_visibleSet; // Reused every frame
+    std::unique_ptr<OcclusionCuller> m_occlusionCuller; // Null with occlusion culling turned off
 };
@@ -15,6 +15,23 @@ Texture::Texture(NFSVer tag, uint32_t id, GLubyte *data, uint32_t width, uint32_
     this->rawTextureInfo = rawTextureInfo;
 }
 
+bool Texture::IsOpaque() const
+{
+    if (data == nullptr)
+    {
+        return false;
+    }
+    // RGBA
+    for (size_t texelIdx = 0; texelIdx < (size_t) width * height; ++texelIdx)
+    {
+        if (data[texelIdx * 4 + 3] != 255)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
 Texture Texture::LoadTexture(NFSVer tag, RawTextureInfo rawTrackTexture, const std::string &trackName)
 {
     std::stringstream filename;
@@ -445,10 +462,7 @@ GLuint Texture::MakeTextureArray(std::map<uint32_t, Texture> &textures, bool rep
     ASSERT(textures.size() < MAX_TEXTURE_ARRAY_SIZE, "Configured maximum texture array size of " << MAX_TEXTURE_ARRAY_SIZE << " has been exceeded");
 
     size_t max_width = 0, max_height = 0;
-    GLuint texture_name;
-
-    glGenTextures(1, &texture_name);
-    glBindTexture(GL_TEXTURE_2D_ARRAY, texture_name);
+    GLuint texture_name = 0;
 
     // Find the maximum width and height, so we can avoid overestimating with blanket values (256x256) and thereby scale UV's uneccesarily
     for (auto &texture : textures)
@@ -459,44 +473,57 @@ GLuint Texture::MakeTextureArray(std::map<uint32_t, Texture> &textures, bool rep
             max_height = texture.second.height;
     }
 
-    std::vector<uint32_t> clear_data(max_width * max_height, 0);
+    // Simulation only loads still lay the textures out, as geometry UVs are generated against the layers, but upload nothing
+    bool uploadToGL = Config::get().UseGL();
+    std::vector<uint32_t> clear_data;
 
-    LOG(INFO) << "Creating texture array with " << (int) textures.size() << " textures, max texture width " << max_width << ", max texture height " << max_height;
-    glTexStorage3D(GL_TEXTURE_2D_ARRAY,
-                   3,
-                   GL_RGBA8,
-                   static_cast<GLsizei>(max_width),
-                   static_cast<GLsizei>(max_height),
-                   MAX_TEXTURE_ARRAY_SIZE); // I should really call this on textures.size(), but the layer numbers are not linear up to
-                                            // textures.size(). HS Bloats tex index up over 2048.
+    if (uploadToGL)
+    {
+        glGenTextures(1, &texture_name);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, texture_name);
+
+        clear_data.resize(max_width * max_height, 0);
+
+        LOG(INFO) << "Creating texture array with " << (int) textures.size() << " textures, max texture width " << max_width << ", max texture height " << max_height;
+        glTexStorage3D(GL_TEXTURE_2D_ARRAY,
+                       3,
+                       GL_RGBA8,
+                       static_cast<GLsizei>(max_width),
+                       static_cast<GLsizei>(max_height),
+                       MAX_TEXTURE_ARRAY_SIZE); // I should really call this on textures.size(), but the layer numbers are not linear up to
+                                                // textures.size(). HS Bloats tex index up over 2048.
+    }
 
     for (auto &texture : textures)
     {
         ASSERT(texture.second.width <= max_width, "Texture " << texture.second.id << " exceeds maximum specified texture size (" << max_width << ") for Array");
         ASSERT(texture.second.height <= max_height, "Texture " << texture.second.id << " exceeds maximum specified texture size (" << max_height << ") for Array");
-        // Set the whole texture to transparent (so min/mag filters don't find bad data off the edge of the actual image data)
-        glTexSubImage3D(GL_TEXTURE_2D_ARRAY,
-                        0,
-                        0,
-                        0,
-                        hsStockTextureIndexRemap(texture.first),
-                        static_cast<GLsizei>(max_width),
-                        static_cast<GLsizei>(max_height),
-                        1,
-                        GL_RGBA,
-                        GL_UNSIGNED_BYTE,
-                        &clear_data[0]);
-        glTexSubImage3D(GL_TEXTURE_2D_ARRAY,
-                        0,
-                        0,
-                        0,
-                        hsStockTextureIndexRemap(texture.first),
-                        texture.second.width,
-                        texture.second.height,
-                        1,
-                        GL_RGBA,
-                        GL_UNSIGNED_BYTE,
-                        (const GLvoid *) texture.second.data);
+        if (uploadToGL)
+        {
+            // Set the whole texture to transparent (so min/mag filters don't find bad data off the edge of the actual image data)
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY,
+                            0,
+                            0,
+                            0,
+                            hsStockTextureIndexRemap(texture.first),
+                            static_cast<GLsizei>(max_width),
+                            static_cast<GLsizei>(max_height),
+                            1,
+                            GL_RGBA,
+                            GL_UNSIGNED_BYTE,
+                            &clear_data[0]);
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY,
+                            0,
+                            0,
+                            0,
+                            hsStockTextureIndexRemap(texture.first),
+                            texture.second.width,
+                            texture.second.height,
+                            1,
+                            GL_RGBA,
+                            GL_UNSIGNED_BYTE,
+                            (const GLvoid *) texture.second.data);
+        }
 
         texture.second.minU  = 0.00;
         texture.second.minV  = 0.00;
@@ -506,6 +533,11 @@ GLuint Texture::MakeTextureArray(std::map<uint32_t, Texture> &textures, bool rep
         texture.second.id    = texture_name;
     }
 
+    if (!uploadToGL)
+    {
+        return texture_name;
+    }
+
     if (repeatable)
     {
         glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
@@ -23,6 +23,8 @@ public:
     Texture() = default;
     explicit Texture(NFSVer tag, uint32_t id, GLubyte *data, uint32_t width, uint32_t height, RawTextureInfo rawTextureInfo);
     std::vector<glm::vec2> GenerateUVs(EntityType meshType, uint32_t textureFlags, RawTextureInfo rawTrackTexture);
+    // Whether every texel is fully opaque, so geometry textured with it hides what's behind it
+    bool IsOpaque() const;
 
     // Utils
     static Texture LoadTexture(NFSVer tag, RawTextureInfo rawTrackTexture, const std::string &trackName);
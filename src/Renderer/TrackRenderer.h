@@ -16,7 +16,7 @@ public:
     void Render(const std::vector<std::shared_ptr<CarAgent>> &racers,
                 const std::shared_ptr<BaseCamera> &camera,
                 GLuint trackTextureArrayID,
-                const std::vector<std::shared_ptr<Entity>> &visibleEntities,
+                const std::vector<Entity *> &visibleEntities,
                 const std::vector<shared_ptr<BaseLight>> &lights,
                 const ParamData &userParams,
                 GLuint depthTextureID,
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "../Physics/AABB.h"
+#include "../Scene/Entity.h"
+#include "../Scene/Lights/BaseLight.h"
+
+// What a camera can see this frame. Entities are borrowed from the track rather than copied, so a set is only good while its track
+// is loaded. It is cleared and refilled in place each frame, once its vectors have grown to fit the track culling doesn't allocate.
+struct VisibleSet
+{
+    std::vector<Entity *> entities;
+    std::vector<Entity *> shadowCasters; // Entities before occlusion culling, what's hidden from the camera can still cast into view
+    std::vector<std::shared_ptr<BaseLight>> lights;
+    std::vector<uint32_t> trackBlockIDs;  // Local trackblocks the entities were culled from
+    std::vector<uint32_t> visibilityMask; // Scratch for Frustum::CheckIntersections
+    std::vector<uint32_t> treeObjects;    // Scratch for AABBTree queries
+    // Scratch for OcclusionCuller::Cull
+    std::vector<const std::vector<glm::vec3> *> occluders;
+    std::vector<AABB> occlusionCandidates;
+    std::vector<uint8_t> occlusionVisible;
+
+    void Clear()
+    {
+        entities.clear();
+        shadowCasters.clear();
+        lights.clear();
+        trackBlockIDs.clear();
+        visibilityMask.clear();
+        treeObjects.clear();
+        occluders.clear();
+        occlusionCandidates.clear();
+        occlusionVisible.clear();
+    }
+};
@@ -46,14 +46,15 @@ void Entity::_GenCollisionMesh()
         std::vector<glm::vec3> vertices = trackLight->model.m_vertices;
         center                          = baseLight->position;
         float lightBoundScaleF          = 10.f;
+        auto *mesh                      = new btTriangleMesh();
         for (int i = 0; i < vertices.size() - 2; i += 3)
         {
             glm::vec3 triangle  = glm::vec3((vertices[i].x / lightBoundScaleF), (vertices[i].y / lightBoundScaleF), (vertices[i].z / lightBoundScaleF));
             glm::vec3 triangle1 = glm::vec3((vertices[i + 1].x / lightBoundScaleF), (vertices[i + 1].y / lightBoundScaleF), (vertices[i + 1].z / lightBoundScaleF));
             glm::vec3 triangle2 = glm::vec3((vertices[i + 2].x / lightBoundScaleF), (vertices[i + 2].y / lightBoundScaleF), (vertices[i + 2].z / lightBoundScaleF));
-            m_collisionMesh.addTriangle(Utils::glmToBullet(triangle), Utils::glmToBullet(triangle1), Utils::glmToBullet(triangle2), false);
+            mesh->addTriangle(Utils::glmToBullet(triangle), Utils::glmToBullet(triangle1), Utils::glmToBullet(triangle2), false);
         }
-        m_collisionShape = new btBvhTriangleMeshShape(&m_collisionMesh, true, true);
+        m_collisionShape = new btBvhTriangleMeshShape(mesh, true, true);
     }
     break;
     case VROAD:
@@ -112,14 +113,16 @@ void Entity::_GenCollisionMesh()
         else
         {
             // TODO: Use passable flags (flags&0x80) of VROAD to work out whether collidable
+            // Mesh lives on the heap so the shape survives copies of this Entity, and the track can be registered with more than one world
+            auto *mesh = new btTriangleMesh();
             for (size_t vertIdx = 0; vertIdx < vertices.size() - 2; vertIdx += 3)
             {
                 glm::vec3 triangle  = vertices[vertIdx];
                 glm::vec3 triangle1 = vertices[vertIdx + 1];
                 glm::vec3 triangle2 = vertices[vertIdx + 2];
-                m_collisionMesh.addTriangle(Utils::glmToBullet(triangle), Utils::glmToBullet(triangle1), Utils::glmToBullet(triangle2), false);
+                mesh->addTriangle(Utils::glmToBullet(triangle), Utils::glmToBullet(triangle1), Utils::glmToBullet(triangle2), false);
             }
-            m_collisionShape = new btBvhTriangleMeshShape(&m_collisionMesh, true, true);
+            m_collisionShape = new btBvhTriangleMeshShape(mesh, true, true);
         }
     }
     break;
@@ -183,8 +186,13 @@ void Entity::Update()
     }
     btTransform trans;
     m_motionState->getWorldTransform(trans);
-    boost::get<TrackModel>(raw).position    = Utils::bulletToGlm(trans.getOrigin());
-    boost::get<TrackModel>(raw).orientation = Utils::bulletToGlm(trans.getRotation());
+    this->Update(Utils::bulletToGlm(trans.getOrigin()), Utils::bulletToGlm(trans.getRotation()));
+}
+
+void Entity::Update(glm::vec3 position, glm::quat orientation)
+{
+    boost::get<TrackModel>(raw).position    = position;
+    boost::get<TrackModel>(raw).orientation = orientation;
     boost::get<TrackModel>(raw).update();
 }
 
@@ -33,12 +33,13 @@ public:
            glm::vec3 toA      = glm::vec3(0, 0, 0),
            glm::vec3 toB      = glm::vec3(0, 0, 0));
     void Update(); // Update Entity position based on Physics engine
+    void Update(glm::vec3 position, glm::quat orientation); // Update Entity position from a transform captured from the Physics engine
     AABB GetAABB() const;
 
     NFSVer tag;
     EntityType type;
     EngineModel raw;
-    btRigidBody* rigidBody;
+    btRigidBody* rigidBody = nullptr; // Only set for vroad barriers, worlds take ownership of dynamic object bodies and static track geometry lives in TrackCollision
     uint32_t parentTrackblockID, entityID;
     uint32_t flags;
     bool collideable = false;
@@ -48,7 +49,6 @@ public:
 
 private:
     glm::vec3 startPointA, startPointB, endPointA, endPointB;
-    btTriangleMesh m_collisionMesh;
     btCollisionShape* m_collisionShape;
     btDefaultMotionState* m_motionState;
     AABB m_boundingBox;
@@ -22,6 +22,9 @@ LightModel::LightModel() : Model("Light", std::vector<glm::vec3>(), std::vector<
 
 void LightModel::destroy()
 {
+    if (!Config::get().UseGL())
+        return;
+
     glDeleteBuffers(LightVBO::Length, m_lightVertexBuffers);
 }
 
@@ -37,6 +40,9 @@ void LightModel::render()
 
 bool LightModel::genBuffers()
 {
+    if (!Config::get().UseGL())
+        return true;
+
     glGenVertexArrays(1, &VertexArrayID);
     glBindVertexArray(VertexArrayID);
     glGenBuffers(LightVBO::Length, m_lightVertexBuffers);
@@ -161,7 +161,7 @@ void CarModel::update()
 
 void CarModel::destroy()
 {
-    if (!Config::get().vulkanRender)
+    if (Config::get().UseGL())
     {
         glDeleteBuffers(1, &vertexBuffer);
         glDeleteBuffers(1, &uvBuffer);
@@ -183,7 +183,7 @@ void CarModel::render()
 
 bool CarModel::genBuffers()
 {
-    if (Config::get().vulkanRender)
+    if (!Config::get().UseGL())
         return true;
 
     glGenVertexArrays(1, &VertexArrayID);
@@ -52,6 +52,9 @@ void TrackModel::update()
 
 void TrackModel::destroy()
 {
+    if (!Config::get().UseGL())
+        return;
+
     glDeleteBuffers(1, &m_vertexBuffer);
     glDeleteBuffers(1, &m_uvBuffer);
     glDeleteBuffers(1, &m_textureIndexBuffer);
@@ -72,6 +75,9 @@ void TrackModel::render()
 
 bool TrackModel::genBuffers()
 {
+    if (!Config::get().UseGL())
+        return true;
+
     glGenVertexArrays(1, &VertexArrayID);
     glBindVertexArray(VertexArrayID);
     // 1st attribute buffer : Vertices
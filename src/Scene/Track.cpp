@@ -13,20 +13,86 @@ void Track::GenerateSpline()
 
 void Track::GenerateAabbTree()
 {
-    // Build an optimised BvH of AABB's so that culling for render becomes cheap
-    for (auto &trackBlock : trackBlocks)
+    // Nothing in either tree moves, so they're built once top down rather than inserted into
+    std::vector<AABB> bounds;
+    for (auto &globalEntity : globalObjects)
+    {
+        bounds.emplace_back(globalEntity.GetAABB());
+    }
+    globalObjectTree.Build(bounds);
+
+    bounds.clear();
+    trackLights.clear();
+    for (uint32_t trackBlockIdx = 0; trackBlockIdx < trackBlocks.size(); ++trackBlockIdx)
     {
-        for (auto &baseTrackEntity : trackBlock.track)
+        for (uint32_t lightIdx = 0; lightIdx < trackBlocks[trackBlockIdx].lights.size(); ++lightIdx)
+        {
+            trackLights.emplace_back(trackBlockIdx, lightIdx);
+            bounds.emplace_back(trackBlocks[trackBlockIdx].lights[lightIdx].GetAABB());
+        }
+    }
+    lightTree.Build(bounds);
+}
+
+void Track::GenerateSpatialIndex()
+{
+    // Nearest trackblock and vroad queries run for every racer every tick, so index them rather than scanning
+    spatialIndex.Build(trackBlocks, virtualRoad);
+}
+
+void Track::GenerateCullingBounds()
+{
+    // Entity AABBs are fixed once loaded, so only need laying out for the batched frustum test once
+    auto buildBounds = [](const std::vector<Entity> &entities, CullingBounds &bounds) {
+        bounds.Clear();
+        for (auto &entity : entities)
         {
-            cullTree.insertObject(std::make_shared<Entity>(baseTrackEntity));
+            bounds.Add(entity.GetAABB());
         }
-        for (auto &trackObjectEntity : trackBlock.objects)
+    };
+    for (auto &trackBlock : trackBlocks)
+    {
+        buildBounds(trackBlock.track, trackBlock.trackBounds);
+        buildBounds(trackBlock.objects, trackBlock.objectBounds);
+    }
+}
+
+void Track::GenerateOccluders()
+{
+    // Only what's sure to hide everything behind it, and big enough to be worth drawing into the coarse occlusion buffer
+    std::set<uint32_t> opaqueTextures;
+    for (auto &texture : textureMap)
+    {
+        if (texture.second.IsOpaque())
         {
-            cullTree.insertObject(std::make_shared<Entity>(trackObjectEntity));
+            opaqueTextures.insert(texture.first);
         }
-        for (auto &trackLaneEntity : trackBlock.lanes)
+    }
+    size_t nOccluderTriangles = 0;
+    for (auto &trackBlock : trackBlocks)
+    {
+        trackBlock.occluders.clear();
+        for (auto &trackEntity : trackBlock.track)
         {
-            cullTree.insertObject(std::make_shared<Entity>(trackLaneEntity));
+            auto &trackModel = boost::get<TrackModel>(trackEntity.raw);
+            for (size_t vertIdx = 0; vertIdx + 2 < trackModel.m_vertices.size(); vertIdx += 3)
+            {
+                if (vertIdx >= trackModel.m_textureIndices.size() || !opaqueTextures.count(trackModel.m_textureIndices[vertIdx]))
+                {
+                    continue;
+                }
+                glm::vec3 triangle[3];
+                for (uint32_t cornerIdx = 0; cornerIdx < 3; ++cornerIdx)
+                {
+                    triangle[cornerIdx] = trackModel.initialPosition + trackModel.orientation * trackModel.m_vertices[vertIdx + cornerIdx];
+                }
+                if (glm::length(glm::cross(triangle[1] - triangle[0], triangle[2] - triangle[0])) * 0.5f >= kMinOccluderArea)
+                {
+                    trackBlock.occluders.insert(trackBlock.occluders.end(), triangle, triangle + 3);
+                }
+            }
         }
+        nOccluderTriangles += trackBlock.occluders.size() / 3;
     }
-}
\ No newline at end of file
+    LOG(INFO) << "Occlusion culling against " << nOccluderTriangles << " track triangles";
+}
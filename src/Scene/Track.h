@@ -3,24 +3,32 @@
 #include <cstdint>
 #include <vector>
 #include <memory>
+#include <set>
 
 #include "Entity.h"
 #include "TrackBlock.h"
 #include "VirtualRoad.h"
+#include "TrackSpatialIndex.h"
 
 #include "../Loaders/Shared/CanFile.h"
 #include "../Physics/AABBTree.h"
 #include "../Renderer/Texture.h"
 #include "../Renderer/HermiteCurve.h"
 
-constexpr uint16_t kCullTreeInitialSize = 4000;
+constexpr float kMinOccluderArea = 2.f; // Square metres, smaller track triangles cover too few pixels to be worth drawing as occluders
+
+class TrackCollision;
+class VroadWalls;
 
 class Track
 {
 public:
-    Track() : cullTree(kCullTreeInitialSize), nBlocks(0), nfsVersion(UNKNOWN){};
+    Track() : nBlocks(0), nfsVersion(UNKNOWN){};
     void GenerateSpline();
     void GenerateAabbTree();
+    void GenerateSpatialIndex();
+    void GenerateCullingBounds();
+    void GenerateOccluders();
 
     // Metadata
     NFSVer nfsVersion;
@@ -28,15 +36,24 @@ public:
     uint32_t nBlocks;
     std::vector<CameraAnimPoint> cameraAnimation;
     std::vector<VirtualRoad> virtualRoad;
+    std::vector<float> vroadSpeeds; // AI target speed (m/s) at each vroad node, empty if the track has none
     HermiteCurve centerSpline;
 
     // Geometry
     std::vector<OpenNFS::TrackBlock> trackBlocks;
     std::vector<Entity> globalObjects;
     std::vector<Entity> vroadBarriers;
+    TrackSpatialIndex spatialIndex;
 
     // GL 3D Render Data
     std::map<uint32_t, Texture> textureMap;
     GLuint textureArrayID = 0;
-    AABBTree cullTree;
+    // Global objects and lights aren't culled a trackblock at a time like the rest, but through trees over the whole track
+    AABBTree globalObjectTree;                              // Of globalObjects, by index
+    AABBTree lightTree;                                     // Of trackLights, by index
+    std::vector<std::pair<uint32_t, uint32_t>> trackLights; // Trackblock and index into its lights of every track light
+
+    // Physics Data, shared by every PhysicsEngine the track is registered with
+    std::shared_ptr<TrackCollision> collision;
+    std::shared_ptr<VroadWalls> vroadWalls; // Built by the first car with vroad rangefinders
 };
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include <vector>
 
 #include "Entity.h"
+#include "../Physics/CullingBounds.h"
 
 namespace OpenNFS
 {
@@ -23,5 +24,11 @@ namespace OpenNFS
         std::vector<Entity> lanes;
         std::vector<Entity> lights;
         std::vector<Entity> sounds;
+
+        // World space AABBs of track and objects, in the same order, for frustum culling in batches
+        CullingBounds trackBounds;
+        CullingBounds objectBounds;
+        // World space triangles, three vertices each, of the large opaque track polygons, to occlusion cull against
+        std::vector<glm::vec3> occluders;
     };
 } // namespace OpenNFS
@@ -0,0 +1,279 @@
+#include "TrackSpatialIndex.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+// Points per grid cell to aim for, a couple keeps the first ring cheap without leaving most cells empty
+constexpr float kPointsPerCell = 2.f;
+// A walk that ends this many vroad node spacings away from its node has probably been fooled by a hairpin or a teleport
+constexpr float kTrackingSpacingTolerance = 4.f;
+
+void PointGrid::Build(const std::vector<glm::vec3> &points, float targetPointsPerCell)
+{
+    m_points = points;
+    m_cellStart.clear();
+    m_cellPoints.clear();
+    if (m_points.empty())
+    {
+        m_nCellsX = m_nCellsZ = 0;
+        return;
+    }
+
+    glm::vec2 max(-FLT_MAX);
+    m_min = glm::vec2(FLT_MAX);
+    for (auto &point : m_points)
+    {
+        m_min = glm::min(m_min, glm::vec2(point.x, point.z));
+        max   = glm::max(max, glm::vec2(point.x, point.z));
+    }
+    glm::vec2 extent = glm::max(max - m_min, glm::vec2(1.f));
+    m_cellSize       = std::sqrt((extent.x * extent.y * targetPointsPerCell) / m_points.size());
+    m_nCellsX        = (int32_t) (extent.x / m_cellSize) + 1;
+    m_nCellsZ        = (int32_t) (extent.y / m_cellSize) + 1;
+
+    // Counting sort of point indices into cells
+    m_cellStart.assign((size_t) (m_nCellsX * m_nCellsZ) + 1, 0);
+    std::vector<uint32_t> pointCells(m_points.size());
+    for (uint32_t pointIdx = 0; pointIdx < m_points.size(); ++pointIdx)
+    {
+        int32_t cellX, cellZ;
+        this->_GetCell(m_points[pointIdx], cellX, cellZ);
+        pointCells[pointIdx] = (uint32_t) (cellZ * m_nCellsX + cellX);
+        ++m_cellStart[pointCells[pointIdx] + 1];
+    }
+    for (size_t cellIdx = 1; cellIdx < m_cellStart.size(); ++cellIdx)
+    {
+        m_cellStart[cellIdx] += m_cellStart[cellIdx - 1];
+    }
+    m_cellPoints.resize(m_points.size());
+    std::vector<uint32_t> cellFill(m_cellStart.begin(), m_cellStart.end() - 1);
+    for (uint32_t pointIdx = 0; pointIdx < m_points.size(); ++pointIdx)
+    {
+        m_cellPoints[cellFill[pointCells[pointIdx]]++] = pointIdx;
+    }
+}
+
+// Search rings of cells outward from the query's cell. Anything not yet searched lies outside the searched box, so once the box's
+// nearest inner edge (ignoring edges already past the grid) is further than the best point, that point is the nearest in 3D too.
+uint32_t PointGrid::GetNearest(const glm::vec3 &position) const
+{
+    uint32_t nearestPoint = 0;
+    float lowestDistance2 = FLT_MAX;
+    if (m_points.empty())
+    {
+        return nearestPoint;
+    }
+
+    int32_t cellX, cellZ;
+    this->_GetCell(position, cellX, cellZ);
+
+    auto searchCell = [&](int32_t x, int32_t z) {
+        if (x < 0 || z < 0 || x >= m_nCellsX || z >= m_nCellsZ)
+        {
+            return;
+        }
+        uint32_t cellIdx = (uint32_t) (z * m_nCellsX + x);
+        for (uint32_t entryIdx = m_cellStart[cellIdx]; entryIdx < m_cellStart[cellIdx + 1]; ++entryIdx)
+        {
+            glm::vec3 delta = m_points[m_cellPoints[entryIdx]] - position;
+            float distance2 = glm::dot(delta, delta);
+            if (distance2 < lowestDistance2)
+            {
+                nearestPoint    = m_cellPoints[entryIdx];
+                lowestDistance2 = distance2;
+            }
+        }
+    };
+
+    for (int32_t ring = 0;; ++ring)
+    {
+        for (int32_t z = cellZ - ring; z <= cellZ + ring; ++z)
+        {
+            if (z == cellZ - ring || z == cellZ + ring)
+            {
+                for (int32_t x = cellX - ring; x <= cellX + ring; ++x)
+                {
+                    searchCell(x, z);
+                }
+            }
+            else
+            {
+                searchCell(cellX - ring, z);
+                searchCell(cellX + ring, z);
+            }
+        }
+
+        bool pastMinX = cellX - ring <= 0, pastMaxX = cellX + ring >= m_nCellsX - 1;
+        bool pastMinZ = cellZ - ring <= 0, pastMaxZ = cellZ + ring >= m_nCellsZ - 1;
+        if (pastMinX && pastMaxX && pastMinZ && pastMaxZ)
+        {
+            break;
+        }
+        float unsearchedDistance = FLT_MAX;
+        if (!pastMinX)
+        {
+            unsearchedDistance = std::min(unsearchedDistance, position.x - (m_min.x + (cellX - ring) * m_cellSize));
+        }
+        if (!pastMaxX)
+        {
+            unsearchedDistance = std::min(unsearchedDistance, (m_min.x + (cellX + ring + 1) * m_cellSize) - position.x);
+        }
+        if (!pastMinZ)
+        {
+            unsearchedDistance = std::min(unsearchedDistance, position.z - (m_min.y + (cellZ - ring) * m_cellSize));
+        }
+        if (!pastMaxZ)
+        {
+            unsearchedDistance = std::min(unsearchedDistance, (m_min.y + (cellZ + ring + 1) * m_cellSize) - position.z);
+        }
+        if (unsearchedDistance > 0.f && unsearchedDistance * unsearchedDistance >= lowestDistance2)
+        {
+            break;
+        }
+    }
+
+    return nearestPoint;
+}
+
+void PointGrid::_GetCell(const glm::vec3 &position, int32_t &cellX, int32_t &cellZ) const
+{
+    cellX = std::min(std::max((int32_t) std::floor((position.x - m_min.x) / m_cellSize), 0), m_nCellsX - 1);
+    cellZ = std::min(std::max((int32_t) std::floor((position.z - m_min.y) / m_cellSize), 0), m_nCellsZ - 1);
+}
+
+void TrackSpatialIndex::Build(const std::vector<OpenNFS::TrackBlock> &trackBlocks, const std::vector<VirtualRoad> &virtualRoad)
+{
+    uint32_t nTrackblocks = (uint32_t) trackBlocks.size();
+
+    m_trackblockPositions.clear();
+    m_trackblockNeighbours.assign(nTrackblocks, {});
+    m_vroadTrackblocks.assign(virtualRoad.size(), 0);
+    for (auto &trackBlock : trackBlocks)
+    {
+        m_trackblockPositions.push_back(trackBlock.position);
+        // Adjacent blocks are always neighbours, some tracks don't carry any neighbour data
+        std::vector<uint32_t> &neighbours = m_trackblockNeighbours[trackBlock.id];
+        neighbours.push_back((trackBlock.id + 1) % nTrackblocks);
+        neighbours.push_back((trackBlock.id + nTrackblocks - 1) % nTrackblocks);
+        for (auto &neighbourID : trackBlock.neighbourIds)
+        {
+            if (neighbourID < nTrackblocks && neighbourID != trackBlock.id && std::find(neighbours.begin(), neighbours.end(), neighbourID) == neighbours.end())
+            {
+                neighbours.push_back(neighbourID);
+            }
+        }
+        for (uint32_t vroadIdx = trackBlock.virtualRoadStartIndex; vroadIdx < trackBlock.virtualRoadStartIndex + trackBlock.nVirtualRoadPositions && vroadIdx < virtualRoad.size(); ++vroadIdx)
+        {
+            m_vroadTrackblocks[vroadIdx] = trackBlock.id;
+        }
+    }
+
+    m_vroadPositions.clear();
+    float maxVroadSpacing = 0.f;
+    for (size_t vroadIdx = 0; vroadIdx < virtualRoad.size(); ++vroadIdx)
+    {
+        m_vroadPositions.push_back(virtualRoad[vroadIdx].position);
+        if (vroadIdx > 0)
+        {
+            maxVroadSpacing = std::max(maxVroadSpacing, glm::distance(virtualRoad[vroadIdx].position, virtualRoad[vroadIdx - 1].position));
+        }
+    }
+    m_maxTrackingDistance = maxVroadSpacing * kTrackingSpacingTolerance;
+
+    m_trackblockGrid.Build(m_trackblockPositions, kPointsPerCell);
+    m_vroadGrid.Build(m_vroadPositions, kPointsPerCell);
+}
+
+uint32_t TrackSpatialIndex::GetNearestTrackblock(const glm::vec3 &position) const
+{
+    return m_trackblockGrid.GetNearest(position);
+}
+
+uint32_t TrackSpatialIndex::GetNearestVroad(const glm::vec3 &position) const
+{
+    return m_vroadGrid.GetNearest(position);
+}
+
+void TrackSpatialIndex::UpdateLocation(const glm::vec3 &position, TrackLocation &location) const
+{
+    if (m_trackblockPositions.empty())
+    {
+        return;
+    }
+
+    if (location.valid && !m_vroadPositions.empty())
+    {
+        uint32_t vroadID = this->_ClimbVroad(position, location.vroadID);
+        if (glm::distance(position, m_vroadPositions[vroadID]) <= m_maxTrackingDistance)
+        {
+            // The nearest centre is nearly always the walked-to node's own block or a neighbour of it
+            uint32_t startTrackblockID = m_vroadTrackblocks[vroadID];
+            if (this->_DistanceToTrackblock(position, location.trackblockID) < this->_DistanceToTrackblock(position, startTrackblockID))
+            {
+                startTrackblockID = location.trackblockID;
+            }
+            location.vroadID      = vroadID;
+            location.trackblockID = this->_ClimbTrackblock(position, startTrackblockID);
+            return;
+        }
+    }
+
+    location.trackblockID = this->GetNearestTrackblock(position);
+    location.vroadID      = this->GetNearestVroad(position);
+    location.valid        = true;
+}
+
+uint32_t TrackSpatialIndex::_ClimbVroad(const glm::vec3 &position, uint32_t vroadID) const
+{
+    uint32_t nVroad       = (uint32_t) m_vroadPositions.size();
+    uint32_t nearestVroad = vroadID % nVroad;
+    float lowestDistance  = glm::distance(position, m_vroadPositions[nearestVroad]);
+    for (uint32_t stepIdx = 0; stepIdx < nVroad; ++stepIdx)
+    {
+        uint32_t currentVroad = nearestVroad;
+        for (uint32_t candidateVroad : {(currentVroad + 1) % nVroad, (currentVroad + nVroad - 1) % nVroad})
+        {
+            float distance = glm::distance(position, m_vroadPositions[candidateVroad]);
+            if (distance < lowestDistance)
+            {
+                nearestVroad   = candidateVroad;
+                lowestDistance = distance;
+            }
+        }
+        if (nearestVroad == currentVroad)
+        {
+            break;
+        }
+    }
+    return nearestVroad;
+}
+
+uint32_t TrackSpatialIndex::_ClimbTrackblock(const glm::vec3 &position, uint32_t trackblockID) const
+{
+    uint32_t nearestTrackblock = trackblockID;
+    float lowestDistance       = this->_DistanceToTrackblock(position, nearestTrackblock);
+    for (size_t stepIdx = 0; stepIdx < m_trackblockPositions.size(); ++stepIdx)
+    {
+        uint32_t currentTrackblock = nearestTrackblock;
+        for (auto &neighbourID : m_trackblockNeighbours[currentTrackblock])
+        {
+            float distance = this->_DistanceToTrackblock(position, neighbourID);
+            if (distance < lowestDistance)
+            {
+                nearestTrackblock = neighbourID;
+                lowestDistance    = distance;
+            }
+        }
+        if (nearestTrackblock == currentTrackblock)
+        {
+            break;
+        }
+    }
+    return nearestTrackblock;
+}
+
+float TrackSpatialIndex::_DistanceToTrackblock(const glm::vec3 &position, uint32_t trackblockID) const
+{
+    return glm::distance(position, m_trackblockPositions[trackblockID]);
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "TrackBlock.h"
+#include "VirtualRoad.h"
+
+// Where something was on the track at the last query. Held by whoever is being tracked, so each racer (or camera) walks on from its
+// own previous answer.
+struct TrackLocation
+{
+    uint32_t trackblockID = 0;
+    uint32_t vroadID      = 0;
+    bool valid            = false;
+};
+
+// Uniform grid over points on the ground plane (XZ), answering exact nearest point queries by searching outward ring by ring
+class PointGrid
+{
+public:
+    void Build(const std::vector<glm::vec3> &points, float targetPointsPerCell);
+    uint32_t GetNearest(const glm::vec3 &position) const;
+
+private:
+    void _GetCell(const glm::vec3 &position, int32_t &cellX, int32_t &cellZ) const;
+
+    std::vector<glm::vec3> m_points;
+    std::vector<uint32_t> m_cellStart; // Offset of each cell's first point index in m_cellPoints, plus a trailing end offset
+    std::vector<uint32_t> m_cellPoints;
+    glm::vec2 m_min{0.f};
+    float m_cellSize = 1.f;
+    int32_t m_nCellsX = 0, m_nCellsZ = 0;
+};
+
+// Built once at track load. Exact queries go through a grid over trackblock centres and vroad nodes, incremental queries start from
+// the previous answer and walk the vroad chain and trackblock neighbours, falling back to the grid when the walk can't be trusted.
+class TrackSpatialIndex
+{
+public:
+    void Build(const std::vector<OpenNFS::TrackBlock> &trackBlocks, const std::vector<VirtualRoad> &virtualRoad);
+    uint32_t GetNearestTrackblock(const glm::vec3 &position) const;
+    uint32_t GetNearestVroad(const glm::vec3 &position) const;
+    void UpdateLocation(const glm::vec3 &position, TrackLocation &location) const;
+
+private:
+    uint32_t _ClimbVroad(const glm::vec3 &position, uint32_t vroadID) const;
+    uint32_t _ClimbTrackblock(const glm::vec3 &position, uint32_t trackblockID) const;
+    float _DistanceToTrackblock(const glm::vec3 &position, uint32_t trackblockID) const;
+
+    std::vector<glm::vec3> m_trackblockPositions;
+    std::vector<std::vector<uint32_t>> m_trackblockNeighbours;
+    std::vector<glm::vec3> m_vroadPositions;
+    std::vector<uint32_t> m_vroadTrackblocks; // Trackblock that owns each vroad node
+    PointGrid m_trackblockGrid;
+    PointGrid m_vroadGrid;
+    float m_maxTrackingDistance = 0.f; // Further than this from the walked-to vroad node and the walk may have been fooled, so use the grid
+};
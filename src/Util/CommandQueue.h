@@ -0,0 +1,36 @@
+#pragma once
+
+#include <functional>
+#include <mutex>
+#include <vector>
+
+// Commands pushed from any thread and run, in the order they were pushed, by the one thread that owns the state they change. Lets
+// the render thread edit simulation state without touching it while a tick reads it.
+class CommandQueue
+{
+public:
+    void Push(std::function<void()> command)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pending.emplace_back(std::move(command));
+    }
+
+    // Owning thread side
+    void Run()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_running.swap(m_pending);
+        }
+        for (auto &command : m_running)
+        {
+            command();
+        }
+        m_running.clear();
+    }
+
+private:
+    std::mutex m_mutex;
+    std::vector<std::function<void()>> m_pending;
+    std::vector<std::function<void()>> m_running; // Kept between runs so the swap doesn't allocate
+};
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Lock-free single producer/single consumer triple buffer. The producer fills Back() and publishes it, the consumer acquires the
+// most recently published buffer. Neither side ever waits on the other, a slow consumer just skips to the latest value.
+template <typename T>
+class TripleBuffer
+{
+public:
+    // Producer side
+    T &Back()
+    {
+        return m_buffers[m_backIdx];
+    }
+    void Publish()
+    {
+        m_backIdx = m_ready.exchange(m_backIdx | kNewDataFlag) & kIndexMask;
+    }
+
+    // Consumer side, returns false and keeps the current front buffer if nothing new has been published
+    bool Acquire()
+    {
+        if (!(m_ready.load() & kNewDataFlag))
+        {
+            return false;
+        }
+        m_frontIdx = m_ready.exchange(m_frontIdx) & kIndexMask;
+        return true;
+    }
+    const T &Front() const
+    {
+        return m_buffers[m_frontIdx];
+    }
+
+private:
+    static constexpr uint8_t kIndexMask   = 0x3;
+    static constexpr uint8_t kNewDataFlag = 0x4;
+
+    T m_buffers[3];
+    uint8_t m_backIdx  = 0;
+    uint8_t m_frontIdx = 1;
+    std::atomic<uint8_t> m_ready{2};
+};
@@ -2,12 +2,18 @@
 
 namespace Utils
 {
+    static std::mt19937 s_randomEngine(std::random_device{}());
+
+    void SeedRandom(uint32_t seed)
+    {
+        s_randomEngine.seed(seed);
+    }
+
     float RandomFloat(float min, float max)
     {
-        static std::mt19937 mt(std::random_device{}());
         std::uniform_real_distribution<double> fdis(min, max);
 
-        return static_cast<float>(fdis(mt));
+        return static_cast<float>(fdis(s_randomEngine));
     }
 
     glm::vec3 bulletToGlm(const btVector3 &v)
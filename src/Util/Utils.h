@@ -62,6 +62,9 @@ namespace Utils
         std::chrono::time_point<clock_> m_beg;
     };
 
+    // Races seed this, so a recorded race can be replayed with the same random car colours
+    void SeedRandom(uint32_t seed);
+
     float RandomFloat(float min, float max);
 
     glm::vec3 bulletToGlm(const btVector3 &v);
@@ -8,6 +8,7 @@
 #endif
 
 #include <cstdlib>
+#include <random>
 #include <string>
 #include <iostream>
 #include <GL/glew.h>
@@ -19,9 +20,15 @@
 #include "Loaders/TrackLoader.h"
 #include "Loaders/CarLoader.h"
 #include "Loaders/MusicLoader.h"
+#include "Physics/PhysicsEngine.h"
 #include "Renderer/Renderer.h"
 #include "Race/RaceSession.h"
 #include "RaceNet/TrainingGround.h"
+#include "RaceNet/Farm/FarmWorker.h"
+#include "Benchmark/PhysicsBenchmark.h"
+#include "Benchmark/SpatialIndexBenchmark.h"
+#include "Benchmark/CullingBenchmark.h"
+#include "Benchmark/RaceNetBenchmark.h"
 
 using namespace boost::filesystem;
 
@@ -30,12 +37,18 @@ class OpenNFSEngine
 public:
     explicit OpenNFSEngine(std::shared_ptr<Logger> &onfs_logger) : logger(onfs_logger)
     {
+        if (!Config::get().checkpointToText.empty())
+        {
+            ExportCheckpointToText(Config::get().checkpointToText);
+            return;
+        }
         if (Config::get().renameAssets)
         {
             RenameAssetsToLowercase();
         }
         InitDirectories();
         PopulateAssets();
+        PhysicsEngine::InitTaskScheduler(Config::get().physicsThreads);
 
         if (Config::get().vulkanRender)
         {
@@ -46,10 +59,18 @@ public:
             ASSERT(false, "This build of OpenNFS was not compiled with Vulkan support!");
 #endif
         }
+        else if (!Config::get().farmWorker.empty())
+        {
+            farmWork();
+        }
         else if (Config::get().trainingMode)
         {
             train();
         }
+        else if (!Config::get().benchmark.empty())
+        {
+            bench();
+        }
         else
         {
             run();
@@ -60,14 +81,56 @@ public:
     {
         LOG(INFO) << "OpenNFS Version " << ONFS_VERSION;
 
-        // Must initialise OpenGL here as the Loaders instantiate meshes which create VAO's
-        std::shared_ptr<GLFWwindow> window = Renderer::InitOpenGL(Config::get().resX, Config::get().resY, "OpenNFS v" + ONFS_VERSION);
+        // A replay races what was recorded, whatever the command line asks for
+        std::shared_ptr<RaceReplay> replay;
+        uint32_t raceSeed = std::random_device{}();
+        if (!Config::get().replayPath.empty())
+        {
+            replay = std::make_shared<RaceReplay>();
+            if (!replay->Load(Config::get().replayPath))
+            {
+                LOG(WARNING) << Config::get().replayPath << " isn't a race recording this version of OpenNFS can read";
+                return;
+            }
+            if (replay->GetHeader().timeStep != kSimulationTimeStep)
+            {
+                LOG(WARNING) << Config::get().replayPath << " was recorded at a different simulation rate, it can't be replayed exactly";
+                return;
+            }
+            replay->GetHeader().ApplyToConfig();
+            raceSeed = replay->GetHeader().seed;
+        }
+        Utils::SeedRandom(raceSeed);
+        ASSERT(!Config::get().headless || replay, "Headless mode only supports training, benchmarks and replays, a race needs a window to render to");
+
+        std::shared_ptr<RaceRecorder> recorder;
+        if (!Config::get().recordPath.empty() && !replay)
+        {
+            recorder = std::make_shared<RaceRecorder>(Config::get().recordPath,
+                                                      RaceRecordingHeader::FromConfig(raceSeed, kSimulationTimeStep, Config::get().recordChecksumInterval));
+            if (!recorder->IsOpen())
+            {
+                LOG(WARNING) << "Couldn't open " << Config::get().recordPath << " to record the race to";
+                recorder.reset();
+            }
+        }
 
         AssetData loadedAssets = {getEnum(Config::get().carTag), Config::get().car, getEnum(Config::get().trackTag), Config::get().track};
 
         // TODO: TEMP FIX UNTIL I DO A PROPER RETURN from race session
         ASSERT(loadedAssets.trackTag != UNKNOWN, "Unknown track type!");
 
+        if (Config::get().headless)
+        {
+            auto track = TrackLoader::LoadTrack(loadedAssets.trackTag, loadedAssets.track);
+            auto car   = CarLoader::LoadCar(loadedAssets.carTag, loadedAssets.car);
+            RaceSession::ReplayHeadless(track, car, *replay);
+            return;
+        }
+
+        // Must initialise OpenGL here as the Loaders instantiate meshes which create VAO's
+        std::shared_ptr<GLFWwindow> window = Renderer::InitOpenGL(Config::get().resX, Config::get().resY, "OpenNFS v" + ONFS_VERSION);
+
         /*------- Render --------*/
         while (loadedAssets.trackTag != UNKNOWN)
         {
@@ -80,7 +143,10 @@ public:
             // Load Music
             // MusicLoader musicLoader("F:\\NFS3\\nfs3_modern_base_eng\\gamedata\\audio\\pc\\atlatech");
 
-            RaceSession race(window, logger, installedNFS, track, car);
+            // Only the first race is recorded or replayed, picking other assets from the menu starts an ordinary one
+            RaceSession race(window, logger, installedNFS, track, car, recorder, replay);
+            recorder.reset();
+            replay.reset();
             loadedAssets = race.Simulate();
         }
 
@@ -92,8 +158,12 @@ public:
     {
         LOG(INFO) << "OpenNFS Version " << ONFS_VERSION << " (GA Training Mode)";
 
-        // Must initialise OpenGL here as the Loaders instantiate meshes which create VAO's
-        std::shared_ptr<GLFWwindow> window = Renderer::InitOpenGL(Config::get().resX, Config::get().resY, "OpenNFS v" + ONFS_VERSION + " (GA Training Mode)");
+        // Must initialise OpenGL here as the Loaders instantiate meshes which create VAO's, unless headless where they stay on the CPU
+        std::shared_ptr<GLFWwindow> window;
+        if (!Config::get().headless)
+        {
+            window = Renderer::InitOpenGL(Config::get().resX, Config::get().resY, "OpenNFS v" + ONFS_VERSION + " (GA Training Mode)");
+        }
 
         AssetData trainingAssets = {getEnum(Config::get().carTag), Config::get().car, getEnum(Config::get().trackTag), Config::get().track};
 
@@ -106,11 +176,105 @@ public:
         auto trainingGround = TrainingGround(Config::get().nGenerations, Config::get().nTicks, track, car, logger, window);
     }
 
+    // Races species sent by a headless training coordinator, started with the same options it was plus --farm-worker
+    void farmWork()
+    {
+        LOG(INFO) << "OpenNFS Version " << ONFS_VERSION << " (Training Farm Worker)";
+        ASSERT(Config::get().headless, "Training farm workers only run headless, launch the coordinator with --headless");
+
+        std::unique_ptr<SpeciesEvaluator> speciesEvaluator;
+        FarmWorker farmWorker(Config::get().farmWorker, Config::get().farmTimeout / 4);
+        bool connected = farmWorker.Run(
+          [&]() {
+              AssetData trainingAssets = {getEnum(Config::get().carTag), Config::get().car, getEnum(Config::get().trackTag), Config::get().track};
+
+              /*------ ASSET LOAD ------*/
+              auto track               = TrackLoader::LoadTrack(trainingAssets.trackTag, trainingAssets.track);
+              std::shared_ptr<Car> car = CarLoader::LoadCar(trainingAssets.carTag, trainingAssets.car);
+              speciesEvaluator         = std::make_unique<SpeciesEvaluator>(track, car, Config::get().trainingShards);
+          },
+          [&](const std::string &batch) { return speciesEvaluator->EvaluateBatch(batch); });
+        if (!connected)
+        {
+            LOG(WARNING) << "No training coordinator at " << Config::get().farmWorker;
+        }
+    }
+
+    void bench()
+    {
+        LOG(INFO) << "OpenNFS Version " << ONFS_VERSION << " (Benchmark Mode)";
+
+        // Needs no assets, window or track
+        if (Config::get().benchmark == "racenet")
+        {
+            RaceNetBenchmark().Run();
+            return;
+        }
+
+        // Must initialise OpenGL here as the Loaders instantiate meshes which create VAO's, unless headless where they stay on the CPU
+        std::shared_ptr<GLFWwindow> window;
+        if (!Config::get().headless)
+        {
+            window = Renderer::InitOpenGL(Config::get().resX, Config::get().resY, "OpenNFS v" + ONFS_VERSION + " (Benchmark Mode)");
+        }
+
+        AssetData benchmarkAssets = {getEnum(Config::get().carTag), Config::get().car, getEnum(Config::get().trackTag), Config::get().track};
+
+        /*------ ASSET LOAD ------*/
+        auto track               = TrackLoader::LoadTrack(benchmarkAssets.trackTag, benchmarkAssets.track);
+        std::shared_ptr<Car> car = CarLoader::LoadCar(benchmarkAssets.carTag, benchmarkAssets.car);
+
+        if (Config::get().benchmark == "physics")
+        {
+            PhysicsBenchmark(track, car).Run();
+        }
+        else if (Config::get().benchmark == "broadphase")
+        {
+            PhysicsBenchmark(track, car).RunBroadphase();
+        }
+        else if (Config::get().benchmark == "raycaster")
+        {
+            PhysicsBenchmark(track, car).RunRaycaster();
+        }
+        else if (Config::get().benchmark == "rangefinder")
+        {
+            PhysicsBenchmark(track, car).RunRangefinder();
+        }
+        else if (Config::get().benchmark == "spatial")
+        {
+            SpatialIndexBenchmark(track).Run();
+        }
+        else if (Config::get().benchmark == "culling")
+        {
+            CullingBenchmark(track).Run();
+        }
+        else
+        {
+            LOG(WARNING) << "Unknown benchmark: " << Config::get().benchmark;
+        }
+
+        glfwTerminate();
+    }
+
 private:
     std::shared_ptr<Logger> logger;
 
     std::vector<NfsAssetList> installedNFS;
 
+    // Binary pool checkpoints can't be read by eye, this writes one out in the old text pool format as <checkpoint>.txt
+    static void ExportCheckpointToText(const std::string &checkpointPath)
+    {
+        pool pool(1, 1);
+        std::ifstream checkpoint(checkpointPath, std::ios::binary);
+        if (!pool.import_checkpoint(checkpoint))
+        {
+            LOG(WARNING) << checkpointPath << " isn't a pool checkpoint this version of OpenNFS can read";
+            return;
+        }
+        pool.export_tofile(checkpointPath + ".txt");
+        LOG(INFO) << "Exported generation " << pool.generation() << " of " << checkpointPath << " to " << checkpointPath << ".txt";
+    }
+
     static void InitDirectories()
     {
         if (!(exists(CAR_PATH)))
@@ -0,0 +1,212 @@
+#include "gtest/gtest.h"
+
+#include "../src/Physics/AABBTree.h"
+
+#include <algorithm>
+#include <random>
+#include <glm/gtc/matrix_transform.hpp>
+
+constexpr uint32_t kObjects = 1000;
+
+class AABBTreeTest : public testing::Test {
+public:
+    virtual void SetUp()
+    {
+        for (uint32_t object = 0; object < kObjects; ++object)
+        {
+            bounds.emplace_back(this->RandomBox());
+        }
+    }
+
+    // Scattered over something the size of a track, from small props to whole buildings
+    AABB RandomBox()
+    {
+        std::uniform_real_distribution<float> coordinate(-1000.f, 1000.f), size(0.1f, 40.f);
+        glm::vec3 halfSize(size(random), size(random), size(random));
+        return AABB(-halfSize, halfSize, glm::vec3(coordinate(random), coordinate(random) * 0.05f, coordinate(random)));
+    }
+
+    Frustum RandomFrustum()
+    {
+        std::uniform_real_distribution<float> coordinate(-1000.f, 1000.f);
+        glm::vec3 eye(coordinate(random), 2.f, coordinate(random));
+        Frustum frustum;
+        glm::vec3 target(coordinate(random), 0.f, coordinate(random));
+        frustum.Update(glm::perspective(glm::radians(60.f), 4.0f / 3.0f, 0.01f, 1000.0f) * glm::lookAt(eye, target, glm::vec3(0, 1, 0)));
+        return frustum;
+    }
+
+    // Every query against a brute force pass over the objects still in the tree
+    void ExpectMatchesBruteForce(const AABBTree &tree, const std::vector<bool> &inTree)
+    {
+        std::uniform_real_distribution<float> coordinate(-1000.f, 1000.f), radius(1.f, 200.f);
+        std::vector<uint32_t> found, expected;
+        for (uint32_t queryIdx = 0; queryIdx < 30; ++queryIdx)
+        {
+            Frustum frustum = this->RandomFrustum();
+            found.clear();
+            expected.clear();
+            tree.QueryFrustum(frustum, found);
+            for (uint32_t object = 0; object < bounds.size(); ++object)
+            {
+                if (inTree[object] && frustum.CheckIntersection(bounds[object]))
+                {
+                    expected.emplace_back(object);
+                }
+            }
+            std::sort(found.begin(), found.end());
+            ASSERT_EQ(found, expected) << "Frustum query " << queryIdx;
+
+            glm::vec3 centre(coordinate(random), 0.f, coordinate(random));
+            float sphereRadius = radius(random);
+            found.clear();
+            expected.clear();
+            tree.QuerySphere(centre, sphereRadius, found);
+            for (uint32_t object = 0; object < bounds.size(); ++object)
+            {
+                glm::vec3 offset = glm::clamp(centre, bounds[object].position + bounds[object].min, bounds[object].position + bounds[object].max) - centre;
+                if (inTree[object] && glm::dot(offset, offset) <= sphereRadius * sphereRadius)
+                {
+                    expected.emplace_back(object);
+                }
+            }
+            std::sort(found.begin(), found.end());
+            ASSERT_EQ(found, expected) << "Sphere query " << queryIdx;
+
+            // Along the ground, where the boxes are, so rays hit plenty of them. Brute forcing rays is slow so only for some.
+            if (queryIdx % 5 != 0)
+            {
+                continue;
+            }
+            glm::vec3 origin(coordinate(random), 0.f, coordinate(random));
+            glm::vec3 direction = glm::normalize(glm::vec3(coordinate(random), 0.f, coordinate(random)));
+            found.clear();
+            tree.QueryRay(origin, direction, 500.f, found);
+            for (auto &object : found)
+            {
+                ASSERT_TRUE(inTree[object]);
+            }
+            for (uint32_t object = 0; object < bounds.size(); ++object)
+            {
+                // Sample along the ray, anything it passes through the middle of has to be found
+                bool hit = false;
+                for (float t = 0.f; t <= 500.f && !hit; t += 0.25f)
+                {
+                    glm::vec3 point = origin + direction * t;
+                    hit             = glm::all(glm::greaterThan(point, bounds[object].position + bounds[object].min)) &&
+                                      glm::all(glm::lessThan(point, bounds[object].position + bounds[object].max));
+                }
+                if (inTree[object] && hit)
+                {
+                    ASSERT_NE(std::find(found.begin(), found.end(), object), found.end()) << "Ray query " << queryIdx << " missed " << object;
+                }
+            }
+        }
+    }
+
+    std::vector<AABB> bounds;
+    std::mt19937 random{7};
+};
+
+TEST_F(AABBTreeTest, BuiltTreeMatchesBruteForce)
+{
+    AABBTree tree;
+    tree.Build(bounds);
+    ASSERT_TRUE(tree.Validate());
+    EXPECT_EQ(tree.Size(), kObjects);
+    this->ExpectMatchesBruteForce(tree, std::vector<bool>(kObjects, true));
+}
+
+TEST_F(AABBTreeTest, InsertedTreeMatchesBruteForce)
+{
+    AABBTree tree;
+    for (uint32_t object = 0; object < kObjects; ++object)
+    {
+        tree.Insert(object, bounds[object]);
+    }
+    ASSERT_TRUE(tree.Validate());
+    this->ExpectMatchesBruteForce(tree, std::vector<bool>(kObjects, true));
+
+    // Rotations should keep a tree built up one at a time in the same league as a built one
+    AABBTree builtTree;
+    builtTree.Build(bounds);
+    EXPECT_LT(tree.GetHeight(), 3 * builtTree.GetHeight());
+    EXPECT_LT(tree.GetCost(), 2.f * builtTree.GetCost());
+}
+
+TEST_F(AABBTreeTest, RemoveAndUpdate)
+{
+    AABBTree tree(0.5f);
+    tree.Build(bounds);
+    std::vector<bool> inTree(kObjects, true);
+    for (uint32_t object = 0; object < kObjects; object += 3)
+    {
+        tree.Remove(object);
+        inTree[object] = false;
+    }
+    ASSERT_TRUE(tree.Validate());
+
+    // Move some a long way, which reinserts them, and nudge others, which shouldn't
+    for (uint32_t object = 1; object < kObjects; object += 3)
+    {
+        bounds[object] = this->RandomBox();
+        EXPECT_TRUE(tree.Update(object, bounds[object]));
+    }
+    for (uint32_t object = 2; object < kObjects; object += 3)
+    {
+        bounds[object].position += glm::vec3(0.1f, 0.f, 0.f);
+        EXPECT_FALSE(tree.Update(object, bounds[object]));
+    }
+    ASSERT_TRUE(tree.Validate());
+    EXPECT_EQ(tree.Size(), kObjects - (kObjects + 2) / 3);
+
+    // The fattened leaves mean queries may find more than brute force would, but never less
+    std::vector<uint32_t> found;
+    for (uint32_t queryIdx = 0; queryIdx < 30; ++queryIdx)
+    {
+        Frustum frustum = this->RandomFrustum();
+        found.clear();
+        tree.QueryFrustum(frustum, found);
+        for (uint32_t object = 0; object < kObjects; ++object)
+        {
+            bool wasFound = std::find(found.begin(), found.end(), object) != found.end();
+            if (!inTree[object])
+            {
+                ASSERT_FALSE(wasFound);
+            }
+            else if (frustum.CheckIntersection(bounds[object]))
+            {
+                ASSERT_TRUE(wasFound);
+            }
+        }
+    }
+}
+
+TEST_F(AABBTreeTest, Refit)
+{
+    AABBTree tree;
+    tree.Build(bounds);
+    for (auto &aabb : bounds)
+    {
+        aabb.position += glm::vec3(5.f, 1.f, -5.f);
+    }
+    for (uint32_t object = 0; object < kObjects; ++object)
+    {
+        tree.SetBounds(object, bounds[object]);
+    }
+    tree.Refit();
+    ASSERT_TRUE(tree.Validate());
+    this->ExpectMatchesBruteForce(tree, std::vector<bool>(kObjects, true));
+}
+
+TEST_F(AABBTreeTest, Empty)
+{
+    AABBTree tree;
+    tree.Build({});
+    std::vector<uint32_t> found;
+    tree.QueryFrustum(this->RandomFrustum(), found);
+    tree.QuerySphere(glm::vec3(0, 0, 0), 1000.f, found);
+    EXPECT_TRUE(found.empty());
+    EXPECT_TRUE(tree.Validate());
+    EXPECT_EQ(tree.GetHeight(), 0);
+}
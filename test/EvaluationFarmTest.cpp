@@ -0,0 +1,126 @@
+#include "gtest/gtest.h"
+
+#include "../src/RaceNet/Farm/EvaluationFarm.h"
+#include "../src/RaceNet/Farm/FarmWorker.h"
+
+#include <csignal>
+#include <unistd.h>
+#include <sys/wait.h>
+
+// Short enough that the lost worker tests finish well inside the test timeout
+static const uint32_t kTimeoutMs   = 500;
+static const uint32_t kHeartbeatMs = 50;
+
+// Stands in for a species evaluation, depends on nothing but the batch
+static std::string FakeEvaluate(const std::string &batch)
+{
+    uint32_t hash = 2166136261u;
+    for (auto &byte : batch)
+    {
+        hash = (hash ^ static_cast<uint8_t>(byte)) * 16777619u;
+    }
+    return std::to_string(hash);
+}
+
+class EvaluationFarmTest : public testing::Test {
+public:
+    virtual void SetUp()
+    {
+        endpoint = "unix:/tmp/onfs-farm-test-" + std::to_string(getpid()) + ".sock";
+        for (uint32_t batchIdx = 0; batchIdx < 64; ++batchIdx)
+        {
+            batches.emplace_back("species " + std::to_string(batchIdx));
+        }
+    }
+
+    virtual void TearDown()
+    {
+        for (auto &pid : workerPids)
+        {
+            kill(pid, SIGKILL);
+            waitpid(pid, nullptr, 0);
+        }
+    }
+
+    // failure is run in place of evaluating the failAfter'th batch the worker is given
+    void StartWorker(uint32_t failAfter = UINT32_MAX, const std::function<void()> &failure = nullptr)
+    {
+        int pid = fork();
+        if (pid == 0)
+        {
+            uint32_t nBatches = 0;
+            FarmWorker worker(endpoint, kHeartbeatMs);
+            worker.Run([] {},
+                       [&](const std::string &batch) {
+                           if (nBatches++ == failAfter)
+                           {
+                               failure();
+                           }
+                           return FakeEvaluate(batch);
+                       });
+            _exit(0);
+        }
+        workerPids.push_back(pid);
+    }
+
+    void ExpectResults(const std::vector<std::string> &results)
+    {
+        ASSERT_EQ(results.size(), batches.size());
+        for (size_t batchIdx = 0; batchIdx < batches.size(); ++batchIdx)
+        {
+            EXPECT_EQ(results[batchIdx], FakeEvaluate(batches[batchIdx]));
+        }
+    }
+
+    std::string endpoint;
+    std::vector<std::string> batches;
+    std::vector<int> workerPids;
+};
+
+TEST_F(EvaluationFarmTest, ResultsComeBackInBatchOrder)
+{
+    EvaluationFarm farm(endpoint, kTimeoutMs);
+    ASSERT_TRUE(farm.IsListening());
+    for (uint32_t workerIdx = 0; workerIdx < 3; ++workerIdx)
+    {
+        StartWorker();
+    }
+
+    // Twice, the same workers carry on from one generation to the next
+    for (uint32_t generationIdx = 0; generationIdx < 2; ++generationIdx)
+    {
+        std::vector<std::string> results;
+        ASSERT_TRUE(farm.Evaluate(batches, results));
+        ExpectResults(results);
+    }
+    EXPECT_EQ(farm.GetStats().nReassigned, 0u);
+}
+
+TEST_F(EvaluationFarmTest, LostWorkersBatchesAreReassigned)
+{
+    EvaluationFarm farm(endpoint, kTimeoutMs);
+    ASSERT_TRUE(farm.IsListening());
+    StartWorker();
+    // One crashes mid batch, the other hangs, heartbeats and all
+    StartWorker(2, [] { _exit(1); });
+    StartWorker(3, [] { raise(SIGSTOP); });
+
+    std::vector<std::string> results;
+    ASSERT_TRUE(farm.Evaluate(batches, results));
+    ExpectResults(results);
+    FarmStats stats = farm.GetStats();
+    EXPECT_EQ(stats.nWorkersLost, 2u);
+    EXPECT_EQ(stats.nReassigned, 2u);
+    EXPECT_EQ(stats.nWorkersReady, 1u);
+}
+
+TEST_F(EvaluationFarmTest, FailsOnceEveryWorkerHasGone)
+{
+    EvaluationFarm farm(endpoint, kTimeoutMs);
+    ASSERT_TRUE(farm.IsListening());
+    // Not a real worker, so it exits straight away without ever connecting
+    farm.SpawnLocalWorkers(1, "/bin/false", {});
+
+    std::vector<std::string> results;
+    EXPECT_FALSE(farm.Evaluate(batches, results));
+}
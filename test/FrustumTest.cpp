@@ -0,0 +1,70 @@
+#include "gtest/gtest.h"
+
+#include "../src/Physics/Frustum.h"
+
+#include <random>
+#include <glm/gtc/matrix_transform.hpp>
+
+class FrustumTest : public testing::Test {
+public:
+    // Cameras all over the place looking every which way, with the near and far planes the game uses
+    Frustum RandomFrustum()
+    {
+        std::uniform_real_distribution<float> coordinate(-500.f, 500.f), fov(30.f, 110.f);
+        glm::vec3 eye(coordinate(random), coordinate(random), coordinate(random));
+        glm::vec3 target = eye + glm::vec3(coordinate(random), coordinate(random), coordinate(random));
+        Frustum frustum;
+        frustum.Update(glm::perspective(glm::radians(fov(random)), 4.0f / 3.0f, 0.01f, 1000.0f) * glm::lookAt(eye, target, glm::vec3(0, 1, 0)));
+        return frustum;
+    }
+
+    // Sized like track geometry, from small props to whole road sections, spread over the frustum and around its edges
+    AABB RandomBox(const Frustum &frustum)
+    {
+        std::uniform_real_distribution<float> size(0.1f, 60.f), jitter(-30.f, 30.f);
+        std::uniform_int_distribution<int> corner(0, 7);
+        glm::vec3 centre = frustum.points[corner(random)] * 0.5f + frustum.points[corner(random)] * 0.5f + glm::vec3(jitter(random), jitter(random), jitter(random));
+        glm::vec3 halfSize(size(random), size(random), size(random));
+        return AABB(-halfSize, halfSize, centre);
+    }
+
+    std::mt19937 random{42};
+};
+
+TEST_F(FrustumTest, BatchMatchesSingleBoxTest)
+{
+    const uint32_t nFrustums = 200, nBoxes = 257; // Not a whole number of batches, or mask words
+    uint64_t nVisible = 0;
+    std::vector<uint32_t> visibilityMask;
+    for (uint32_t frustumIdx = 0; frustumIdx < nFrustums; ++frustumIdx)
+    {
+        Frustum frustum = this->RandomFrustum();
+        std::vector<AABB> boxes;
+        CullingBounds bounds;
+        for (uint32_t boxIdx = 0; boxIdx < nBoxes; ++boxIdx)
+        {
+            boxes.emplace_back(this->RandomBox(frustum));
+            bounds.Add(boxes.back());
+        }
+
+        frustum.CheckIntersections(bounds, visibilityMask);
+        ASSERT_EQ(visibilityMask.size(), (nBoxes + 31) / 32);
+        for (uint32_t boxIdx = 0; boxIdx < nBoxes; ++boxIdx)
+        {
+            bool visible = (visibilityMask[boxIdx / 32] >> (boxIdx % 32)) & 1;
+            ASSERT_EQ(visible, frustum.CheckIntersection(boxes[boxIdx])) << "Frustum " << frustumIdx << ", box " << boxIdx;
+            nVisible += visible;
+        }
+        EXPECT_EQ(visibilityMask.back() >> (nBoxes % 32), 0u) << "Padding reported visible";
+    }
+    // Make sure the boxes actually exercise both answers
+    EXPECT_GT(nVisible, 0u);
+    EXPECT_LT(nVisible, (uint64_t) nFrustums * nBoxes);
+}
+
+TEST_F(FrustumTest, EmptyBounds)
+{
+    std::vector<uint32_t> visibilityMask{~0u};
+    this->RandomFrustum().CheckIntersections(CullingBounds(), visibilityMask);
+    EXPECT_TRUE(visibilityMask.empty());
+}
@@ -0,0 +1,167 @@
+#include "gtest/gtest.h"
+
+#include "../src/Renderer/OcclusionCuller.h"
+#include "../src/Physics/Frustum.h"
+
+#include <random>
+#include <glm/gtc/matrix_transform.hpp>
+
+// A city of blocks with streets between them, which a camera drives down
+constexpr float kBlockSize        = 30.f;
+constexpr float kStreetWidth      = 12.f;
+constexpr uint32_t kBlocksPerSide = 8;
+constexpr uint32_t kProps         = 300;
+constexpr uint32_t kPathFrames    = 24;
+
+class OcclusionCullerTest : public testing::Test {
+public:
+    virtual void SetUp()
+    {
+        std::mt19937 random(11);
+        std::uniform_real_distribution<float> height(8.f, 40.f), coordinate(0.f, kBlocksPerSide * (kBlockSize + kStreetWidth)), size(0.5f, 3.f);
+        // Occluders come a row of blocks at a time, as they would a trackblock at a time
+        occluders.resize(kBlocksPerSide);
+        for (uint32_t blockX = 0; blockX < kBlocksPerSide; ++blockX)
+        {
+            for (uint32_t blockZ = 0; blockZ < kBlocksPerSide; ++blockZ)
+            {
+                glm::vec3 min(blockX * (kBlockSize + kStreetWidth), 0.f, blockZ * (kBlockSize + kStreetWidth));
+                glm::vec3 max = min + glm::vec3(kBlockSize, height(random), kBlockSize);
+                buildings.emplace_back(min, max, glm::vec3(0, 0, 0));
+                this->AddBox(min, max, occluders[blockX]);
+            }
+        }
+        for (auto &occluder : occluders)
+        {
+            occluderLists.emplace_back(&occluder);
+        }
+
+        candidates = buildings;
+        for (uint32_t propIdx = 0; propIdx < kProps; ++propIdx)
+        {
+            glm::vec3 min(coordinate(random), 0.f, coordinate(random));
+            candidates.emplace_back(min, min + glm::vec3(size(random), size(random), size(random)), glm::vec3(0, 0, 0));
+        }
+    }
+
+    static void AddBox(const glm::vec3 &min, const glm::vec3 &max, std::vector<glm::vec3> &triangles)
+    {
+        auto corner = [&](uint32_t cornerIdx) { return glm::vec3(cornerIdx & 1 ? max.x : min.x, cornerIdx & 2 ? max.y : min.y, cornerIdx & 4 ? max.z : min.z); };
+        const uint32_t faces[6][4] = {{0, 1, 3, 2}, {4, 5, 7, 6}, {0, 1, 5, 4}, {2, 3, 7, 6}, {0, 2, 6, 4}, {1, 3, 7, 5}};
+        for (auto &face : faces)
+        {
+            for (uint32_t vertIdx : {0, 1, 2, 0, 2, 3})
+            {
+                triangles.emplace_back(corner(face[vertIdx]));
+            }
+        }
+    }
+
+    // Down the streets at car height, weaving to look across the blocks, then from above the rooftops
+    static glm::mat4 PathViewProjection(uint32_t frameIdx, glm::vec3 &eye)
+    {
+        float streetX = 3 * (kBlockSize + kStreetWidth) - kStreetWidth / 2;
+        eye           = frameIdx < kPathFrames - 4 ? glm::vec3(streetX, 1.5f, frameIdx * 12.f) : glm::vec3(streetX, 60.f, frameIdx * 12.f);
+        glm::vec3 direction(std::sin(frameIdx * 0.7f) * 0.8f, frameIdx < kPathFrames - 4 ? 0.f : -0.3f, 1.f);
+        return glm::perspective(glm::radians(55.f), 16.f / 9.f, 0.5f, 1000.f) * glm::lookAt(eye, eye + direction, glm::vec3(0, 1, 0));
+    }
+
+    // Whether every point of the box on screen has a building in front of it, other than itself, sampled at its corners, edges, faces
+    // and centre with rays from the eye
+    bool IsHidden(const glm::vec3 &eye, const glm::mat4 &viewProjection, size_t candidateIdx)
+    {
+        const AABB &candidate = candidates[candidateIdx];
+        for (uint32_t sampleIdx = 0; sampleIdx < 27; ++sampleIdx)
+        {
+            glm::vec3 weights((sampleIdx % 3) * 0.5f, ((sampleIdx / 3) % 3) * 0.5f, (sampleIdx / 9) * 0.5f);
+            glm::vec3 point = candidate.min + (candidate.max - candidate.min) * weights;
+            glm::vec4 clip  = viewProjection * glm::vec4(point, 1.f);
+            if (clip.w <= 0.f || std::abs(clip.x) > clip.w || std::abs(clip.y) > clip.w || std::abs(clip.z) > clip.w)
+            {
+                continue;
+            }
+            bool pointHidden = false;
+            for (size_t buildingIdx = 0; buildingIdx < buildings.size() && !pointHidden; ++buildingIdx)
+            {
+                pointHidden = buildingIdx != candidateIdx && RayEntersBox(eye, point - eye, buildings[buildingIdx]);
+            }
+            if (!pointHidden)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Whether the segment from origin to origin + direction goes into the box, short of its end
+    static bool RayEntersBox(const glm::vec3 &origin, const glm::vec3 &direction, const AABB &box)
+    {
+        float entry = 0.f, exit = 1.f - 1e-3f;
+        for (uint32_t axis = 0; axis < 3; ++axis)
+        {
+            float near = (box.min[axis] - origin[axis]) / direction[axis];
+            float far  = (box.max[axis] - origin[axis]) / direction[axis];
+            entry      = std::max(entry, std::min(near, far));
+            exit       = std::min(exit, std::max(near, far));
+        }
+        return entry <= exit;
+    }
+
+    std::vector<AABB> buildings, candidates;
+    std::vector<std::vector<glm::vec3>> occluders;
+    std::vector<const std::vector<glm::vec3> *> occluderLists;
+};
+
+TEST_F(OcclusionCullerTest, WallHidesWhatIsBehindIt)
+{
+    std::vector<glm::vec3> wall;
+    this->AddBox(glm::vec3(-10.f, -10.f, -20.f), glm::vec3(10.f, 10.f, -20.f), wall);
+    glm::mat4 viewProjection = glm::perspective(glm::radians(55.f), 16.f / 9.f, 0.5f, 1000.f) * glm::lookAt(glm::vec3(0, 0, 0), glm::vec3(0, 0, -1), glm::vec3(0, 1, 0));
+    std::vector<AABB> boxes = {AABB(glm::vec3(-1, -1, -41), glm::vec3(1, 1, -39), glm::vec3(0, 0, 0)),   // Behind
+                               AABB(glm::vec3(-1, -1, -11), glm::vec3(1, 1, -9), glm::vec3(0, 0, 0)),    // In front
+                               AABB(glm::vec3(29, -1, -41), glm::vec3(31, 1, -39), glm::vec3(0, 0, 0)),  // Behind, off to the side of it
+                               AABB(glm::vec3(9, -1, -41), glm::vec3(20, 1, -39), glm::vec3(0, 0, 0)),   // Behind, poking out past its edge
+                               AABB(glm::vec3(-1, -1, -25), glm::vec3(1, 1, -15), glm::vec3(0, 0, 0))};  // Through it
+    std::vector<uint8_t> visible;
+
+    OcclusionCuller culler(1);
+    culler.Cull(viewProjection, {&wall}, boxes, visible);
+    EXPECT_EQ(visible, std::vector<uint8_t>({0, 1, 1, 1, 1}));
+
+    culler.Cull(viewProjection, {}, boxes, visible);
+    EXPECT_EQ(visible, std::vector<uint8_t>({1, 1, 1, 1, 1}));
+}
+
+TEST_F(OcclusionCullerTest, CameraPathIsConservative)
+{
+    OcclusionCuller serialCuller(1), parallelCuller(4);
+    std::vector<uint8_t> serialVisible, parallelVisible;
+    size_t nCulled = 0, nInFrustum = 0;
+    for (uint32_t frameIdx = 0; frameIdx < kPathFrames; ++frameIdx)
+    {
+        glm::vec3 eye;
+        glm::mat4 viewProjection = PathViewProjection(frameIdx, eye);
+        serialCuller.Cull(viewProjection, occluderLists, candidates, serialVisible);
+        parallelCuller.Cull(viewProjection, occluderLists, candidates, parallelVisible);
+        // However the work is split, the result is the same
+        ASSERT_EQ(serialVisible, parallelVisible) << "Frame " << frameIdx;
+
+        Frustum frustum;
+        frustum.Update(viewProjection);
+        for (size_t candidateIdx = 0; candidateIdx < candidates.size(); ++candidateIdx)
+        {
+            if (!frustum.CheckIntersection(candidates[candidateIdx]))
+            {
+                continue;
+            }
+            ++nInFrustum;
+            if (!serialVisible[candidateIdx])
+            {
+                ASSERT_TRUE(this->IsHidden(eye, viewProjection, candidateIdx)) << "Frame " << frameIdx << " culled candidate " << candidateIdx << " which can be seen";
+                ++nCulled;
+            }
+        }
+    }
+    // Most of what's in front of the camera in a city is behind the buildings nearest it
+    EXPECT_GT(nCulled, nInFrustum / 2);
+}
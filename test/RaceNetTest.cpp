@@ -0,0 +1,267 @@
+#include "gtest/gtest.h"
+
+#include "../src/RaceNet/RaceNet.h"
+
+#include <random>
+#include <sstream>
+
+// Shape of the networks TrainingGround evolves
+static const unsigned int kInputs  = 8;
+static const unsigned int kOutputs = 5;
+static const unsigned int kBias    = 4;
+
+class RaceNetTest : public testing::Test {
+public:
+    virtual void SetUp()
+    {
+        generator.seed(1337);
+    }
+
+    // Evolves the pool on random fitness, so later generations hold hidden nodes and disabled genes
+    void Evolve(pool &genePool)
+    {
+        std::uniform_int_distribution<unsigned int> fitness(0, 1000);
+        for (auto &species : genePool.species)
+            for (auto &genome : species.genomes)
+                genome.fitness = fitness(generator);
+        genePool.new_generation();
+    }
+
+    std::vector<float> RandomInputs(size_t nNets)
+    {
+        // Rangefinder distances and speed/10 all sit roughly between 0 and 5
+        std::uniform_real_distribution<float> input(0.f, 5.f);
+        std::vector<float> inputs(nNets * kInputs);
+        for (auto &value : inputs)
+            value = input(generator);
+        return inputs;
+    }
+
+    std::mt19937 generator;
+};
+
+// The compiled program runs in float, the interpreter in double, so they can only agree to float precision
+TEST_F(RaceNetTest, CompiledMatchesInterpreter){
+    pool genePool(kInputs, kOutputs, kBias, false);
+    for (int generation = 0; generation < 20; generation++)
+    {
+        for (auto &species : genePool.species)
+        {
+            for (auto &genome : species.genomes)
+            {
+                RaceNet raceNet;
+                raceNet.from_genome(genome);
+                std::vector<float> inputs = RandomInputs(1);
+                std::vector<double> interpreterInputs(inputs.begin(), inputs.end()), interpreterOutputs(kOutputs);
+                float compiledOutputs[kOutputs];
+
+                raceNet.evaluate(interpreterInputs, interpreterOutputs);
+                raceNet.evaluate(inputs.data(), kInputs, compiledOutputs, kOutputs);
+                for (unsigned int i = 0; i < kOutputs; i++)
+                    ASSERT_NEAR(interpreterOutputs[i], compiledOutputs[i], 1e-5) << "generation " << generation << " output " << i;
+            }
+        }
+        Evolve(genePool);
+    }
+}
+
+// Batches run the same operations per lane as the single network program
+TEST_F(RaceNetTest, BatchMatchesCompiled){
+    pool genePool(kInputs, kOutputs, kBias, false);
+    for (int generation = 0; generation < 20; generation++)
+    {
+        std::vector<RaceNet> raceNets;
+        for (auto &species : genePool.species)
+            for (auto &genome : species.genomes)
+            {
+                raceNets.emplace_back();
+                raceNets.back().from_genome(genome);
+            }
+        // Clones make sure full batches are exercised as well as mixed topologies
+        std::vector<RaceNet> clones(RACENET_BATCH_LANES * 2 + 3, raceNets.back());
+        raceNets.insert(raceNets.end(), clones.begin(), clones.end());
+
+        std::vector<RaceNet *> raceNetPtrs;
+        for (auto &raceNet : raceNets)
+            raceNetPtrs.push_back(&raceNet);
+        RaceNetBatch batch;
+        batch.build(raceNetPtrs);
+        ASSERT_EQ(batch.size(), raceNets.size());
+
+        std::vector<float> inputs = RandomInputs(raceNets.size());
+        std::vector<float> batchOutputs(raceNets.size() * kOutputs);
+        batch.evaluate(inputs.data(), kInputs, batchOutputs.data(), kOutputs);
+        for (size_t netIdx = 0; netIdx < raceNets.size(); netIdx++)
+        {
+            float compiledOutputs[kOutputs];
+            raceNets[netIdx].evaluate(&inputs[netIdx * kInputs], kInputs, compiledOutputs, kOutputs);
+            for (unsigned int i = 0; i < kOutputs; i++)
+                ASSERT_FLOAT_EQ(compiledOutputs[i], batchOutputs[netIdx * kOutputs + i]) << "generation " << generation << " network " << netIdx;
+        }
+        Evolve(genePool);
+    }
+}
+
+// Pooled agents rebind one RaceNet to genome after genome, which must leave nothing of the previous network behind
+TEST_F(RaceNetTest, RebindMatchesFreshNetwork){
+    pool genePool(kInputs, kOutputs, kBias, false);
+    for (int generation = 0; generation < 5; generation++)
+        Evolve(genePool);
+
+    RaceNet reused;
+    for (auto &species : genePool.species)
+    {
+        for (auto &genome : species.genomes)
+        {
+            RaceNet fresh;
+            fresh.from_genome(genome);
+            reused.from_genome(genome);
+            std::vector<float> inputs = RandomInputs(1);
+            float freshOutputs[kOutputs], reusedOutputs[kOutputs];
+            fresh.evaluate(inputs.data(), kInputs, freshOutputs, kOutputs);
+            reused.evaluate(inputs.data(), kInputs, reusedOutputs, kOutputs);
+            for (unsigned int i = 0; i < kOutputs; i++)
+                ASSERT_EQ(freshOutputs[i], reusedOutputs[i]);
+        }
+    }
+}
+
+// Compiled drivers are only used for the network they were generated from, so any change of weight has to show in the fingerprint
+TEST_F(RaceNetTest, FingerprintTracksWeights){
+    pool genePool(kInputs, kOutputs, kBias, false);
+    for (int generation = 0; generation < 5; generation++)
+        Evolve(genePool);
+
+    genome &genome = genePool.species.front().genomes.front();
+    RaceNet original, same, perturbed;
+    original.from_genome(genome);
+    same.from_genome(genome);
+    ASSERT_EQ(original.fingerprint(), same.fingerprint());
+
+    // Every gene, as some may feed hidden nodes no output depends on
+    for (auto &gene : genome.genes)
+        gene.weight += 0.5;
+    perturbed.from_genome(genome);
+    ASSERT_NE(original.fingerprint(), perturbed.fingerprint());
+}
+
+// Every child breeds from a stream of its own, so a seeded pool evolves the same however many threads breed it
+TEST_F(RaceNetTest, SeededPoolIgnoresThreadCount){
+    pool singleThreaded(kInputs, kOutputs, kBias, false, 1337);
+    pool multiThreaded(kInputs, kOutputs, kBias, false, 1337);
+    singleThreaded.set_threads(1);
+    multiThreaded.set_threads(4);
+
+    for (int generation = 0; generation < 10; generation++)
+    {
+        std::vector<std::pair<specie *, genome *>> singleGenomes = singleThreaded.get_genomes(), multiGenomes = multiThreaded.get_genomes();
+        ASSERT_EQ(singleGenomes.size(), multiGenomes.size()) << "generation " << generation;
+        for (size_t genomeIdx = 0; genomeIdx < singleGenomes.size(); genomeIdx++)
+        {
+            const genome &single = *singleGenomes[genomeIdx].second, &multi = *multiGenomes[genomeIdx].second;
+            ASSERT_EQ(single.genes.size(), multi.genes.size()) << "generation " << generation << " genome " << genomeIdx;
+            for (size_t geneIdx = 0; geneIdx < single.genes.size(); geneIdx++)
+            {
+                ASSERT_EQ(single.genes[geneIdx].innovation_num, multi.genes[geneIdx].innovation_num);
+                ASSERT_EQ(single.genes[geneIdx].weight, multi.genes[geneIdx].weight);
+                ASSERT_EQ(single.genes[geneIdx].enabled, multi.genes[geneIdx].enabled);
+            }
+
+            // Any fitness will do, as long as both pools are given the same
+            unsigned int fitness = static_cast<unsigned int>((genomeIdx * 7919 + single.genes.size() * 104729) % 1000);
+            singleGenomes[genomeIdx].second->fitness = fitness;
+            multiGenomes[genomeIdx].second->fitness  = fitness;
+        }
+        singleThreaded.new_generation();
+        multiThreaded.new_generation();
+    }
+}
+
+// A pool restored from a checkpoint, packed or not, carries on breeding exactly as the original would have
+TEST_F(RaceNetTest, CheckpointResumesIdentically){
+    for (bool packed : {true, false})
+    {
+        pool original(kInputs, kOutputs, kBias, false, 4242);
+        for (int generation = 0; generation < 3; generation++)
+            Evolve(original);
+
+        std::stringstream checkpoint;
+        original.export_checkpoint(checkpoint, packed);
+        pool restored(kInputs, kOutputs, kBias, false, 1);
+        ASSERT_TRUE(restored.import_checkpoint(checkpoint));
+        ASSERT_EQ(original.generation(), restored.generation());
+        ASSERT_EQ(original.seed(), restored.seed());
+
+        original.new_generation();
+        restored.new_generation();
+        std::vector<std::pair<specie *, genome *>> originalGenomes = original.get_genomes(), restoredGenomes = restored.get_genomes();
+        ASSERT_EQ(originalGenomes.size(), restoredGenomes.size());
+        for (size_t genomeIdx = 0; genomeIdx < originalGenomes.size(); genomeIdx++)
+        {
+            const genome &originalGenome = *originalGenomes[genomeIdx].second, &restoredGenome = *restoredGenomes[genomeIdx].second;
+            ASSERT_EQ(originalGenome.genes.size(), restoredGenome.genes.size());
+            for (size_t geneIdx = 0; geneIdx < originalGenome.genes.size(); geneIdx++)
+            {
+                ASSERT_EQ(originalGenome.genes[geneIdx].innovation_num, restoredGenome.genes[geneIdx].innovation_num);
+                ASSERT_EQ(originalGenome.genes[geneIdx].weight, restoredGenome.genes[geneIdx].weight);
+            }
+        }
+    }
+
+    std::stringstream garbage("not a checkpoint");
+    pool untouched(kInputs, kOutputs, kBias, false, 7);
+    ASSERT_FALSE(untouched.import_checkpoint(garbage));
+    ASSERT_EQ(untouched.seed(), 7u);
+}
+
+TEST_F(RaceNetTest, GenomeSurvivesExport){
+    pool genePool(kInputs, kOutputs, kBias, false, 99);
+    for (int generation = 0; generation < 5; generation++)
+        Evolve(genePool);
+
+    std::stringstream genomeBytes;
+    std::vector<std::pair<specie *, genome *>> genomes = genePool.get_genomes();
+    for (auto &exported : genomes)
+        export_genome(genomeBytes, *exported.second);
+
+    network_info_container info = {};
+    mutation_rate_container rates;
+    for (auto &exported : genomes)
+    {
+        genome imported(info, rates);
+        ASSERT_TRUE(import_genome(genomeBytes, imported));
+        RaceNet exportedNet, importedNet;
+        exportedNet.from_genome(*exported.second);
+        importedNet.from_genome(imported);
+        ASSERT_EQ(exportedNet.fingerprint(), importedNet.fingerprint());
+        ASSERT_EQ(exported.second->fitness, imported.fitness);
+    }
+}
+
+// Racing one genome at a time keeps the pool at its population, a generation passing for every population raced
+TEST_F(RaceNetTest, SteadyStateKeepsPopulation){
+    pool genePool(kInputs, kOutputs, kBias, false, 31);
+    unsigned int population = genePool.speciating_parameters.population;
+    unsigned int generation = genePool.generation();
+    std::vector<genome> racing = genePool.take_genomes();
+    ASSERT_EQ(racing.size(), population);
+    ASSERT_TRUE(genePool.species.empty());
+
+    std::uniform_int_distribution<unsigned int> fitness(0, 1000);
+    for (auto &raced : racing)
+    {
+        raced.fitness = fitness(generator);
+        ASSERT_EQ(genePool.add_evaluated(raced), &raced == &racing.back());
+    }
+    ASSERT_EQ(genePool.generation(), generation + 1);
+
+    for (unsigned int evaluation = 0; evaluation < 3 * population; evaluation++)
+    {
+        genome child = genePool.breed_steady_state();
+        ASSERT_EQ(child.fitness, 0u);
+        child.fitness = fitness(generator);
+        genePool.add_evaluated(child);
+        ASSERT_EQ(genePool.get_genomes().size(), population);
+    }
+    ASSERT_EQ(genePool.generation(), generation + 4);
+}
@@ -0,0 +1,102 @@
+#include "gtest/gtest.h"
+
+#include "../src/Race/RaceRecording.h"
+
+#include <cstdio>
+#include <unistd.h>
+
+class RaceRecordingTest : public testing::Test {
+public:
+    virtual void SetUp()
+    {
+        path = "/tmp/onfs-recording-test-" + std::to_string(getpid()) + ".rec";
+
+        header.seed             = 1234;
+        header.timeStep         = 1.f / 120;
+        header.checksumInterval = 2;
+        header.carTag           = "NFS_3";
+        header.car              = "diab";
+        header.trackTag         = "NFS_3";
+        header.track            = "trk006";
+        header.nRacers          = 8;
+        header.racerLodDistance = 150.f;
+    }
+
+    virtual void TearDown()
+    {
+        std::remove(path.c_str());
+    }
+
+    // Ticks as the simulation would record them, with a checksum every header.checksumInterval
+    void Record(uint32_t nTicks)
+    {
+        RaceRecorder recorder(path, header);
+        ASSERT_TRUE(recorder.IsOpen());
+        for (uint32_t tickIdx = 0; tickIdx < nTicks; ++tickIdx)
+        {
+            RecordedTick tick;
+            tick.playerInputs   = tickIdx % 64;
+            tick.simulateCars   = tickIdx % 3 != 0;
+            tick.cameraPosition = glm::vec3(tickIdx, -1.f, 0.5f);
+            tick.hasChecksum    = recorder.ChecksumDue();
+            tick.checksum       = tickIdx * 0x9E3779B97F4A7C15ULL;
+            recorder.RecordTick(tick);
+        }
+    }
+
+    std::string path;
+    RaceRecordingHeader header;
+};
+
+TEST_F(RaceRecordingTest, RoundTrip)
+{
+    this->Record(10);
+
+    RaceReplay replay;
+    ASSERT_TRUE(replay.Load(path));
+    EXPECT_EQ(replay.GetHeader().seed, header.seed);
+    EXPECT_EQ(replay.GetHeader().timeStep, header.timeStep);
+    EXPECT_EQ(replay.GetHeader().track, header.track);
+    EXPECT_EQ(replay.GetHeader().nRacers, header.nRacers);
+    ASSERT_EQ(replay.GetTicks().size(), 10u);
+    for (uint32_t tickIdx = 0; tickIdx < 10; ++tickIdx)
+    {
+        const RecordedTick &tick = replay.GetTicks()[tickIdx];
+        EXPECT_EQ(tick.playerInputs, tickIdx % 64);
+        EXPECT_EQ(tick.simulateCars, tickIdx % 3 != 0);
+        EXPECT_TRUE(tick.cameraPosition == glm::vec3(tickIdx, -1.f, 0.5f));
+        EXPECT_EQ(tick.hasChecksum, tickIdx % 2 == 1);
+        if (tick.hasChecksum)
+        {
+            EXPECT_EQ(tick.checksum, tickIdx * 0x9E3779B97F4A7C15ULL);
+        }
+    }
+}
+
+TEST_F(RaceRecordingTest, ReportsDivergence)
+{
+    this->Record(10);
+
+    RaceReplay replay;
+    ASSERT_TRUE(replay.Load(path));
+    for (uint32_t tickIdx = 0; tickIdx < 10; ++tickIdx)
+    {
+        // Goes wrong from tick 5 on
+        replay.Verify(tickIdx, tickIdx < 5 ? tickIdx * 0x9E3779B97F4A7C15ULL : 0);
+    }
+    EXPECT_EQ(replay.GetStats().nTicks, 10u);
+    EXPECT_EQ(replay.GetStats().nChecksums, 5u);
+    EXPECT_EQ(replay.GetStats().nDiverged, 3u);
+    EXPECT_EQ(replay.GetStats().firstDivergence, 5u);
+}
+
+TEST_F(RaceRecordingTest, RejectsOtherFiles)
+{
+    {
+        std::ofstream file(path, std::ios::binary);
+        file << "not a recording";
+    }
+    RaceReplay replay;
+    EXPECT_FALSE(replay.Load(path));
+    EXPECT_TRUE(replay.GetTicks().empty());
+}
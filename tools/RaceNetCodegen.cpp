@@ -0,0 +1,35 @@
+// Turns a network exported by RaceNet::export_tofile into a C++ source that registers an unrolled evaluate for it with
+// CompiledRaceNets. Run by the build over resources/racenets, the network is registered under its file name without the extension.
+//   RaceNetCodegen <network.net> <output.cpp>
+
+#include <fstream>
+#include <iostream>
+#include <boost/filesystem.hpp>
+
+#include "../src/RaceNet/RaceNet.h"
+
+int main(int argc, char **argv)
+{
+    if (argc != 3)
+    {
+        std::cerr << "Usage: RaceNetCodegen <network.net> <output.cpp>" << std::endl;
+        return 1;
+    }
+    boost::filesystem::path networkPath(argv[1]);
+    if (!boost::filesystem::exists(networkPath))
+    {
+        std::cerr << "Network " << networkPath << " doesn't exist" << std::endl;
+        return 1;
+    }
+
+    RaceNet raceNet;
+    raceNet.import_fromfile(networkPath.string());
+
+    std::ofstream out(argv[2]);
+    if (!raceNet.export_tocpp(networkPath.stem().string(), out))
+    {
+        std::cerr << "Network " << networkPath << " is recurrent, only non recurrent networks can be compiled" << std::endl;
+        return 1;
+    }
+    return out.good() ? 0 : 1;
+}